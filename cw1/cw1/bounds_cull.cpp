@@ -0,0 +1,319 @@
+#include "bounds_cull.hpp"
+
+#include <limits>
+#include <chrono>
+#include <random>
+#include <iterator>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define CW1_CULL_AVX2_ 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define CW1_CULL_SSE2_ 1
+#endif
+
+namespace
+{
+	constexpr std::size_t kBenchmarkRuns = 5;
+
+	// Relative margin around the tests' boundaries, within which the kernels
+	// may disagree; a few float roundings, as from fused multiply-adds
+	constexpr double kBoundaryTolerance = 1e-5;
+
+	bool sphere_visible_( BoundsSoA const& aBounds, std::size_t aIndex, Frustum const& aFrustum, glm::vec3 const& aCameraPos,
+		float aPixelScale, float aMinPixels ) noexcept
+	{
+		glm::vec3 const center( aBounds.centerX[aIndex], aBounds.centerY[aIndex], aBounds.centerZ[aIndex] );
+		float const radius = aBounds.radius[aIndex];
+
+		for( auto const& plane : aFrustum.planes )
+		{
+			// Same operation order as the SIMD kernels
+			if( plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius )
+				return false;
+		}
+
+		// Projected diameter 2*r*scale/d below aMinPixels, without the square
+		// root: (2*r*scale)^2 < aMinPixels^2 * d^2
+		auto const d = center - aCameraPos;
+		float const dist2 = d.x * d.x + d.y * d.y + d.z * d.z;
+		float const size = 2.f * radius * aPixelScale;
+		return !(size * size < aMinPixels * aMinPixels * dist2);
+	}
+
+	// Whether the sphere is so close to a plane or to the size threshold
+	// that rounding decides which side it is on
+	bool sphere_on_boundary_( BoundsSoA const& aBounds, std::size_t aIndex, Frustum const& aFrustum, glm::vec3 const& aCameraPos,
+		float aPixelScale, float aMinPixels ) noexcept
+	{
+		double const x = aBounds.centerX[aIndex], y = aBounds.centerY[aIndex], z = aBounds.centerZ[aIndex];
+		double const r = aBounds.radius[aIndex];
+
+		for( auto const& plane : aFrustum.planes )
+		{
+			double const terms[5] = { plane.x * x, plane.y * y, plane.z * z, plane.w, r };
+			double sum = 0.0, magnitude = 0.0;
+			for( auto const term : terms )
+			{
+				sum += term;
+				magnitude += std::abs( term );
+			}
+
+			if( std::abs( sum ) <= kBoundaryTolerance * magnitude )
+				return true;
+		}
+
+		double const dx = x - aCameraPos.x, dy = y - aCameraPos.y, dz = z - aCameraPos.z;
+		double const size = 2.0 * r * aPixelScale;
+		double const a = size * size, b = double(aMinPixels) * aMinPixels * (dx*dx + dy*dy + dz*dz);
+		return std::abs( a - b ) <= kBoundaryTolerance * std::max( a, b );
+	}
+
+	void pad_( AlignedFloats& aArray, std::size_t aCount )
+	{
+		aArray.resize( (aCount + kBoundsLanes - 1) / kBoundsLanes * kBoundsLanes, 0.f );
+	}
+}
+
+MeshBounds compute_mesh_bounds( ModelData const& aModel, MeshInfo const& aMesh )
+{
+	assert( aMesh.vertexStartIndex + aMesh.numberOfVertices <= aModel.vertexPositions.size() );
+
+	MeshBounds ret{};
+	if( 0 == aMesh.numberOfVertices )
+		return ret;
+
+	auto const* positions = aModel.vertexPositions.data() + aMesh.vertexStartIndex;
+
+	ret.aabbMin = glm::vec3( std::numeric_limits<float>::max() );
+	ret.aabbMax = glm::vec3( -std::numeric_limits<float>::max() );
+	for( std::size_t i = 0; i < aMesh.numberOfVertices; ++i )
+	{
+		ret.aabbMin = glm::min( ret.aabbMin, positions[i] );
+		ret.aabbMax = glm::max( ret.aabbMax, positions[i] );
+	}
+
+	// Centered on the AABB; tighter than the AABB's circumsphere for most
+	// shapes
+	ret.center = (ret.aabbMin + ret.aabbMax) * 0.5f;
+
+	float radius2 = 0.f;
+	for( std::size_t i = 0; i < aMesh.numberOfVertices; ++i )
+	{
+		auto const d = positions[i] - ret.center;
+		radius2 = std::max( radius2, glm::dot( d, d ) );
+	}
+
+	ret.radius = std::sqrt( radius2 );
+	return ret;
+}
+
+void BoundsSoA::push_back( glm::vec3 const& aCenter, float aRadius )
+{
+	// Padding is kept, such that the kernels can always load whole registers
+	centerX.resize( count );
+	centerY.resize( count );
+	centerZ.resize( count );
+	radius.resize( count );
+
+	centerX.emplace_back( aCenter.x );
+	centerY.emplace_back( aCenter.y );
+	centerZ.emplace_back( aCenter.z );
+	radius.emplace_back( aRadius );
+	++count;
+
+	for( auto* array : { &centerX, &centerY, &centerZ, &radius } )
+		pad_( *array, count );
+}
+
+void cull_bounds( BoundsSoA const& aBounds, Frustum const& aFrustum, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels,
+	std::vector<std::uint32_t>& aVisible )
+{
+	assert( aBounds.centerX.size() >= aBounds.count && 0 == aBounds.centerX.size() % kBoundsLanes );
+
+	std::size_t i = 0;
+
+#	if defined(CW1_CULL_AVX2_)
+	{
+		__m256 planes[6][4];
+		for( std::size_t p = 0; p < 6; ++p )
+		{
+			for( std::size_t c = 0; c < 4; ++c )
+				planes[p][c] = _mm256_set1_ps( aFrustum.planes[p][c] );
+		}
+
+		__m256 const camX = _mm256_set1_ps( aCameraPos.x );
+		__m256 const camY = _mm256_set1_ps( aCameraPos.y );
+		__m256 const camZ = _mm256_set1_ps( aCameraPos.z );
+		__m256 const sizeScale = _mm256_set1_ps( 2.f * aPixelScale );
+		__m256 const minPixels2 = _mm256_set1_ps( aMinPixels * aMinPixels );
+		__m256 const signBit = _mm256_set1_ps( -0.f );
+
+		// The arrays are padded to whole registers; lanes past the end are masked
+		for( ; i < aBounds.count; i += 8 )
+		{
+			__m256 const x = _mm256_load_ps( aBounds.centerX.data() + i );
+			__m256 const y = _mm256_load_ps( aBounds.centerY.data() + i );
+			__m256 const z = _mm256_load_ps( aBounds.centerZ.data() + i );
+			__m256 const r = _mm256_load_ps( aBounds.radius.data() + i );
+			__m256 const negR = _mm256_xor_ps( r, signBit );
+
+			// Outside if any plane has the sphere fully behind it
+			__m256 outside = _mm256_setzero_ps();
+			for( std::size_t p = 0; p < 6; ++p )
+			{
+				__m256 dist = _mm256_mul_ps( planes[p][0], x );
+				dist = _mm256_add_ps( dist, _mm256_mul_ps( planes[p][1], y ) );
+				dist = _mm256_add_ps( dist, _mm256_mul_ps( planes[p][2], z ) );
+				dist = _mm256_add_ps( dist, planes[p][3] );
+				outside = _mm256_or_ps( outside, _mm256_cmp_ps( dist, negR, _CMP_LT_OQ ) );
+			}
+
+			__m256 const dx = _mm256_sub_ps( x, camX );
+			__m256 const dy = _mm256_sub_ps( y, camY );
+			__m256 const dz = _mm256_sub_ps( z, camZ );
+			__m256 dist2 = _mm256_mul_ps( dx, dx );
+			dist2 = _mm256_add_ps( dist2, _mm256_mul_ps( dy, dy ) );
+			dist2 = _mm256_add_ps( dist2, _mm256_mul_ps( dz, dz ) );
+
+			__m256 const size = _mm256_mul_ps( r, sizeScale );
+			__m256 const tiny = _mm256_cmp_ps( _mm256_mul_ps( size, size ), _mm256_mul_ps( minPixels2, dist2 ), _CMP_LT_OQ );
+
+			auto const lanes = std::min<std::size_t>( 8, aBounds.count - i );
+			auto const visible = ~_mm256_movemask_ps( _mm256_or_ps( outside, tiny ) ) & ((1 << lanes) - 1);
+			for( std::uint32_t k = 0; visible && k < lanes; ++k )
+			{
+				if( visible & (1 << k) )
+					aVisible.emplace_back( std::uint32_t(i) + k );
+			}
+		}
+	}
+#	elif defined(CW1_CULL_SSE2_)
+	{
+		__m128 planes[6][4];
+		for( std::size_t p = 0; p < 6; ++p )
+		{
+			for( std::size_t c = 0; c < 4; ++c )
+				planes[p][c] = _mm_set1_ps( aFrustum.planes[p][c] );
+		}
+
+		__m128 const camX = _mm_set1_ps( aCameraPos.x );
+		__m128 const camY = _mm_set1_ps( aCameraPos.y );
+		__m128 const camZ = _mm_set1_ps( aCameraPos.z );
+		__m128 const sizeScale = _mm_set1_ps( 2.f * aPixelScale );
+		__m128 const minPixels2 = _mm_set1_ps( aMinPixels * aMinPixels );
+		__m128 const signBit = _mm_set1_ps( -0.f );
+
+		for( ; i < aBounds.count; i += 4 )
+		{
+			__m128 const x = _mm_load_ps( aBounds.centerX.data() + i );
+			__m128 const y = _mm_load_ps( aBounds.centerY.data() + i );
+			__m128 const z = _mm_load_ps( aBounds.centerZ.data() + i );
+			__m128 const r = _mm_load_ps( aBounds.radius.data() + i );
+			__m128 const negR = _mm_xor_ps( r, signBit );
+
+			__m128 outside = _mm_setzero_ps();
+			for( std::size_t p = 0; p < 6; ++p )
+			{
+				__m128 dist = _mm_mul_ps( planes[p][0], x );
+				dist = _mm_add_ps( dist, _mm_mul_ps( planes[p][1], y ) );
+				dist = _mm_add_ps( dist, _mm_mul_ps( planes[p][2], z ) );
+				dist = _mm_add_ps( dist, planes[p][3] );
+				outside = _mm_or_ps( outside, _mm_cmplt_ps( dist, negR ) );
+			}
+
+			__m128 const dx = _mm_sub_ps( x, camX );
+			__m128 const dy = _mm_sub_ps( y, camY );
+			__m128 const dz = _mm_sub_ps( z, camZ );
+			__m128 dist2 = _mm_mul_ps( dx, dx );
+			dist2 = _mm_add_ps( dist2, _mm_mul_ps( dy, dy ) );
+			dist2 = _mm_add_ps( dist2, _mm_mul_ps( dz, dz ) );
+
+			__m128 const size = _mm_mul_ps( r, sizeScale );
+			__m128 const tiny = _mm_cmplt_ps( _mm_mul_ps( size, size ), _mm_mul_ps( minPixels2, dist2 ) );
+
+			auto const lanes = std::min<std::size_t>( 4, aBounds.count - i );
+			auto const visible = ~_mm_movemask_ps( _mm_or_ps( outside, tiny ) ) & ((1 << lanes) - 1);
+			for( std::uint32_t k = 0; visible && k < lanes; ++k )
+			{
+				if( visible & (1 << k) )
+					aVisible.emplace_back( std::uint32_t(i) + k );
+			}
+		}
+	}
+#	endif // ~ AVX2/SSE2
+
+	for( ; i < aBounds.count; ++i )
+	{
+		if( sphere_visible_( aBounds, i, aFrustum, aCameraPos, aPixelScale, aMinPixels ) )
+			aVisible.emplace_back( std::uint32_t(i) );
+	}
+}
+
+void cull_bounds_scalar( BoundsSoA const& aBounds, Frustum const& aFrustum, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels,
+	std::vector<std::uint32_t>& aVisible )
+{
+	for( std::size_t i = 0; i < aBounds.count; ++i )
+	{
+		if( sphere_visible_( aBounds, i, aFrustum, aCameraPos, aPixelScale, aMinPixels ) )
+			aVisible.emplace_back( std::uint32_t(i) );
+	}
+}
+
+BoundsCullBenchmark benchmark_cull_bounds( std::size_t aCount, Frustum const& aFrustum, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels )
+{
+	// Spheres of 0.1 to 10 units within 1000 units of the camera, roughly
+	// like the city's meshes
+	std::mt19937 rng( 42 );
+	std::uniform_real_distribution<float> position( -1000.f, 1000.f );
+	std::uniform_real_distribution<float> logRadius( -1.f, 1.f );
+
+	BoundsSoA bounds;
+	bounds.centerX.reserve( aCount + kBoundsLanes );
+	bounds.centerY.reserve( aCount + kBoundsLanes );
+	bounds.centerZ.reserve( aCount + kBoundsLanes );
+	bounds.radius.reserve( aCount + kBoundsLanes );
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		glm::vec3 const offset( position( rng ), position( rng ), position( rng ) );
+		bounds.push_back( aCameraPos + offset, std::pow( 10.f, logRadius( rng ) ) );
+	}
+
+	BoundsCullBenchmark ret;
+	ret.count = aCount;
+
+	std::vector<std::uint32_t> simd, scalar;
+	simd.reserve( aCount );
+	scalar.reserve( aCount );
+
+	auto const time = [&] ( auto&& aKernel, std::vector<std::uint32_t>& aVisible ) {
+		double best = std::numeric_limits<double>::max();
+		for( std::size_t run = 0; run < kBenchmarkRuns; ++run )
+		{
+			aVisible.clear();
+
+			auto const start = std::chrono::steady_clock::now();
+			aKernel( bounds, aFrustum, aCameraPos, aPixelScale, aMinPixels, aVisible );
+			best = std::min( best, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+		}
+		return best;
+	};
+
+	ret.simdMilliseconds = time( cull_bounds, simd );
+	ret.scalarMilliseconds = time( cull_bounds_scalar, scalar );
+	ret.visible = simd.size();
+
+	// Both lists are in index order
+	std::vector<std::uint32_t> differ;
+	std::set_symmetric_difference( simd.begin(), simd.end(), scalar.begin(), scalar.end(), std::back_inserter( differ ) );
+	ret.identical = std::all_of( differ.begin(), differ.end(), [&] ( std::uint32_t aIndex ) {
+		return sphere_on_boundary_( bounds, aIndex, aFrustum, aCameraPos, aPixelScale, aMinPixels );
+	} );
+
+	return ret;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <new>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+#include "meshlet.hpp"
+
+/* CPU culling of whole meshes.
+ *
+ * compute_mesh_bounds() finds a mesh's AABB and a bounding sphere around
+ * the AABB's center. The spheres of all meshes are kept in a BoundsSoA,
+ * with one array per component, which cull_bounds() tests 8 (AVX2) or 4
+ * (SSE2) at a time against the frustum (see make_frustum()).
+ *
+ * cull_bounds() also rejects small objects, whose projected diameter is
+ * below aMinPixels. aPixelScale converts an object-space length at distance
+ * 1 into pixels (see lod_pixel_scale()); with aMinPixels = 0, only the
+ * frustum is tested. The test uses the distance to the sphere's center, so
+ * nothing is rejected once the camera is inside the sphere (unless the
+ * sphere is tiny compared to the pixel scale).
+ *
+ * cull_bounds_scalar() is the reference implementation, with the same
+ * results up to rounding: the compiler may fuse multiplies and adds in
+ * either one. benchmark_cull_bounds() compares the two on random spheres.
+ */
+struct MeshBounds
+{
+	glm::vec3 aabbMin;
+	glm::vec3 aabbMax;
+
+	glm::vec3 center;
+	float radius;
+};
+
+MeshBounds compute_mesh_bounds( ModelData const& aModel, MeshInfo const& aMesh );
+
+
+// Arrays for the SIMD kernel
+constexpr std::size_t kBoundsAlignment = 32; // bytes; one AVX register
+constexpr std::size_t kBoundsLanes = 8; // arrays are padded to a multiple of this
+
+template< typename tType, std::size_t tAlignment >
+struct AlignedAllocator
+{
+	using value_type = tType;
+
+	template< typename tOther >
+	struct rebind { using other = AlignedAllocator<tOther,tAlignment>; };
+
+	AlignedAllocator() noexcept = default;
+	template< typename tOther >
+	AlignedAllocator( AlignedAllocator<tOther,tAlignment> const& ) noexcept {}
+
+	tType* allocate( std::size_t aCount )
+	{
+		return static_cast<tType*>(::operator new( aCount * sizeof(tType), std::align_val_t(tAlignment) ));
+	}
+	void deallocate( tType* aPtr, std::size_t ) noexcept
+	{
+		::operator delete( aPtr, std::align_val_t(tAlignment) );
+	}
+
+	template< typename tOther >
+	bool operator== (AlignedAllocator<tOther,tAlignment> const&) const noexcept { return true; }
+	template< typename tOther >
+	bool operator!= (AlignedAllocator<tOther,tAlignment> const&) const noexcept { return false; }
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float,kBoundsAlignment>>;
+
+struct BoundsSoA
+{
+	// Sphere i is (centerX[i], centerY[i], centerZ[i]) with radius[i], for i
+	// in [0,count). The padding after count is zero.
+	AlignedFloats centerX, centerY, centerZ, radius;
+	std::size_t count = 0;
+
+	void push_back( glm::vec3 const& aCenter, float aRadius );
+};
+
+// Appends the indices of the visible spheres to aVisible, in ascending order
+void cull_bounds( BoundsSoA const&, Frustum const&, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels,
+	std::vector<std::uint32_t>& aVisible );
+void cull_bounds_scalar( BoundsSoA const&, Frustum const&, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels,
+	std::vector<std::uint32_t>& aVisible );
+
+
+// Microbenchmark over aCount random spheres around aCameraPos; times are
+// the best of a few runs
+struct BoundsCullBenchmark
+{
+	std::size_t count = 0;
+	std::size_t visible = 0;
+	double simdMilliseconds = 0.0;
+	double scalarMilliseconds = 0.0;
+	bool identical = true; // same spheres, up to ones on a test's boundary
+};
+
+BoundsCullBenchmark benchmark_cull_bounds( std::size_t aCount, Frustum const&, glm::vec3 const& aCameraPos, float aPixelScale, float aMinPixels );
@@ -0,0 +1,287 @@
+#include "depth_pyramid.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr VkFormat kPyramidFormat = VK_FORMAT_R32G32_SFLOAT; // min, max; storage support is mandatory
+	constexpr std::uint32_t kWorkgroupSize = 8; // must match shaders/depth_pyramid.comp
+
+	// Must match shaders/depth_pyramid.comp
+	struct ReduceParams_
+	{
+		std::int32_t srcWidth, srcHeight;
+		std::int32_t dstWidth, dstHeight;
+		std::uint32_t fromDepth;
+	};
+}
+
+DepthPyramid::DepthPyramid( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, VkImageView aDepthView,
+	VkExtent2D aDepthExtent, char const* aShaderPath )
+	: mContext( &aContext )
+	, mDepthExtent( aDepthExtent )
+{
+	assert( aDepthExtent.width > 0 && aDepthExtent.height > 0 );
+
+	// Levels, halving (rounded up) down to 1x1
+	VkExtent2D extent = aDepthExtent;
+	do
+	{
+		extent.width = (extent.width + 1) / 2;
+		extent.height = (extent.height + 1) / 2;
+		mLevelExtents.emplace_back( extent );
+	} while( extent.width > 1 || extent.height > 1 );
+
+	auto const levels = std::uint32_t(mLevelExtents.size());
+
+	// Image
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = kPyramidFormat;
+	imageInfo.extent = VkExtent3D{ mLevelExtents[0].width, mLevelExtents[0].height, 1 };
+	imageInfo.mipLevels = levels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to allocate depth pyramid\nvmaCreateImage() returned %s", lut::to_string(res).c_str() );
+
+	mImage = lut::Image( aAllocator.allocator, image, allocation );
+
+	// Views: all levels for sampling, and one per level for writing
+	auto const create_view = [&] ( std::uint32_t aBaseLevel, std::uint32_t aLevels ) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = mImage.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = kPyramidFormat;
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, aBaseLevel, aLevels, 0, 1 };
+
+		VkImageView view = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImageView( aContext.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+			throw lut::Error( "Unable to create depth pyramid view\nvkCreateImageView() returned %s", lut::to_string(res).c_str() );
+
+		return lut::ImageView( aContext.device, view );
+	};
+
+	mView = create_view( 0, levels );
+	for( std::uint32_t level = 0; level < levels; ++level )
+		mLevelViews.emplace_back( create_view( level, 1 ) );
+
+	// Texels are fetched exactly; the sampler only has to exist. The same one
+	// reads the depth buffer.
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = float(levels);
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	if( auto const res = vkCreateSampler( aContext.device, &samplerInfo, nullptr, &sampler ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create depth pyramid sampler\nvkCreateSampler() returned %s", lut::to_string(res).c_str() );
+
+	mSampler = lut::Sampler( aContext.device, sampler );
+
+	// Descriptor set layout: depth buffer, source level, destination level
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	for( std::uint32_t i = 1; i < 3; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create depth pyramid descriptor set layout\nvkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str() );
+
+	mLayout = lut::DescriptorSetLayout( aContext.device, layout );
+
+	// Pool; the pyramid is recreated with the swapchain, so it has its own
+	VkDescriptorPoolSize const poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levels },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * levels }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = levels;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorPool( aContext.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create depth pyramid descriptor pool\nvkCreateDescriptorPool() returned %s", lut::to_string(res).c_str() );
+
+	mPool = lut::DescriptorPool( aContext.device, pool );
+
+	// One set per level; level 0 reads the depth buffer, and does not use its
+	// source image
+	for( std::uint32_t level = 0; level < levels; ++level )
+	{
+		auto const set = mSets.emplace_back( lut::alloc_desc_set( aContext, mPool.handle, mLayout.handle ) );
+
+		VkDescriptorImageInfo depthInfo{};
+		depthInfo.sampler = mSampler.handle;
+		depthInfo.imageView = aDepthView;
+		depthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkDescriptorImageInfo srcInfo{};
+		srcInfo.imageView = mLevelViews[level > 0 ? level-1 : 0].handle;
+		srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo dstInfo{};
+		dstInfo.imageView = mLevelViews[level].handle;
+		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo const* infos[3] = { &depthInfo, &srcInfo, &dstInfo };
+
+		VkWriteDescriptorSet desc[3]{};
+		for( std::uint32_t i = 0; i < 3; ++i )
+		{
+			desc[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[i].dstSet = set;
+			desc[i].dstBinding = i;
+			desc[i].descriptorType = bindings[i].descriptorType;
+			desc[i].descriptorCount = 1;
+			desc[i].pImageInfo = infos[i];
+		}
+
+		vkUpdateDescriptorSets( aContext.device, 3, desc, 0, nullptr );
+	}
+
+	// Pipeline
+	VkPushConstantRange pushConstants{};
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstants.size = sizeof(ReduceParams_);
+
+	VkPipelineLayoutCreateInfo pipeLayoutInfo{};
+	pipeLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeLayoutInfo.setLayoutCount = 1;
+	pipeLayoutInfo.pSetLayouts = &mLayout.handle;
+	pipeLayoutInfo.pushConstantRangeCount = 1;
+	pipeLayoutInfo.pPushConstantRanges = &pushConstants;
+
+	VkPipelineLayout pipeLayout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &pipeLayoutInfo, nullptr, &pipeLayout ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create depth pyramid pipeline layout\nvkCreatePipelineLayout() returned %s", lut::to_string(res).c_str() );
+
+	mPipeLayout = lut::PipelineLayout( aContext.device, pipeLayout );
+
+	auto const shader = lut::load_shader_module( aContext, aShaderPath );
+
+	VkComputePipelineCreateInfo pipeInfo{};
+	pipeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeInfo.stage.module = shader.handle;
+	pipeInfo.stage.pName = "main";
+	pipeInfo.layout = mPipeLayout.handle;
+
+	VkPipeline pipe = VK_NULL_HANDLE;
+	if( auto const res = vkCreateComputePipelines( aContext.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create depth pyramid pipeline\nvkCreateComputePipelines() returned %s", lut::to_string(res).c_str() );
+
+	mPipe = lut::Pipeline( aContext.device, pipe );
+}
+
+void DepthPyramid::record_build( VkCommandBuffer aCmdBuff ) const
+{
+	auto const levels = std::uint32_t(mLevelExtents.size());
+	VkImageSubresourceRange const allLevels{ VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1 };
+
+	// The previous contents are not needed; earlier culling passes must be
+	// done reading them
+	lut::image_barrier( aCmdBuff, mImage.image,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		allLevels
+	);
+
+	vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, mPipe.handle );
+
+	VkExtent2D src = mDepthExtent;
+	for( std::uint32_t level = 0; level < levels; ++level )
+	{
+		auto const dst = mLevelExtents[level];
+
+		ReduceParams_ params{};
+		params.srcWidth = std::int32_t(src.width);
+		params.srcHeight = std::int32_t(src.height);
+		params.dstWidth = std::int32_t(dst.width);
+		params.dstHeight = std::int32_t(dst.height);
+		params.fromDepth = 0 == level;
+
+		vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeLayout.handle, 0, 1, &mSets[level], 0, nullptr );
+		vkCmdPushConstants( aCmdBuff, mPipeLayout.handle, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params );
+		vkCmdDispatch( aCmdBuff, (dst.width + kWorkgroupSize - 1) / kWorkgroupSize, (dst.height + kWorkgroupSize - 1) / kWorkgroupSize, 1 );
+
+		// The next level reads this one; the culling pass reads them all
+		lut::image_barrier( aCmdBuff, mImage.image,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 }
+		);
+
+		src = dst;
+	}
+}
+
+VkImageView DepthPyramid::view() const noexcept
+{
+	return mView.handle;
+}
+
+VkSampler DepthPyramid::sampler() const noexcept
+{
+	return mSampler.handle;
+}
+
+VkExtent2D DepthPyramid::depth_extent() const noexcept
+{
+	return mDepthExtent;
+}
+
+std::uint32_t DepthPyramid::level_count() const noexcept
+{
+	return std::uint32_t(mLevelExtents.size());
+}
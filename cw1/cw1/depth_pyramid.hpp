@@ -0,0 +1,72 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstdint>
+
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* Hierarchical depth (Hi-Z) pyramid for occlusion culling.
+ *
+ * record_build() reduces the depth buffer into a mip chain with the minimum
+ * (r) and maximum (g) depth of each texel's footprint, in a compute shader
+ * (shaders/depth_pyramid.comp). Level 0 has half the depth buffer's
+ * resolution, rounded up, and so on down to 1x1. Texel j of level k thus
+ * covers depth pixels [j*2^(k+1), (j+1)*2^(k+1)), which is what the
+ * occlusion test in shaders/cull.comp relies on.
+ *
+ * The pyramid stays in VK_IMAGE_LAYOUT_GENERAL and is rebuilt from scratch
+ * each time. It refers to the depth buffer's view, and must be recreated
+ * with it.
+ */
+class DepthPyramid
+{
+	public:
+		// The depth buffer must be usable as a sampled image
+		DepthPyramid(
+			labutils::VulkanContext const&,
+			labutils::Allocator const&,
+			VkImageView aDepthView,
+			VkExtent2D aDepthExtent,
+			char const* aShaderPath
+		);
+
+		DepthPyramid( DepthPyramid const& ) = delete;
+		DepthPyramid& operator= (DepthPyramid const&) = delete;
+
+	public:
+		// Record outside a render pass, once the depth buffer has been written
+		// and is in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL. The
+		// pyramid is then ready for compute shader reads.
+		void record_build( VkCommandBuffer ) const;
+
+		// All levels, for texelFetch() through sampler()
+		VkImageView view() const noexcept;
+		VkSampler sampler() const noexcept;
+
+		VkExtent2D depth_extent() const noexcept;
+		std::uint32_t level_count() const noexcept;
+
+	private:
+		labutils::VulkanContext const* mContext;
+		VkExtent2D mDepthExtent;
+
+		std::vector<VkExtent2D> mLevelExtents;
+
+		labutils::Image mImage;
+		labutils::ImageView mView;
+		std::vector<labutils::ImageView> mLevelViews;
+		labutils::Sampler mSampler;
+
+		labutils::DescriptorSetLayout mLayout;
+		labutils::DescriptorPool mPool;
+		std::vector<VkDescriptorSet> mSets; // per level
+
+		labutils::PipelineLayout mPipeLayout;
+		labutils::Pipeline mPipe;
+};
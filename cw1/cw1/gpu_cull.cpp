@@ -0,0 +1,513 @@
+#include "gpu_cull.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include "meshlet.hpp"
+#include "mesh_lod.hpp"
+#include "depth_pyramid.hpp"
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kNone = ~std::uint32_t(0);
+	constexpr std::uint32_t kWorkgroupSize = 64; // must match shaders/cull.comp
+
+	// Layouts must match shaders/cull.comp (std430)
+	enum class ItemKind_ : std::uint32_t
+	{
+		range, // mesh or meshlet
+		group  // LOD group, drawn at its selected level unless that is 0
+	};
+
+	struct CullItem_
+	{
+		glm::vec4 sphere; // xyz = center, w = radius; < 0 is always visible
+		glm::vec4 coneApex; // w = cutoff; >= 1 disables the cone test
+		glm::vec4 coneAxis;
+
+		std::uint32_t firstIndex; // in the scene's index buffer of the pack's type
+		std::uint32_t indexCount;
+		std::int32_t vertexOffset;
+		std::uint32_t drawIndex;
+
+		std::uint32_t batch;
+		std::uint32_t group; // in the group buffer, or kNone
+		ItemKind_ kind;
+		std::uint32_t pad;
+	};
+
+	static_assert( sizeof(CullItem_) == 80, "CullItem_ must match the std430 layout in cull.comp" );
+
+	struct CullGroup_
+	{
+		glm::vec4 sphere;
+		glm::uvec4 info; // x = levelCount
+		glm::uvec4 levels[kMaxLodLevels]; // firstIndex (absolute), indexCount, error (float bits)
+	};
+
+	static_assert( sizeof(CullGroup_) == 32 + 16*kMaxLodLevels, "CullGroup_ must match the std430 layout in cull.comp" );
+
+	// Uniform buffer (std140); too large for push constants
+	struct CullParams_
+	{
+		glm::vec4 planes[6];
+		glm::mat4 camera;
+		glm::vec4 cameraPos; // w = LOD pixel scale
+		glm::vec4 projection; // P[0][0], P[1][1], P[2][2], P[3][2]
+		glm::vec4 depth; // xy = depth buffer size, z = pyramid levels
+
+		std::uint32_t itemCount;
+		std::uint32_t batchCount;
+		float lodPixelError;
+		std::uint32_t pad;
+	};
+
+	static_assert( sizeof(CullParams_) == 224, "CullParams_ must match the std140 layout in cull.comp" );
+
+	// Commands and counts of a pass
+	std::uint32_t phase_of_( GpuCullPass aPass )
+	{
+		return GpuCullPass::disoccluded == aPass ? 1 : 0;
+	}
+
+	template< typename tData >
+	lut::Buffer upload_( lut::Allocator const& aAllocator, lut::UploadQueue& aQueue, std::vector<tData> const& aData )
+	{
+		VkDeviceSize const bytes = std::max<std::size_t>( 1, aData.size() ) * sizeof(tData);
+
+		auto buffer = lut::create_buffer(
+			aAllocator,
+			bytes,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+
+		auto const staging = aQueue.stage( bytes );
+		std::memset( staging.data, 0, std::size_t(bytes) );
+		std::memcpy( staging.data, aData.data(), aData.size() * sizeof(tData) );
+		aQueue.copy_to_buffer( staging, buffer.buffer, bytes, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT );
+
+		return buffer;
+	}
+}
+
+GpuCuller::GpuCuller( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, lut::UploadQueue& aQueue, VkDescriptorPool aPool,
+	std::vector<ModelBufferPack> const& aPacks, std::vector<std::uint32_t> const& aPackBatches, std::uint32_t aBatchCount,
+	std::uint32_t aFrameSlots, char const* aShaderPath )
+	: mContext( &aContext )
+	, mAllocator( &aAllocator )
+	, mBatchCount( aBatchCount )
+{
+	assert( aContext.drawIndirectCount && aContext.multiDrawIndirect );
+	assert( aPackBatches.size() == aPacks.size() );
+	assert( aFrameSlots > 0 );
+
+	// Cull items
+	std::vector<CullItem_> items;
+	std::vector<CullGroup_> groups;
+
+	auto const range_item = [&] ( std::uint32_t aPack, glm::vec4 const& aSphere, std::uint32_t aFirstIndex, std::uint32_t aIndexCount ) -> CullItem_& {
+		auto const& pack = aPacks[aPack];
+
+		auto& item = items.emplace_back();
+		item.sphere = aSphere;
+		item.coneApex = glm::vec4( 0.f, 0.f, 0.f, 1.f );
+		item.firstIndex = pack.firstIndex + aFirstIndex;
+		item.indexCount = aIndexCount;
+		item.vertexOffset = pack.vertexOffset;
+		item.drawIndex = aPack;
+		item.batch = aPackBatches[aPack];
+		item.group = kNone;
+		item.kind = ItemKind_::range;
+		return item;
+	};
+
+	auto const meshlet_item = [&] ( std::uint32_t aPack, std::size_t aMeshlet, std::uint32_t aGroup ) {
+		auto const& meshlet = aPacks[aPack].meshlets[aMeshlet];
+		auto const& bounds = aPacks[aPack].meshletBounds[aMeshlet];
+
+		auto& item = range_item( aPack, glm::vec4( bounds.center, bounds.radius ), meshlet.firstIndex, meshlet.triangleCount * 3 );
+		item.coneApex = glm::vec4( bounds.coneApex, bounds.coneCutoff );
+		item.coneAxis = glm::vec4( bounds.coneAxis, 0.f );
+		item.group = aGroup;
+	};
+
+	for( std::uint32_t i = 0; i < aPacks.size(); ++i )
+	{
+		auto const& pack = aPacks[i];
+
+		if( pack.meshlets.empty() )
+		{
+			// No bounds; drawn whole, as on the CPU
+			range_item( i, glm::vec4( 0.f, 0.f, 0.f, -1.f ), 0, pack.indexCount );
+		}
+		else if( pack.lodGroups.empty() )
+		{
+			for( std::size_t k = 0; k < pack.meshlets.size(); ++k )
+				meshlet_item( i, k, kNone );
+		}
+		else
+		{
+			for( auto const& group : pack.lodGroups )
+			{
+				auto const index = std::uint32_t(groups.size());
+
+				auto& cullGroup = groups.emplace_back();
+				cullGroup.sphere = glm::vec4( group.center, group.radius );
+				cullGroup.info = glm::uvec4( group.levelCount, 0, 0, 0 );
+				for( std::uint32_t level = 0; level < group.levelCount; ++level )
+				{
+					auto const& lod = group.levels[level];
+					std::uint32_t error;
+					std::memcpy( &error, &lod.error, sizeof(error) );
+					cullGroup.levels[level] = glm::uvec4( pack.firstIndex + lod.firstIndex, lod.indexCount, error, 0 );
+				}
+
+				// The group draws its coarser levels; at full detail, its meshlets draw themselves
+				auto& item = range_item( i, cullGroup.sphere, 0, 0 );
+				item.group = index;
+				item.kind = ItemKind_::group;
+
+				for( std::uint32_t k = 0; k < group.meshletCount; ++k )
+					meshlet_item( i, pack.lodMeshlets[group.meshletStart + k], index );
+			}
+		}
+	}
+
+	mItemCount = std::uint32_t(items.size());
+
+	// Each batch has room for all of its items
+	mBatchCapacity.assign( mBatchCount, 0 );
+	for( auto const& item : items )
+	{
+		assert( item.batch < mBatchCount );
+		++mBatchCapacity[item.batch];
+	}
+
+	mBatchFirst.assign( mBatchCount, 0 );
+	for( std::uint32_t i = 1; i < mBatchCount; ++i )
+		mBatchFirst[i] = mBatchFirst[i-1] + mBatchCapacity[i-1];
+
+	mItems = upload_( aAllocator, aQueue, items );
+	mGroups = upload_( aAllocator, aQueue, groups );
+	mBatches = upload_( aAllocator, aQueue, mBatchFirst );
+
+	// Nothing was drawn before the first frame
+	mVisibility = upload_( aAllocator, aQueue, std::vector<std::uint32_t>( mItemCount, 0 ) );
+
+	// Descriptor set layout: items, groups, batch offsets, commands, counts,
+	// visibility, depth pyramid, parameters
+	VkDescriptorSetLayoutBinding bindings[8]{};
+	for( std::uint32_t i = 0; i < 8; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 8;
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create culling descriptor set layout\nvkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str() );
+
+	mLayout = lut::DescriptorSetLayout( aContext.device, layout );
+
+	// Pipeline
+	VkPushConstantRange pushConstants{};
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstants.size = sizeof(GpuCullPass);
+
+	VkPipelineLayoutCreateInfo pipeLayoutInfo{};
+	pipeLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeLayoutInfo.setLayoutCount = 1;
+	pipeLayoutInfo.pSetLayouts = &mLayout.handle;
+	pipeLayoutInfo.pushConstantRangeCount = 1;
+	pipeLayoutInfo.pPushConstantRanges = &pushConstants;
+
+	VkPipelineLayout pipeLayout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &pipeLayoutInfo, nullptr, &pipeLayout ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create culling pipeline layout\nvkCreatePipelineLayout() returned %s", lut::to_string(res).c_str() );
+
+	mPipeLayout = lut::PipelineLayout( aContext.device, pipeLayout );
+
+	auto const shader = lut::load_shader_module( aContext, aShaderPath );
+
+	VkComputePipelineCreateInfo pipeInfo{};
+	pipeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeInfo.stage.module = shader.handle;
+	pipeInfo.stage.pName = "main";
+	pipeInfo.layout = mPipeLayout.handle;
+
+	VkPipeline pipe = VK_NULL_HANDLE;
+	if( auto const res = vkCreateComputePipelines( aContext.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to create culling pipeline\nvkCreateComputePipelines() returned %s", lut::to_string(res).c_str() );
+
+	mPipe = lut::Pipeline( aContext.device, pipe );
+
+	// Per-slot commands and counts, for both phases
+	VkDeviceSize const commandBytes = 2 * std::max<VkDeviceSize>( 1, mItemCount ) * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize const countBytes = 2 * (mBatchCount + 2) * sizeof(std::uint32_t);
+
+	mSlots.resize( aFrameSlots );
+	for( auto& slot : mSlots )
+	{
+		slot.commands = lut::create_buffer(
+			aAllocator,
+			commandBytes,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+		slot.counts = lut::create_buffer(
+			aAllocator,
+			countBytes,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+		slot.params = lut::create_buffer(
+			aAllocator,
+			sizeof(CullParams_),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+		slot.readback = lut::create_buffer(
+			aAllocator,
+			countBytes,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_TO_CPU,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT
+		);
+		slot.readbackData = static_cast<std::uint32_t const*>(lut::mapped_pointer( aAllocator, slot.readback ));
+		assert( slot.readbackData );
+
+		slot.set = lut::alloc_desc_set( aContext, aPool, mLayout.handle );
+
+		// The depth pyramid follows below, and in set_depth_pyramid()
+		VkBuffer const buffers[7] = { mItems.buffer, mGroups.buffer, mBatches.buffer, slot.commands.buffer, slot.counts.buffer,
+			mVisibility.buffer, slot.params.buffer };
+		std::uint32_t const bufferBindings[7] = { 0, 1, 2, 3, 4, 5, 7 };
+
+		VkDescriptorBufferInfo bufferInfos[7]{};
+		VkWriteDescriptorSet desc[7]{};
+		for( std::uint32_t i = 0; i < 7; ++i )
+		{
+			bufferInfos[i].buffer = buffers[i];
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+
+			desc[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc[i].dstSet = slot.set;
+			desc[i].dstBinding = bufferBindings[i];
+			desc[i].descriptorType = bindings[bufferBindings[i]].descriptorType;
+			desc[i].descriptorCount = 1;
+			desc[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets( aContext.device, 7, desc, 0, nullptr );
+	}
+
+	// Without occlusion culling there is no pyramid, but binding 6 must still
+	// hold a valid image. A 1x1 one does; GpuCullPass::all never samples it.
+	mDummyDepth = lut::create_image_texture2d( aAllocator, 1, 1, VK_FORMAT_R32_SFLOAT );
+	mDummyDepthView = lut::create_image_view_texture2d( aContext, mDummyDepth.image, VK_FORMAT_R32_SFLOAT );
+	mDummySampler = lut::create_default_sampler( aContext, VK_FALSE );
+
+	float const farthest = 1.f;
+	auto const staging = aQueue.stage( sizeof(farthest) );
+	std::memcpy( staging.data, &farthest, sizeof(farthest) );
+
+	VkBufferImageCopy copy{};
+	copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copy.imageExtent = VkExtent3D{ 1, 1, 1 };
+	aQueue.copy_to_image( staging, mDummyDepth.image, 1, { copy } );
+
+	bind_depth_( mDummyDepthView.handle, mDummySampler.handle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+}
+
+void GpuCuller::set_depth_pyramid( DepthPyramid const& aPyramid )
+{
+	mDepthExtent = aPyramid.depth_extent();
+	mPyramidLevels = aPyramid.level_count();
+
+	bind_depth_( aPyramid.view(), aPyramid.sampler(), VK_IMAGE_LAYOUT_GENERAL );
+}
+
+void GpuCuller::bind_depth_( VkImageView aView, VkSampler aSampler, VkImageLayout aLayout )
+{
+	for( auto& slot : mSlots )
+	{
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = aSampler;
+		imageInfo.imageView = aView;
+		imageInfo.imageLayout = aLayout;
+
+		VkWriteDescriptorSet desc{};
+		desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc.dstSet = slot.set;
+		desc.dstBinding = 6;
+		desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		desc.descriptorCount = 1;
+		desc.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets( mContext->device, 1, &desc, 0, nullptr );
+	}
+}
+
+void GpuCuller::record_cull( VkCommandBuffer aCmdBuff, std::uint32_t aSlot, GpuCullPass aPass, glm::mat4 const& aCamera,
+	glm::mat4 const& aProjection, glm::vec3 const& aCameraPos, float aLodPixelScale, float aLodPixelError )
+{
+	assert( aSlot < mSlots.size() );
+	assert( GpuCullPass::all == aPass || mPyramidLevels > 0 );
+	auto const& slot = mSlots[aSlot];
+
+	// The first pass of the frame resets the counts of both phases and sets
+	// the parameters. The slot's previous frame has completed, so neither is
+	// read any longer.
+	if( GpuCullPass::disoccluded != aPass )
+	{
+		vkCmdFillBuffer( aCmdBuff, slot.counts.buffer, 0, VK_WHOLE_SIZE, 0 );
+
+		Frustum const frustum = make_frustum( aProjection * aCamera );
+
+		CullParams_ params{};
+		for( std::size_t i = 0; i < 6; ++i )
+			params.planes[i] = frustum.planes[i];
+		params.camera = aCamera;
+		params.cameraPos = glm::vec4( aCameraPos, aLodPixelScale );
+		params.projection = glm::vec4( aProjection[0][0], aProjection[1][1], aProjection[2][2], aProjection[3][2] );
+		params.depth = glm::vec4( float(mDepthExtent.width), float(mDepthExtent.height), float(mPyramidLevels), 0.f );
+		params.itemCount = mItemCount;
+		params.batchCount = mBatchCount;
+		params.lodPixelError = aLodPixelError;
+
+		vkCmdUpdateBuffer( aCmdBuff, slot.params.buffer, 0, sizeof(params), &params );
+
+		lut::buffer_barrier( aCmdBuff, slot.counts.buffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		);
+		lut::buffer_barrier( aCmdBuff, slot.params.buffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_UNIFORM_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		);
+	}
+
+	// The second phase writes the visibility that the next frame's first
+	// phase reads
+	lut::buffer_barrier( aCmdBuff, mVisibility.buffer,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+	);
+
+	vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, mPipe.handle );
+	vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeLayout.handle, 0, 1, &slot.set, 0, nullptr );
+	vkCmdPushConstants( aCmdBuff, mPipeLayout.handle, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(aPass), &aPass );
+	vkCmdDispatch( aCmdBuff, (mItemCount + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1 );
+
+	// The commands and counts are read by the draws, and the counts are
+	// copied back after the render pass. The phases write separate ranges.
+	for( auto const buffer : { slot.commands.buffer, slot.counts.buffer } )
+	{
+		lut::buffer_barrier( aCmdBuff, buffer,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT
+		);
+	}
+}
+
+void GpuCuller::record_draw( VkCommandBuffer aCmdBuff, std::uint32_t aSlot, GpuCullPass aPass, std::uint32_t aBatch ) const
+{
+	assert( aSlot < mSlots.size() && aBatch < mBatchCount );
+	auto const& slot = mSlots[aSlot];
+
+	if( 0 == mBatchCapacity[aBatch] )
+		return;
+
+	auto const phase = phase_of_( aPass );
+	auto const firstCommand = phase * mItemCount + mBatchFirst[aBatch];
+	auto const countIndex = phase * (mBatchCount + 2) + aBatch;
+
+	vkCmdDrawIndexedIndirectCountKHR( aCmdBuff,
+		slot.commands.buffer, firstCommand * sizeof(VkDrawIndexedIndirectCommand),
+		slot.counts.buffer, countIndex * sizeof(std::uint32_t),
+		mBatchCapacity[aBatch], sizeof(VkDrawIndexedIndirectCommand)
+	);
+}
+
+void GpuCuller::record_readback( VkCommandBuffer aCmdBuff, std::uint32_t aSlot )
+{
+	assert( aSlot < mSlots.size() );
+	auto& slot = mSlots[aSlot];
+
+	VkBufferCopy copy{};
+	copy.size = 2 * (mBatchCount + 2) * sizeof(std::uint32_t);
+	vkCmdCopyBuffer( aCmdBuff, slot.counts.buffer, slot.readback.buffer, 1, &copy );
+
+	lut::buffer_barrier( aCmdBuff, slot.readback.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_HOST_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT
+	);
+
+	slot.recorded = true;
+}
+
+GpuCullStats GpuCuller::stats( std::uint32_t aSlot ) const
+{
+	assert( aSlot < mSlots.size() );
+	auto const& slot = mSlots[aSlot];
+
+	GpuCullStats ret;
+	ret.items = mItemCount;
+	if( !slot.recorded )
+		return ret;
+
+	if( auto const res = vmaInvalidateAllocation( mAllocator->allocator, slot.readback.allocation, 0, VK_WHOLE_SIZE ); VK_SUCCESS != res )
+		throw lut::Error( "Unable to invalidate culling readback buffer\nvmaInvalidateAllocation() returned %s", lut::to_string(res).c_str() );
+
+	// Without occlusion culling, the second phase's counts stay 0
+	for( std::uint32_t phase = 0; phase < 2; ++phase )
+	{
+		auto const* counts = slot.readbackData + phase * (mBatchCount + 2);
+
+		std::size_t drawn = 0;
+		for( std::uint32_t i = 0; i < mBatchCount; ++i )
+			drawn += counts[i];
+
+		ret.visible += drawn;
+		ret.triangles += counts[mBatchCount];
+		ret.occluded += counts[mBatchCount+1];
+		if( 1 == phase )
+			ret.disoccluded = drawn;
+	}
+
+	ret.culled = ret.items - std::min( ret.items, ret.visible );
+	return ret;
+}
+
+std::uint32_t GpuCuller::item_count() const noexcept
+{
+	return mItemCount;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "vertex_data.h"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/upload_queue.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* GPU-driven culling.
+ *
+ * A compute pass (shaders/cull.comp) tests cull items against the view
+ * frustum and appends the visible ones as indirect draw commands, which the
+ * graphics pass draws with vkCmdDrawIndexedIndirectCount(). The items mirror
+ * what record_commands() culls on the CPU:
+ *  - meshes without meshlets, which are always drawn,
+ *  - meshlets, by their bounding sphere and normal cone (see
+ *    meshlet_visible()),
+ *  - LOD groups, by their bounding sphere. The level is selected as by
+ *    select_lod(); coarser levels are drawn as one range, while at full
+ *    detail the group's meshlets are culled individually.
+ * Each visible item becomes one command; unlike on the CPU, consecutive
+ * meshlets are not merged.
+ *
+ * The commands are grouped into batches of draws that share their state
+ * (pipeline, texture set, index type), which the caller assigns per
+ * ModelBufferPack. Each batch has its own range of the command buffer,
+ * sized for all of its items, and its own counter. A command's
+ * firstInstance is the index of its pack, i.e. of its draw data.
+ *
+ * The command and count buffers are per frame slot. The counts are copied
+ * back for the statistics, which are thus a few frames old.
+ *
+ * Occlusion culling follows the two-phase scheme: the culler remembers
+ * which items it drew last frame, and the frame
+ *  1. culls and draws those that remain in the frustum
+ *     (GpuCullPass::visibleLastFrame), then builds a DepthPyramid from the
+ *     resulting depth buffer,
+ *  2. tests every item against the pyramid, and draws those that passed but
+ *     were not drawn in the first phase (GpuCullPass::disoccluded). Items
+ *     that passed are remembered for the next frame.
+ * Each phase has its own commands and counts. Without occlusion culling,
+ * GpuCullPass::all draws everything that passes frustum culling in one go.
+ *
+ * Requires VulkanContext::drawIndirectCount and multiDrawIndirect.
+ */
+struct GpuCullStats
+{
+	std::size_t items = 0; // tested per frame
+	std::size_t visible = 0; // drawn, i.e. indirect commands
+	std::size_t culled = 0; // frustum, cone, LOD or occlusion
+	std::size_t occluded = 0; // by the depth pyramid
+	std::size_t disoccluded = 0; // drawn by the second phase
+	std::size_t triangles = 0;
+};
+
+enum class GpuCullPass : std::uint32_t
+{
+	all, // no occlusion culling
+	visibleLastFrame,
+	disoccluded
+};
+
+class DepthPyramid;
+
+class GpuCuller
+{
+	public:
+		// aPackBatches holds the batch of each pack, in [0,aBatchCount)
+		GpuCuller(
+			labutils::VulkanContext const&,
+			labutils::Allocator const&,
+			labutils::UploadQueue&,
+			VkDescriptorPool,
+			std::vector<ModelBufferPack> const&,
+			std::vector<std::uint32_t> const& aPackBatches,
+			std::uint32_t aBatchCount,
+			std::uint32_t aFrameSlots,
+			char const* aShaderPath
+		);
+
+		GpuCuller( GpuCuller const& ) = delete;
+		GpuCuller& operator= (GpuCuller const&) = delete;
+
+	public:
+		// The pyramid is read by GpuCullPass::disoccluded. Set it before the
+		// first record_cull() of that pass, and again whenever it is
+		// recreated, while the culler is not in use. GpuCullPass::all does
+		// not need one.
+		void set_depth_pyramid( DepthPyramid const& );
+
+		// Record outside a render pass: GpuCullPass::all or visibleLastFrame
+		// start the frame, disoccluded follows visibleLastFrame once the
+		// pyramid has been built. aCamera is the world-to-view matrix, and
+		// aProjection a glm::perspectiveRH_ZO() projection.
+		void record_cull( VkCommandBuffer, std::uint32_t aSlot, GpuCullPass, glm::mat4 const& aCamera, glm::mat4 const& aProjection,
+			glm::vec3 const& aCameraPos, float aLodPixelScale, float aLodPixelError );
+
+		// Draws the batch's visible commands of the pass; record inside the
+		// render pass, with the batch's state bound
+		void record_draw( VkCommandBuffer, std::uint32_t aSlot, GpuCullPass, std::uint32_t aBatch ) const;
+
+		// Copies the counts back; record after the render pass
+		void record_readback( VkCommandBuffer, std::uint32_t aSlot );
+
+		// Results of the slot's last frame; call once it has completed
+		GpuCullStats stats( std::uint32_t aSlot ) const;
+
+		std::uint32_t item_count() const noexcept;
+
+	private:
+		struct Slot_
+		{
+			labutils::Buffer commands; // per phase and batch, at mBatchFirst
+			labutils::Buffer counts; // per phase: per batch, followed by the triangle and occluded counts
+			labutils::Buffer params;
+			labutils::Buffer readback;
+			std::uint32_t const* readbackData = nullptr;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			bool recorded = false;
+		};
+
+		labutils::VulkanContext const* mContext;
+		labutils::Allocator const* mAllocator;
+
+		std::uint32_t mItemCount = 0, mBatchCount;
+		std::vector<std::uint32_t> mBatchFirst, mBatchCapacity;
+
+		labutils::Buffer mItems, mGroups, mBatches;
+		labutils::Buffer mVisibility; // per item, drawn last frame
+
+		std::uint32_t mPyramidLevels = 0;
+		VkExtent2D mDepthExtent{};
+
+		// Bound in place of the pyramid until one is set; never read
+		labutils::Image mDummyDepth;
+		labutils::ImageView mDummyDepthView;
+		labutils::Sampler mDummySampler;
+
+		labutils::DescriptorSetLayout mLayout;
+		labutils::PipelineLayout mPipeLayout;
+		labutils::Pipeline mPipe;
+
+		std::vector<Slot_> mSlots;
+
+	private:
+		void bind_depth_( VkImageView, VkSampler, VkImageLayout );
+};
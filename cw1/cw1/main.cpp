@@ -3,7 +3,13 @@
 #include <tuple>
 #include <chrono>
 #include <limits>
+#include <iterator>
+#include <optional>
+#include <string>
 #include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
@@ -35,10 +41,29 @@ using namespace labutils::literals;
 #include "../labutils/vkobject.hpp"
 #include "../labutils/vkbuffer.hpp"
 #include "../labutils/allocator.hpp"
+#include "../labutils/thread_pool.hpp"
+#include "../labutils/image_decode.hpp"
+#include "../labutils/mip_generate.hpp"
+#include "../labutils/block_compress.hpp"
+#include "../labutils/ktx2.hpp"
+#include "../labutils/resource_cache.hpp"
+#include "../labutils/staging_ring.hpp"
+#include "../labutils/upload_queue.hpp"
+#include "../labutils/texture_streamer.hpp"
+#include "../labutils/bindless_textures.hpp"
 #include "vertex_data.h"
 namespace lut = labutils;
 
 #include "model.hpp"
+#include "model_cache.hpp"
+#include "vertex_weld.hpp"
+#include "vertex_format.hpp"
+#include "meshlet.hpp"
+#include "mesh_lod.hpp"
+#include "gpu_cull.hpp"
+#include "bounds_cull.hpp"
+#include "depth_pyramid.hpp"
+#include "occlusion_cull.hpp"
 
 namespace
 {
@@ -50,6 +75,10 @@ namespace
 #		define SHADERDIR_ "assets/cw1/shaders/"
 		constexpr char const* kVertShaderPath = SHADERDIR_ "default.vert.spv";
 		constexpr char const* kFragShaderPath = SHADERDIR_ "default.frag.spv";
+		constexpr char const* kUntexturedFragShaderPath = SHADERDIR_ "untextured.frag.spv";
+		constexpr char const* kBindlessFragShaderPath = SHADERDIR_ "bindless.frag.spv";
+		constexpr char const* kCullShaderPath = SHADERDIR_ "cull.comp.spv";
+		constexpr char const* kDepthPyramidShaderPath = SHADERDIR_ "depth_pyramid.comp.spv";
 #		undef SHADERDIR_
 
 		
@@ -70,6 +99,131 @@ namespace
 		constexpr auto kCameraFov    = 60.0_degf;
 
 		constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+
+		// Reorder triangles and vertices of the loaded meshes for the
+		// post-transform vertex cache and overdraw (see mesh_optimize.hpp).
+		// Set to false to A/B against the OBJ's face order.
+		constexpr bool kOptimizeMeshes = true;
+
+		// Merge all meshes sharing a material into a single draw (see
+		// mesh_batch.hpp).
+		constexpr bool kBatchByMaterial = true;
+
+		// Parse OBJs with the bounded-memory streaming loader instead of the
+		// parallel whole-file loader (see load_obj_model_streaming()). Set
+		// kCompareObjLoaders to parse each OBJ with both at start-up and
+		// report their peak memory use side by side; this bypasses the mesh
+		// cache, which keeps whatever the selected loader produced.
+		constexpr bool kStreamObjLoad = false;
+		constexpr bool kCompareObjLoaders = false;
+
+		// Vertex format used for rendering (see vertex_format.hpp).
+		// VertexF32 is the unquantized reference. The city's UVs are tiled
+		// well beyond [0,1], so texture coordinates are stored as unorm16
+		// rather than half floats.
+		using RenderVertex = VertexQuantizedUnorm;
+
+		// Keep the CPU-side copies of the vertex and index data once they have
+		// been uploaded. Nothing after the upload needs them.
+		constexpr bool kKeepCpuGeometry = false;
+
+		// Size of the persistently mapped staging ring that all uploads go
+		// through (see labutils::StagingRing). Uploads that do not fit get a
+		// dedicated buffer; the start-up report counts those.
+		constexpr VkDeviceSize kStagingRingBytes = VkDeviceSize(32) << 20;
+
+		// Per-frame budget for uploads made while rendering (see
+		// labutils::UploadBudget); 0 is unlimited. The uploads before the
+		// main loop are not limited.
+		constexpr VkDeviceSize kUploadBytesPerFrame = VkDeviceSize(4) << 20;
+		constexpr double kUploadMillisecondsPerFrame = 2.0;
+
+		// Threads used to decode the scene's textures before they are
+		// uploaded (see labutils::decode_images()). 0 uses one per core; 1
+		// gives the serial time for comparison.
+		constexpr std::size_t kTextureDecodeThreads = 0;
+
+		// Generate the textures' mip chains on the CPU (see
+		// labutils::generate_mipmaps()) and upload each chain in a single
+		// copy, instead of blitting level by level on the GPU. This also
+		// gives mipmaps to formats that do not support linear filtering.
+		constexpr bool kCpuMipmaps = true;
+		constexpr lut::MipFilter kCpuMipFilter = lut::MipFilter::box;
+
+		// Block-compress the textures (see labutils::compress_image()) where
+		// the device supports the format; this needs the CPU mip chains. BC1
+		// is used for opaque textures and BC7 for those with alpha (set to
+		// bc7 to use it throughout). The start-up report compares quality and
+		// memory against RGBA8.
+		constexpr bool kCompressTextures = true;
+		constexpr lut::BlockFormat kTextureBlockFormat = lut::BlockFormat::bc1;
+
+		// Bake the final mip chains to "<texture>.ktx2" next to each texture
+		// (see labutils::bake_texture()). Later runs map the baked files and
+		// upload them as they are, skipping decoding, mip generation and
+		// compression; they are rebuilt when the texture or the settings
+		// above change. Needs the CPU mip chains.
+		constexpr bool kBakeTextures = true;
+
+		// Split meshes into meshlets and cull them individually (frustum and
+		// back-facing normal cones) on the CPU each frame
+		constexpr bool kClusterCulling = true;
+
+		// Simplified levels of detail for groups of meshlets. A level is used
+		// if its geometric error projects to at most kLodPixelError pixels.
+		constexpr bool kLevelOfDetail = true;
+		constexpr float kLodPixelError = 1.f;
+
+		static_assert(!kLevelOfDetail || kClusterCulling, "LOD groups are made of meshlets");
+
+		// Without GPU culling, whole meshes are first culled by their bounding
+		// spheres (see cull_bounds()), which also rejects meshes smaller than
+		// kMinObjectPixels on screen; 0 only tests the frustum. Set
+		// kBenchmarkBoundsCulling to time the SIMD kernel against the scalar
+		// one at start-up.
+		constexpr float kMinObjectPixels = 1.f;
+		constexpr bool kBenchmarkBoundsCulling = false;
+
+		// Stream the textures' finer mip levels as the fragment shader asks for
+		// them (see labutils::TextureStreamer), starting from levels of at most
+		// kStreamInitialExtent texels. The streamed images stay within
+		// kTextureBudgetBytes, or if that is 0, within
+		// kTextureHeapBudgetFraction of the device-local heap's budget. Needs
+		// the CPU mip chains; textures with a single level are loaded as
+		// before.
+		constexpr bool kStreamTextures = true;
+		constexpr std::uint32_t kStreamInitialExtent = 128;
+		constexpr VkDeviceSize kTextureBudgetBytes = 0;
+		constexpr float kTextureHeapBudgetFraction = 0.5f;
+
+		// Index all material textures from one descriptor array that is bound
+		// once per frame (see labutils::BindlessTextures), instead of binding a
+		// descriptor set per textured mesh. Needs descriptor indexing; without
+		// it, the per-material sets are used. The table holds at most
+		// kBindlessTextureCapacity textures.
+		constexpr bool kBindlessTextures = true;
+		constexpr std::uint32_t kBindlessTextureCapacity = 4096;
+
+		// Cull meshlets and LOD groups in a compute pass, which writes the
+		// indirect draw commands that the frame draws with a count from the GPU
+		// (see gpu_cull.hpp), instead of culling on the CPU. Needs draw
+		// indirect count and multi-draw; without them, the CPU culls as before.
+		constexpr bool kGpuCulling = true;
+
+		// With GPU culling, also cull what is hidden behind the depth of what
+		// was visible last frame, in two phases around a depth pyramid (see
+		// GpuCuller and DepthPyramid).
+		constexpr bool kOcclusionCulling = true;
+
+		// Without GPU culling, rasterize the city's largest buildings (see
+		// select_occluders()) into a software depth buffer of
+		// kSoftwareOcclusionWidth x kSoftwareOcclusionHeight each frame, and
+		// skip what they hide (see OcclusionCuller).
+		// kSoftwareOcclusionThreads = 0 uses one thread per core.
+		constexpr bool kSoftwareOcclusion = true;
+		constexpr std::uint32_t kSoftwareOcclusionWidth = 320;
+		constexpr std::uint32_t kSoftwareOcclusionHeight = 192;
+		constexpr std::size_t kSoftwareOcclusionThreads = 0;
 	}
 
 
@@ -90,26 +244,102 @@ namespace
 
 		static_assert(sizeof(SceneUniform) <= 65536, "SceneUniform must be less than 65536 bytes for vkCmdUpdateBuffer.");
 		static_assert(sizeof(SceneUniform) % 4 == 0, "SceneUniform size must be a multiple of 4 bytes.");
+
+		// One per entry of the MaterialTable (see vertex_data.h), in a storage
+		// buffer
+		struct MaterialConstants
+		{
+			glm::vec4 color;
+			std::uint32_t streamedTexture;
+			std::uint32_t texture; // bindless
+			std::uint32_t pad[2];
+		};
+
+		static_assert(sizeof(MaterialConstants) == 32, "MaterialConstants must match the std430 layout in the shaders.");
+
+		// One per ModelBufferPack, in a storage buffer; indirect draws select
+		// theirs with firstInstance
+		struct DrawData
+		{
+			vfmt::VertexDequant dequant;
+			std::uint32_t materialIndex;
+			std::uint32_t pad[3];
+		};
+
+		static_assert(sizeof(DrawData) == 64, "DrawData must match the std430 layout in default.vert.");
 	}
 
 
 	// Local types/structures:
+	struct DrawStats
+	{
+		std::size_t meshes = 0;
+		std::size_t visibleMeshes = 0;
+		std::size_t clusters = 0;
+		std::size_t visibleClusters = 0;
+		std::size_t draws = 0; // indirect draw commands
+		std::size_t indirectCalls = 0;
+		std::size_t triangles = 0;
+
+		// Triangles that the drawn geometry has at full detail
+		std::size_t fullDetailTriangles = 0;
+		std::size_t lodGroups[kMaxLodLevels] = {};
+	};
+
+	// Indirect draw commands of a frame slot, written after culling (see
+	// record_commands())
+	struct IndirectDraws
+	{
+		lut::Buffer buffer; // host-visible, persistently mapped
+		VkDrawIndexedIndirectCommand* commands = nullptr;
+		std::uint32_t capacity = 0;
+	};
+
+	// State shared by the draws of a batch under GPU culling; one per GpuCuller
+	// batch
+	struct DrawBatch
+	{
+		bool textured;
+		VkIndexType indexType;
+		std::uint32_t streamedTexture; // without bindless textures; see ModelBufferPack
+		VkDescriptorSet materialSet;
+
+		bool operator==(DrawBatch const& aOther) const noexcept
+		{
+			return textured == aOther.textured && indexType == aOther.indexType && streamedTexture == aOther.streamedTexture && materialSet == aOther.materialSet;
+		}
+	};
+
+	// Occlusion culling splits the frame's render pass around the depth
+	// pyramid's construction; the second pass continues the first one's
+	// attachments
+	enum class RenderPassUse
+	{
+		whole,
+		beforeDepthPyramid,
+		afterDepthPyramid
+	};
 
 	// Local functions:
-	lut::RenderPass create_render_pass(lut::VulkanWindow const& );
+	lut::RenderPass create_render_pass(lut::VulkanWindow const&, RenderPassUse = RenderPassUse::whole);
 	lut::DescriptorSetLayout create_descriptor_layout(lut::VulkanWindow const& aWindow, VkDescriptorType, VkShaderStageFlags);
+	lut::DescriptorSetLayout create_scene_descriptor_layout(lut::VulkanWindow const& aWindow);
+	IndirectDraws create_indirect_draws(lut::Allocator const&, std::uint32_t aCapacity);
 	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const&);
 	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, std::vector<VkDescriptorSetLayout> vaSceneLayouts);
-	lut::Pipeline create_pipeline(lut::VulkanWindow const& , VkRenderPass , VkPipelineLayout );
+	lut::Pipeline create_pipeline(lut::VulkanWindow const& , VkRenderPass , VkPipelineLayout, char const* aFragShaderPath = cfg::kFragShaderPath );
 	
 	
 	void create_swapchain_framebuffers(lut::VulkanWindow const& , VkRenderPass , std::vector<lut::Framebuffer>&, VkImageView aDepthView);
-	void record_commands( VkCommandBuffer, VkRenderPass, VkFramebuffer, VkPipeline, VkPipelineLayout, VkExtent2D const&, 
-		std::vector<ModelBufferPack>&,VkBuffer uniformBuffer, VkDescriptorSet matrixDescriptorSet, glsl::SceneUniform matrixUniform);
+	void record_commands( VkCommandBuffer, VkRenderPass, VkRenderPass aResumeRenderPass, VkFramebuffer, VkPipeline, VkPipeline aUntexturedPipe, VkPipelineLayout, VkExtent2D const&, 
+		std::vector<ModelBufferPack>&, BoundsSoA const& aMeshBounds, SceneGeometry const&, VkBuffer uniformBuffer, VkDescriptorSet matrixDescriptorSet, VkDescriptorSet materialConstantsSet, glsl::SceneUniform matrixUniform,
+		lut::TextureStreamer& aStreamer, std::uint32_t aFrameSlot, VkDescriptorSet aBindlessSet, lut::Allocator const&, IndirectDraws&, bool aMultiDraw,
+		GpuCuller* aGpuCuller, std::vector<DrawBatch> const& aDrawBatches, DepthPyramid const* aDepthPyramid, OcclusionCuller* aOcclusion, DrawStats& aStats);
 	void submit_commands( lut::VulkanContext const&, VkCommandBuffer, VkFence, VkSemaphore, VkSemaphore);
 	void update_scene_uniforms(glsl::SceneUniform& aSceneUniforms, std::uint32_t aFramebufferWidth, std::uint32_t aFramebufferHeight);
-	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator);
-	void update_descriptor_set(lut::VulkanWindow const& window, VkBuffer descriptorBuffer, VkDescriptorSet descritporSet, VkDescriptorType descriptorType);
+	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, bool aSampled);
+	void update_descriptor_set(lut::VulkanWindow const& window, VkBuffer descriptorBuffer, VkDescriptorSet descritporSet, VkDescriptorType descriptorType,
+		std::uint32_t binding = 0);
 }
 
 // Definitions of functions
@@ -194,7 +424,7 @@ namespace
 
 
 	// rendering preparation
-	lut::RenderPass create_render_pass(lut::VulkanWindow const& aWindow)
+	lut::RenderPass create_render_pass(lut::VulkanWindow const& aWindow, RenderPassUse aUse)
 	{
 		//------------//
 		// Attachment //
@@ -220,6 +450,22 @@ namespace
 		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+		// The first half keeps both attachments; its depth is read by the depth
+		// pyramid's compute shader. The second half loads them.
+		if (RenderPassUse::beforeDepthPyramid == aUse)
+		{
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		}
+		else if (RenderPassUse::afterDepthPyramid == aUse)
+		{
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		}
+
 
 		//------------//
 		// Subpass    //
@@ -244,6 +490,35 @@ namespace
 		subpasses[0].pDepthStencilAttachment = &depthAttachment;
 
 
+		//-------------------------//
+		// Dependencies            //
+		//-------------------------//
+
+		VkSubpassDependency deps[1]{};
+		if (RenderPassUse::beforeDepthPyramid == aUse)
+		{
+			// Depth writes before the depth pyramid reads them
+			deps[0].srcSubpass = 0;
+			deps[0].dstSubpass = VK_SUBPASS_EXTERNAL;
+			deps[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			deps[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			deps[0].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			deps[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		}
+		else if (RenderPassUse::afterDepthPyramid == aUse)
+		{
+			// The depth pyramid's reads and the first half's draws before the
+			// draws of the second half
+			deps[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+			deps[0].dstSubpass = 0;
+			deps[0].srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			deps[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			deps[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			deps[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+				| VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+
+
 		//-------------------------//
 		// Create render pass      //
 		//-------------------------//
@@ -254,8 +529,8 @@ namespace
 		passInfo.pAttachments = attachments;
 		passInfo.subpassCount = 1;
 		passInfo.pSubpasses = subpasses;
-		passInfo.dependencyCount = 0;
-		passInfo.pDependencies = nullptr;
+		passInfo.dependencyCount = RenderPassUse::whole == aUse ? 0 : 1;
+		passInfo.pDependencies = deps;
 
 		VkRenderPass rpass = VK_NULL_HANDLE;
 		if (auto const res = vkCreateRenderPass(aWindow.device, &passInfo, nullptr, &rpass); VK_SUCCESS != res)
@@ -297,6 +572,54 @@ namespace
 
 		return lut::DescriptorSetLayout(aWindow.device, layout);
 	}
+
+	lut::DescriptorSetLayout create_scene_descriptor_layout(lut::VulkanWindow const& aWindow)
+	{
+		// scene uniforms, and the draw data that indirect draws index with
+		// their first instance
+		VkDescriptorSetLayoutBinding bindings[2]{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+		layoutInfo.pBindings = bindings;
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+
+		if (auto const res = vkCreateDescriptorSetLayout(aWindow.device, &layoutInfo, nullptr, &layout); VK_SUCCESS != res)
+		{
+			throw lut::Error("Unable to create descriptor set layout\n"
+				"vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str());
+		}
+
+		return lut::DescriptorSetLayout(aWindow.device, layout);
+	}
+
+	IndirectDraws create_indirect_draws(lut::Allocator const& aAllocator, std::uint32_t aCapacity)
+	{
+		IndirectDraws ret;
+		ret.capacity = std::max<std::uint32_t>(1, aCapacity);
+		ret.buffer = lut::create_buffer(
+			aAllocator,
+			ret.capacity * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VMA_MEMORY_USAGE_CPU_TO_GPU,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT
+		);
+		ret.commands = static_cast<VkDrawIndexedIndirectCommand*>(lut::mapped_pointer(aAllocator, ret.buffer));
+		assert(ret.commands);
+
+		return ret;
+	}
 	
 	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext)
 	{
@@ -339,6 +662,8 @@ namespace
 		VkPipelineLayoutCreateInfo layoutInfo{};
 
 		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		// per-draw parameters come from the draw data (see glsl::DrawData), so
+		// there are no push constants
 		layoutInfo.setLayoutCount = vaSceneLayouts.size();
 		layoutInfo.pSetLayouts = vaSceneLayouts.data();
 		layoutInfo.pushConstantRangeCount = 0;
@@ -360,11 +685,11 @@ namespace
 		return lut::PipelineLayout(aContext.device, layout);
 	}
 	
-	lut::Pipeline create_pipeline(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout)
+	lut::Pipeline create_pipeline(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout, char const* aFragShaderPath)
 	{
 		// load shader modules
 		lut::ShaderModule vert = lut::load_shader_module(aWindow, cfg::kVertShaderPath);
-		lut::ShaderModule frag = lut::load_shader_module(aWindow, cfg::kFragShaderPath);
+		lut::ShaderModule frag = lut::load_shader_module(aWindow, aFragShaderPath);
 
 
 		// create pipeline shader stage instance
@@ -383,26 +708,11 @@ namespace
 		stages[1].module = frag.handle;
 		stages[1].pName = "main";
 
-		// vertex input
-		VkVertexInputBindingDescription vertexInputs[2]{};
-		vertexInputs[0].binding = 0;
-		vertexInputs[0].stride = sizeof(float) * 3;
-		vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		vertexInputs[1].binding = 1;
-		vertexInputs[1].stride = sizeof(float) * 2;
-		vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		// vertex attributes
-		VkVertexInputAttributeDescription vertexAttributes[2]{};
-		vertexAttributes[0].binding = 0; // must match binding above
-		vertexAttributes[0].location = 0; // must match shader
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexAttributes[0].offset = 0;
-
-		vertexAttributes[1].binding = 1; // must match binding above
-		vertexAttributes[1].location = 1; // must match shader
-		vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertexAttributes[1].offset = 0;
+		// vertex input: single interleaved binding, derived from the vertex
+		// format
+		constexpr VkVertexInputBindingDescription vertexInputs[] = { vfmt::vertex_binding<cfg::RenderVertex>(0) };
+		// vertex attributes (locations must match shader)
+		constexpr auto vertexAttributes = vfmt::vertex_attributes<cfg::RenderVertex>(0);
 
 		// define primitive of input
 		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
@@ -432,10 +742,10 @@ namespace
 
 		// vertex input info
 		VkPipelineVertexInputStateCreateInfo inputInfo{};
-		inputInfo.vertexBindingDescriptionCount = 2;
+		inputInfo.vertexBindingDescriptionCount = std::uint32_t(std::size(vertexInputs));
 		inputInfo.pVertexBindingDescriptions = vertexInputs;
-		inputInfo.vertexAttributeDescriptionCount = 2;
-		inputInfo.pVertexAttributeDescriptions = vertexAttributes;
+		inputInfo.vertexAttributeDescriptionCount = std::uint32_t(vertexAttributes.size());
+		inputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
 		inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
 
@@ -571,7 +881,7 @@ namespace
 		aSceneUniforms.projCam = aSceneUniforms.projection * aSceneUniforms.camera;
 	}
 	
-	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator)
+	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, bool aSampled)
 	{
 		VkImageCreateInfo imageInfo{};
 
@@ -585,6 +895,8 @@ namespace
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		if (aSampled)
+			imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; // by the depth pyramid
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
@@ -623,7 +935,8 @@ namespace
 		return { std::move(depthImage), lut::ImageView{aWindow.device, view} };
 	}
 	
-	void update_descriptor_set(lut::VulkanWindow const& window, VkBuffer descriptorBuffer, VkDescriptorSet descritporSet, VkDescriptorType descriptorType)
+	void update_descriptor_set(lut::VulkanWindow const& window, VkBuffer descriptorBuffer, VkDescriptorSet descritporSet, VkDescriptorType descriptorType,
+		std::uint32_t binding)
 	{
 		// Write descriptor set
 		VkWriteDescriptorSet desc[1]{};
@@ -635,7 +948,7 @@ namespace
 
 		desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		desc[0].dstSet = descritporSet;
-		desc[0].dstBinding = 0;
+		desc[0].dstBinding = binding;
 		desc[0].descriptorType = descriptorType;
 		desc[0].descriptorCount = 1;
 		desc[0].pBufferInfo = &descBufferInfo;
@@ -645,9 +958,29 @@ namespace
 	}
 	
 	// run cmd commands
-	void record_commands(VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout,
-		VkExtent2D const& aImageExtent, std::vector<ModelBufferPack>& mesh, VkBuffer matrixUBO, VkDescriptorSet matrixDescriptorSet, glsl::SceneUniform matrixUniform)
+	void record_commands(VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkRenderPass aResumeRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkPipeline aUntexturedPipe, VkPipelineLayout aGraphicsPipeLayout,
+		VkExtent2D const& aImageExtent, std::vector<ModelBufferPack>& mesh, BoundsSoA const& aMeshBounds, SceneGeometry const& aGeometry, VkBuffer matrixUBO, VkDescriptorSet matrixDescriptorSet, VkDescriptorSet materialConstantsSet, glsl::SceneUniform matrixUniform,
+		lut::TextureStreamer& aStreamer, std::uint32_t aFrameSlot, VkDescriptorSet aBindlessSet, lut::Allocator const& aAllocator, IndirectDraws& aIndirect, bool aMultiDraw,
+		GpuCuller* aGpuCuller, std::vector<DrawBatch> const& aDrawBatches, DepthPyramid const* aDepthPyramid, OcclusionCuller* aOcclusion, DrawStats& aStats)
 	{
+		aStats = DrawStats{};
+
+		// Cluster culling happens in object space; the models are not
+		// transformed
+		Frustum const frustum = make_frustum(matrixUniform.projCam);
+		glm::vec3 const cameraPos = glm::vec3(glm::inverse(matrixUniform.camera)[3]);
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> runs; // (firstIndex, indexCount)
+
+		auto const add_run = [&runs](std::uint32_t aFirstIndex, std::uint32_t aIndexCount) {
+			if (!runs.empty() && runs.back().first + runs.back().second == aFirstIndex)
+				runs.back().second += aIndexCount;
+			else
+				runs.emplace_back(aFirstIndex, aIndexCount);
+		};
+
+		// LOD selection: errors are projected with the scene's perspective
+		// projection
+		float const lodPixelScale = lod_pixel_scale(lut::Radians(cfg::kCameraFov).value(), float(aImageExtent.height));
 
 		// Begin recording commands
 		VkCommandBufferBeginInfo begInfo{};
@@ -694,6 +1027,17 @@ namespace
 			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 		);
 
+		// The fragment shader reports the mip levels it needs from here on
+		aStreamer.record_feedback_clear(aCmdBuff, aFrameSlot);
+
+		// GPU culling writes this frame's draw commands ahead of the render
+		// pass. With occlusion culling, these are only the draws that were
+		// visible last frame; the others follow once their depth has been
+		// tested.
+		GpuCullPass const cullPass = aDepthPyramid ? GpuCullPass::visibleLastFrame : GpuCullPass::all;
+		if (aGpuCuller)
+			aGpuCuller->record_cull(aCmdBuff, aFrameSlot, cullPass, matrixUniform.camera, matrixUniform.projection, cameraPos, lodPixelScale, cfg::kLodPixelError);
+
 		VkRenderPassBeginInfo passInfo{};
 		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		passInfo.renderPass = aRenderPass;
@@ -705,27 +1049,263 @@ namespace
 		vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 
-		// Begin drawing with our graphics pipeline
-		vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
+		// The scene, material constants and mip feedback are shared by all
+		// draws and by both pipelines; so are the bindless textures, which the
+		// material constants index
+		vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 0, 1, &matrixDescriptorSet, 0, nullptr);
+		if (VK_NULL_HANDLE != aBindlessSet)
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 1, 1, &aBindlessSet, 0, nullptr);
+
+		VkDescriptorSet const sharedSets[] = { materialConstantsSet, aStreamer.feedback_set(aFrameSlot) };
+		vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 2, 2, sharedSets, 0, nullptr);
+
+		// All meshes share the scene's vertex buffer; each draw's vertexOffset
+		// locates its mesh
+		VkBuffer const vertexBuffers[1] = { aGeometry.vertices.buffer };
+		VkDeviceSize const vertexOffsets[1]{};
+		vkCmdBindVertexBuffers(aCmdBuff, 0, 1, vertexBuffers, vertexOffsets);
+
+		// The draws are collected into batches that share their state, and each
+		// batch goes out as one indirect draw: one per pipeline and index type
+		// with bindless textures, otherwise also one per texture set.
+		// Untextured meshes only use their constants. firstInstance selects the
+		// draw's data (see glsl::DrawData), which is in mesh order.
+		struct Batch
+		{
+			VkPipeline pipe;
+			VkDescriptorSet textureSet;
+			VkIndexType indexType;
+			std::vector<VkDrawIndexedIndirectCommand> commands;
+			std::uint32_t first = 0; // in aIndirect
+		};
+		std::vector<Batch> batches;
 		
-		for (unsigned int i = 0; i < mesh.size(); ++i)
+		if (aGpuCuller)
+		{
+			// The culling pass has written the commands and counts of the
+			// static batches
+			for (auto const& drawBatch : aDrawBatches)
+			{
+				VkDescriptorSet textureSet = VK_NULL_HANDLE;
+				if (drawBatch.textured && VK_NULL_HANDLE == aBindlessSet)
+				{
+					textureSet = lut::kNoStreamedTexture != drawBatch.streamedTexture
+						? aStreamer.texture_set(drawBatch.streamedTexture, aFrameSlot) : drawBatch.materialSet;
+				}
+
+				batches.emplace_back(Batch{ drawBatch.textured ? aGraphicsPipe : aUntexturedPipe, textureSet, drawBatch.indexType, {} });
+			}
+		}
+		else
+		{
+			// Whole meshes first, eight at a time; only the visible ones cull
+			// their meshlets
+			std::vector<std::uint32_t> visibleMeshes;
+			visibleMeshes.reserve(mesh.size());
+			cull_bounds(aMeshBounds, frustum, cameraPos, lodPixelScale, cfg::kMinObjectPixels, visibleMeshes);
+
+			// Then whatever the occluders hide: meshes by their boxes, meshlets
+			// and LOD groups by their spheres' boxes
+			auto const sphere_occluded = [aOcclusion](glm::vec3 const& aCenter, float aRadius) {
+				return aOcclusion && aOcclusion->occluded(aCenter - glm::vec3(aRadius), aCenter + glm::vec3(aRadius));
+			};
+
+			if (aOcclusion)
+			{
+				aOcclusion->render(matrixUniform.projCam);
+
+				visibleMeshes.erase(std::remove_if(visibleMeshes.begin(), visibleMeshes.end(), [&](std::uint32_t aMesh) {
+					return aOcclusion->occluded(mesh[aMesh].bounds.aabbMin, mesh[aMesh].bounds.aabbMax);
+				}), visibleMeshes.end());
+			}
+
+			aStats.meshes = mesh.size();
+			aStats.visibleMeshes = visibleMeshes.size();
+
+			for (std::uint32_t const i : visibleMeshes)
+			{
+				// Cull meshlets; consecutive visible meshlets are drawn with a
+				// single call
+				runs.clear();
+				if (cfg::kClusterCulling && !mesh[i].meshlets.empty())
+				{
+					auto const cull_meshlet = [&](std::size_t aMeshlet) {
+						auto const& meshlet = mesh[i].meshlets[aMeshlet];
+						auto const& bounds = mesh[i].meshletBounds[aMeshlet];
+						if (!meshlet_visible(bounds, frustum, cameraPos) || sphere_occluded(bounds.center, bounds.radius))
+							return;
+
+						++aStats.visibleClusters;
+						aStats.fullDetailTriangles += meshlet.triangleCount;
+						add_run(meshlet.firstIndex, meshlet.triangleCount * 3);
+					};
+
+					aStats.clusters += mesh[i].meshlets.size();
+
+					if (!mesh[i].lodGroups.empty())
+					{
+						// Full detail groups still cull their meshlets
+						// individually
+						for (auto const& group : mesh[i].lodGroups)
+						{
+							if (!sphere_in_frustum(group.center, group.radius, frustum) || sphere_occluded(group.center, group.radius))
+								continue;
+
+							auto const level = select_lod(group, cameraPos, lodPixelScale, cfg::kLodPixelError);
+							++aStats.lodGroups[level];
+
+							if (0 == level)
+							{
+								for (std::uint32_t k = 0; k < group.meshletCount; ++k)
+									cull_meshlet(mesh[i].lodMeshlets[group.meshletStart + k]);
+							}
+							else
+							{
+								aStats.fullDetailTriangles += group.levels[0].indexCount / 3;
+								add_run(group.levels[level].firstIndex, group.levels[level].indexCount);
+							}
+						}
+					}
+					else
+					{
+						for (std::size_t k = 0; k < mesh[i].meshlets.size(); ++k)
+							cull_meshlet(k);
+					}
+
+					if (runs.empty())
+						continue;
+				}
+				else
+				{
+					aStats.fullDetailTriangles += mesh[i].indexCount / 3;
+					runs.emplace_back(0, mesh[i].indexCount);
+				}
+
+				bool const textured = mesh[i].textured();
+				VkPipeline const pipe = textured ? aGraphicsPipe : aUntexturedPipe;
+
+				// Streamed textures change their images, so their sets are per
+				// frame
+				VkDescriptorSet textureSet = VK_NULL_HANDLE;
+				if (textured && VK_NULL_HANDLE == aBindlessSet)
+				{
+					textureSet = lut::kNoStreamedTexture != mesh[i].streamedTexture
+						? aStreamer.texture_set(mesh[i].streamedTexture, aFrameSlot) : mesh[i].materialDescriptorSet;
+				}
+
+				// Meshes with the same state are mostly adjacent, so the search
+				// usually ends at the last batch
+				auto batch = std::find_if(batches.rbegin(), batches.rend(), [&](Batch const& b) {
+					return b.pipe == pipe && b.textureSet == textureSet && b.indexType == mesh[i].indexType;
+				});
+				if (batches.rend() == batch)
+				{
+					batches.emplace_back(Batch{ pipe, textureSet, mesh[i].indexType, {} });
+					batch = batches.rbegin();
+				}
+
+				for (auto const& [firstIndex, indexCount] : runs)
+				{
+					batch->commands.emplace_back(VkDrawIndexedIndirectCommand{ indexCount, 1, mesh[i].firstIndex + firstIndex, mesh[i].vertexOffset, i });
+					++aStats.draws;
+					aStats.triangles += indexCount / 3;
+				}
+			}
+
+			// Untextured batches last, so that each pipeline is bound once
+			std::stable_partition(batches.begin(), batches.end(), [aGraphicsPipe](Batch const& b) { return b.pipe == aGraphicsPipe; });
+
+			std::uint32_t written = 0;
+			for (auto& batch : batches)
+			{
+				assert(written + batch.commands.size() <= aIndirect.capacity);
+
+				batch.first = written;
+				std::memcpy(aIndirect.commands + written, batch.commands.data(), batch.commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+				written += std::uint32_t(batch.commands.size());
+			}
+
+			lut::flush_buffer(aAllocator, aIndirect.buffer, 0, written * sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		// Binds each batch's state and draws it; twice with occlusion culling,
+		// once per phase
+		auto const draw_batches = [&](GpuCullPass aPass) {
+			VkPipeline boundPipe = VK_NULL_HANDLE;
+			VkDescriptorSet boundTextureSet = VK_NULL_HANDLE;
+			VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+			for (std::uint32_t b = 0; b < batches.size(); ++b)
+			{
+				auto const& batch = batches[b];
+
+				if (batch.pipe != boundPipe)
+				{
+					vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.pipe);
+					boundPipe = batch.pipe;
+				}
+
+				if (VK_NULL_HANDLE != batch.textureSet && batch.textureSet != boundTextureSet)
+				{
+					vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 1, 1, &batch.textureSet, 0, nullptr);
+					boundTextureSet = batch.textureSet;
+				}
+
+				if (batch.indexType != boundIndexType)
+				{
+					vkCmdBindIndexBuffer(aCmdBuff, aGeometry.index_buffer(batch.indexType), 0, batch.indexType);
+					boundIndexType = batch.indexType;
+				}
+
+				VkDeviceSize const offset = batch.first * sizeof(VkDrawIndexedIndirectCommand);
+				auto const count = std::uint32_t(batch.commands.size());
+
+				// GPU-culled batches take their count from the culling pass.
+				// Without multi-draw, each command needs a call of its own.
+				if (aGpuCuller)
+				{
+					aGpuCuller->record_draw(aCmdBuff, aFrameSlot, aPass, b);
+					++aStats.indirectCalls;
+				}
+				else if (aMultiDraw)
+				{
+					vkCmdDrawIndexedIndirect(aCmdBuff, aIndirect.buffer.buffer, offset, count, sizeof(VkDrawIndexedIndirectCommand));
+					++aStats.indirectCalls;
+				}
+				else
+				{
+					for (std::uint32_t k = 0; k < count; ++k)
+						vkCmdDrawIndexedIndirect(aCmdBuff, aIndirect.buffer.buffer, offset + k * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+					aStats.indirectCalls += count;
+				}
+			}
+		};
+
+		draw_batches(cullPass);
+
+		// Second phase of occlusion culling: the depth drawn so far goes into
+		// the pyramid, against which the remaining draws are tested. The render
+		// pass continues afterwards.
+		if (aDepthPyramid)
 		{
-			// Binding vertex buffers
-			VkBuffer buffers[2] = { mesh[i].positions.buffer, mesh[i].texcoords.buffer};
-			VkDeviceSize offsets[2]{};
-			vkCmdBindVertexBuffers(aCmdBuff, 0, 2, buffers, offsets);
+			vkCmdEndRenderPass(aCmdBuff);
+
+			aDepthPyramid->record_build(aCmdBuff);
+			aGpuCuller->record_cull(aCmdBuff, aFrameSlot, GpuCullPass::disoccluded, matrixUniform.camera, matrixUniform.projection, cameraPos, lodPixelScale, cfg::kLodPixelError);
 
-			// Binding descriptor sets
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 0, 1, &matrixDescriptorSet, 0, nullptr);
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, 1, 1, &mesh[i].materialDescriptorSet, 0, nullptr);
+			passInfo.renderPass = aResumeRenderPass;
+			vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			// Draw a mesh
-			vkCmdDraw(aCmdBuff, mesh[i].vertexCount, 1, 0, 0);
+			draw_batches(GpuCullPass::disoccluded);
 		}
 
 		// End the render pass 
 		vkCmdEndRenderPass(aCmdBuff);
 
+		aStreamer.record_feedback_readback(aCmdBuff, aFrameSlot);
+		if (aGpuCuller)
+			aGpuCuller->record_readback(aCmdBuff, aFrameSlot);
+
 		// End command recording
 		if (auto const res = vkEndCommandBuffer(aCmdBuff); VK_SUCCESS != res)
 		{
@@ -775,19 +1355,53 @@ int main() try
 	// Create VMA allocator
 	lut::Allocator allocator = lut::create_allocator(window);
 	
+	// GPU culling needs draw indirect count and multi-draw (see below).
+	// Occlusion culling builds on it, and splits the frame's render pass in two
+	// (see record_commands()); the halves are compatible with the whole pass.
+	bool const gpuCulling = cfg::kGpuCulling && window.drawIndirectCount && window.multiDrawIndirect;
+	bool const occlusionCulling = gpuCulling && cfg::kOcclusionCulling;
+
 	// Render pass
-	lut::RenderPass renderPass = create_render_pass(window);
+	lut::RenderPass renderPass = create_render_pass(window, occlusionCulling ? RenderPassUse::beforeDepthPyramid : RenderPassUse::whole);
+	lut::RenderPass resumeRenderPass;
+	if (occlusionCulling)
+		resumeRenderPass = create_render_pass(window, RenderPassUse::afterDepthPyramid);
 
 	// Create descriptor set layout
-	lut::DescriptorSetLayout matrixLayout = create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+	lut::DescriptorSetLayout matrixLayout = create_scene_descriptor_layout(window);
 	lut::DescriptorSetLayout materialLayout = create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-	// Pipeline
-	lut::PipelineLayout pipeLayout = create_pipeline_layout(window, { matrixLayout.handle, materialLayout.handle });
-	lut::Pipeline pipe = create_pipeline(window, renderPass.handle, pipeLayout.handle);
+	lut::DescriptorSetLayout materialConstantsLayout = create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
+	lut::DescriptorSetLayout feedbackLayout = create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	// Bindless textures replace the per-material sets at set 1, if the device
+	// supports them. The table has one set per swapchain image, like the
+	// command buffers.
+	std::unique_ptr<lut::BindlessTextures> bindlessTextures;
+	if (cfg::kBindlessTextures && window.descriptorIndexing)
+		bindlessTextures = std::make_unique<lut::BindlessTextures>(window, cfg::kBindlessTextureCapacity, std::uint32_t(window.swapImages.size()));
+
+	if (bindlessTextures)
+		std::printf("Textures: bindless, up to %u in one descriptor array\n", bindlessTextures->capacity());
+	else
+		std::printf("Textures: one descriptor set per material%s\n", cfg::kBindlessTextures ? " (no descriptor indexing)" : "");
+
+	VkDescriptorSetLayout const textureLayout = bindlessTextures ? bindlessTextures->layout() : materialLayout.handle;
+	char const* const texturedFragShaderPath = bindlessTextures ? cfg::kBindlessFragShaderPath : cfg::kFragShaderPath;
+
+	// Pipelines; untextured materials use the same layout, but do not bind a
+	// texture
+	lut::PipelineLayout pipeLayout = create_pipeline_layout(window, { matrixLayout.handle, textureLayout, materialConstantsLayout.handle, feedbackLayout.handle });
+	lut::Pipeline pipe = create_pipeline(window, renderPass.handle, pipeLayout.handle, texturedFragShaderPath);
+	lut::Pipeline untexturedPipe = create_pipeline(window, renderPass.handle, pipeLayout.handle, cfg::kUntexturedFragShaderPath);
 
 	// Create depth buffer
-	auto [depthBuffer, depthBufferView] = create_depth_buffer(window, allocator);
+	auto [depthBuffer, depthBufferView] = create_depth_buffer(window, allocator, occlusionCulling);
+
+	// Only occlusion culling reads the depth pyramid; plain GPU culling binds a
+	// placeholder in its place
+	std::unique_ptr<DepthPyramid> depthPyramid;
+	if (occlusionCulling)
+		depthPyramid = std::make_unique<DepthPyramid>(window, allocator, depthBufferView.handle, window.swapchainExtent, cfg::kDepthPyramidShaderPath);
 
 	// Framebuffer
 	std::vector<lut::Framebuffer> framebuffers;
@@ -829,19 +1443,704 @@ int main() try
 	
 
 	// Load mesh
-	ModelData cityModel = load_obj_model(cfg::cityObjectPath);
-	ModelData carModel = load_obj_model(cfg::carObjectPath);
-	std::vector<ModelBufferPack> modelBuffer;
+	ModelLoadOptions loadOptions{};
+	loadOptions.optimizeMeshes = cfg::kOptimizeMeshes;
+	loadOptions.batchByMaterial = cfg::kBatchByMaterial;
+	loadOptions.streamObj = cfg::kStreamObjLoad;
+
+	ModelCacheInfo cityLoadInfo, carLoadInfo;
+	ModelData cityModel = load_obj_model_cached(cfg::cityObjectPath, &cityLoadInfo, loadOptions);
+	ModelData carModel = load_obj_model_cached(cfg::carObjectPath, &carLoadInfo, loadOptions);
+
+	if (cfg::kCompareObjLoaders)
+	{
+		for (auto const* name : { cfg::cityObjectPath, cfg::carObjectPath })
+		{
+			auto const cmp = compare_obj_loaders(name, loadOptions.streamOptions);
+			std::printf("Loaders: %-28s peak RSS +%.1f MiB parallel vs. +%.1f MiB streaming%s, parse %.2f ms vs. %.2f ms\n", name,
+				cmp.parallelPeakBytes / (1024.0 * 1024.0), cmp.streamingPeakBytes / (1024.0 * 1024.0), cmp.exact ? "" : " (lower bounds)",
+				cmp.parallelMilliseconds, cmp.streamingMilliseconds);
+		}
+	}
+
+	// Start-up time comparison: cache vs. parsing the OBJ
+	for (auto const& [name, info] : { std::pair{ cfg::cityObjectPath, cityLoadInfo }, std::pair{ cfg::carObjectPath, carLoadInfo } })
+	{
+		std::printf("Startup: %-28s %8.2f ms (%s; OBJ parse %.2f ms, %s loader, peak RSS +%.1f MiB)\n", name, info.loadMilliseconds,
+			info.cacheHit ? "mesh cache" : "parsed, cache written", info.parseMilliseconds,
+			info.streamedParse ? "streaming" : "parallel", info.parsePeakBytes / (1024.0 * 1024.0));
+	}
 
-	for(int i =0 ; i<cityModel.meshes.size(); ++i)
-		modelBuffer.emplace_back(create_model_buffer_pack(window, allocator, cityModel, materialLayout.handle, dpool.handle, i));
+	for (auto const& [name, info, model] : { std::tuple{ cfg::cityObjectPath, &cityLoadInfo, &cityModel }, std::tuple{ cfg::carObjectPath, &carLoadInfo, &carModel } })
+	{
+		// Vertex welding: triangle soup vs. indexed geometry (in the render
+		// vertex format)
+		auto const stats = geometry_memory_stats(*model, sizeof(cfg::RenderVertex));
+		std::printf("Geometry: %-27s %zu -> %zu vertices (%.1f%%), %.1f -> %.1f KiB incl. %zu indices (%.1f%%)\n", name,
+			stats.soupVertices, stats.indexedVertices, 100.0 * stats.indexedVertices / std::max<std::size_t>(1, stats.soupVertices),
+			stats.soupBytes / 1024.0, stats.indexedBytes / 1024.0, stats.indices, 100.0 * stats.indexedBytes / std::max<std::size_t>(1, stats.soupBytes));
+
+		// Material batching: draws per model (the original meshes remain as
+		// sub-meshes)
+		std::printf("Batching: %-27s %zu meshes -> %zu draws\n", name,
+			model->subMeshes.empty() ? model->meshes.size() : model->subMeshes.size(), model->meshes.size());
+
+		// Mesh optimisation: vertex cache efficiency before/after
+		if (info->meshesOptimized)
+		{
+			auto const& before = info->optimizeStats.before;
+			auto const& after = info->optimizeStats.after;
+			std::printf("Vertex cache: %-23s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %zu, optimized)\n", name,
+				before.acmr(), after.acmr(), before.atvr(), after.atvr(), kVertexCacheSize);
+		}
+		else
+		{
+			auto const current = analyze_vertex_cache(*model);
+			std::printf("Vertex cache: %-23s ACMR %.3f, ATVR %.3f (FIFO %zu, not optimized)\n", name,
+				current.acmr(), current.atvr(), kVertexCacheSize);
+		}
+	}
+	// Software occlusion culling stands in for the GPU's, on the CPU path. The
+	// occluders are picked from the city's buildings while their positions are
+	// as loaded.
+	std::unique_ptr<OcclusionCuller> occlusionCuller;
+	if (!gpuCulling && cfg::kSoftwareOcclusion)
+	{
+		auto const start = std::chrono::steady_clock::now();
+		auto occluders = select_occluders(cityModel);
+		auto const milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-	for (int i = 0; i < carModel.meshes.size(); ++i)
-		modelBuffer.emplace_back(create_model_buffer_pack(window, allocator, carModel, materialLayout.handle, dpool.handle, i));
+		std::printf("Occluders: %-26s %zu of %zu objects, %zu triangles, selected in %.2f ms\n", cfg::cityObjectPath,
+			occluders.occluders, occluders.candidates, occluders.vertices.size() / 3, milliseconds);
+
+		occlusionCuller = std::make_unique<OcclusionCuller>(std::move(occluders), cfg::kSoftwareOcclusionWidth,
+			cfg::kSoftwareOcclusionHeight, cfg::kSoftwareOcclusionThreads);
+	}
+
+	// Convert into the render vertex format; attributes that it does not use
+	// are dropped. The vertices are packed straight into staging memory by
+	// create_meshes(), so the meshes are only sized here.
+	std::size_t floatVertexBytes = 0, packedVertexBytes = 0;
+
+	std::vector<MeshUpload> uploads;
+
+	// All geometry and texture uploads share one staging ring, and are batched
+	// by the upload queue. The copies overlap with the rest of the start-up,
+	// and run on a dedicated transfer queue if there is one.
+	lut::StagingRing stagingRing(window, allocator, cfg::kStagingRingBytes);
+	lut::UploadQueue uploadQueue(window, stagingRing);
+
+	// Textures, samplers and material descriptor sets are shared between
+	// meshes; the packs hold the references
+	lut::ResourceCache resourceCache(window, allocator);
+	MaterialTable materials;
+
+	// Streamed textures share the default sampler; their images and descriptor
+	// sets live in the streamer. It always exists, as the fragment shader
+	// always writes feedback, if only for no textures at all.
+	auto const streamSampler = resourceCache.sampler(lut::default_sampler_info(window, VK_TRUE));
+
+	lut::TextureStreamerConfig streamConfig;
+	streamConfig.frameSlots = std::uint32_t(cbfences.size());
+	streamConfig.initialExtent = cfg::kStreamInitialExtent;
+	streamConfig.budgetBytes = cfg::kTextureBudgetBytes;
+	streamConfig.heapBudgetFraction = cfg::kTextureHeapBudgetFraction;
+
+	lut::TextureStreamer textureStreamer(window, allocator, uploadQueue, dpool.handle, materialLayout.handle, feedbackLayout.handle,
+		streamSampler->handle, streamConfig, bindlessTextures.get());
+	std::vector<ModelBufferPack> modelBuffer; // meshlets and LODs first, GPU resources once uploaded
+
+	for (auto const& [name, model] : { std::pair{ cfg::cityObjectPath, &cityModel }, std::pair{ cfg::carObjectPath, &carModel } })
+	{
+		// Meshlets reorder the triangles, so they must be built before the
+		// index buffers are created
+		MeshletData meshlets;
+		if (cfg::kClusterCulling)
+		{
+			meshlets = build_meshlets(*model);
+
+			std::size_t triangles = 0;
+			for (auto const& meshlet : meshlets.meshlets)
+				triangles += meshlet.triangleCount;
+
+			std::printf("Meshlets: %-27s %zu meshlets, %.1f vertices, %.1f triangles avg., packed %.1f KiB\n", name,
+				meshlets.meshlets.size(), double(meshlets.vertices.size()) / std::max<std::size_t>(1, meshlets.meshlets.size()),
+				double(triangles) / std::max<std::size_t>(1, meshlets.meshlets.size()),
+				(meshlets.vertices.size() * sizeof(std::uint32_t) + meshlets.triangles.size()) / 1024.0);
+		}
+
+		// LODs need all attributes (seams are found through them), so they are
+		// built before stripping. Normals only matter if they are rendered.
+		ModelLods lods;
+		lods.indices.resize(model->meshes.size());
+		if (cfg::kLevelOfDetail)
+		{
+			lods = build_lods(*model, meshlets, vfmt::uses_semantic<cfg::RenderVertex>(vfmt::Semantic::normal));
+
+			std::size_t triangles[kMaxLodLevels] = {};
+			for (auto const& group : lods.groups)
+			{
+				for (std::size_t level = 0; level < kMaxLodLevels; ++level)
+					triangles[level] += group.levels[std::min<std::size_t>(level, group.levelCount - 1)].indexCount / 3;
+			}
+
+			std::printf("LOD: %-32s %zu groups, triangles per level:", name, lods.groups.size());
+			for (auto const count : triangles)
+				std::printf(" %zu", count);
+			std::printf("\n");
+		}
+
+		vfmt::strip_unused_attributes<cfg::RenderVertex>(*model);
+
+		for (std::size_t i = 0; i < model->meshes.size(); ++i)
+		{
+			auto& upload = uploads.emplace_back(MeshUpload{ model, unsigned(i), vfmt::vertex_writer<cfg::RenderVertex>(*model, model->meshes[i]), std::move(lods.indices[i]) });
+			floatVertexBytes += upload.vertices.count * sizeof(VertexF32);
+			packedVertexBytes += std::size_t(upload.vertices.count) * upload.vertices.stride;
+
+			auto& pack = modelBuffer.emplace_back();
+			pack.bounds = compute_mesh_bounds(*model, model->meshes[i]);
+
+			if (cfg::kClusterCulling)
+			{
+				auto const first = meshlets.meshStart[i], last = meshlets.meshStart[i + 1];
+				pack.meshlets.assign(meshlets.meshlets.begin() + first, meshlets.meshlets.begin() + last);
+				pack.meshletBounds.assign(meshlets.bounds.begin() + first, meshlets.bounds.begin() + last);
+			}
+
+			if (cfg::kLevelOfDetail)
+			{
+				auto const first = lods.meshStart[i], last = lods.meshStart[i + 1];
+				pack.lodGroups.assign(lods.groups.begin() + first, lods.groups.begin() + last);
+
+				// Rebase the groups onto the pack's own meshlet list
+				for (auto& group : pack.lodGroups)
+				{
+					auto const start = group.meshletStart;
+					group.meshletStart = std::uint32_t(pack.lodMeshlets.size());
+					pack.lodMeshlets.insert(pack.lodMeshlets.end(), lods.meshlets.begin() + start, lods.meshlets.begin() + start + group.meshletCount);
+				}
+			}
+		}
+	}
+
+	MeshUploadStats uploadStats;
+	SceneGeometry geometry;
+	auto meshes = create_meshes(window, allocator, uploadQueue, uploads, geometry, &uploadStats);
+
+	// Decode all textures up front on a worker pool; only the GPU upload
+	// remains serial
+	std::vector<lut::ImageDecodeRequest> decodeRequests;
+	std::unordered_map<std::string, std::size_t> decodeIndex; // by normalized path
+	for (auto const& mesh : meshes)
+	{
+		if (mesh.colorTexturePath.empty())
+			continue;
+
+		if (decodeIndex.emplace(lut::ResourceCache::normalize_path(mesh.colorTexturePath), decodeRequests.size()).second)
+			decodeRequests.emplace_back(lut::ImageDecodeRequest{ mesh.colorTexturePath });
+	}
+
+	std::vector<lut::DecodedImage> decodedTextures; // by decodeRequests index; empty if baked
+	std::vector<std::optional<lut::CompressedImage>> compressedTextures; // if compressed, by decodeRequests index
+	std::vector<std::optional<lut::Ktx2Image>> bakedTextures(decodeRequests.size()); // if baked, by decodeRequests index
+	{
+		lut::ThreadPool decodePool(cfg::kTextureDecodeThreads);
+
+		bool const supported[] = {
+			cfg::kCompressTextures && lut::supports_format_features(window, lut::block_format_srgb(lut::BlockFormat::bc1)),
+			cfg::kCompressTextures && lut::supports_format_features(window, lut::block_format_srgb(lut::BlockFormat::bc7))
+		};
+
+		// Everything that affects the contents of the baked textures
+		bool const bakeTextures = cfg::kBakeTextures && (cfg::kCpuMipmaps || cfg::kCompressTextures);
+
+		char bakeSettings[96];
+		std::snprintf(bakeSettings, sizeof(bakeSettings), "mips=%s;format=%s;bc1=%d;bc7=%d",
+			lut::MipFilter::box == cfg::kCpuMipFilter ? "box" : "kaiser",
+			!cfg::kCompressTextures ? "rgba8" : lut::BlockFormat::bc1 == cfg::kTextureBlockFormat ? "bc1" : "bc7",
+			int(supported[0]), int(supported[1]));
+
+		std::vector<std::string> bakeWarnings(decodeRequests.size());
+		if (bakeTextures)
+		{
+			auto const bakedStart = std::chrono::steady_clock::now();
+
+			decodePool.parallel_for(decodeRequests.size(), [&](std::size_t i) {
+				try
+				{
+					bakedTextures[i] = lut::load_baked_texture(decodeRequests[i].path, bakeSettings);
+				}
+				catch (std::exception const& eErr)
+				{
+					bakeWarnings[i] = "Warning: ignoring baked texture '" + lut::baked_texture_path(decodeRequests[i].path) + "': " + eErr.what();
+				}
+			});
+
+			std::size_t count = 0, mappedBytes = 0;
+			for (std::size_t i = 0; i < bakedTextures.size(); ++i)
+			{
+				if (!bakeWarnings[i].empty())
+					std::fprintf(stderr, "%s\n", bakeWarnings[i].c_str());
+
+				if (bakedTextures[i])
+				{
+					++count;
+					mappedBytes += bakedTextures[i]->file.size;
+				}
+			}
+
+			std::printf("Textures: %zu of %zu images loaded from baked KTX2 files (%.1f MiB mapped) in %.2f ms\n",
+				count, bakedTextures.size(), mappedBytes / (1024.0 * 1024.0),
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bakedStart).count());
+		}
+
+		// Describe the sources of the remaining textures before decoding them,
+		// such that changes made in the meantime invalidate the baked files
+		std::vector<std::size_t> missing;
+		for (std::size_t i = 0; i < decodeRequests.size(); ++i)
+		{
+			if (!bakedTextures[i])
+				missing.emplace_back(i);
+		}
+
+		std::vector<std::optional<lut::BakeSource>> bakeSources(decodeRequests.size());
+		if (bakeTextures)
+		{
+			decodePool.parallel_for(missing.size(), [&](std::size_t i) {
+				try
+				{
+					bakeSources[missing[i]] = lut::describe_bake_source(decodeRequests[missing[i]].path.c_str());
+				}
+				catch (std::exception const&)
+				{
+					// Not baked; decoding below reports the error
+				}
+			});
+		}
+
+		std::vector<lut::ImageDecodeRequest> missingRequests;
+		for (auto const i : missing)
+			missingRequests.emplace_back(decodeRequests[i]);
+
+		auto const decodeStart = std::chrono::steady_clock::now();
+		auto decodedMissing = lut::decode_images(missingRequests, &decodePool);
+		auto const decodeWall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+
+		decodedTextures.resize(decodeRequests.size());
+		for (std::size_t i = 0; i < missing.size(); ++i)
+			decodedTextures[missing[i]] = std::move(decodedMissing[i]);
+
+		double decodeSum = 0.0;
+		std::size_t decodedBytes = 0;
+		for (auto const& image : decodedTextures)
+		{
+			decodeSum += image.decodeMilliseconds;
+			for (auto const& level : image.levels)
+				decodedBytes += level.size_bytes();
+		}
+
+		if (!missing.empty())
+		{
+			std::printf("Textures: decoded %zu images (%.1f MiB RGBA) on %zu thread(s) in %.2f ms (%.2f ms of decoding, %.2fx)\n",
+				missing.size(), decodedBytes / (1024.0 * 1024.0), decodePool.thread_count(), decodeWall, decodeSum,
+				decodeSum / std::max(decodeWall, 1e-3));
+		}
+
+		if ((cfg::kCpuMipmaps || cfg::kCompressTextures) && !missing.empty())
+		{
+			auto const mipStart = std::chrono::steady_clock::now();
+
+			// Images in parallel, and the rows of each level in parallel within
+			// each image
+			decodePool.parallel_for(decodedTextures.size(), [&](std::size_t i) {
+				if (1 == decodedTextures[i].levels.size())
+					lut::generate_mipmaps(decodedTextures[i], cfg::kCpuMipFilter, true, &decodePool);
+			});
+
+			std::size_t levels = 0;
+			for (auto const& image : decodedTextures)
+				levels += image.levels.size();
+
+			std::printf("Textures: generated mip chains (%s filter, %zu levels total) in %.2f ms\n",
+				lut::MipFilter::box == cfg::kCpuMipFilter ? "box" : "Kaiser", levels,
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mipStart).count());
+		}
+
+		if (cfg::kCompressTextures && !missing.empty())
+		{
+			auto const compressStart = std::chrono::steady_clock::now();
+
+			compressedTextures.resize(decodedTextures.size());
+			decodePool.parallel_for(decodedTextures.size(), [&](std::size_t i) {
+				if (decodedTextures[i].levels.empty())
+					return;
+
+				auto format = cfg::kTextureBlockFormat;
+				if (lut::BlockFormat::bc1 == format && !lut::is_opaque(decodedTextures[i]))
+					format = lut::BlockFormat::bc7;
+
+				if (supported[std::size_t(format)])
+					compressedTextures[i] = lut::compress_image(decodedTextures[i], format, &decodePool);
+			});
+
+			auto const compressWall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compressStart).count();
+
+			std::size_t count = 0, bc1Count = 0, rawBytes = 0, compressedBytes = 0;
+			double psnrSum = 0.0, psnrMin = std::numeric_limits<double>::infinity();
+			for (std::size_t i = 0; i < compressedTextures.size(); ++i)
+			{
+				auto const& compressed = compressedTextures[i];
+				if (!compressed)
+					continue;
+
+				++count;
+				if (lut::BlockFormat::bc1 == compressed->format)
+					++bc1Count;
+
+				for (auto const& level : decodedTextures[i].levels)
+					rawBytes += level.size_bytes();
+				for (auto const& level : compressed->levels)
+					compressedBytes += level.blocks.size();
+
+				auto const psnr = lut::compression_psnr(decodedTextures[i], *compressed);
+				psnrSum += psnr;
+				psnrMin = std::min(psnrMin, psnr);
+			}
+
+			std::printf("Textures: compressed %zu of %zu images (%zu BC1, %zu BC7) in %.2f ms, %.1f MiB -> %.1f MiB VRAM (%.1fx), PSNR %.2f dB avg., %.2f dB min.\n",
+				count, missing.size(), bc1Count, count - bc1Count, compressWall, rawBytes / (1024.0 * 1024.0),
+				compressedBytes / (1024.0 * 1024.0), double(rawBytes) / std::max<std::size_t>(1, compressedBytes),
+				count ? psnrSum / count : 0.0, psnrMin);
+		}
+
+		if (bakeTextures && !missing.empty())
+		{
+			auto const bakeStart = std::chrono::steady_clock::now();
+
+			std::vector<std::size_t> bakedBytes(decodeRequests.size(), 0);
+			decodePool.parallel_for(missing.size(), [&](std::size_t m) {
+				auto const i = missing[m];
+				if (!bakeSources[i])
+					return;
+
+				VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+				std::vector<lut::ImageLevelData> levels;
+				if (i < compressedTextures.size() && compressedTextures[i])
+				{
+					format = lut::block_format_srgb(compressedTextures[i]->format);
+					for (auto const& level : compressedTextures[i]->levels)
+						levels.emplace_back(lut::ImageLevelData{ level.width, level.height, level.blocks.data(), level.blocks.size() });
+				}
+				else
+				{
+					for (auto const& level : decodedTextures[i].levels)
+						levels.emplace_back(lut::ImageLevelData{ level.width, level.height, level.pixels.get(), level.size_bytes() });
+				}
+
+				try
+				{
+					lut::bake_texture(decodeRequests[i].path, bakeSettings, *bakeSources[i], format, levels);
+					for (auto const& level : levels)
+						bakedBytes[i] += level.size;
+				}
+				catch (std::exception const& eErr)
+				{
+					bakeWarnings[i] = "Warning: unable to bake texture '" + lut::baked_texture_path(decodeRequests[i].path) + "': " + eErr.what();
+				}
+			});
+
+			std::size_t count = 0, bytes = 0;
+			for (auto const i : missing)
+			{
+				if (!bakeWarnings[i].empty())
+					std::fprintf(stderr, "%s\n", bakeWarnings[i].c_str());
+
+				if (bakedBytes[i])
+				{
+					++count;
+					bytes += bakedBytes[i];
+				}
+			}
+
+			std::printf("Textures: baked %zu KTX2 file(s) (%.1f MiB of levels) in %.2f ms\n", count, bytes / (1024.0 * 1024.0),
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bakeStart).count());
+		}
+	}
+
+	// Streamed textures take over the prepared mip chains; by decodeRequests
+	// index
+	std::vector<std::uint32_t> streamedTextures(decodeRequests.size(), lut::kNoStreamedTexture);
+	std::vector<bool> streamChecked(decodeRequests.size(), false);
+
+	auto const stream_texture = [&](std::size_t index) {
+		if (!cfg::kStreamTextures || streamChecked[index])
+			return streamedTextures[index];
+
+		streamChecked[index] = true;
+
+		lut::MipChainSource source;
+		if (bakedTextures[index])
+		{
+			source = lut::ktx2_mip_source(std::make_shared<lut::Ktx2Image const>(std::move(*bakedTextures[index])));
+			bakedTextures[index].reset();
+		}
+		else if (index < compressedTextures.size() && compressedTextures[index])
+		{
+			auto const image = std::make_shared<lut::CompressedImage const>(std::move(*compressedTextures[index]));
+			compressedTextures[index].reset();
+
+			std::vector<lut::ImageLevelData> levels;
+			for (auto const& level : image->levels)
+				levels.emplace_back(lut::ImageLevelData{ level.width, level.height, level.blocks.data(), level.blocks.size() });
+
+			source = lut::memory_mip_source(lut::block_format_srgb(image->format), std::move(levels), image);
+		}
+		else if (decodedTextures[index].levels.size() > 1)
+		{
+			auto const image = std::make_shared<lut::DecodedImage const>(std::move(decodedTextures[index]));
+			decodedTextures[index] = {};
+
+			std::vector<lut::ImageLevelData> levels;
+			for (auto const& level : image->levels)
+				levels.emplace_back(lut::ImageLevelData{ level.width, level.height, level.pixels.get(), level.size_bytes() });
+
+			source = lut::memory_mip_source(VK_FORMAT_R8G8B8A8_SRGB, std::move(levels), image);
+		}
+		else
+		{
+			return lut::kNoStreamedTexture; // a single level, which is loaded as before
+		}
+
+		return streamedTextures[index] = textureStreamer.add(std::move(source));
+	};
+
+	for (std::size_t i = 0; i < meshes.size(); ++i)
+	{
+		PreparedTexture prepared;
+		if (!meshes[i].colorTexturePath.empty())
+		{
+			auto const index = decodeIndex.at(lut::ResourceCache::normalize_path(meshes[i].colorTexturePath));
+			prepared.streamed = stream_texture(index);
+			if (lut::kNoStreamedTexture != prepared.streamed)
+				prepared.streamedBindless = textureStreamer.bindless_index(prepared.streamed);
+			if (bakedTextures[index])
+				prepared.baked = &*bakedTextures[index];
+			prepared.decoded = &decodedTextures[index];
+			if (index < compressedTextures.size() && compressedTextures[index])
+				prepared.compressed = &*compressedTextures[index];
+		}
+
+		auto culling = std::move(modelBuffer[i]);
+		modelBuffer[i] = create_model_buffer_pack(window, allocator, uploadQueue, resourceCache, materials, std::move(meshes[i]), materialLayout.handle, dpool.handle, prepared,
+			bindlessTextures.get());
+
+		modelBuffer[i].meshlets = std::move(culling.meshlets);
+		modelBuffer[i].meshletBounds = std::move(culling.meshletBounds);
+		modelBuffer[i].lodGroups = std::move(culling.lodGroups);
+		modelBuffer[i].lodMeshlets = std::move(culling.lodMeshlets);
+		modelBuffer[i].bounds = culling.bounds;
+	}
+
+	// Textured meshes first, such that each pipeline is bound once per frame
+	// (see record_commands())
+	auto const firstUntextured = std::stable_partition(modelBuffer.begin(), modelBuffer.end(), [](ModelBufferPack const& pack) {
+		return pack.textured();
+	});
+	std::size_t const untexturedMeshes = std::size_t(modelBuffer.end() - firstUntextured);
+
+	// Without bindless textures, draws are batched per texture set; meshes that
+	// share one are made adjacent
+	if (!bindlessTextures)
+	{
+		std::stable_sort(modelBuffer.begin(), firstUntextured, [](ModelBufferPack const& a, ModelBufferPack const& b) {
+			return std::pair(a.streamedTexture, a.materialDescriptorSet) < std::pair(b.streamedTexture, b.materialDescriptorSet);
+		});
+	}
+
+	// Bounding spheres for culling whole meshes, in mesh order
+	BoundsSoA meshBounds;
+	for (auto const& pack : modelBuffer)
+		meshBounds.push_back(pack.bounds.center, pack.bounds.radius);
+
+	if (cfg::kBenchmarkBoundsCulling)
+	{
+		// From the initial camera, with the scene's projection
+		glsl::SceneUniform uniforms{};
+		update_scene_uniforms(uniforms, window.swapchainExtent.width, window.swapchainExtent.height);
+		Frustum const frustum = make_frustum(uniforms.projCam);
+		glm::vec3 const cameraPos = glm::vec3(glm::inverse(uniforms.camera)[3]);
+		float const pixelScale = lod_pixel_scale(lut::Radians(cfg::kCameraFov).value(), float(window.swapchainExtent.height));
+
+		for (std::size_t const count : { std::size_t(10000), std::size_t(100000), std::size_t(1000000) })
+		{
+			auto const bench = benchmark_cull_bounds(count, frustum, cameraPos, pixelScale, cfg::kMinObjectPixels);
+			std::printf("Culling: %8zu spheres, %zu visible, SIMD %.3f ms, scalar %.3f ms (%.2fx)%s\n", bench.count, bench.visible,
+				bench.simdMilliseconds, bench.scalarMilliseconds, bench.scalarMilliseconds / std::max(bench.simdMilliseconds, 1e-6),
+				bench.identical ? "" : ", results differ");
+		}
+	}
+
+	// Per-draw data, in mesh order; the indirect draws select it with their
+	// first instance
+	std::vector<glsl::DrawData> drawData;
+	for (auto const& pack : modelBuffer)
+		drawData.emplace_back(glsl::DrawData{ pack.dequant, pack.materialIndex, {} });
+
+	VkDeviceSize const drawDataBytes = std::max<VkDeviceSize>(1, drawData.size()) * sizeof(glsl::DrawData);
+	lut::Buffer drawDataBuffer = lut::create_buffer(
+		allocator,
+		drawDataBytes,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+
+	{
+		auto const staging = uploadQueue.stage(drawDataBytes);
+		std::memset(staging.data, 0, std::size_t(drawDataBytes));
+		std::memcpy(staging.data, drawData.data(), drawData.size() * sizeof(glsl::DrawData));
+		uploadQueue.copy_to_buffer(staging, drawDataBuffer.buffer, drawDataBytes, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	update_descriptor_set(window, drawDataBuffer.buffer, matrixDescriptors, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1);
+
+	// Indirect draw commands, one buffer per frame slot. A mesh has at most one
+	// command per meshlet and LOD group (consecutive ones are merged), or one
+	// for the whole mesh.
+	std::uint32_t maxDrawCommands = 0;
+	for (auto const& pack : modelBuffer)
+		maxDrawCommands += std::max<std::uint32_t>(1, std::uint32_t(pack.meshlets.size() + pack.lodGroups.size()));
+
+	// GPU culling draws fixed batches of meshes that share their state, in mesh
+	// order (textured first). Each batch has its own range of commands and
+	// count.
+	std::vector<DrawBatch> drawBatches;
+	std::vector<std::uint32_t> packBatches;
+	std::unique_ptr<GpuCuller> gpuCuller;
+	if (gpuCulling)
+	{
+		for (auto const& pack : modelBuffer)
+		{
+			// With bindless textures, all textured meshes share their state
+			bool const perMaterialSets = pack.textured() && !bindlessTextures;
+			DrawBatch const batch{ pack.textured(), pack.indexType,
+				perMaterialSets ? pack.streamedTexture : lut::kNoStreamedTexture,
+				perMaterialSets ? pack.materialDescriptorSet : VK_NULL_HANDLE };
+
+			auto const it = std::find(drawBatches.begin(), drawBatches.end(), batch);
+			packBatches.emplace_back(std::uint32_t(it - drawBatches.begin()));
+			if (drawBatches.end() == it)
+				drawBatches.emplace_back(batch);
+		}
+
+		gpuCuller = std::make_unique<GpuCuller>(window, allocator, uploadQueue, dpool.handle, modelBuffer, packBatches,
+			std::uint32_t(drawBatches.size()), std::uint32_t(cbfences.size()), cfg::kCullShaderPath);
+		if (depthPyramid)
+			gpuCuller->set_depth_pyramid(*depthPyramid);
+	}
+
+	std::vector<IndirectDraws> indirectDraws;
+	for (std::size_t i = 0; i < cbfences.size(); ++i)
+		indirectDraws.emplace_back(create_indirect_draws(allocator, maxDrawCommands));
+
+	if (gpuCuller)
+	{
+		std::printf("Draws: %zu meshes in one vertex buffer (%.1f KiB) and %d index buffer(s) (%.1f KiB), %u cull items in %zu batch(es), culled on the GPU%s\n",
+			modelBuffer.size(), geometry.vertexBytes / 1024.0, int(0 != geometry.indexBytes16) + int(0 != geometry.indexBytes32),
+			(geometry.indexBytes16 + geometry.indexBytes32) / 1024.0, gpuCuller->item_count(), drawBatches.size(),
+			occlusionCulling ? ", with two-phase occlusion culling" : "");
+	}
+	else
+	{
+		std::printf("Draws: %zu meshes in one vertex buffer (%.1f KiB) and %d index buffer(s) (%.1f KiB), up to %u indirect commands per frame, %s%s\n",
+			modelBuffer.size(), geometry.vertexBytes / 1024.0, int(0 != geometry.indexBytes16) + int(0 != geometry.indexBytes32),
+			(geometry.indexBytes16 + geometry.indexBytes32) / 1024.0, maxDrawCommands,
+			window.multiDrawIndirect ? "multi-draw" : "one call per command (no multi-draw)",
+			cfg::kGpuCulling ? ", culled on the CPU (no draw indirect count)" : "");
+	}
+
+	// Material constants, indexed per draw
+	std::vector<glsl::MaterialConstants> materialConstants;
+	for (auto const& entry : materials.entries)
+		materialConstants.emplace_back(glsl::MaterialConstants{ entry.color, entry.streamedTexture, entry.texture, {} });
+
+	VkDeviceSize const materialBytes = std::max<VkDeviceSize>(1, materialConstants.size()) * sizeof(glsl::MaterialConstants);
+	lut::Buffer materialBuffer = lut::create_buffer(
+		allocator,
+		materialBytes,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+
+	{
+		auto const staging = uploadQueue.stage(materialBytes);
+		std::memset(staging.data, 0, std::size_t(materialBytes));
+		std::memcpy(staging.data, materialConstants.data(), materialConstants.size() * sizeof(glsl::MaterialConstants));
+		uploadQueue.copy_to_buffer(staging, materialBuffer.buffer, materialBytes, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	VkDescriptorSet materialConstantsSet = lut::alloc_desc_set(window, dpool.handle, materialConstantsLayout.handle);
+	update_descriptor_set(window, materialBuffer.buffer, materialConstantsSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+	// Submit the last textures. Nothing waits for the copies: the frames are
+	// submitted to the graphics queue after them, which orders them (see
+	// lut::UploadQueue).
+	uploadQueue.flush();
+
+	std::printf("Upload: %zu meshes, %.1f KiB in %zu batch(es)\n",
+		meshes.size(), uploadStats.stagedBytes / 1024.0, uploadStats.batches);
+	{
+		auto const& us = uploadQueue.stats();
+		std::printf("Upload: %zu batch(es) on the %s queue, %zu buffer and %zu image copies (%zu with blitted mipmaps), %zu ownership transfers\n",
+			us.batches, uploadQueue.uses_transfer_queue() ? "transfer" : "graphics", us.bufferCopies, us.imageCopies, us.blits, us.ownershipTransfers);
+
+		auto const& rs = stagingRing.stats();
+		std::printf("Upload: %.1f MiB staging ring, %zu allocations (%.1f MiB) in %zu submissions, %zu waited for space, %zu dedicated\n",
+			rs.capacity / (1024.0 * 1024.0), rs.allocations, rs.allocatedBytes / (1024.0 * 1024.0), rs.submissions, rs.waits, rs.dedicated);
+	}
+
+	{
+		auto const& cs = resourceCache.stats();
+		std::printf("Textures: %zu requests -> %zu images, %zu -> %zu sampler(s), %zu -> %zu descriptor sets\n",
+			cs.textureRequests, cs.texturesLoaded, cs.samplerRequests, cs.samplersCreated, cs.setRequests, cs.setsAllocated);
+		std::printf("Textures: %.1f MiB VRAM (%.1f MiB without sharing), loaded in %.2f ms (%.2f ms saved)\n",
+			cs.textureBytes / (1024.0 * 1024.0), cs.textureBytesRequested / (1024.0 * 1024.0), cs.loadMilliseconds, cs.savedMilliseconds);
+		std::printf("Materials: %zu constant entries (%zu bytes), %zu untextured mesh(es) without images\n",
+			materialConstants.size(), std::size_t(materialBytes), untexturedMeshes);
+
+		auto const ss = textureStreamer.stats();
+		std::printf("Streaming: %zu texture(s), %zu/%zu levels resident (%.1f MiB)\n",
+			ss.textures, ss.residentLevels, ss.totalLevels, ss.residentBytes / (1024.0 * 1024.0));
+	}
+
+	uploads.clear();
+
+	// The geometry now lives on the GPU; the CPU-side copy is only kept if
+	// requested
+	if (!cfg::kKeepCpuGeometry)
+	{
+		for (auto* model : { &cityModel, &carModel })
+		{
+			model->vertexPositions = {};
+			model->vertexNormals = {};
+			model->vertexTextureCoords = {};
+			model->indices = {};
+		}
+	}
+
+	std::printf("Vertex format: %zu bytes/vertex (fp32: %zu), vertex data %.1f KiB (fp32: %.1f KiB, %.1f%%)\n",
+		sizeof(cfg::RenderVertex), sizeof(VertexF32), packedVertexBytes / 1024.0, floatVertexBytes / 1024.0,
+		100.0 * packedVertexBytes / std::max<std::size_t>(1, floatVertexBytes));
+
+	// Uploads from here on are streamed alongside the frames
+	uploadQueue.set_budget(lut::UploadBudget{ cfg::kUploadBytesPerFrame, cfg::kUploadMillisecondsPerFrame });
 
 	// Application main loop
 	bool recreateSwapchain = false;
 
+	DrawStats drawStats;
+	auto lastStatsReport = std::chrono::steady_clock::now();
+
 	while (!glfwWindowShouldClose(window.window))
 	{
 		// window event check
@@ -858,15 +2157,25 @@ int main() try
 			// re-create render pass
 			if (changes.changedFormat)
 			{
-				renderPass = create_render_pass(window);
+				renderPass = create_render_pass(window, occlusionCulling ? RenderPassUse::beforeDepthPyramid : RenderPassUse::whole);
+				if (occlusionCulling)
+					resumeRenderPass = create_render_pass(window, RenderPassUse::afterDepthPyramid);
 			}
 
 
 			// re-create pipeline
 			if (changes.changedSize)
 			{
-				pipe = create_pipeline(window, renderPass.handle, pipeLayout.handle);
-				std::tie(depthBuffer, depthBufferView) = create_depth_buffer(window, allocator);
+				pipe = create_pipeline(window, renderPass.handle, pipeLayout.handle, texturedFragShaderPath);
+				untexturedPipe = create_pipeline(window, renderPass.handle, pipeLayout.handle, cfg::kUntexturedFragShaderPath);
+				std::tie(depthBuffer, depthBufferView) = create_depth_buffer(window, allocator, occlusionCulling);
+
+				if (depthPyramid)
+				{
+					depthPyramid.reset();
+					depthPyramid = std::make_unique<DepthPyramid>(window, allocator, depthBufferView.handle, window.swapchainExtent, cfg::kDepthPyramidShaderPath);
+					gpuCuller->set_depth_pyramid(*depthPyramid);
+				}
 			}
 
 			// clear framebuffers in the vector and recreate a new vector of framebuffer
@@ -925,6 +2234,16 @@ int main() try
 		}
 
 
+		// Uploads made for this frame stop once they have used the frame's
+		// budget (see lut::UploadQueue::has_budget())
+		uploadQueue.begin_frame();
+
+		// The frame's previous use has completed, so its mip feedback can be
+		// read and its texture sets updated
+		textureStreamer.begin_frame(imageIndex);
+		if (bindlessTextures)
+			bindlessTextures->begin_frame(imageIndex);
+
 		// Prepare data for this frame
 		glsl::SceneUniform matrixUniforms{};
 		update_scene_uniforms(matrixUniforms, window.swapchainExtent.width,
@@ -937,16 +2256,77 @@ int main() try
 		record_commands(
 			cbuffers[imageIndex],
 			renderPass.handle,
+			resumeRenderPass.handle,
 			framebuffers[imageIndex].handle,
 			pipe.handle,
+			untexturedPipe.handle,
 			pipeLayout.handle,
 			window.swapchainExtent,
 			modelBuffer,
+			meshBounds,
+			geometry,
 			matrixUBO.buffer,
 			matrixDescriptors,
-			matrixUniforms
+			materialConstantsSet,
+			matrixUniforms,
+			textureStreamer,
+			imageIndex,
+			bindlessTextures ? bindlessTextures->set(imageIndex) : VK_NULL_HANDLE,
+			allocator,
+			indirectDraws[imageIndex],
+			window.multiDrawIndirect,
+			gpuCuller.get(),
+			drawBatches,
+			depthPyramid.get(),
+			occlusionCuller.get(),
+			drawStats
 		);
 
+		// Report culling results about once per second
+		if (auto const now = std::chrono::steady_clock::now(); now - lastStatsReport >= std::chrono::seconds(1))
+		{
+			if (gpuCuller)
+			{
+				// From this slot's previous frame, which has completed
+				auto const cs = gpuCuller->stats(imageIndex);
+				// Each visible item writes exactly one draw command
+				std::printf("Frame: %zu/%zu cull items drawn (%zu culled on the GPU) in %zu indirect call(s), %zu triangles",
+					cs.visible, cs.items, cs.culled, drawStats.indirectCalls, cs.triangles);
+				if (occlusionCulling)
+					std::printf(", %zu occluded, %zu drawn by the second phase", cs.occluded, cs.disoccluded);
+				std::printf("\n");
+			}
+			else
+			{
+				std::printf("Frame: %zu/%zu meshes and %zu/%zu clusters visible, %zu draws in %zu indirect call(s), %zu triangles (%zu at full detail, %.1f%%), LOD groups per level:",
+					drawStats.visibleMeshes, drawStats.meshes, drawStats.visibleClusters, drawStats.clusters, drawStats.draws, drawStats.indirectCalls, drawStats.triangles, drawStats.fullDetailTriangles,
+					100.0 * drawStats.triangles / std::max<std::size_t>(1, drawStats.fullDetailTriangles));
+				for (auto const count : drawStats.lodGroups)
+					std::printf(" %zu", count);
+				std::printf("\n");
+
+				if (occlusionCuller)
+				{
+					auto const& os = occlusionCuller->stats();
+					std::printf("Occlusion: %zu/%zu tests occluded (%.1f%%), %zu occluder triangles (%zu binned), raster %.3f ms + tests %.3f ms on %zu thread(s)\n",
+						os.occluded, os.tested, 100.0 * os.occluded / std::max<std::size_t>(1, os.tested), os.triangles, os.binned,
+						os.rasterMilliseconds, os.testMilliseconds, occlusionCuller->thread_count());
+				}
+			}
+
+			if (textureStreamer.texture_count() > 0)
+			{
+				auto const ss = textureStreamer.stats();
+				std::printf("Streaming: %zu/%zu levels resident, %.1f MiB of %.1f MiB budget, %zu level(s) loaded, %zu evicted, %zu deferred\n",
+					ss.residentLevels, ss.totalLevels, ss.residentBytes / (1024.0 * 1024.0), ss.budgetBytes / (1024.0 * 1024.0),
+					ss.loads, ss.evictions, ss.deferred);
+			}
+			lastStatsReport = now;
+		}
+
+		// The frame's uploads go ahead of it on the graphics queue
+		uploadQueue.flush();
+
 		submit_commands(
 			window,
 			cbuffers[imageIndex],
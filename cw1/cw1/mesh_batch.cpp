@@ -0,0 +1,116 @@
+#include "mesh_batch.hpp"
+
+#include <limits>
+#include <vector>
+#include <utility>
+
+#include <cassert>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+BatchStats batch_meshes_by_material( ModelData& aModel )
+{
+	BatchStats stats{};
+	stats.meshesBefore = aModel.meshes.size();
+
+	// Group meshes by material, in order of first use
+	std::vector<std::vector<std::size_t>> groups;
+	std::vector<std::size_t> groupOfMaterial( aModel.materials.size(), ~std::size_t(0) );
+
+	for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
+	{
+		auto const& mesh = aModel.meshes[i];
+		if( 0 == mesh.numberOfIndices && 0 != mesh.numberOfVertices )
+			throw lut::Error( "batch_meshes_by_material(): mesh '%s' is not indexed", mesh.meshName.c_str() );
+		if( 0 != mesh.numberOfSubMeshes )
+			throw lut::Error( "batch_meshes_by_material(): mesh '%s' is already batched", mesh.meshName.c_str() );
+
+		assert( mesh.materialIndex < aModel.materials.size() );
+		auto& group = groupOfMaterial[mesh.materialIndex];
+		if( ~std::size_t(0) == group )
+		{
+			group = groups.size();
+			groups.emplace_back();
+		}
+
+		groups[group].emplace_back( i );
+	}
+
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<std::uint32_t> indices;
+
+	positions.reserve( aModel.vertexPositions.size() );
+	normals.reserve( aModel.vertexNormals.size() );
+	texcoords.reserve( aModel.vertexTextureCoords.size() );
+	indices.reserve( aModel.indices.size() );
+
+	std::vector<MeshInfo> batches;
+	std::vector<SubMeshInfo> subMeshes;
+	subMeshes.reserve( aModel.meshes.size() );
+
+	for( auto const& group : groups )
+	{
+		auto const materialIndex = aModel.meshes[group.front()].materialIndex;
+
+		MeshInfo batch{};
+		batch.meshName           = "batch::" + aModel.materials[materialIndex].materialName;
+		batch.materialIndex      = materialIndex;
+		batch.vertexStartIndex   = positions.size();
+		batch.indexStartIndex    = indices.size();
+		batch.subMeshStartIndex  = subMeshes.size();
+
+		for( auto const meshIndex : group )
+		{
+			auto const& mesh = aModel.meshes[meshIndex];
+
+			auto const vertexOffset = positions.size() - batch.vertexStartIndex;
+			if( vertexOffset + mesh.numberOfVertices > std::numeric_limits<std::uint32_t>::max() )
+				throw lut::Error( "batch_meshes_by_material(): batch '%s' has too many vertices", batch.meshName.c_str() );
+
+			auto const vbeg = mesh.vertexStartIndex, vend = vbeg + mesh.numberOfVertices;
+			positions.insert( positions.end(), aModel.vertexPositions.begin() + vbeg, aModel.vertexPositions.begin() + vend );
+			normals.insert( normals.end(), aModel.vertexNormals.begin() + vbeg, aModel.vertexNormals.begin() + vend );
+			texcoords.insert( texcoords.end(), aModel.vertexTextureCoords.begin() + vbeg, aModel.vertexTextureCoords.begin() + vend );
+
+			SubMeshInfo sub{};
+			sub.meshName         = mesh.meshName;
+			sub.indexStartIndex  = indices.size();
+			sub.numberOfIndices  = mesh.numberOfIndices;
+			sub.boundsMin        = glm::vec3( std::numeric_limits<float>::max() );
+			sub.boundsMax        = glm::vec3( -std::numeric_limits<float>::max() );
+
+			for( std::size_t i = 0; i < mesh.numberOfIndices; ++i )
+			{
+				auto const index = aModel.indices[mesh.indexStartIndex + i];
+				assert( index < mesh.numberOfVertices );
+
+				auto const& p = aModel.vertexPositions[mesh.vertexStartIndex + index];
+				sub.boundsMin = glm::min( sub.boundsMin, p );
+				sub.boundsMax = glm::max( sub.boundsMax, p );
+
+				indices.emplace_back( std::uint32_t(index + vertexOffset) );
+			}
+
+			subMeshes.emplace_back( std::move(sub) );
+		}
+
+		batch.numberOfVertices   = positions.size() - batch.vertexStartIndex;
+		batch.numberOfIndices    = indices.size() - batch.indexStartIndex;
+		batch.numberOfSubMeshes  = subMeshes.size() - batch.subMeshStartIndex;
+
+		batches.emplace_back( std::move(batch) );
+	}
+
+	aModel.meshes = std::move(batches);
+	aModel.subMeshes = std::move(subMeshes);
+	aModel.vertexPositions = std::move(positions);
+	aModel.vertexNormals = std::move(normals);
+	aModel.vertexTextureCoords = std::move(texcoords);
+	aModel.indices = std::move(indices);
+
+	stats.meshesAfter = aModel.meshes.size();
+	return stats;
+}
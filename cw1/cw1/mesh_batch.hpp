@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+#include "model.hpp"
+
+/* Material batching.
+ *
+ * load_obj_model() starts a new mesh every time the material changes, and
+ * each mesh ends up as a separate draw with its own vertex/index buffers and
+ * descriptor binds. batch_meshes_by_material() merges all meshes that use
+ * the same material (within and across OBJ shapes) into a single mesh with
+ * one contiguous vertex and index range.
+ *
+ * The original meshes are kept as SubMeshInfo ranges of the batch, together
+ * with their bounds, so that they can still be culled individually.
+ *
+ * Batches appear in the order in which their material is first used. Inside
+ * a batch, the original meshes keep their order (and their triangle order,
+ * so optimize_meshes() results are preserved). Requires an indexed model.
+ */
+
+struct BatchStats
+{
+	std::size_t meshesBefore = 0;
+	std::size_t meshesAfter = 0;
+};
+
+BatchStats batch_meshes_by_material( ModelData& aModel );
@@ -0,0 +1,771 @@
+#include "mesh_lod.hpp"
+
+#include <queue>
+#include <utility>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kNone = ~std::uint32_t(0);
+
+	std::uint32_t spread_bits_( std::uint32_t aX ) noexcept
+	{
+		// 10 bits -> every third bit of 30
+		aX &= 0x3ff;
+		aX = (aX | (aX << 16)) & 0x030000ff;
+		aX = (aX | (aX <<  8)) & 0x0300f00f;
+		aX = (aX | (aX <<  4)) & 0x030c30c3;
+		aX = (aX | (aX <<  2)) & 0x09249249;
+		return aX;
+	}
+
+	// Each level targets this fraction of the previous level's triangles
+	constexpr float kLodReduction = 0.5f;
+	// Levels that keep more than this fraction of the previous level's
+	// triangles are dropped
+	constexpr float kLodMinReduction = 0.85f;
+
+	// Vertices on an open edge may slide along it, together with their twin
+	// on the other side, if the edges on either side are this close to
+	// parallel (cosine of the angle between them)
+	constexpr float kBorderSlideCos = 0.9999f;
+
+	// Quadric over (x, y, z, u, v), see Garland & Heckbert, "Simplifying
+	// surfaces with color and texture using quadric error metrics". Q(p) is
+	// the sum of squared distances of p to the triangles (extended to planes)
+	// accumulated in Q, so texture coordinates are preserved as well.
+	struct Quadric_
+	{
+		static constexpr int kDim = 5;
+
+		double a[kDim*(kDim+1)/2] = {}; // upper triangle of A, row-major
+		double b[kDim] = {};
+		double c = 0.0;
+
+		void add_triangle( double const* aP0, double const* aP1, double const* aP2 ) noexcept
+		{
+			double e1[kDim], e2[kDim];
+			for( int i = 0; i < kDim; ++i )
+			{
+				e1[i] = aP1[i] - aP0[i];
+				e2[i] = aP2[i] - aP0[i];
+			}
+
+			// Orthonormal basis of the triangle's plane
+			auto const dot = [] ( double const* aX, double const* aY ) {
+				double r = 0.0;
+				for( int i = 0; i < kDim; ++i )
+					r += aX[i] * aY[i];
+				return r;
+			};
+
+			auto const l1 = std::sqrt( dot( e1, e1 ) );
+			if( l1 <= 0.0 )
+				return;
+			for( auto& x : e1 )
+				x /= l1;
+
+			auto const d12 = dot( e1, e2 );
+			for( int i = 0; i < kDim; ++i )
+				e2[i] -= d12 * e1[i];
+
+			auto const l2 = std::sqrt( dot( e2, e2 ) );
+			if( l2 <= 0.0 )
+				return;
+			for( auto& x : e2 )
+				x /= l2;
+
+			// A = I - e1 e1^T - e2 e2^T, b = (p.e1) e1 + (p.e2) e2 - p,
+			// c = p.p - (p.e1)^2 - (p.e2)^2
+			auto const pe1 = dot( aP0, e1 ), pe2 = dot( aP0, e2 );
+
+			int k = 0;
+			for( int i = 0; i < kDim; ++i )
+			{
+				for( int j = i; j < kDim; ++j, ++k )
+					a[k] += (i == j ? 1.0 : 0.0) - e1[i]*e1[j] - e2[i]*e2[j];
+
+				b[i] += pe1*e1[i] + pe2*e2[i] - aP0[i];
+			}
+
+			c += dot( aP0, aP0 ) - pe1*pe1 - pe2*pe2;
+		}
+
+		Quadric_& operator+= ( Quadric_ const& aOther ) noexcept
+		{
+			for( std::size_t i = 0; i < std::size(a); ++i )
+				a[i] += aOther.a[i];
+			for( int i = 0; i < kDim; ++i )
+				b[i] += aOther.b[i];
+			c += aOther.c;
+			return *this;
+		}
+
+		double evaluate( double const* aP ) const noexcept
+		{
+			double r = c;
+			int k = 0;
+			for( int i = 0; i < kDim; ++i )
+			{
+				for( int j = i; j < kDim; ++j, ++k )
+					r += (i == j ? 1.0 : 2.0) * a[k] * aP[i] * aP[j];
+
+				r += 2.0 * b[i] * aP[i];
+			}
+
+			return std::max( 0.0, r );
+		}
+	};
+
+	struct Collapse_
+	{
+		double cost;
+		std::uint32_t from, to;
+		std::uint32_t fromVersion, toVersion;
+
+		bool operator< ( Collapse_ const& aOther ) const noexcept
+		{
+			return cost > aOther.cost; // min-heap
+		}
+	};
+
+	struct SimplifiedLevel_
+	{
+		std::vector<std::uint32_t> indices;
+		float error;
+	};
+
+	// Simplifies the triangles aIndices (canonical vertex ids, relative to
+	// the mesh). Vertices with aLocked set are never moved. Vertices on open
+	// edges only move along straight runs of these edges, onto their
+	// neighbour, and only together with their twin (aTwins, kNone if none) on
+	// the other side of the seam, which moves onto the twin of the
+	// neighbour. The outline is unchanged, and both sides stay joined.
+	std::vector<SimplifiedLevel_> simplify_group_( std::vector<std::uint32_t> const& aIndices, glm::vec3 const* aPositions, glm::vec2 const* aTexcoords, std::vector<char> const& aLocked, std::vector<std::uint32_t> const& aTwins )
+	{
+		auto const triangleCount = aIndices.size() / 3;
+
+		// Dense ids for the group's vertices
+		std::vector<std::uint32_t> groupVertices( aIndices );
+		std::sort( groupVertices.begin(), groupVertices.end() );
+		groupVertices.erase( std::unique( groupVertices.begin(), groupVertices.end() ), groupVertices.end() );
+
+		auto const vertexCount = groupVertices.size();
+		auto const local = [&] ( std::uint32_t aVertex ) {
+			return std::uint32_t(std::lower_bound( groupVertices.begin(), groupVertices.end(), aVertex ) - groupVertices.begin());
+		};
+
+		std::vector<std::uint32_t> tris( aIndices.size() );
+		for( std::size_t i = 0; i < aIndices.size(); ++i )
+			tris[i] = local( aIndices[i] );
+
+		std::vector<glm::vec3> positions( vertexCount );
+		std::vector<char> locked( vertexCount );
+		std::vector<std::uint32_t> twins( vertexCount, kNone );
+		for( std::size_t v = 0; v < vertexCount; ++v )
+		{
+			positions[v] = aPositions[groupVertices[v]];
+			locked[v] = aLocked[groupVertices[v]];
+
+			// Twins outside of the group cannot move along
+			auto const twin = aTwins[groupVertices[v]];
+			if( kNone != twin && std::binary_search( groupVertices.begin(), groupVertices.end(), twin ) )
+				twins[v] = local( twin );
+		}
+
+		// Texture coordinates are scaled such that moving across the texture
+		// costs about as much as moving the same distance on the surface. The
+		// error thus remains in object-space units.
+		double uvScale = 0.0;
+		{
+			glm::vec3 plo( std::numeric_limits<float>::max() ), phi( -std::numeric_limits<float>::max() );
+			glm::vec2 tlo( std::numeric_limits<float>::max() ), thi( -std::numeric_limits<float>::max() );
+			for( auto const v : groupVertices )
+			{
+				plo = glm::min( plo, aPositions[v] );
+				phi = glm::max( phi, aPositions[v] );
+				tlo = glm::min( tlo, aTexcoords[v] );
+				thi = glm::max( thi, aTexcoords[v] );
+			}
+
+			auto const uvExtent = double(glm::length( thi - tlo ));
+			if( uvExtent > 0.0 )
+				uvScale = double(glm::length( phi - plo )) / uvExtent;
+		}
+
+		std::vector<double> points( vertexCount * Quadric_::kDim );
+		for( std::size_t v = 0; v < vertexCount; ++v )
+		{
+			auto* p = &points[v * Quadric_::kDim];
+			auto const& t = aTexcoords[groupVertices[v]];
+			p[0] = positions[v].x;
+			p[1] = positions[v].y;
+			p[2] = positions[v].z;
+			p[3] = t.x * uvScale;
+			p[4] = t.y * uvScale;
+		}
+
+		// Open edges: each vertex on them links to its (up to) two neighbours
+		// along them. Vertices on non-manifold edges, or on more than two
+		// open edges, are locked.
+		std::vector<std::uint32_t> borderLinks( vertexCount * 2, kNone );
+		auto const is_border = [&] ( std::uint32_t aVertex ) {
+			return kNone != borderLinks[aVertex*2];
+		};
+
+		{
+			std::vector<std::uint64_t> edges;
+			edges.reserve( tris.size() );
+			for( std::size_t t = 0; t < triangleCount; ++t )
+			{
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					auto const a = tris[t*3+c], b = tris[t*3+(c+1)%3];
+					edges.emplace_back( (std::uint64_t(std::min( a, b )) << 32) | std::max( a, b ) );
+				}
+			}
+
+			std::sort( edges.begin(), edges.end() );
+			for( std::size_t i = 0; i < edges.size(); )
+			{
+				std::size_t j = i;
+				while( j < edges.size() && edges[j] == edges[i] )
+					++j;
+
+				auto const a = std::uint32_t(edges[i] >> 32), b = std::uint32_t(edges[i]);
+				if( 1 == j - i )
+				{
+					for( auto const& [from, to] : { std::pair{ a, b }, std::pair{ b, a } } )
+					{
+						auto* links = &borderLinks[from*2];
+						if( kNone == links[0] )
+							links[0] = to;
+						else if( kNone == links[1] )
+							links[1] = to;
+						else
+							locked[from] = 1;
+					}
+				}
+				else if( 2 != j - i )
+				{
+					locked[a] = 1;
+					locked[b] = 1;
+				}
+
+				i = j;
+			}
+
+			// Ends of open chains, and vertices without a twin on an open
+			// edge of its own: the outline of the mesh, or a material border
+			for( std::size_t v = 0; v < vertexCount; ++v )
+			{
+				if( !is_border( std::uint32_t(v) ) )
+					continue;
+
+				if( kNone == borderLinks[v*2+1] || kNone == twins[v] || !is_border( twins[v] ) )
+					locked[v] = 1;
+			}
+
+			// Twins move together, or not at all
+			for( std::size_t v = 0; v < vertexCount; ++v )
+			{
+				if( is_border( std::uint32_t(v) ) && kNone != twins[v] && locked[twins[v]] )
+					locked[v] = 1;
+			}
+		}
+
+		// Quadrics and adjacency
+		std::vector<Quadric_> quadrics( vertexCount );
+		std::vector<std::vector<std::uint32_t>> vertexTriangles( vertexCount );
+		std::vector<char> alive( triangleCount, 1 );
+
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			Quadric_ q;
+			q.add_triangle( &points[tris[t*3+0] * Quadric_::kDim], &points[tris[t*3+1] * Quadric_::kDim], &points[tris[t*3+2] * Quadric_::kDim] );
+
+			for( std::size_t c = 0; c < 3; ++c )
+			{
+				vertexTriangles[tris[t*3+c]].emplace_back( std::uint32_t(t) );
+				quadrics[tris[t*3+c]] += q;
+			}
+		}
+
+		std::vector<std::uint32_t> version( vertexCount, 0 );
+		std::priority_queue<Collapse_> queue;
+
+		auto const push = [&] ( std::uint32_t aFrom, std::uint32_t aTo ) {
+			if( locked[aFrom] )
+				return;
+			if( is_border( aFrom ) && aTo != borderLinks[aFrom*2] && aTo != borderLinks[aFrom*2+1] )
+				return;
+
+			Quadric_ q = quadrics[aFrom];
+			q += quadrics[aTo];
+			queue.push( Collapse_{ q.evaluate( &points[aTo * Quadric_::kDim] ), aFrom, aTo, version[aFrom], version[aTo] } );
+		};
+
+		std::vector<std::uint32_t> neighbours;
+		auto const gather_neighbours = [&] ( std::uint32_t aVertex ) {
+			neighbours.clear();
+			for( auto const t : vertexTriangles[aVertex] )
+			{
+				if( !alive[t] )
+					continue;
+
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					if( tris[t*3+c] != aVertex )
+						neighbours.emplace_back( tris[t*3+c] );
+				}
+			}
+
+			std::sort( neighbours.begin(), neighbours.end() );
+			neighbours.erase( std::unique( neighbours.begin(), neighbours.end() ), neighbours.end() );
+		};
+
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			for( std::size_t c = 0; c < 3; ++c )
+				push( tris[t*3+c], tris[t*3+(c+1)%3] );
+		}
+
+		// Collapses must not flip (or nearly flip) any remaining triangle.
+		// Vertices on open edges must lie on a straight run of them, which
+		// must not close into a triangle; their twins' collapses are checked
+		// separately.
+		auto const collapse_is_valid = [&] ( std::uint32_t aFrom, std::uint32_t aTo ) {
+			if( is_border( aFrom ) )
+			{
+				auto const* links = &borderLinks[aFrom*2];
+				auto const other = aTo == links[0] ? links[1] : links[0];
+				if( other == borderLinks[aTo*2] || other == borderLinks[aTo*2+1] )
+					return false;
+
+				auto const d0 = positions[aFrom] - positions[other];
+				auto const d1 = positions[aTo] - positions[aFrom];
+				auto const l0 = glm::length( d0 ), l1 = glm::length( d1 );
+				if( l0 <= 0.f || l1 <= 0.f || glm::dot( d0, d1 ) < kBorderSlideCos * l0 * l1 )
+					return false;
+			}
+
+			for( auto const t : vertexTriangles[aFrom] )
+			{
+				if( !alive[t] )
+					continue;
+
+				auto const* tri = &tris[t*3];
+				if( tri[0] == aTo || tri[1] == aTo || tri[2] == aTo )
+					continue; // removed by the collapse
+
+				glm::vec3 p[3], q[3];
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					p[c] = positions[tri[c]];
+					q[c] = tri[c] == aFrom ? positions[aTo] : p[c];
+				}
+
+				auto const before = glm::cross( p[1] - p[0], p[2] - p[0] );
+				auto const after = glm::cross( q[1] - q[0], q[2] - q[0] );
+				auto const lb = glm::length( before ), la = glm::length( after );
+				if( la <= 0.f || (lb > 0.f && glm::dot( before, after ) < 0.25f * lb * la) )
+					return false;
+			}
+
+			return true;
+		};
+
+		std::vector<SimplifiedLevel_> ret;
+
+		std::size_t liveTriangles = triangleCount;
+		std::size_t lastCount = triangleCount;
+		double maxCost = 0.0;
+
+		auto const snapshot = [&] () {
+			SimplifiedLevel_ level;
+			level.error = float(std::sqrt( maxCost ));
+			level.indices.reserve( liveTriangles*3 );
+			for( std::size_t t = 0; t < triangleCount; ++t )
+			{
+				if( !alive[t] )
+					continue;
+
+				for( std::size_t c = 0; c < 3; ++c )
+					level.indices.emplace_back( groupVertices[tris[t*3+c]] );
+			}
+
+			ret.emplace_back( std::move(level) );
+			lastCount = liveTriangles;
+		};
+
+		auto const collapse_edge = [&] ( std::uint32_t aFrom, std::uint32_t aTo ) {
+			for( auto const t : vertexTriangles[aFrom] )
+			{
+				if( !alive[t] )
+					continue;
+
+				auto* tri = &tris[t*3];
+				if( tri[0] == aTo || tri[1] == aTo || tri[2] == aTo )
+				{
+					alive[t] = 0;
+					--liveTriangles;
+					continue;
+				}
+
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					if( tri[c] == aFrom )
+						tri[c] = aTo;
+				}
+
+				vertexTriangles[aTo].emplace_back( t );
+			}
+
+			// The open edges now run from the other neighbour to the target
+			if( is_border( aFrom ) )
+			{
+				auto const* links = &borderLinks[aFrom*2];
+				auto const other = aTo == links[0] ? links[1] : links[0];
+				for( auto const& [vertex, replacement] : { std::pair{ aTo, other }, std::pair{ other, aTo } } )
+				{
+					auto* link = &borderLinks[vertex*2];
+					link[aFrom == link[0] ? 0 : 1] = replacement;
+				}
+			}
+
+			vertexTriangles[aFrom].clear();
+			quadrics[aTo] += quadrics[aFrom];
+			locked[aFrom] = 1; // removed
+			++version[aFrom];
+			++version[aTo];
+
+			gather_neighbours( aTo );
+			for( auto const n : neighbours )
+			{
+				push( n, aTo );
+				push( aTo, n );
+			}
+		};
+
+		auto target = std::size_t(lastCount * kLodReduction);
+
+		while( ret.size() + 1 < kMaxLodLevels && !queue.empty() )
+		{
+			auto const collapse = queue.top();
+			queue.pop();
+
+			auto const from = collapse.from, to = collapse.to;
+			if( version[from] != collapse.fromVersion || version[to] != collapse.toVersion )
+				continue; // stale
+			if( !collapse_is_valid( from, to ) )
+				continue;
+
+			// Seams: the twin moves onto the target's twin, along its own
+			// open edge
+			auto const twinFrom = is_border( from ) ? twins[from] : kNone;
+			auto const twinTo = kNone != twinFrom ? twins[to] : kNone;
+			if( kNone != twinFrom )
+			{
+				auto const* links = &borderLinks[twinFrom*2];
+				if( kNone == twinTo || (twinTo != links[0] && twinTo != links[1]) || !collapse_is_valid( twinFrom, twinTo ) )
+					continue;
+			}
+
+			maxCost = std::max( maxCost, collapse.cost );
+			collapse_edge( from, to );
+
+			if( kNone != twinFrom )
+			{
+				Quadric_ q = quadrics[twinFrom];
+				q += quadrics[twinTo];
+				maxCost = std::max( maxCost, q.evaluate( &points[twinTo * Quadric_::kDim] ) );
+				collapse_edge( twinFrom, twinTo );
+			}
+
+			if( liveTriangles <= target )
+			{
+				snapshot();
+				target = std::size_t(lastCount * kLodReduction);
+			}
+		}
+
+		// Keep what was reached, if it is enough of an improvement
+		if( ret.size() + 1 < kMaxLodLevels && liveTriangles <= lastCount * kLodMinReduction )
+			snapshot();
+
+		return ret;
+	}
+
+	// Vertices that are identical except for (possibly) their normals get
+	// the same canonical id.
+	std::vector<std::uint32_t> canonical_vertices_( ModelData const& aModel, MeshInfo const& aMesh, bool aUseNormals )
+	{
+		auto const base = aMesh.vertexStartIndex;
+		auto const key = [&] ( std::uint32_t aV, float* aOut ) {
+			auto const& p = aModel.vertexPositions[base+aV];
+			auto const& t = aModel.vertexTextureCoords[base+aV];
+			auto const& n = aModel.vertexNormals[base+aV];
+			float const k[8] = { p.x, p.y, p.z, t.x, t.y, aUseNormals ? n.x : 0.f, aUseNormals ? n.y : 0.f, aUseNormals ? n.z : 0.f };
+			std::memcpy( aOut, k, sizeof(k) );
+		};
+
+		std::vector<std::uint32_t> order( aMesh.numberOfVertices );
+		for( std::size_t v = 0; v < order.size(); ++v )
+			order[v] = std::uint32_t(v);
+
+		auto const compare = [&] ( std::uint32_t aA, std::uint32_t aB ) {
+			float ka[8], kb[8];
+			key( aA, ka );
+			key( aB, kb );
+			return std::memcmp( ka, kb, sizeof(ka) );
+		};
+
+		std::sort( order.begin(), order.end(), [&] ( std::uint32_t aA, std::uint32_t aB ) {
+			auto const c = compare( aA, aB );
+			return c < 0 || (0 == c && aA < aB);
+		} );
+
+		std::vector<std::uint32_t> ret( aMesh.numberOfVertices );
+		for( std::size_t i = 0; i < order.size(); ++i )
+		{
+			if( i > 0 && 0 == compare( order[i-1], order[i] ) )
+				ret[order[i]] = ret[order[i-1]];
+			else
+				ret[order[i]] = order[i];
+		}
+
+		return ret;
+	}
+
+	// Seam twins: pairs of canonical vertices of one mesh that share their
+	// position with each other, and with no other vertex of the model. Any
+	// other vertex is kNone.
+	std::vector<std::vector<std::uint32_t>> seam_twins_( ModelData const& aModel, std::vector<std::vector<std::uint32_t>> const& aCanonical )
+	{
+		struct Entry_
+		{
+			glm::vec3 position;
+			std::uint32_t mesh, vertex;
+		};
+
+		std::vector<Entry_> entries;
+		std::vector<std::vector<std::uint32_t>> ret( aModel.meshes.size() );
+		for( std::size_t m = 0; m < aModel.meshes.size(); ++m )
+		{
+			auto const& mesh = aModel.meshes[m];
+			ret[m].assign( mesh.numberOfVertices, kNone );
+
+			for( std::uint32_t v = 0; v < mesh.numberOfVertices; ++v )
+			{
+				if( aCanonical[m][v] == v )
+					entries.emplace_back( Entry_{ aModel.vertexPositions[mesh.vertexStartIndex+v], std::uint32_t(m), v } );
+			}
+		}
+
+		auto const same_position = [] ( Entry_ const& aA, Entry_ const& aB ) {
+			return 0 == std::memcmp( &aA.position, &aB.position, sizeof(glm::vec3) );
+		};
+
+		std::sort( entries.begin(), entries.end(), [] ( Entry_ const& aA, Entry_ const& aB ) {
+			return std::memcmp( &aA.position, &aB.position, sizeof(glm::vec3) ) < 0;
+		} );
+
+		for( std::size_t i = 0; i < entries.size(); )
+		{
+			std::size_t j = i+1;
+			while( j < entries.size() && same_position( entries[i], entries[j] ) )
+				++j;
+
+			if( 2 == j - i && entries[i].mesh == entries[i+1].mesh )
+			{
+				ret[entries[i].mesh][entries[i].vertex] = entries[i+1].vertex;
+				ret[entries[i].mesh][entries[i+1].vertex] = entries[i].vertex;
+			}
+
+			i = j;
+		}
+
+		return ret;
+	}
+}
+
+ModelLods build_lods( ModelData const& aModel, MeshletData const& aMeshlets, bool aUseNormals )
+{
+	if( aModel.vertexNormals.size() != aModel.vertexPositions.size() || aModel.vertexTextureCoords.size() != aModel.vertexPositions.size() )
+		throw lut::Error( "build_lods(): model '%s' is missing vertex attributes", aModel.modelName.c_str() );
+	if( aMeshlets.meshStart.size() != aModel.meshes.size()+1 )
+		throw lut::Error( "build_lods(): meshlets do not match model '%s'", aModel.modelName.c_str() );
+
+	ModelLods ret;
+	ret.meshStart.reserve( aModel.meshes.size()+1 );
+	ret.indices.resize( aModel.meshes.size() );
+
+	std::vector<std::vector<std::uint32_t>> canonicals;
+	for( auto const& mesh : aModel.meshes )
+		canonicals.emplace_back( canonical_vertices_( aModel, mesh, aUseNormals ) );
+
+	auto const twins = seam_twins_( aModel, canonicals );
+
+	for( std::size_t m = 0; m < aModel.meshes.size(); ++m )
+	{
+		auto const& mesh = aModel.meshes[m];
+		ret.meshStart.emplace_back( ret.groups.size() );
+
+		auto const* meshIndices = aModel.indices.data() + mesh.indexStartIndex;
+		auto const* positions = aModel.vertexPositions.data() + mesh.vertexStartIndex;
+		auto const* texcoords = aModel.vertexTextureCoords.data() + mesh.vertexStartIndex;
+		auto const& canonical = canonicals[m];
+
+		auto const meshletBegin = aMeshlets.meshStart[m], meshletEnd = aMeshlets.meshStart[m+1];
+		auto const meshletCount = meshletEnd - meshletBegin;
+		if( 0 == meshletCount )
+			continue;
+
+		// Group meshlets by sorting them along a Morton (Z-) curve of their
+		// centres, and cutting the result into pieces
+		std::vector<std::uint32_t> order( meshletCount );
+		{
+			glm::vec3 lo( std::numeric_limits<float>::max() ), hi( -std::numeric_limits<float>::max() );
+			for( auto k = meshletBegin; k < meshletEnd; ++k )
+			{
+				lo = glm::min( lo, aMeshlets.bounds[k].center );
+				hi = glm::max( hi, aMeshlets.bounds[k].center );
+			}
+
+			auto const scale = 1023.f / glm::max( hi - lo, glm::vec3( std::numeric_limits<float>::min() ) );
+
+			std::vector<std::uint32_t> codes( meshletCount );
+			for( std::size_t i = 0; i < meshletCount; ++i )
+			{
+				auto const q = glm::clamp( (aMeshlets.bounds[meshletBegin+i].center - lo) * scale, glm::vec3( 0.f ), glm::vec3( 1023.f ) );
+				codes[i] = spread_bits_( std::uint32_t(q.x) ) | (spread_bits_( std::uint32_t(q.y) ) << 1) | (spread_bits_( std::uint32_t(q.z) ) << 2);
+				order[i] = std::uint32_t(i);
+			}
+
+			std::stable_sort( order.begin(), order.end(), [&] ( std::uint32_t aA, std::uint32_t aB ) {
+				return codes[aA] < codes[aB];
+			} );
+
+			for( std::size_t g = 0; g < meshletCount; g += kLodGroupMeshlets )
+				std::sort( order.begin() + g, order.begin() + std::min( meshletCount, g + kLodGroupMeshlets ) );
+		}
+
+		// Vertices used by more than one group are locked
+		std::vector<std::uint32_t> firstGroup( mesh.numberOfVertices, kNone );
+		std::vector<char> locked( mesh.numberOfVertices, 0 );
+
+		for( std::size_t g = 0; g < meshletCount; g += kLodGroupMeshlets )
+		{
+			auto const groupId = std::uint32_t(g);
+			for( auto i = g; i < std::min( meshletCount, g + kLodGroupMeshlets ); ++i )
+			{
+				auto const& meshlet = aMeshlets.meshlets[meshletBegin + order[i]];
+				for( std::size_t j = 0; j < meshlet.triangleCount*3; ++j )
+				{
+					auto const v = canonical[meshIndices[meshlet.firstIndex + j]];
+					if( kNone == firstGroup[v] )
+						firstGroup[v] = groupId;
+					else if( groupId != firstGroup[v] )
+						locked[v] = 1;
+				}
+			}
+		}
+
+		auto& lodIndices = ret.indices[m];
+
+		for( std::size_t g = 0; g < meshletCount; g += kLodGroupMeshlets )
+		{
+			auto const last = std::min( meshletCount, g + kLodGroupMeshlets );
+
+			LodGroup group{};
+			group.meshletStart = std::uint32_t(ret.meshlets.size());
+			group.meshletCount = std::uint32_t(last - g);
+
+			// Level 0: the meshlets themselves
+			std::vector<std::uint32_t> groupIndices;
+			for( auto i = g; i < last; ++i )
+			{
+				auto const& meshlet = aMeshlets.meshlets[meshletBegin + order[i]];
+				for( std::size_t j = 0; j < meshlet.triangleCount*3; ++j )
+					groupIndices.emplace_back( canonical[meshIndices[meshlet.firstIndex + j]] );
+
+				ret.meshlets.emplace_back( order[i] );
+			}
+
+			auto& level0 = group.levels[0];
+			level0.firstIndex = 0;
+			level0.indexCount = std::uint32_t(groupIndices.size());
+			level0.error = 0.f;
+			group.levelCount = 1;
+
+			// Bounding sphere: enclose the meshlets' spheres
+			glm::vec3 lo( std::numeric_limits<float>::max() ), hi( -std::numeric_limits<float>::max() );
+			for( auto i = g; i < last; ++i )
+			{
+				auto const& b = aMeshlets.bounds[meshletBegin + order[i]];
+				lo = glm::min( lo, b.center - b.radius );
+				hi = glm::max( hi, b.center + b.radius );
+			}
+
+			group.center = (lo + hi) * 0.5f;
+			group.radius = 0.f;
+			for( auto i = g; i < last; ++i )
+			{
+				auto const& b = aMeshlets.bounds[meshletBegin + order[i]];
+				group.radius = std::max( group.radius, glm::length( b.center - group.center ) + b.radius );
+			}
+
+			// Simplified levels
+
+			float error = 0.f;
+			for( auto& level : simplify_group_( groupIndices, positions, texcoords, locked, twins[m] ) )
+			{
+				assert( group.levelCount < kMaxLodLevels );
+
+				error = std::max( error, level.error );
+
+				auto& out = group.levels[group.levelCount++];
+				out.firstIndex = std::uint32_t(mesh.numberOfIndices + lodIndices.size());
+				out.indexCount = std::uint32_t(level.indices.size());
+				out.error = error;
+
+				lodIndices.insert( lodIndices.end(), level.indices.begin(), level.indices.end() );
+			}
+
+			ret.groups.emplace_back( group );
+		}
+	}
+
+	ret.meshStart.emplace_back( ret.groups.size() );
+	return ret;
+}
+
+float lod_pixel_scale( float aFovY, float aViewportHeight ) noexcept
+{
+	return aViewportHeight / (2.f * std::tan( aFovY * 0.5f ));
+}
+
+std::uint32_t select_lod( LodGroup const& aGroup, glm::vec3 const& aCameraPos, float aPixelScale, float aMaxPixelError ) noexcept
+{
+	auto const distance = glm::length( aGroup.center - aCameraPos ) - aGroup.radius;
+	if( distance <= 0.f )
+		return 0;
+
+	// Errors increase monotonically with the level
+	std::uint32_t level = 0;
+	while( level+1 < aGroup.levelCount && aGroup.levels[level+1].error * aPixelScale / distance <= aMaxPixelError )
+		++level;
+
+	return level;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+#include "meshlet.hpp"
+
+/* Level of detail.
+ *
+ * build_lods() groups nearby meshlets (see build_meshlets()) into LOD groups
+ * of up to kLodGroupMeshlets meshlets, and simplifies each group with
+ * quadric error metrics (half-edge collapses, so no new vertices are needed).
+ * The quadrics include the texture coordinates, so that regions in which the
+ * texture mapping is not affine are not flattened.
+ * Each group gets up to kMaxLodLevels levels. Level 0 is the full-detail
+ * geometry, which is drawn through the group's meshlets (so that these can
+ * still be culled individually); each further level targets half the
+ * triangles of the previous one. Levels that do not reduce the triangle
+ * count noticeably are dropped.
+ *
+ * Vertices shared with other LOD groups are locked, so neighbouring groups
+ * at different levels do not crack. Vertices on open edges, which (since
+ * welding keeps vertices with different attributes apart) include UV seams,
+ * only slide along straight runs of these edges, and only together with
+ * their twin on the other side of the seam, so that the outline stays the
+ * same and both sides stay joined. Open edges without such a twin (the
+ * outline of the mesh, and borders with other materials) are locked, so
+ * geometry that is cut up by many material borders reaches fewer levels.
+ * If aUseNormals is false, vertices that only differ in their normal are
+ * treated as the same vertex, so that flat-shaded geometry (whose faces are
+ * disconnected by their normals) can be simplified; this is only
+ * appropriate if the normals are not used for rendering.
+ *
+ * Each level records its geometric error, an (object-space) upper bound of
+ * the distance of the simplified surface from the original, which is used to
+ * select a level based on its projected size (see lod_pixel_scale()).
+ *
+ * The simplified indices are returned separately per mesh and are meant to
+ * be appended to the mesh's index buffer; LodLevel::firstIndex accounts for
+ * this.
+ */
+
+constexpr std::size_t kMaxLodLevels = 5; // including level 0
+constexpr std::size_t kLodGroupMeshlets = 8;
+
+struct LodLevel
+{
+	// Range in the mesh's index buffer (the mesh's own indices followed by
+	// ModelLods::indices). Level 0 only uses indexCount, which is the total
+	// of the group's meshlets.
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+
+	// Geometric error (object space)
+	float error;
+};
+
+struct LodGroup
+{
+	// Bounding sphere of the group
+	glm::vec3 center;
+	float radius;
+
+	// The group's meshlets are meshletCount entries of ModelLods::meshlets,
+	// starting at meshletStart
+	std::uint32_t meshletStart;
+	std::uint32_t meshletCount;
+
+	std::uint32_t levelCount;
+	LodLevel levels[kMaxLodLevels];
+};
+
+struct ModelLods
+{
+	// The groups of mesh i are [meshStart[i], meshStart[i+1])
+	std::vector<LodGroup> groups;
+	std::vector<std::size_t> meshStart;
+
+	// Meshlet indices, relative to the mesh's first meshlet. Ascending
+	// within each group.
+	std::vector<std::uint32_t> meshlets;
+
+	// Simplified indices, one array per mesh. Relative to the mesh's
+	// vertexStartIndex, like ModelData::indices.
+	std::vector<std::vector<std::uint32_t>> indices;
+};
+
+ModelLods build_lods( ModelData const& aModel, MeshletData const& aMeshlets, bool aUseNormals );
+
+// Converts an object-space error at distance 1 into pixels, for a
+// perspective projection with the given vertical field of view (radians)
+// and viewport height (pixels).
+float lod_pixel_scale( float aFovY, float aViewportHeight ) noexcept;
+
+// Selects the coarsest level of aGroup whose error, projected from the
+// distance between aCameraPos and the group's bounding sphere, stays below
+// aMaxPixelError.
+std::uint32_t select_lod( LodGroup const& aGroup, glm::vec3 const& aCameraPos, float aPixelScale, float aMaxPixelError ) noexcept;
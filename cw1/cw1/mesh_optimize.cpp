@@ -0,0 +1,369 @@
+#include "mesh_optimize.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include <cassert>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// Counts FIFO cache misses. A vertex is in the cache if fewer than
+	// aCacheSize misses happened since it was (last) inserted.
+	std::size_t count_cache_misses_( std::uint32_t const* aIndices, std::size_t aIndexCount, std::size_t aVertexCount, std::size_t aCacheSize )
+	{
+		std::vector<std::size_t> insertedAt( aVertexCount, 0 );
+
+		std::size_t misses = 0;
+		for( std::size_t i = 0; i < aIndexCount; ++i )
+		{
+			auto const v = aIndices[i];
+			if( 0 == insertedAt[v] || misses - insertedAt[v] >= aCacheSize )
+			{
+				++misses;
+				insertedAt[v] = misses; // 1-based, 0 means "never"
+			}
+		}
+
+		return misses;
+	}
+
+	struct TipsifyResult_
+	{
+		std::vector<std::uint32_t> triangles;     // triangle order
+		std::vector<std::size_t> clusterStarts;   // offsets into triangles
+	};
+
+	// Tipsify. Triangles are emitted fan-wise around the current vertex; the
+	// next fanning vertex is picked among the vertices of the just-emitted
+	// triangles, preferring ones that will still be in the cache once all
+	// of their remaining triangles are emitted. A new cluster starts at each
+	// "hard boundary", i.e., when the algorithm has to jump elsewhere
+	// (dead-end) or continues with a vertex that has left the cache.
+	TipsifyResult_ tipsify_( std::uint32_t const* aIndices, std::size_t aTriangleCount, std::size_t aVertexCount, std::size_t aCacheSize )
+	{
+		// Vertex -> triangle adjacency (CSR)
+		std::vector<std::uint32_t> liveTriangles( aVertexCount, 0 );
+		for( std::size_t i = 0; i < aTriangleCount*3; ++i )
+			++liveTriangles[aIndices[i]];
+
+		std::vector<std::size_t> adjacencyStart( aVertexCount+1, 0 );
+		for( std::size_t v = 0; v < aVertexCount; ++v )
+			adjacencyStart[v+1] = adjacencyStart[v] + liveTriangles[v];
+
+		std::vector<std::uint32_t> adjacency( aTriangleCount*3 );
+		{
+			auto fill = adjacencyStart;
+			for( std::size_t i = 0; i < aTriangleCount*3; ++i )
+				adjacency[fill[aIndices[i]]++] = std::uint32_t(i / 3);
+		}
+
+		std::vector<std::size_t> cacheTime( aVertexCount, 0 );
+		std::vector<char> emitted( aTriangleCount, 0 );
+		std::vector<std::uint32_t> deadEnd;
+		std::vector<std::uint32_t> candidates;
+
+		TipsifyResult_ ret;
+		ret.triangles.reserve( aTriangleCount );
+
+		std::size_t timeStamp = aCacheSize+1;
+		std::size_t cursor = 0;
+
+		auto const skip_dead_end = [&] () -> std::int64_t {
+			while( !deadEnd.empty() )
+			{
+				auto const d = deadEnd.back();
+				deadEnd.pop_back();
+
+				if( liveTriangles[d] > 0 )
+					return d;
+			}
+
+			for( ; cursor < aVertexCount; ++cursor )
+			{
+				if( liveTriangles[cursor] > 0 )
+					return std::int64_t(cursor);
+			}
+
+			return -1;
+		};
+
+		std::int64_t fanning = skip_dead_end();
+		bool newCluster = true;
+
+		while( fanning >= 0 )
+		{
+			if( newCluster )
+				ret.clusterStarts.emplace_back( ret.triangles.size() );
+
+			candidates.clear();
+
+			for( auto a = adjacencyStart[fanning]; a < adjacencyStart[fanning+1]; ++a )
+			{
+				auto const t = adjacency[a];
+				if( emitted[t] )
+					continue;
+
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					auto const v = aIndices[t*3+c];
+
+					deadEnd.emplace_back( v );
+					candidates.emplace_back( v );
+					--liveTriangles[v];
+
+					if( timeStamp - cacheTime[v] > aCacheSize )
+						cacheTime[v] = timeStamp++;
+				}
+
+				emitted[t] = 1;
+				ret.triangles.emplace_back( t );
+			}
+
+			// Pick the next fanning vertex among the candidates
+			std::int64_t next = -1;
+			std::size_t best = 0;
+			for( auto const v : candidates )
+			{
+				if( 0 == liveTriangles[v] )
+					continue;
+
+				// Vertices that stay in the cache while their remaining
+				// triangles are emitted are preferred; among those, the
+				// oldest one (most likely to be evicted soon).
+				std::size_t priority = 0;
+				if( timeStamp - cacheTime[v] + 2*liveTriangles[v] <= aCacheSize )
+					priority = timeStamp - cacheTime[v];
+
+				if( -1 == next || priority > best )
+				{
+					next = v;
+					best = priority;
+				}
+			}
+
+			if( -1 == next )
+			{
+				newCluster = true;
+				fanning = skip_dead_end();
+			}
+			else
+			{
+				newCluster = timeStamp - cacheTime[next] > aCacheSize;
+				fanning = next;
+			}
+		}
+
+		assert( ret.triangles.size() == aTriangleCount );
+		return ret;
+	}
+
+	// Sorts Tipsify's clusters such that clusters facing away from the mesh
+	// centre are drawn first. For each of a set of view directions, a
+	// cluster that faces the viewer and lies towards the viewer gets a high
+	// score; the scores are summed over all directions.
+	void sort_clusters_for_overdraw_( TipsifyResult_& aResult, std::uint32_t const* aIndices, glm::vec3 const* aPositions )
+	{
+		auto const clusterCount = aResult.clusterStarts.size();
+		if( clusterCount < 2 )
+			return;
+
+		// 26 directions: the 3x3x3 grid around the origin, excluding the centre
+		std::vector<glm::vec3> directions;
+		for( int x = -1; x <= 1; ++x )
+		{
+			for( int y = -1; y <= 1; ++y )
+			{
+				for( int z = -1; z <= 1; ++z )
+				{
+					if( x || y || z )
+						directions.emplace_back( glm::normalize( glm::vec3( float(x), float(y), float(z) ) ) );
+				}
+			}
+		}
+
+		struct Cluster_
+		{
+			std::size_t begin, end;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float score;
+		};
+
+		std::vector<Cluster_> clusters( clusterCount );
+
+		// Area-weighted centroid and normal per cluster
+		glm::vec3 meshCentroid( 0.f );
+		float meshArea = 0.f;
+
+		for( std::size_t c = 0; c < clusterCount; ++c )
+		{
+			auto& cluster = clusters[c];
+			cluster.begin = aResult.clusterStarts[c];
+			cluster.end = c+1 < clusterCount ? aResult.clusterStarts[c+1] : aResult.triangles.size();
+
+			glm::vec3 centroid( 0.f ), normal( 0.f );
+			float area = 0.f;
+
+			for( auto i = cluster.begin; i < cluster.end; ++i )
+			{
+				auto const t = aResult.triangles[i];
+				auto const& p0 = aPositions[aIndices[t*3+0]];
+				auto const& p1 = aPositions[aIndices[t*3+1]];
+				auto const& p2 = aPositions[aIndices[t*3+2]];
+
+				auto const n = glm::cross( p1 - p0, p2 - p0 );
+				auto const a = glm::length( n );
+
+				centroid += (p0 + p1 + p2) * (a / 3.f);
+				normal += n;
+				area += a;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+
+			cluster.centroid = area > 0.f ? centroid / area : aPositions[aIndices[aResult.triangles[cluster.begin]*3]];
+			auto const nlen = glm::length( normal );
+			cluster.normal = nlen > 0.f ? normal / nlen : glm::vec3( 0.f );
+		}
+
+		if( meshArea > 0.f )
+			meshCentroid /= meshArea;
+
+		for( auto& cluster : clusters )
+		{
+			auto const offset = cluster.centroid - meshCentroid;
+
+			float score = 0.f;
+			for( auto const& d : directions )
+				score += glm::dot( offset, d ) * std::max( 0.f, glm::dot( cluster.normal, d ) );
+
+			cluster.score = score;
+		}
+
+		std::stable_sort( clusters.begin(), clusters.end(), [] ( Cluster_ const& aA, Cluster_ const& aB ) {
+			return aA.score > aB.score;
+		} );
+
+		std::vector<std::uint32_t> triangles;
+		triangles.reserve( aResult.triangles.size() );
+
+		std::vector<std::size_t> clusterStarts;
+		clusterStarts.reserve( clusterCount );
+
+		for( auto const& cluster : clusters )
+		{
+			clusterStarts.emplace_back( triangles.size() );
+			triangles.insert( triangles.end(), aResult.triangles.begin() + cluster.begin, aResult.triangles.begin() + cluster.end );
+		}
+
+		aResult.triangles = std::move(triangles);
+		aResult.clusterStarts = std::move(clusterStarts);
+	}
+
+	void optimize_mesh_( ModelData& aModel, MeshInfo const& aMesh )
+	{
+		auto const triangleCount = aMesh.numberOfIndices / 3;
+		auto const vertexCount = aMesh.numberOfVertices;
+		if( 0 == triangleCount )
+			return;
+
+		auto* indices = aModel.indices.data() + aMesh.indexStartIndex;
+		auto const* positions = aModel.vertexPositions.data() + aMesh.vertexStartIndex;
+
+		// Steps 1 and 2: triangle order
+		auto order = tipsify_( indices, triangleCount, vertexCount, kVertexCacheSize );
+		sort_clusters_for_overdraw_( order, indices, positions );
+
+		std::vector<std::uint32_t> reordered( triangleCount*3 );
+		for( std::size_t i = 0; i < triangleCount; ++i )
+		{
+			auto const t = order.triangles[i];
+			reordered[i*3+0] = indices[t*3+0];
+			reordered[i*3+1] = indices[t*3+1];
+			reordered[i*3+2] = indices[t*3+2];
+		}
+
+		// Step 3: vertex order
+		constexpr auto kUnassigned = ~std::uint32_t(0);
+		std::vector<std::uint32_t> remap( vertexCount, kUnassigned );
+
+		std::uint32_t nextVertex = 0;
+		for( auto& index : reordered )
+		{
+			if( kUnassigned == remap[index] )
+				remap[index] = nextVertex++;
+
+			index = remap[index];
+		}
+
+		// Unreferenced vertices (if any) go to the end
+		for( auto& r : remap )
+		{
+			if( kUnassigned == r )
+				r = nextVertex++;
+		}
+
+		std::copy( reordered.begin(), reordered.end(), indices );
+
+		auto const permute = [&] ( auto& aAttribute ) {
+			auto* data = aAttribute.data() + aMesh.vertexStartIndex;
+			std::vector<std::decay_t<decltype(*data)>> tmp( vertexCount );
+			for( std::size_t v = 0; v < vertexCount; ++v )
+				tmp[remap[v]] = data[v];
+			std::copy( tmp.begin(), tmp.end(), data );
+		};
+
+		permute( aModel.vertexPositions );
+		permute( aModel.vertexNormals );
+		permute( aModel.vertexTextureCoords );
+	}
+}
+
+double VertexCacheStats::acmr() const noexcept
+{
+	return triangles ? double(misses) / triangles : 0.0;
+}
+double VertexCacheStats::atvr() const noexcept
+{
+	return vertices ? double(misses) / vertices : 0.0;
+}
+
+VertexCacheStats analyze_vertex_cache( ModelData const& aModel, std::size_t aCacheSize )
+{
+	VertexCacheStats stats{};
+
+	for( auto const& mesh : aModel.meshes )
+	{
+		assert( mesh.numberOfIndices > 0 ); // indexed meshes only
+
+		stats.triangles += mesh.numberOfIndices / 3;
+		stats.vertices += mesh.numberOfVertices;
+		stats.misses += count_cache_misses_( aModel.indices.data() + mesh.indexStartIndex, mesh.numberOfIndices, mesh.numberOfVertices, aCacheSize );
+	}
+
+	return stats;
+}
+
+MeshOptimizeStats optimize_meshes( ModelData& aModel )
+{
+	// Reordering triangles across the sub-mesh ranges would invalidate them
+	if( !aModel.subMeshes.empty() )
+		throw lut::Error( "optimize_meshes(): model '%s' is batched; optimize before batching", aModel.modelName.c_str() );
+
+	MeshOptimizeStats stats{};
+	stats.before = analyze_vertex_cache( aModel );
+
+	for( auto const& mesh : aModel.meshes )
+		optimize_mesh_( aModel, mesh );
+
+	stats.after = analyze_vertex_cache( aModel );
+	return stats;
+}
@@ -0,0 +1,539 @@
+#include "meshlet.hpp"
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kNone = ~std::uint32_t(0);
+
+	static_assert( kMaxMeshletVertices <= 256, "Meshlet-local indices are 8 bits" );
+
+	// Uniform grid over the triangle centroids, for finding the free
+	// triangle nearest to a point.
+	class TriangleGrid_
+	{
+		public:
+			explicit TriangleGrid_( std::vector<glm::vec3> const& aCentroids )
+				: mCentroids( aCentroids )
+			{
+				glm::vec3 hi( -std::numeric_limits<float>::max() );
+				mLo = glm::vec3( std::numeric_limits<float>::max() );
+				for( auto const& c : aCentroids )
+				{
+					mLo = glm::min( mLo, c );
+					hi = glm::max( hi, c );
+				}
+
+				// About two triangles per cell, at most kMaxRes cells per axis
+				auto const extent = hi - mLo;
+				auto const maxExtent = std::max( { extent.x, extent.y, extent.z, std::numeric_limits<float>::min() } );
+				auto const clamped = glm::max( extent, glm::vec3( maxExtent * 1e-3f ) );
+				auto const cells = std::max( 1.f, float(aCentroids.size()) / 2.f );
+				mCellSize = std::cbrt( clamped.x * clamped.y * clamped.z / cells );
+				mCellSize = std::max( mCellSize, maxExtent / kMaxRes );
+
+				for( int i = 0; i < 3; ++i )
+					mRes[i] = std::clamp( int(std::ceil( extent[i] / mCellSize )), 1, kMaxRes );
+
+				// Bucket the triangles (CSR)
+				mCellStart.assign( std::size_t(mRes[0]) * mRes[1] * mRes[2] + 1, 0 );
+				std::vector<std::uint32_t> cellOf( aCentroids.size() );
+				for( std::size_t t = 0; t < aCentroids.size(); ++t )
+				{
+					auto const cell = cell_index_( cell_of_( aCentroids[t] ) );
+					cellOf[t] = std::uint32_t(cell);
+					++mCellStart[cell+1];
+				}
+				for( std::size_t c = 1; c < mCellStart.size(); ++c )
+					mCellStart[c] += mCellStart[c-1];
+
+				mCellBegin.assign( mCellStart.begin(), mCellStart.end()-1 );
+				mTriangles.resize( aCentroids.size() );
+
+				auto fill = mCellBegin;
+				for( std::size_t t = 0; t < aCentroids.size(); ++t )
+					mTriangles[fill[cellOf[t]]++] = std::uint32_t(t);
+			}
+
+			// Returns the triangle that is not yet emitted and whose
+			// centroid is closest to aPoint, or kNone.
+			std::uint32_t nearest( glm::vec3 const& aPoint, std::vector<char> const& aEmitted )
+			{
+				auto const origin = cell_of_( aPoint );
+				auto const maxRing = std::max( { mRes[0], mRes[1], mRes[2] } );
+
+				std::uint32_t best = kNone;
+				float bestDist = std::numeric_limits<float>::max();
+
+				for( int ring = 0; ring < maxRing; ++ring )
+				{
+					for( int z = origin.z - ring; z <= origin.z + ring; ++z )
+					{
+						for( int y = origin.y - ring; y <= origin.y + ring; ++y )
+						{
+							for( int x = origin.x - ring; x <= origin.x + ring; ++x )
+							{
+								if( std::max( { std::abs( x - origin.x ), std::abs( y - origin.y ), std::abs( z - origin.z ) } ) != ring )
+									continue;
+								if( x < 0 || y < 0 || z < 0 || x >= mRes[0] || y >= mRes[1] || z >= mRes[2] )
+									continue;
+
+								auto const cell = cell_index_( glm::ivec3( x, y, z ) );
+
+								// Emitted triangles are moved to the front of
+								// the cell and skipped from then on
+								auto& begin = mCellBegin[cell];
+								for( auto i = begin; i < mCellStart[cell+1]; ++i )
+								{
+									auto const t = mTriangles[i];
+									if( aEmitted[t] )
+									{
+										std::swap( mTriangles[i], mTriangles[begin] );
+										++begin;
+										continue;
+									}
+
+									auto const d = glm::dot( mCentroids[t] - aPoint, mCentroids[t] - aPoint );
+									if( d < bestDist )
+									{
+										best = t;
+										bestDist = d;
+									}
+								}
+							}
+						}
+					}
+
+					// Cells further out are at least ring*mCellSize away
+					auto const bound = ring * mCellSize;
+					if( kNone != best && bestDist <= bound*bound )
+						break;
+				}
+
+				return best;
+			}
+
+		private:
+			static constexpr int kMaxRes = 32;
+
+			glm::ivec3 cell_of_( glm::vec3 const& aPoint ) const noexcept
+			{
+				auto const c = glm::ivec3( glm::floor( (aPoint - mLo) / mCellSize ) );
+				return glm::clamp( c, glm::ivec3( 0 ), glm::ivec3( mRes[0]-1, mRes[1]-1, mRes[2]-1 ) );
+			}
+			std::size_t cell_index_( glm::ivec3 const& aCell ) const noexcept
+			{
+				return (std::size_t(aCell.z) * mRes[1] + aCell.y) * mRes[0] + aCell.x;
+			}
+
+			std::vector<glm::vec3> const& mCentroids;
+
+			glm::vec3 mLo;
+			float mCellSize;
+			int mRes[3];
+
+			std::vector<std::uint32_t> mCellStart;
+			std::vector<std::uint32_t> mCellBegin;
+			std::vector<std::uint32_t> mTriangles;
+	};
+
+	MeshletBounds compute_bounds_( glm::vec3 const* aPositions, std::uint32_t const* aVertices, std::size_t aVertexCount, std::uint32_t const* aIndices, std::size_t aTriangleCount )
+	{
+		assert( aVertexCount > 0 );
+
+		MeshletBounds ret{};
+
+		// Bounding sphere (Ritter): start from two far-apart points, then
+		// grow the sphere to include any vertices outside it.
+		auto const farthest_from = [&] ( glm::vec3 const& aP ) {
+			std::size_t best = 0;
+			float bestDist = -1.f;
+			for( std::size_t i = 0; i < aVertexCount; ++i )
+			{
+				auto const d = glm::dot( aPositions[aVertices[i]] - aP, aPositions[aVertices[i]] - aP );
+				if( d > bestDist )
+				{
+					best = i;
+					bestDist = d;
+				}
+			}
+			return aPositions[aVertices[best]];
+		};
+
+		auto const pa = farthest_from( aPositions[aVertices[0]] );
+		auto const pb = farthest_from( pa );
+
+		glm::vec3 center = (pa + pb) * 0.5f;
+		float radius = glm::length( pb - pa ) * 0.5f;
+
+		for( std::size_t i = 0; i < aVertexCount; ++i )
+		{
+			auto const& p = aPositions[aVertices[i]];
+			auto const d = glm::length( p - center );
+			if( d > radius )
+			{
+				auto const grown = (radius + d) * 0.5f;
+				center += (p - center) * ((grown - radius) / d);
+				radius = grown;
+			}
+		}
+
+		ret.center = center;
+		ret.radius = radius;
+
+		// Normal cone
+		std::vector<glm::vec3> normals;
+		normals.reserve( aTriangleCount );
+
+		glm::vec3 axis( 0.f );
+		for( std::size_t t = 0; t < aTriangleCount; ++t )
+		{
+			auto const& p0 = aPositions[aIndices[t*3+0]];
+			auto const& p1 = aPositions[aIndices[t*3+1]];
+			auto const& p2 = aPositions[aIndices[t*3+2]];
+
+			auto const n = glm::cross( p1 - p0, p2 - p0 );
+			auto const len = glm::length( n );
+			if( len <= 0.f )
+				continue; // degenerate; never visible
+
+			normals.emplace_back( n / len );
+			axis += normals.back();
+		}
+
+		ret.coneApex = center;
+		ret.coneAxis = glm::vec3( 0.f, 0.f, 1.f );
+		ret.coneCutoff = 1.f;
+
+		auto const axisLength = glm::length( axis );
+		if( normals.empty() || axisLength <= 0.f )
+			return ret;
+
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for( auto const& n : normals )
+			minDot = std::min( minDot, glm::dot( n, axis ) );
+
+		ret.coneAxis = axis;
+
+		// Cones wider than ~84 degrees (half angle) are practically never
+		// entirely back-facing
+		if( minDot <= 0.1f )
+			return ret;
+
+		// Move the apex behind all triangle planes, so that testing from the
+		// apex is conservative for the whole meshlet.
+		float maxT = 0.f;
+		std::size_t ni = 0;
+		for( std::size_t t = 0; t < aTriangleCount; ++t )
+		{
+			auto const& p0 = aPositions[aIndices[t*3+0]];
+			auto const& p1 = aPositions[aIndices[t*3+1]];
+			auto const& p2 = aPositions[aIndices[t*3+2]];
+			if( glm::length( glm::cross( p1 - p0, p2 - p0 ) ) <= 0.f )
+				continue;
+
+			auto const& n = normals[ni++];
+			maxT = std::max( maxT, glm::dot( center - p0, n ) / glm::dot( axis, n ) );
+		}
+
+		ret.coneApex = center - axis * maxT;
+		ret.coneCutoff = std::sqrt( 1.f - minDot*minDot );
+		return ret;
+	}
+
+	// Builds the meshlets for aIndexCount indices of aMesh, starting at
+	// aIndexBegin (relative to the mesh's indexStartIndex). The range's
+	// indices are rewritten in meshlet order.
+	void build_range_( ModelData& aModel, MeshInfo const& aMesh, std::size_t aIndexBegin, std::size_t aIndexCount, std::vector<std::uint32_t>& aLocalId, MeshletData& aOut )
+	{
+		auto const triangleCount = aIndexCount / 3;
+		if( 0 == triangleCount )
+			return;
+
+		auto* indices = aModel.indices.data() + aMesh.indexStartIndex + aIndexBegin;
+		auto const* positions = aModel.vertexPositions.data() + aMesh.vertexStartIndex;
+
+		// Dense ids for the vertices used by the range
+		std::vector<std::uint32_t> rangeVertices;
+		std::vector<std::uint32_t> tris( triangleCount*3 );
+		for( std::size_t i = 0; i < triangleCount*3; ++i )
+		{
+			auto const v = indices[i];
+			if( kNone == aLocalId[v] )
+			{
+				aLocalId[v] = std::uint32_t(rangeVertices.size());
+				rangeVertices.emplace_back( v );
+			}
+
+			tris[i] = aLocalId[v];
+		}
+
+		for( auto const v : rangeVertices )
+			aLocalId[v] = kNone;
+
+		auto const vertexCount = rangeVertices.size();
+
+		// Vertex -> triangle adjacency (CSR)
+		std::vector<std::uint32_t> adjacencyStart( vertexCount+1, 0 );
+		for( auto const v : tris )
+			++adjacencyStart[v+1];
+		for( std::size_t v = 0; v < vertexCount; ++v )
+			adjacencyStart[v+1] += adjacencyStart[v];
+
+		std::vector<std::uint32_t> adjacency( triangleCount*3 );
+		{
+			auto fill = adjacencyStart;
+			for( std::size_t i = 0; i < triangleCount*3; ++i )
+				adjacency[fill[tris[i]]++] = std::uint32_t(i / 3);
+		}
+
+		std::vector<glm::vec3> centroids( triangleCount );
+		for( std::size_t t = 0; t < triangleCount; ++t )
+			centroids[t] = (positions[rangeVertices[tris[t*3+0]]] + positions[rangeVertices[tris[t*3+1]]] + positions[rangeVertices[tris[t*3+2]]]) / 3.f;
+
+		TriangleGrid_ grid( centroids );
+
+		std::vector<char> emitted( triangleCount, 0 );
+		std::vector<std::uint32_t> queuedFor( triangleCount, kNone );
+		std::vector<std::uint32_t> slot( vertexCount, kNone );
+
+		std::vector<std::uint32_t> current;     // triangles of the current meshlet
+		std::vector<std::uint32_t> currentVerts;
+		std::vector<std::uint32_t> candidates;
+
+		std::vector<std::uint32_t> reordered;
+		reordered.reserve( triangleCount*3 );
+
+		std::uint32_t meshletId = 0;
+
+		// Centre of the current meshlet's vertices; after a flush, that of the
+		// previous meshlet, so that the next one starts nearby.
+		glm::vec3 center = centroids.empty() ? glm::vec3( 0.f ) : centroids[0];
+		glm::vec3 centerSum( 0.f );
+
+		auto const flush = [&] () {
+			if( current.empty() )
+				return;
+
+			// Keep the previous (vertex cache optimized) order inside the meshlet
+			std::sort( current.begin(), current.end() );
+
+			for( auto const v : currentVerts )
+				slot[v] = kNone;
+
+			Meshlet meshlet{};
+			meshlet.vertexOffset = std::uint32_t(aOut.vertices.size());
+			meshlet.triangleOffset = std::uint32_t(aOut.triangles.size());
+			meshlet.triangleCount = std::uint32_t(current.size());
+			meshlet.firstIndex = std::uint32_t(aIndexBegin + reordered.size());
+
+			std::uint32_t localCount = 0;
+			for( auto const t : current )
+			{
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					auto const v = tris[t*3+c];
+					if( kNone == slot[v] )
+					{
+						slot[v] = localCount++;
+						aOut.vertices.emplace_back( rangeVertices[v] );
+					}
+
+					aOut.triangles.emplace_back( std::uint8_t(slot[v]) );
+					reordered.emplace_back( rangeVertices[v] );
+				}
+			}
+
+			assert( localCount <= kMaxMeshletVertices );
+			meshlet.vertexCount = localCount;
+
+			for( auto const v : currentVerts )
+				slot[v] = kNone;
+
+			aOut.bounds.emplace_back( compute_bounds_(
+				positions,
+				aOut.vertices.data() + meshlet.vertexOffset, meshlet.vertexCount,
+				reordered.data() + (meshlet.firstIndex - aIndexBegin), meshlet.triangleCount
+			) );
+			aOut.meshlets.emplace_back( meshlet );
+
+			current.clear();
+			currentVerts.clear();
+			candidates.clear();
+			centerSum = glm::vec3( 0.f );
+			++meshletId;
+		};
+
+		auto const new_vertices = [&] ( std::uint32_t aTri ) {
+			return std::size_t(kNone == slot[tris[aTri*3+0]]) + std::size_t(kNone == slot[tris[aTri*3+1]]) + std::size_t(kNone == slot[tris[aTri*3+2]]);
+		};
+
+		for( std::size_t done = 0; done < triangleCount; )
+		{
+			// Prefer triangles adjacent to the meshlet that add the fewest
+			// new vertices; ties go to the one closest to the meshlet.
+			std::uint32_t best = kNone;
+			std::size_t bestNew = 4;
+			float bestDist = 0.f;
+
+			for( std::size_t i = 0; i < candidates.size(); )
+			{
+				auto const t = candidates[i];
+				if( emitted[t] )
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+
+				auto const n = new_vertices( t );
+				auto const d = glm::dot( centroids[t] - center, centroids[t] - center );
+				if( n < bestNew || (n == bestNew && d < bestDist) )
+				{
+					best = t;
+					bestNew = n;
+					bestDist = d;
+				}
+
+				++i;
+			}
+
+			if( kNone == best )
+			{
+				best = grid.nearest( center, emitted );
+				assert( kNone != best );
+				bestNew = new_vertices( best );
+			}
+
+			if( currentVerts.size() + bestNew > kMaxMeshletVertices || current.size() == kMaxMeshletTriangles )
+			{
+				flush();
+				continue;
+			}
+
+			emitted[best] = 1;
+			current.emplace_back( best );
+			++done;
+
+			for( std::size_t c = 0; c < 3; ++c )
+			{
+				auto const v = tris[best*3+c];
+				if( kNone != slot[v] )
+					continue;
+
+				slot[v] = std::uint32_t(currentVerts.size());
+				currentVerts.emplace_back( v );
+
+				centerSum += positions[rangeVertices[v]];
+				center = centerSum / float(currentVerts.size());
+
+				for( auto a = adjacencyStart[v]; a < adjacencyStart[v+1]; ++a )
+				{
+					auto const t = adjacency[a];
+					if( !emitted[t] && meshletId != queuedFor[t] )
+					{
+						queuedFor[t] = meshletId;
+						candidates.emplace_back( t );
+					}
+				}
+			}
+		}
+
+		flush();
+
+		assert( reordered.size() == triangleCount*3 );
+		std::copy( reordered.begin(), reordered.end(), indices );
+	}
+}
+
+MeshletData build_meshlets( ModelData& aModel )
+{
+	MeshletData ret;
+	ret.meshStart.reserve( aModel.meshes.size()+1 );
+
+	for( auto const& mesh : aModel.meshes )
+	{
+		ret.meshStart.emplace_back( ret.meshlets.size() );
+
+		if( 0 == mesh.numberOfIndices && 0 != mesh.numberOfVertices )
+			throw lut::Error( "build_meshlets(): mesh '%s' is not indexed", mesh.meshName.c_str() );
+
+		std::vector<std::uint32_t> localId( mesh.numberOfVertices, kNone );
+
+		if( 0 == mesh.numberOfSubMeshes )
+		{
+			build_range_( aModel, mesh, 0, mesh.numberOfIndices, localId, ret );
+			continue;
+		}
+
+		for( std::size_t i = 0; i < mesh.numberOfSubMeshes; ++i )
+		{
+			auto const& sub = aModel.subMeshes[mesh.subMeshStartIndex + i];
+			assert( sub.indexStartIndex >= mesh.indexStartIndex );
+			build_range_( aModel, mesh, sub.indexStartIndex - mesh.indexStartIndex, sub.numberOfIndices, localId, ret );
+		}
+	}
+
+	ret.meshStart.emplace_back( ret.meshlets.size() );
+	return ret;
+}
+
+
+Frustum make_frustum( glm::mat4 const& aProjCam ) noexcept
+{
+	auto const row = [&] ( int aRow ) {
+		return glm::vec4( aProjCam[0][aRow], aProjCam[1][aRow], aProjCam[2][aRow], aProjCam[3][aRow] );
+	};
+
+	Frustum ret{};
+	ret.planes[0] = row(3) + row(0); // left
+	ret.planes[1] = row(3) - row(0); // right
+	ret.planes[2] = row(3) + row(1); // bottom
+	ret.planes[3] = row(3) - row(1); // top
+	ret.planes[4] = row(2);          // near (0 <= z)
+	ret.planes[5] = row(3) - row(2); // far
+
+	for( auto& plane : ret.planes )
+		plane /= glm::length( glm::vec3( plane ) );
+
+	return ret;
+}
+
+bool sphere_in_frustum( glm::vec3 const& aCenter, float aRadius, Frustum const& aFrustum ) noexcept
+{
+	for( auto const& plane : aFrustum.planes )
+	{
+		if( glm::dot( glm::vec3( plane ), aCenter ) + plane.w < -aRadius )
+			return false;
+	}
+
+	return true;
+}
+
+bool meshlet_visible( MeshletBounds const& aBounds, Frustum const& aFrustum, glm::vec3 const& aCameraPos ) noexcept
+{
+	if( !sphere_in_frustum( aBounds.center, aBounds.radius, aFrustum ) )
+		return false;
+
+	if( aBounds.coneCutoff < 1.f )
+	{
+		auto const view = aBounds.coneApex - aCameraPos;
+		auto const dist = glm::length( view );
+		if( dist > 0.f && glm::dot( view, aBounds.coneAxis ) >= aBounds.coneCutoff * dist )
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+
+/* Meshlets (clusters).
+ *
+ * build_meshlets() partitions each mesh of an indexed model into meshlets of
+ * at most kMaxMeshletVertices vertices and kMaxMeshletTriangles triangles.
+ * Triangles are added to a meshlet preferring ones that share vertices with
+ * it (and, among those, ones close to it); when there are none, building
+ * continues with the free triangle closest to the meshlet, which keeps
+ * meshlets spatially compact even for meshes made of many small disconnected
+ * parts.
+ *
+ * The meshlets are stored in a packed form (MeshletData::vertices and
+ * MeshletData::triangles), which can be consumed by e.g. a mesh shader. So
+ * that standard vertex shaders can draw individual meshlets as well,
+ * build_meshlets() also reorders the triangles in ModelData::indices such
+ * that each meshlet is a contiguous index range. Meshlets never straddle
+ * sub-meshes (see batch_meshes_by_material()), so the sub-mesh ranges
+ * remain valid. Inside a meshlet, the triangles keep their previous relative
+ * order (see optimize_meshes()).
+ *
+ * Each meshlet has a bounding sphere and a normal cone for culling; see
+ * meshlet_visible().
+ */
+
+constexpr std::size_t kMaxMeshletVertices = 64;
+constexpr std::size_t kMaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+	// Packed data: vertexCount entries of MeshletData::vertices, starting at
+	// vertexOffset, and triangleCount*3 entries of MeshletData::triangles,
+	// starting at triangleOffset.
+	std::uint32_t vertexOffset;
+	std::uint32_t triangleOffset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleCount;
+
+	// The same triangles as a range of ModelData::indices, relative to the
+	// owning mesh's indexStartIndex (i.e., directly usable as firstIndex).
+	std::uint32_t firstIndex;
+};
+
+struct MeshletBounds
+{
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone. The meshlet is entirely back-facing for viewers at
+	// positions p for which dot( normalize(coneApex - p), coneAxis ) is at
+	// least coneCutoff. A cutoff of 1 disables the test.
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds; // one per meshlet
+
+	// Vertex indices, relative to the owning mesh's vertexStartIndex
+	std::vector<std::uint32_t> vertices;
+	// Three meshlet-local vertex indices per triangle
+	std::vector<std::uint8_t> triangles;
+
+	// The meshlets of mesh i are [meshStart[i], meshStart[i+1])
+	std::vector<std::size_t> meshStart;
+};
+
+MeshletData build_meshlets( ModelData& aModel );
+
+
+// Culling
+struct Frustum
+{
+	glm::vec4 planes[6]; // xyz = inward normal, w = distance
+};
+
+// Extracts the planes from a projection-view matrix with a [0,1] depth range
+// (e.g. glm::perspectiveRH_ZO()).
+Frustum make_frustum( glm::mat4 const& aProjCam ) noexcept;
+
+bool sphere_in_frustum( glm::vec3 const& aCenter, float aRadius, Frustum const& ) noexcept;
+
+// Frustum test against the bounding sphere, and back-face test against the
+// normal cone. Positions are in the meshlet's (object) space.
+bool meshlet_visible( MeshletBounds const&, Frustum const&, glm::vec3 const& aCameraPos ) noexcept;
@@ -1,13 +1,30 @@
 #include "model.hpp"
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 #include <utility>
+#include <sstream>
+#include <optional>
+#include <algorithm>
 
+#include <cmath>
+#include <cctype>
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
 
 #include "../labutils/error.hpp"
+#include "../labutils/thread_pool.hpp"
+#include "../labutils/mapped_file.hpp"
 namespace lut = labutils;
 
+#if !defined(CW1_VALIDATE_OBJ_LOADER)
+#	define CW1_VALIDATE_OBJ_LOADER 0
+#endif
+
 // ModelData
 ModelData::ModelData() noexcept = default;
 
@@ -16,9 +33,11 @@ ModelData::ModelData( ModelData&& aOther ) noexcept
 	, modelSourcePath( std::exchange( aOther.modelSourcePath, {} ) )
 	, materials( std::move( aOther.materials ) )
 	, meshes( std::move( aOther.meshes ) )
+	, subMeshes( std::move( aOther.subMeshes ) )
 	, vertexPositions( std::move( aOther.vertexPositions ) )
 	, vertexNormals( std::move( aOther.vertexNormals ) )
 	, vertexTextureCoords( std::move( aOther.vertexTextureCoords ) )
+	, indices( std::move( aOther.indices ) )
 {}
 
 ModelData& ModelData::operator=( ModelData&& aOther ) noexcept
@@ -27,15 +46,1332 @@ ModelData& ModelData::operator=( ModelData&& aOther ) noexcept
 	std::swap( modelSourcePath, aOther.modelSourcePath );
 	std::swap( materials, aOther.materials );
 	std::swap( meshes, aOther.meshes );
+	std::swap( subMeshes, aOther.subMeshes );
 	std::swap( vertexPositions, aOther.vertexPositions );
 	std::swap( vertexNormals, aOther.vertexNormals );
 	std::swap( vertexTextureCoords, aOther.vertexTextureCoords );
+	std::swap( indices, aOther.indices );
 	return *this;
 }
 
 
+// Parallel OBJ parser
+//
+// Parsing happens in two phases. First, the file is split into line-aligned
+// chunks that are tokenized independently. Each chunk collects its own v, vt
+// and vn arrays, its faces, and a list of the remaining statements (usemtl,
+// g, o, mtllib) together with their position relative to the faces.
+//
+// OBJ indices are global (or relative to the number of vertices seen so
+// far). A chunk does not know how many vertices precede it, so relative
+// indices are stored as chunk-local values and flagged; they are fixed up
+// once the per-chunk counts are known.
+//
+// The second phase replays the statements in file order. This is cheap, as
+// it operates on face ranges rather than individual faces. It reproduces the
+// grouping rules of tinyobj::LoadObj() (including its quirks), such that the
+// resulting ModelData is identical to load_obj_model_tinyobj(). Finally, the
+// triangle soup is filled in parallel.
+namespace
+{
+	// Target chunk size. Chunks are only used for parallelism; smaller files
+	// simply end up with fewer chunks.
+	constexpr std::size_t kObjChunkBytes = std::size_t(1) << 20;
+
+	// Faces per fill job
+	constexpr std::size_t kFillJobFaces = std::size_t(1) << 16;
+
+	struct ObjCorner_
+	{
+		// Indices after fixIndex(). A value of -1 means "not present" unless
+		// the corresponding bit is set in relative, in which case the index
+		// was relative and the chunk's attribute offset must be added.
+		std::int32_t v, vt, vn;
+		std::uint32_t relative;
+	};
+
+	constexpr std::uint32_t kRelativeV = 1u << 0;
+	constexpr std::uint32_t kRelativeVT = 1u << 1;
+	constexpr std::uint32_t kRelativeVN = 1u << 2;
+
+	enum class ObjStatementKind_ : std::uint8_t
+	{
+		usemtl,
+		group,
+		object,
+		mtllib
+	};
+
+	struct ObjStatement_
+	{
+		ObjStatementKind_ kind;
+		std::size_t faceIndex; // number of faces in the chunk before this statement
+		std::string argument;
+	};
+
+	struct ObjChunk_
+	{
+		char const* begin;
+		char const* end;
+
+		std::vector<float> positions; // 3 per vertex
+		std::vector<float> normals;   // 3 per vertex
+		std::vector<float> texcoords; // 2 per vertex
+
+		std::vector<ObjCorner_> corners;
+		std::vector<std::size_t> faceCorners = { 0 }; // faces+1 entries, prefix sum
+		std::vector<std::size_t> faceOutput = { 0 };  // faces+1 entries, triangle soup vertices
+
+		std::vector<ObjStatement_> statements;
+
+		// Attribute offsets of this chunk, set after parsing
+		std::size_t positionBase = 0, normalBase = 0, texcoordBase = 0;
+	};
+
+	// Tokenizer helpers. They operate on [aPtr,aEnd) of a single line and
+	// mirror the behaviour of the C-string functions used by tinyobjloader.
+	inline bool is_space_( char aC ) noexcept
+	{
+		return ' ' == aC || '\t' == aC;
+	}
+	inline char peek_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		return aPtr < aEnd ? *aPtr : '\0';
+	}
+	inline char const* skip_space_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		while( aPtr < aEnd && is_space_( *aPtr ) )
+			++aPtr;
+		return aPtr;
+	}
+	inline char const* token_end_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		// strcspn( " \t\r" )
+		while( aPtr < aEnd && !is_space_( *aPtr ) && '\r' != *aPtr )
+			++aPtr;
+		return aPtr;
+	}
+	inline char const* index_end_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		// strcspn( "/ \t\r" )
+		while( aPtr < aEnd && '/' != *aPtr && !is_space_( *aPtr ) && '\r' != *aPtr )
+			++aPtr;
+		return aPtr;
+	}
+
+	inline int atoi_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		while( aPtr < aEnd && (is_space_( *aPtr ) || '\v' == *aPtr || '\f' == *aPtr) )
+			++aPtr;
+
+		bool negative = false;
+		if( aPtr < aEnd && ('-' == *aPtr || '+' == *aPtr) )
+			negative = ('-' == *aPtr++);
+
+		long long value = 0;
+		while( aPtr < aEnd && unsigned(*aPtr - '0') < 10u )
+			value = value * 10 + (*aPtr++ - '0');
+
+		return int(negative ? -value : value);
+	}
+
+	// Same arithmetic as tinyobj's tryParseDouble(), so that the results are
+	// bit-identical. Avoiding strtod() and per-line std::string copies is
+	// where most of the single-thread speedup comes from.
+	bool parse_double_( char const* aPtr, char const* aEnd, double& aResult ) noexcept
+	{
+		if( aPtr >= aEnd )
+			return false;
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		bool negative = false;
+
+		if( '+' == *aPtr || '-' == *aPtr )
+			negative = ('-' == *aPtr++);
+		else if( unsigned(*aPtr - '0') >= 10u )
+			return false;
+
+		int read = 0;
+		while( aPtr < aEnd && unsigned(*aPtr - '0') < 10u )
+		{
+			mantissa *= 10;
+			mantissa += static_cast<int>(*aPtr - '0');
+			++aPtr;
+			++read;
+		}
+
+		if( 0 == read )
+			return false;
+
+		if( aPtr < aEnd && '.' == *aPtr )
+		{
+			static constexpr double kPowLut[] = {
+				1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+			};
+			constexpr int kLutEntries = sizeof(kPowLut) / sizeof(kPowLut[0]);
+
+			++aPtr;
+			read = 1;
+			while( aPtr < aEnd && unsigned(*aPtr - '0') < 10u )
+			{
+				mantissa += static_cast<int>(*aPtr - '0') * (read < kLutEntries ? kPowLut[read] : std::pow( 10.0, -read ));
+				++read;
+				++aPtr;
+			}
+		}
+
+		if( aPtr < aEnd && ('e' == *aPtr || 'E' == *aPtr) )
+		{
+			++aPtr;
+
+			bool negativeExp = false;
+			if( aPtr < aEnd && ('+' == *aPtr || '-' == *aPtr) )
+				negativeExp = ('-' == *aPtr++);
+			else if( aPtr >= aEnd || unsigned(*aPtr - '0') >= 10u )
+				return false;
+
+			read = 0;
+			while( aPtr < aEnd && unsigned(*aPtr - '0') < 10u )
+			{
+				exponent *= 10;
+				exponent += static_cast<int>(*aPtr - '0');
+				++aPtr;
+				++read;
+			}
+
+			if( 0 == read )
+				return false;
+
+			if( negativeExp )
+				exponent = -exponent;
+		}
+
+		aResult = (negative ? -1 : 1) * (exponent ? std::ldexp( mantissa * std::pow( 5.0, exponent ), exponent ) : mantissa);
+		return true;
+	}
+
+	inline float parse_real_( char const*& aPtr, char const* aEnd, double aDefault = 0.0 ) noexcept
+	{
+		aPtr = skip_space_( aPtr, aEnd );
+		auto const* end = token_end_( aPtr, aEnd );
+
+		double value = aDefault;
+		parse_double_( aPtr, end, value );
+
+		aPtr = end;
+		return static_cast<float>(value);
+	}
+
+	// First whitespace-delimited word, like sscanf( "%s" )
+	std::string parse_word_( char const* aPtr, char const* aEnd )
+	{
+		while( aPtr < aEnd && std::isspace( static_cast<unsigned char>(*aPtr) ) )
+			++aPtr;
+
+		auto const* beg = aPtr;
+		while( aPtr < aEnd && !std::isspace( static_cast<unsigned char>(*aPtr) ) )
+			++aPtr;
+
+		return std::string( beg, aPtr );
+	}
+
+	// tinyobj's fixIndex(), but returns a chunk-local value for relative
+	// indices
+	inline std::int32_t fix_index_( int aIndex, std::size_t aLocalCount, std::uint32_t aRelativeBit, std::uint32_t& aRelative ) noexcept
+	{
+		if( aIndex > 0 ) return aIndex - 1;
+		if( 0 == aIndex ) return 0;
+
+		aRelative |= aRelativeBit;
+		return std::int32_t(aLocalCount) + aIndex;
+	}
+
+	void parse_face_( ObjChunk_& aChunk, char const* aPtr, char const* aEnd )
+	{
+		auto const vcount = aChunk.positions.size() / 3;
+		auto const vncount = aChunk.normals.size() / 3;
+		auto const vtcount = aChunk.texcoords.size() / 2;
+
+		aPtr = skip_space_( aPtr, aEnd );
+
+		std::size_t corners = 0;
+		while( aPtr < aEnd && '\r' != *aPtr )
+		{
+			ObjCorner_ corner{ -1, -1, -1, 0 };
+
+			// i, i/j/k, i//k, i/j
+			corner.v = fix_index_( atoi_( aPtr, aEnd ), vcount, kRelativeV, corner.relative );
+			aPtr = index_end_( aPtr, aEnd );
+
+			if( '/' == peek_( aPtr, aEnd ) )
+			{
+				++aPtr;
+				if( '/' == peek_( aPtr, aEnd ) )
+				{
+					++aPtr;
+					corner.vn = fix_index_( atoi_( aPtr, aEnd ), vncount, kRelativeVN, corner.relative );
+					aPtr = index_end_( aPtr, aEnd );
+				}
+				else
+				{
+					corner.vt = fix_index_( atoi_( aPtr, aEnd ), vtcount, kRelativeVT, corner.relative );
+					aPtr = index_end_( aPtr, aEnd );
+
+					if( '/' == peek_( aPtr, aEnd ) )
+					{
+						++aPtr;
+						corner.vn = fix_index_( atoi_( aPtr, aEnd ), vncount, kRelativeVN, corner.relative );
+						aPtr = index_end_( aPtr, aEnd );
+					}
+				}
+			}
+
+			aChunk.corners.emplace_back( corner );
+			++corners;
+
+			while( aPtr < aEnd && (is_space_( *aPtr ) || '\r' == *aPtr) )
+				++aPtr;
+		}
+
+		// Faces are triangulated as fans; faces with fewer than three corners
+		// don't produce any triangles.
+		auto const triangles = corners >= 3 ? corners - 2 : 0;
+		aChunk.faceCorners.emplace_back( aChunk.corners.size() );
+		aChunk.faceOutput.emplace_back( aChunk.faceOutput.back() + triangles*3 );
+	}
+
+	bool starts_with_keyword_( char const* aPtr, char const* aEnd, std::string_view const& aKeyword ) noexcept
+	{
+		auto const len = aKeyword.size();
+		return std::size_t(aEnd - aPtr) > len && 0 == std::memcmp( aPtr, aKeyword.data(), len ) && is_space_( aPtr[len] );
+	}
+
+	void parse_line_( ObjChunk_& aChunk, char const* aPtr, char const* aEnd )
+	{
+		aPtr = skip_space_( aPtr, aEnd );
+		if( aPtr == aEnd || '#' == *aPtr )
+			return;
+
+		char const c0 = *aPtr, c1 = peek_( aPtr+1, aEnd );
+
+		if( 'v' == c0 && is_space_( c1 ) )
+		{
+			aPtr += 2;
+			float const x = parse_real_( aPtr, aEnd );
+			float const y = parse_real_( aPtr, aEnd );
+			float const z = parse_real_( aPtr, aEnd );
+			aChunk.positions.insert( aChunk.positions.end(), { x, y, z } );
+			return;
+		}
+
+		if( 'v' == c0 && 'n' == c1 && is_space_( peek_( aPtr+2, aEnd ) ) )
+		{
+			aPtr += 3;
+			float const x = parse_real_( aPtr, aEnd );
+			float const y = parse_real_( aPtr, aEnd );
+			float const z = parse_real_( aPtr, aEnd );
+			aChunk.normals.insert( aChunk.normals.end(), { x, y, z } );
+			return;
+		}
+
+		if( 'v' == c0 && 't' == c1 && is_space_( peek_( aPtr+2, aEnd ) ) )
+		{
+			aPtr += 3;
+			float const u = parse_real_( aPtr, aEnd );
+			float const v = parse_real_( aPtr, aEnd );
+			aChunk.texcoords.insert( aChunk.texcoords.end(), { u, v } );
+			return;
+		}
+
+		if( 'f' == c0 && is_space_( c1 ) )
+		{
+			parse_face_( aChunk, aPtr+2, aEnd );
+			return;
+		}
+
+		auto const faces = aChunk.faceCorners.size()-1;
+
+		if( starts_with_keyword_( aPtr, aEnd, "usemtl" ) )
+		{
+			aChunk.statements.emplace_back( ObjStatement_{ ObjStatementKind_::usemtl, faces, parse_word_( aPtr+7, aEnd ) } );
+			return;
+		}
+
+		if( starts_with_keyword_( aPtr, aEnd, "mtllib" ) )
+		{
+			aChunk.statements.emplace_back( ObjStatement_{ ObjStatementKind_::mtllib, faces, std::string( aPtr+7, aEnd ) } );
+			return;
+		}
+
+		if( 'g' == c0 && is_space_( c1 ) )
+		{
+			// The group name is the second token (the first one is "g")
+			auto const* beg = skip_space_( token_end_( aPtr, aEnd ), aEnd );
+			while( beg < aEnd && '\r' == *beg )
+				beg = skip_space_( beg+1, aEnd );
+
+			aChunk.statements.emplace_back( ObjStatement_{ ObjStatementKind_::group, faces, std::string( beg, token_end_( beg, aEnd ) ) } );
+			return;
+		}
+
+		if( 'o' == c0 && is_space_( c1 ) )
+		{
+			aChunk.statements.emplace_back( ObjStatement_{ ObjStatementKind_::object, faces, parse_word_( aPtr+2, aEnd ) } );
+			return;
+		}
+
+		// Ignore everything else (including tags)
+	}
+
+	void parse_chunk_( ObjChunk_& aChunk )
+	{
+		// Lines may end with "\n", "\r\n" or a lone "\r".
+		for( auto const* line = aChunk.begin; line < aChunk.end; )
+		{
+			auto const* eol = line;
+			while( eol < aChunk.end && '\n' != *eol && '\r' != *eol )
+				++eol;
+
+			parse_line_( aChunk, line, eol );
+
+			line = eol+1;
+		}
+	}
+
+	std::vector<ObjChunk_> split_chunks_( char const* aBegin, char const* aEnd )
+	{
+		std::vector<ObjChunk_> chunks;
+
+		for( auto const* beg = aBegin; beg < aEnd; )
+		{
+			auto const* end = beg + std::min( kObjChunkBytes, std::size_t(aEnd-beg) );
+
+			// Extend to the end of the line
+			if( end < aEnd )
+			{
+				if( auto const* nl = static_cast<char const*>(std::memchr( end, '\n', std::size_t(aEnd-end) )) )
+					end = nl+1;
+				else
+					end = aEnd;
+			}
+
+			auto& chunk = chunks.emplace_back();
+			chunk.begin = beg;
+			chunk.end = end;
+
+			beg = end;
+		}
+
+		return chunks;
+	}
+
+	// Materials from "mtllib" statements. MTL files are small, so they are
+	// read with tinyobjloader.
+	class ObjMaterialLibrary_
+	{
+		public:
+			explicit ObjMaterialLibrary_( std::string const& aDirectory )
+				: mDirectory( aDirectory )
+				, mReader( aDirectory )
+			{}
+
+			// Appends the materials of the MTL file(s) to aMaterials
+			void load( std::string const& aArgument, std::vector<MaterialInfo>& aMaterials, std::string& aWarnings )
+			{
+				// Mirrors SplitString( ..., ' ' ) in tinyobjloader
+				std::vector<std::string> filenames;
+				{
+					std::stringstream ss( aArgument );
+					std::string item;
+					while( std::getline( ss, item, ' ' ) )
+						filenames.emplace_back( std::move(item) );
+				}
+
+				if( filenames.empty() )
+				{
+					aWarnings += "WARN: Looks like empty filename for mtllib. Use default material. \n";
+					return;
+				}
+
+				for( auto const& filename : filenames )
+				{
+					// The material map stores indices into mMaterials, so the
+					// same vector must be passed to each call.
+					auto const firstNew = mMaterials.size();
+
+					std::string warn;
+					bool const ok = mReader( filename, &mMaterials, &mMaterialMap, &warn );
+					aWarnings += warn;
+
+					for( auto i = firstNew; i < mMaterials.size(); ++i )
+					{
+						auto const& m = mMaterials[i];
+
+						MaterialInfo info{};
+						info.materialName      = m.name;
+						info.color             = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
+
+						if( !m.diffuse_texname.empty() )
+							info.colorTexturePath  = mDirectory + m.diffuse_texname;
+
+						aMaterials.emplace_back( std::move(info) );
+					}
+
+					if( ok )
+						return;
+				}
+
+				aWarnings += "WARN: Failed to load material file(s). Use default material.\n";
+			}
+
+			// Material index for "usemtl", or -1 if the material is unknown
+			int find( std::string const& aName ) const
+			{
+				if( auto const it = mMaterialMap.find( aName ); mMaterialMap.end() != it )
+					return it->second;
+
+				return -1;
+			}
+
+		private:
+			std::string mDirectory;
+			tinyobj::MaterialFileReader mReader;
+			std::vector<tinyobj::material_t> mMaterials;
+			std::map<std::string, int> mMaterialMap;
+	};
+
+	// Phase two: replay statements in file order
+	struct FaceRange_
+	{
+		std::size_t chunk;
+		std::size_t faceBegin, faceEnd;
+	};
+
+	struct FillJob_
+	{
+		FaceRange_ faces;
+		std::size_t outputStart;
+	};
+
+	class ObjAssembler_
+	{
+		public:
+			ObjAssembler_( ModelData& aModel, std::vector<ObjChunk_> const& aChunks, std::string const& aDirectory, std::string& aWarnings )
+				: mModel( aModel )
+				, mChunks( aChunks )
+				, mMaterials( aDirectory )
+				, mWarnings( aWarnings )
+			{}
+
+			void run()
+			{
+				for( std::size_t c = 0; c < mChunks.size(); ++c )
+				{
+					auto const& chunk = mChunks[c];
+
+					std::size_t face = 0;
+					for( auto const& statement : chunk.statements )
+					{
+						faces_( c, face, statement.faceIndex );
+						face = statement.faceIndex;
+
+						switch( statement.kind )
+						{
+							case ObjStatementKind_::usemtl: usemtl_( statement.argument ); break;
+							case ObjStatementKind_::mtllib: mtllib_( statement.argument ); break;
+							case ObjStatementKind_::group: // fall-through
+							case ObjStatementKind_::object: group_( statement.argument ); break;
+						}
+					}
+
+					faces_( c, face, chunk.faceCorners.size()-1 );
+				}
+
+				bool const exported = export_();
+				if( exported || mShapeHasTriangles )
+					push_shape_();
+			}
+
+			std::size_t output_vertices() const noexcept
+			{
+				return mOutputVertices;
+			}
+
+			std::vector<FillJob_> const& jobs() const noexcept
+			{
+				return mJobs;
+			}
+
+		private:
+			struct Segment_
+			{
+				int material;
+				std::vector<FaceRange_> faces;
+			};
+
+			std::size_t triangle_vertices_( FaceRange_ const& aRange ) const noexcept
+			{
+				auto const& out = mChunks[aRange.chunk].faceOutput;
+				return out[aRange.faceEnd] - out[aRange.faceBegin];
+			}
+
+			void faces_( std::size_t aChunk, std::size_t aBegin, std::size_t aEnd )
+			{
+				if( aBegin == aEnd )
+					return;
+
+				if( !mFaceGroup.empty() && mFaceGroup.back().chunk == aChunk && mFaceGroup.back().faceEnd == aBegin )
+					mFaceGroup.back().faceEnd = aEnd;
+				else
+					mFaceGroup.emplace_back( FaceRange_{ aChunk, aBegin, aEnd } );
+			}
+
+			// exportFaceGroupToShape()
+			bool export_()
+			{
+				if( mFaceGroup.empty() )
+					return false;
+
+				std::size_t vertices = 0;
+				for( auto const& range : mFaceGroup )
+					vertices += triangle_vertices_( range );
+
+				if( vertices )
+				{
+					mShape.emplace_back( Segment_{ mMaterial, std::move(mFaceGroup) } );
+					mShapeHasTriangles = true;
+				}
+
+				mFaceGroup.clear();
+				mShapeName = mName;
+				return true;
+			}
+
+			void usemtl_( std::string const& aName )
+			{
+				int const newMaterial = mMaterials.find( aName );
+				if( newMaterial != mMaterial )
+				{
+					export_();
+					mMaterial = newMaterial;
+				}
+			}
+
+			void mtllib_( std::string const& aArgument )
+			{
+				mMaterials.load( aArgument, mModel.materials, mWarnings );
+			}
+
+			void group_( std::string const& aName )
+			{
+				if( export_() )
+					push_shape_();
+
+				mShape.clear();
+				mShapeHasTriangles = false;
+				mFaceGroup.clear();
+				mName = aName;
+			}
+
+			// Equivalent to the de-indexing loop of load_obj_model_tinyobj():
+			// starts a new mesh whenever the material changes.
+			void push_shape_()
+			{
+				int currentMaterial = 0;
+				bool first = true;
+				std::size_t meshStart = mOutputVertices;
+
+				auto const flush = [&] {
+					if( mOutputVertices == meshStart )
+						return;
+
+					assert( currentMaterial >= 0 );
+
+					MeshInfo mesh{};
+					mesh.materialIndex     = currentMaterial;
+					mesh.meshName          = mShapeName + "::" + mModel.materials[currentMaterial].materialName;
+					mesh.vertexStartIndex  = meshStart;
+					mesh.numberOfVertices  = mOutputVertices - meshStart;
+
+					mModel.meshes.emplace_back( std::move(mesh) );
+				};
+
+				for( auto const& segment : mShape )
+				{
+					if( first || segment.material != currentMaterial )
+					{
+						flush();
+						meshStart = mOutputVertices;
+						currentMaterial = segment.material;
+						first = false;
+					}
+
+					for( auto const& range : segment.faces )
+					{
+						// Split large ranges, such that they can be filled in
+						// parallel.
+						for( auto face = range.faceBegin; face < range.faceEnd; face += kFillJobFaces )
+						{
+							FaceRange_ const part{ range.chunk, face, std::min( face + kFillJobFaces, range.faceEnd ) };
+							mJobs.emplace_back( FillJob_{ part, mOutputVertices } );
+							mOutputVertices += triangle_vertices_( part );
+						}
+					}
+				}
+
+				flush();
+
+				mShape.clear();
+				mShapeHasTriangles = false;
+			}
+
+		private:
+			ModelData& mModel;
+			std::vector<ObjChunk_> const& mChunks;
+
+			ObjMaterialLibrary_ mMaterials;
+			std::string& mWarnings;
+
+			int mMaterial = -1;
+			std::string mName;
+
+			std::vector<FaceRange_> mFaceGroup;
+
+			std::vector<Segment_> mShape;
+			std::string mShapeName;
+			bool mShapeHasTriangles = false;
+
+			std::size_t mOutputVertices = 0;
+			std::vector<FillJob_> mJobs;
+	};
+
+	struct ObjAttributes_
+	{
+		std::vector<float> positions, normals, texcoords;
+	};
+
+	// Absolute attribute indices of a face corner; -1 if the attribute is not
+	// present.
+	struct ObjVertexRef_
+	{
+		std::int64_t v, vt, vn;
+	};
+
+	inline ObjVertexRef_ resolve_corner_( ObjCorner_ const& aCorner, ObjChunk_ const& aChunk, std::size_t aPositionCount, std::size_t aNormalCount, std::size_t aTexcoordCount )
+	{
+		ObjVertexRef_ ret{};
+
+		ret.v = std::int64_t(aCorner.v) + (aCorner.relative & kRelativeV ? std::int64_t(aChunk.positionBase) : 0);
+		if( ret.v < 0 || std::uint64_t(ret.v) >= aPositionCount )
+			throw lut::Error( "OBJ vertex index %lld out of range (%zu vertices)", (long long)ret.v, aPositionCount );
+
+		ret.vn = std::int64_t(aCorner.vn) + (aCorner.relative & kRelativeVN ? std::int64_t(aChunk.normalBase) : 0);
+		assert( ret.vn >= 0 ); // must have a normal!
+		if( ret.vn >= 0 && std::uint64_t(ret.vn) >= aNormalCount )
+			throw lut::Error( "OBJ normal index %lld out of range (%zu normals)", (long long)ret.vn, aNormalCount );
+
+		ret.vt = std::int64_t(aCorner.vt) + (aCorner.relative & kRelativeVT ? std::int64_t(aChunk.texcoordBase) : 0);
+		if( ret.vt >= 0 || (aCorner.relative & kRelativeVT) )
+		{
+			if( ret.vt < 0 || std::uint64_t(ret.vt) >= aTexcoordCount )
+				throw lut::Error( "OBJ texture coordinate index %lld out of range (%zu coordinates)", (long long)ret.vt, aTexcoordCount );
+		}
+
+		if( ret.vn < 0 ) ret.vn = -1;
+		if( ret.vt < 0 ) ret.vt = -1;
+
+		return ret;
+	}
+
+	void fill_job_( ModelData& aModel, ObjAttributes_ const& aAttribs, ObjChunk_ const& aChunk, FillJob_ const& aJob )
+	{
+		auto const positionCount = aAttribs.positions.size() / 3;
+		auto const normalCount = aAttribs.normals.size() / 3;
+		auto const texcoordCount = aAttribs.texcoords.size() / 2;
+
+		auto out = aJob.outputStart;
+		auto const emit = [&] ( ObjCorner_ const& aCorner ) {
+			auto const ref = resolve_corner_( aCorner, aChunk, positionCount, normalCount, texcoordCount );
+
+			aModel.vertexPositions[out] = glm::vec3(
+				aAttribs.positions[ ref.v * 3 + 0 ],
+				aAttribs.positions[ ref.v * 3 + 1 ],
+				aAttribs.positions[ ref.v * 3 + 2 ]
+			);
+
+			if( ref.vn >= 0 )
+			{
+				aModel.vertexNormals[out] = glm::vec3(
+					aAttribs.normals[ ref.vn * 3 + 0 ],
+					aAttribs.normals[ ref.vn * 3 + 1 ],
+					aAttribs.normals[ ref.vn * 3 + 2 ]
+				);
+			}
+			else
+			{
+				aModel.vertexNormals[out] = glm::vec3( 0.f, 0.f, 0.f );
+			}
+
+			if( ref.vt >= 0 )
+			{
+				aModel.vertexTextureCoords[out] = glm::vec2(
+					aAttribs.texcoords[ ref.vt * 2 + 0 ],
+					aAttribs.texcoords[ ref.vt * 2 + 1 ]
+				);
+			}
+			else
+			{
+				aModel.vertexTextureCoords[out] = glm::vec2( 0.f, 0.f );
+			}
+
+			++out;
+		};
+
+		for( auto face = aJob.faces.faceBegin; face < aJob.faces.faceEnd; ++face )
+		{
+			auto const* corners = aChunk.corners.data() + aChunk.faceCorners[face];
+			auto const count = aChunk.faceCorners[face+1] - aChunk.faceCorners[face];
+
+			// Polygon -> triangle fan, like tinyobjloader
+			for( std::size_t k = 2; k < count; ++k )
+			{
+				emit( corners[0] );
+				emit( corners[k-1] );
+				emit( corners[k] );
+			}
+		}
+
+		assert( out == aJob.outputStart + (aChunk.faceOutput[aJob.faces.faceEnd] - aChunk.faceOutput[aJob.faces.faceBegin]) );
+	}
+
+#	if CW1_VALIDATE_OBJ_LOADER
+	void validate_obj_model_( ModelData const& aModel, std::string_view const& aOBJPath )
+	{
+		auto const ref = load_obj_model_tinyobj( aOBJPath );
+
+		bool same = ref.materials.size() == aModel.materials.size()
+			&& ref.meshes.size() == aModel.meshes.size()
+			&& ref.vertexPositions.size() == aModel.vertexPositions.size();
+
+		for( std::size_t i = 0; same && i < ref.materials.size(); ++i )
+		{
+			auto const& a = ref.materials[i];
+			auto const& b = aModel.materials[i];
+			same = a.materialName == b.materialName && a.color == b.color && a.colorTexturePath == b.colorTexturePath;
+		}
+
+		for( std::size_t i = 0; same && i < ref.meshes.size(); ++i )
+		{
+			auto const& a = ref.meshes[i];
+			auto const& b = aModel.meshes[i];
+			same = a.meshName == b.meshName && a.materialIndex == b.materialIndex && a.vertexStartIndex == b.vertexStartIndex && a.numberOfVertices == b.numberOfVertices;
+		}
+
+		auto const bytes = ref.vertexPositions.size() * sizeof(glm::vec3);
+		same = same
+			&& 0 == std::memcmp( ref.vertexPositions.data(), aModel.vertexPositions.data(), bytes )
+			&& 0 == std::memcmp( ref.vertexNormals.data(), aModel.vertexNormals.data(), bytes )
+			&& 0 == std::memcmp( ref.vertexTextureCoords.data(), aModel.vertexTextureCoords.data(), ref.vertexTextureCoords.size() * sizeof(glm::vec2) );
+
+		if( !same )
+			throw lut::Error( "Parallel OBJ loader: output for '%s' differs from tinyobj::LoadObj()", aModel.modelSourcePath.c_str() );
+
+		std::printf( "Validated: '%s' matches tinyobj::LoadObj()\n", aModel.modelSourcePath.c_str() );
+	}
+#	endif // ~ CW1_VALIDATE_OBJ_LOADER
+}
+
 // load_obj_model()
-ModelData load_obj_model( std::string_view const& aOBJPath )
+ModelData load_obj_model( std::string_view const& aOBJPath, lut::ThreadPool* aPool )
+{
+	// "Decode" path
+	std::string fileName, directory;
+
+	if( auto const separator = aOBJPath.find_last_of( "/\\" ); std::string_view::npos != separator )
+	{
+		fileName = aOBJPath.substr( separator+1 );
+		directory = aOBJPath.substr( 0, separator+1 );
+	}
+	else
+	{
+		fileName = aOBJPath;
+		directory = "./";
+	}
+
+	std::string const normalizedPath = directory + fileName;
+
+	// Load model
+	std::printf( "Loading: '%s' ...", normalizedPath.c_str() );
+	std::fflush( stdout );
+
+	std::optional<lut::ThreadPool> localPool;
+	if( !aPool )
+		aPool = &localPool.emplace();
+
+	lut::MappedFile file;
+	try
+	{
+		file = lut::map_file( normalizedPath.c_str() );
+	}
+	catch( lut::Error const& eErr )
+	{
+		throw lut::Error( "Unable to load OBJ '%s':\n%s", normalizedPath.c_str(), eErr.what() );
+	}
+
+	// Phase one: tokenize chunks in parallel
+	auto const* text = reinterpret_cast<char const*>(file.data);
+	auto chunks = split_chunks_( text, text + file.size );
+
+	aPool->parallel_for( chunks.size(), [&] ( std::size_t aIndex ) {
+		parse_chunk_( chunks[aIndex] );
+	} );
+
+	// Concatenate attributes
+	ObjAttributes_ attribs;
+	{
+		std::size_t positions = 0, normals = 0, texcoords = 0;
+		for( auto& chunk : chunks )
+		{
+			chunk.positionBase = positions / 3;
+			chunk.normalBase = normals / 3;
+			chunk.texcoordBase = texcoords / 2;
+
+			positions += chunk.positions.size();
+			normals += chunk.normals.size();
+			texcoords += chunk.texcoords.size();
+		}
+
+		attribs.positions.resize( positions );
+		attribs.normals.resize( normals );
+		attribs.texcoords.resize( texcoords );
+
+		aPool->parallel_for( chunks.size(), [&] ( std::size_t aIndex ) {
+			auto& chunk = chunks[aIndex];
+			std::copy( chunk.positions.begin(), chunk.positions.end(), attribs.positions.begin() + chunk.positionBase*3 );
+			std::copy( chunk.normals.begin(), chunk.normals.end(), attribs.normals.begin() + chunk.normalBase*3 );
+			std::copy( chunk.texcoords.begin(), chunk.texcoords.end(), attribs.texcoords.begin() + chunk.texcoordBase*2 );
+
+			chunk.positions = {};
+			chunk.normals = {};
+			chunk.texcoords = {};
+		} );
+	}
+
+	// Phase two: group faces into meshes in file order
+	ModelData model;
+	model.modelName        = aOBJPath;
+	model.modelSourcePath  = normalizedPath;
+
+	std::string err;
+	ObjAssembler_ assembler( model, chunks, directory, err );
+	assembler.run();
+
+	// Apparently this can include some warnings:
+	if( !err.empty() )
+		std::printf( "\n%s\n... OK", err.c_str() );
+	else
+		std::printf( " OK\n" );
+
+	// Fill the triangle soup
+	auto const totalVertices = assembler.output_vertices();
+	model.vertexPositions.resize( totalVertices );
+	model.vertexNormals.resize( totalVertices );
+	model.vertexTextureCoords.resize( totalVertices );
+
+	auto const& jobs = assembler.jobs();
+	aPool->parallel_for( jobs.size(), [&] ( std::size_t aIndex ) {
+		auto const& job = jobs[aIndex];
+		fill_job_( model, attribs, chunks[job.faces.chunk], job );
+	} );
+
+#	if CW1_VALIDATE_OBJ_LOADER
+	validate_obj_model_( model, aOBJPath );
+#	endif // ~ CW1_VALIDATE_OBJ_LOADER
+
+	return model;
+}
+
+// Streaming OBJ parser
+//
+// Reuses the tokenizer of the parallel parser: each window is split into
+// chunks, which are tokenized in parallel and then consumed in file order.
+// The chunks' attributes are appended to the global pools before their faces
+// are processed, so the usual chunk-relative fix-up applies.
+namespace
+{
+	struct ObjStreamSlot_
+	{
+		std::int64_t v, vt, vn;
+		std::uint32_t index;
+		std::uint32_t generation; // empty unless equal to the current generation
+	};
+
+	std::uint64_t hash_ref_( ObjVertexRef_ const& aRef ) noexcept
+	{
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		for( auto const w : { aRef.v, aRef.vt, aRef.vn } )
+		{
+			h ^= std::uint64_t(w);
+			h *= 0x100000001b3ull;
+			h ^= h >> 29;
+		}
+
+		return h;
+	}
+
+	class ObjStreamer_
+	{
+		public:
+			using Callback = std::function<void(ObjMeshRange const&)>;
+
+			ObjStreamer_( std::string const& aDirectory, ObjStreamOptions const& aOptions, Callback const& aOnRange, std::string& aWarnings )
+				: mOptions( aOptions )
+				, mOnRange( aOnRange )
+				, mLibrary( aDirectory )
+				, mWarnings( aWarnings )
+			{
+				mSlots.resize( 1024 );
+			}
+
+			void consume( ObjChunk_& aChunk )
+			{
+				aChunk.positionBase = mPositions.size() / 3;
+				aChunk.normalBase = mNormals.size() / 3;
+				aChunk.texcoordBase = mTexcoords.size() / 2;
+
+				mPositions.insert( mPositions.end(), aChunk.positions.begin(), aChunk.positions.end() );
+				mNormals.insert( mNormals.end(), aChunk.normals.begin(), aChunk.normals.end() );
+				mTexcoords.insert( mTexcoords.end(), aChunk.texcoords.begin(), aChunk.texcoords.end() );
+
+				std::size_t face = 0;
+				for( auto const& statement : aChunk.statements )
+				{
+					faces_( aChunk, face, statement.faceIndex );
+					face = statement.faceIndex;
+
+					switch( statement.kind )
+					{
+						case ObjStatementKind_::usemtl:
+							mMaterial = mLibrary.find( statement.argument );
+							break;
+						case ObjStatementKind_::mtllib:
+							mLibrary.load( statement.argument, mMaterials, mWarnings );
+							break;
+						case ObjStatementKind_::group: // fall-through
+						case ObjStatementKind_::object:
+							flush_();
+							mName = statement.argument;
+							break;
+					}
+				}
+
+				faces_( aChunk, face, aChunk.faceCorners.size()-1 );
+			}
+
+			std::vector<MaterialInfo> finish()
+			{
+				flush_();
+				return std::move(mMaterials);
+			}
+
+		private:
+			void faces_( ObjChunk_ const& aChunk, std::size_t aBegin, std::size_t aEnd )
+			{
+				auto const positionCount = mPositions.size() / 3;
+				auto const normalCount = mNormals.size() / 3;
+				auto const texcoordCount = mTexcoords.size() / 2;
+
+				for( auto face = aBegin; face < aEnd; ++face )
+				{
+					auto const* corners = aChunk.corners.data() + aChunk.faceCorners[face];
+					auto const count = aChunk.faceCorners[face+1] - aChunk.faceCorners[face];
+
+					if( count < 3 )
+						continue;
+
+					if( !mRangeIndices.empty() && mRangeMaterial != mMaterial )
+						flush_();
+
+					assert( mMaterial >= 0 );
+					mRangeMaterial = mMaterial;
+
+					auto const first = resolve_corner_( corners[0], aChunk, positionCount, normalCount, texcoordCount );
+					auto prev = resolve_corner_( corners[1], aChunk, positionCount, normalCount, texcoordCount );
+
+					// Polygon -> triangle fan, like tinyobjloader
+					for( std::size_t k = 2; k < count; ++k )
+					{
+						auto const cur = resolve_corner_( corners[k], aChunk, positionCount, normalCount, texcoordCount );
+
+						if( range_full_() )
+							flush_();
+
+						mRangeIndices.emplace_back( find_or_insert_( first ) );
+						mRangeIndices.emplace_back( find_or_insert_( prev ) );
+						mRangeIndices.emplace_back( find_or_insert_( cur ) );
+
+						prev = cur;
+					}
+				}
+			}
+
+			bool range_full_() const noexcept
+			{
+				// A triangle adds up to three vertices
+				if( mOptions.maxRangeVertices && mRangePositions.size() + 3 > mOptions.maxRangeVertices )
+					return true;
+				if( mOptions.maxRangeTriangles && mRangeIndices.size()/3 + 1 > mOptions.maxRangeTriangles )
+					return true;
+
+				return false;
+			}
+
+			std::uint32_t find_or_insert_( ObjVertexRef_ const& aRef )
+			{
+				// Keep the load factor below 1/2
+				if( (mRangePositions.size()+1) * 2 > mSlots.size() )
+					grow_();
+
+				auto const mask = mSlots.size()-1;
+				for( auto slot = std::size_t(hash_ref_( aRef )) & mask;; slot = (slot+1) & mask )
+				{
+					auto& entry = mSlots[slot];
+					if( mGeneration != entry.generation )
+					{
+						auto const index = std::uint32_t(mRangePositions.size());
+						entry = ObjStreamSlot_{ aRef.v, aRef.vt, aRef.vn, index, mGeneration };
+						append_vertex_( aRef );
+						return index;
+					}
+
+					if( entry.v == aRef.v && entry.vt == aRef.vt && entry.vn == aRef.vn )
+						return entry.index;
+				}
+			}
+
+			void grow_()
+			{
+				std::vector<ObjStreamSlot_> slots( mSlots.size() * 2 );
+				auto const mask = slots.size()-1;
+
+				for( auto const& entry : mSlots )
+				{
+					if( mGeneration != entry.generation )
+						continue;
+
+					auto slot = std::size_t(hash_ref_( ObjVertexRef_{ entry.v, entry.vt, entry.vn } )) & mask;
+					while( mGeneration == slots[slot].generation )
+						slot = (slot+1) & mask;
+
+					slots[slot] = entry;
+				}
+
+				mSlots = std::move(slots);
+			}
+
+			void append_vertex_( ObjVertexRef_ const& aRef )
+			{
+				mRangePositions.emplace_back( glm::vec3(
+					mPositions[ aRef.v * 3 + 0 ],
+					mPositions[ aRef.v * 3 + 1 ],
+					mPositions[ aRef.v * 3 + 2 ]
+				) );
+
+				if( aRef.vn >= 0 )
+				{
+					mRangeNormals.emplace_back( glm::vec3(
+						mNormals[ aRef.vn * 3 + 0 ],
+						mNormals[ aRef.vn * 3 + 1 ],
+						mNormals[ aRef.vn * 3 + 2 ]
+					) );
+				}
+				else
+				{
+					mRangeNormals.emplace_back( glm::vec3( 0.f, 0.f, 0.f ) );
+				}
+
+				if( aRef.vt >= 0 )
+				{
+					mRangeTexcoords.emplace_back( glm::vec2(
+						mTexcoords[ aRef.vt * 2 + 0 ],
+						mTexcoords[ aRef.vt * 2 + 1 ]
+					) );
+				}
+				else
+				{
+					mRangeTexcoords.emplace_back( glm::vec2( 0.f, 0.f ) );
+				}
+			}
+
+			void flush_()
+			{
+				if( !mRangeIndices.empty() )
+				{
+					std::string const meshName = mName + "::" + mMaterials[mRangeMaterial].materialName;
+
+					mOnRange( ObjMeshRange{
+						meshName,
+						std::uint32_t(mRangeMaterial),
+						mMaterials,
+						mRangePositions,
+						mRangeNormals,
+						mRangeTexcoords,
+						mRangeIndices
+					} );
+				}
+
+				// Keep the capacity; the next range likely needs a similar
+				// amount.
+				mRangePositions.clear();
+				mRangeNormals.clear();
+				mRangeTexcoords.clear();
+				mRangeIndices.clear();
+
+				// Invalidates all slots
+				if( 0 == ++mGeneration )
+				{
+					std::fill( mSlots.begin(), mSlots.end(), ObjStreamSlot_{} );
+					mGeneration = 1;
+				}
+			}
+
+		private:
+			ObjStreamOptions mOptions;
+			Callback const& mOnRange;
+
+			ObjMaterialLibrary_ mLibrary;
+			std::vector<MaterialInfo> mMaterials;
+			std::string& mWarnings;
+
+			int mMaterial = -1;
+			std::string mName;
+
+			std::vector<float> mPositions, mNormals, mTexcoords;
+
+			int mRangeMaterial = -1;
+			std::vector<glm::vec3> mRangePositions, mRangeNormals;
+			std::vector<glm::vec2> mRangeTexcoords;
+			std::vector<std::uint32_t> mRangeIndices;
+
+			std::vector<ObjStreamSlot_> mSlots;
+			std::uint32_t mGeneration = 1;
+	};
+
+	// Splits aOBJPath into a directory (with trailing separator) and a file
+	// name, like load_obj_model().
+	std::pair<std::string,std::string> decode_path_( std::string_view const& aOBJPath )
+	{
+		if( auto const separator = aOBJPath.find_last_of( "/\\" ); std::string_view::npos != separator )
+			return { std::string(aOBJPath.substr( 0, separator+1 )), std::string(aOBJPath.substr( separator+1 )) };
+
+		return { "./", std::string(aOBJPath) };
+	}
+}
+
+// stream_obj_model()
+std::vector<MaterialInfo> stream_obj_model( std::string_view const& aOBJPath, ObjStreamOptions const& aOptions, std::function<void(ObjMeshRange const&)> const& aOnRange, lut::ThreadPool* aPool )
+{
+	auto const [directory, fileName] = decode_path_( aOBJPath );
+	std::string const normalizedPath = directory + fileName;
+
+	std::optional<lut::ThreadPool> localPool;
+	if( !aPool )
+		aPool = &localPool.emplace();
+
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> file( std::fopen( normalizedPath.c_str(), "rb" ), &std::fclose );
+	if( !file )
+		throw lut::Error( "Unable to load OBJ '%s':\nunable to open file", normalizedPath.c_str() );
+
+	std::string warnings;
+	ObjStreamer_ streamer( directory, aOptions, aOnRange, warnings );
+
+	std::vector<char> window( std::max<std::size_t>( aOptions.windowBytes, 4096 ) );
+	std::size_t filled = 0;
+
+	for( bool eof = false; !eof; )
+	{
+		filled += std::fread( window.data() + filled, 1, window.size() - filled, file.get() );
+		eof = filled < window.size();
+
+		if( std::ferror( file.get() ) )
+			throw lut::Error( "Unable to load OBJ '%s':\nread error", normalizedPath.c_str() );
+
+		// Only complete lines are parsed; the rest moves to the start of the
+		// next window.
+		std::size_t complete = filled;
+		if( !eof )
+		{
+			while( complete > 0 && '\n' != window[complete-1] && '\r' != window[complete-1] )
+				--complete;
+
+			if( 0 == complete )
+			{
+				// A single line fills the whole window
+				window.resize( window.size() * 2 );
+				continue;
+			}
+		}
+
+		auto chunks = split_chunks_( window.data(), window.data() + complete );
+
+		aPool->parallel_for( chunks.size(), [&] ( std::size_t aIndex ) {
+			parse_chunk_( chunks[aIndex] );
+		} );
+
+		for( auto& chunk : chunks )
+			streamer.consume( chunk );
+
+		chunks.clear();
+
+		std::memmove( window.data(), window.data() + complete, filled - complete );
+		filled -= complete;
+	}
+
+	auto materials = streamer.finish();
+
+	if( !warnings.empty() )
+		std::printf( "%s\n", warnings.c_str() );
+
+	return materials;
+}
+
+// load_obj_model_streaming()
+ModelData load_obj_model_streaming( std::string_view const& aOBJPath, ObjStreamOptions const& aOptions, lut::ThreadPool* aPool )
+{
+	auto const [directory, fileName] = decode_path_( aOBJPath );
+
+	ModelData model;
+	model.modelName        = aOBJPath;
+	model.modelSourcePath  = directory + fileName;
+
+	std::printf( "Loading: '%s' (streaming) ...", model.modelSourcePath.c_str() );
+	std::fflush( stdout );
+
+	model.materials = stream_obj_model( aOBJPath, aOptions, [&] ( ObjMeshRange const& aRange ) {
+		MeshInfo mesh{};
+		mesh.meshName          = aRange.meshName;
+		mesh.materialIndex     = aRange.materialIndex;
+		mesh.vertexStartIndex  = model.vertexPositions.size();
+		mesh.numberOfVertices  = aRange.positions.size();
+		mesh.indexStartIndex   = model.indices.size();
+		mesh.numberOfIndices   = aRange.indices.size();
+
+		model.vertexPositions.insert( model.vertexPositions.end(), aRange.positions.begin(), aRange.positions.end() );
+		model.vertexNormals.insert( model.vertexNormals.end(), aRange.normals.begin(), aRange.normals.end() );
+		model.vertexTextureCoords.insert( model.vertexTextureCoords.end(), aRange.texcoords.begin(), aRange.texcoords.end() );
+		model.indices.insert( model.indices.end(), aRange.indices.begin(), aRange.indices.end() );
+
+		model.meshes.emplace_back( std::move(mesh) );
+	}, aPool );
+
+	std::printf( " OK\n" );
+
+	return model;
+}
+
+// load_obj_model_tinyobj()
+ModelData load_obj_model_tinyobj( std::string_view const& aOBJPath )
 {
 	// "Decode" path
 	std::string fileName, directory;
@@ -215,6 +1551,8 @@ ModelData load_obj_model( std::string_view const& aOBJPath )
 
 			model.meshes.emplace_back( mesh );
 		}
+
+		currentIndex += indices;
 	}
 
 	assert( model.vertexPositions.size() == totalVertices );
@@ -6,8 +6,10 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 #include <string_view>
 
+#include <cstddef>
 #include <cstdint>
 
 #include <glm/glm.hpp>
@@ -50,6 +52,33 @@ struct MeshInfo
 	// ModelData.
 	std::size_t vertexStartIndex;
 	std::size_t numberOfVertices;
+
+	// Indexed meshes (see weld_vertices()) additionally use numberOfIndices
+	// entries of ModelData::indices, starting at indexStartIndex. Both are
+	// zero for a triangle soup.
+	std::size_t indexStartIndex;
+	std::size_t numberOfIndices;
+
+	// Meshes merged by batch_meshes_by_material() remember the original
+	// meshes as numberOfSubMeshes entries of ModelData::subMeshes, starting
+	// at subMeshStartIndex. Both are zero for meshes that were not batched.
+	std::size_t subMeshStartIndex;
+	std::size_t numberOfSubMeshes;
+};
+
+struct SubMeshInfo
+{
+	// Name of the original mesh
+	std::string meshName;
+
+	// Range in ModelData::indices. The indices are relative to the owning
+	// (batched) mesh's vertexStartIndex.
+	std::size_t indexStartIndex;
+	std::size_t numberOfIndices;
+
+	// Object-space bounds, e.g. for culling
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
 };
 
 
@@ -69,10 +98,96 @@ struct ModelData
 
 	std::vector<MaterialInfo> materials;
 	std::vector<MeshInfo> meshes;
+	std::vector<SubMeshInfo> subMeshes;
 
 	std::vector<glm::vec3> vertexPositions;
 	std::vector<glm::vec3> vertexNormals;
 	std::vector<glm::vec2> vertexTextureCoords;
+
+	// Indices are relative to the owning mesh's vertexStartIndex, so that
+	// meshes with few vertices can be drawn with 16-bit indices. Empty if
+	// the model is a triangle soup.
+	std::vector<std::uint32_t> indices;
+};
+
+namespace labutils
+{
+	class ThreadPool;
+}
+
+/* load_obj_model() parses the OBJ in parallel. The file is mapped and split
+ * into line-aligned chunks, which are tokenized on the worker threads of
+ * aPool (a temporary pool is created if aPool is null). The per-chunk results
+ * are then stitched together in file order, and the triangle soup is filled
+ * in parallel. MTL files are small and are read with tinyobjloader.
+ *
+ * The result is identical to load_obj_model_tinyobj(), which is the previous,
+ * single-threaded loader based on tinyobj::LoadObj(). It is kept as a
+ * reference; define CW1_VALIDATE_OBJ_LOADER=1 to have load_obj_model() compare
+ * its output against it on every load.
+ */
+ModelData load_obj_model( std::string_view const& aOBJPath, labutils::ThreadPool* aPool = nullptr );
+ModelData load_obj_model_tinyobj( std::string_view const& aOBJPath );
+
+
+/* Streaming OBJ ingestion for scenes that do not comfortably fit into memory.
+ *
+ * load_obj_model() needs the whole file (mapped), its tokenized form and the
+ * fully expanded triangle soup at the same time; welding then makes another
+ * copy. stream_obj_model() instead reads the file in windows of
+ * ObjStreamOptions::windowBytes (each window is tokenized in parallel, like
+ * the chunks of load_obj_model()), and welds each mesh as its faces arrive,
+ * using the (v,vt,vn) index triples as keys. Finished mesh ranges are handed
+ * to a callback and then dropped, so the working set is:
+ *
+ *  - the current window and its tokens,
+ *  - the current mesh range (at most maxRangeVertices vertices and
+ *    maxRangeTriangles triangles) and its weld table, and
+ *  - the v/vt/vn pools. OBJ indices are global, so any face may refer to any
+ *    earlier attribute; these are unavoidable, but are the compact, shared
+ *    form of the data.
+ *
+ * Meshes are split like in load_obj_model() (on group/object and material
+ * changes), except that ranges that reach the limits are closed early and
+ * the next range continues the same mesh (same name and material). Capping
+ * ranges at 64k vertices also means that every range can use 16-bit indices.
+ * Two quirks of tinyobj::LoadObj() are not reproduced: faces that refer to
+ * vertices defined later in the file are rejected, and faces of a group
+ * whose last material section is empty are kept rather than dropped.
+ *
+ * load_obj_model_streaming() collects the ranges into an indexed ModelData
+ * (see weld_vertices()); other callers can, for example, copy them straight
+ * into upload staging memory.
+ */
+struct ObjStreamOptions
+{
+	// Bytes read (and tokenized) at once. A window grows if a single line does
+	// not fit.
+	std::size_t windowBytes = std::size_t(4) << 20;
+
+	// Mesh ranges are closed when they reach this many vertices or
+	// triangles. Zero means unlimited.
+	std::size_t maxRangeVertices = std::size_t(1) << 16;
+	std::size_t maxRangeTriangles = std::size_t(1) << 17;
 };
 
-ModelData load_obj_model( std::string_view const& aOBJPath );
+struct ObjMeshRange
+{
+	std::string const& meshName;
+	std::uint32_t materialIndex;
+
+	// Materials loaded so far; materialIndex refers to this
+	std::vector<MaterialInfo> const& materials;
+
+	// Welded vertices. Indices are relative to the first vertex of the range.
+	std::vector<glm::vec3> const& positions;
+	std::vector<glm::vec3> const& normals;
+	std::vector<glm::vec2> const& texcoords;
+	std::vector<std::uint32_t> const& indices;
+};
+
+// Streams the OBJ at aOBJPath, calling aOnRange for each finished mesh range
+// in file order. Returns all materials.
+std::vector<MaterialInfo> stream_obj_model( std::string_view const& aOBJPath, ObjStreamOptions const& aOptions, std::function<void(ObjMeshRange const&)> const& aOnRange, labutils::ThreadPool* aPool = nullptr );
+
+ModelData load_obj_model_streaming( std::string_view const& aOBJPath, ObjStreamOptions const& aOptions = {}, labutils::ThreadPool* aPool = nullptr );
@@ -0,0 +1,657 @@
+#include "model_cache.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <optional>
+#include <exception>
+#include <filesystem>
+#include <type_traits>
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <cstdint>
+
+#include "vertex_weld.hpp"
+
+#include "../labutils/error.hpp"
+#include "../labutils/mapped_file.hpp"
+#include "../labutils/process_memory.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// Bump kCacheVersion whenever the layout below or the contents of
+	// ModelData change. Old caches are then rebuilt automatically.
+	constexpr char kCacheMagic[8] = { 'C', 'W', '1', 'M', 'E', 'S', 'H', '\0' };
+	constexpr std::uint32_t kCacheVersion = 5;
+
+	constexpr char const* kCacheSuffix = ".meshcache";
+
+	// Attribute blobs start on cache line boundaries.
+	constexpr std::uint64_t kBlobAlignment = 64;
+
+	// Marks a source file that did not exist when the cache was written.
+	constexpr std::uint64_t kMissingSource = ~std::uint64_t(0);
+
+	// Post-processing applied to the cached model
+	constexpr std::uint32_t kProcessOptimizeMeshes = 1u << 0;
+	constexpr std::uint32_t kProcessBatchByMaterial = 1u << 1;
+	constexpr std::uint32_t kProcessStreamObj = 1u << 2;
+
+	struct CacheHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t headerBytes;
+		std::uint64_t fileBytes;
+
+		double parseMilliseconds;
+		std::uint64_t parsePeakBytes;
+
+		std::uint32_t processingFlags;
+		std::uint32_t padding;
+
+		// VertexCacheStats before/after optimize_meshes(): triangles,
+		// vertices, misses
+		std::uint64_t cacheStatsBefore[3];
+		std::uint64_t cacheStatsAfter[3];
+
+		std::uint64_t sourceCount, sourcesOffset;
+		std::uint64_t materialCount, materialsOffset;
+		std::uint64_t meshCount, meshesOffset;
+		std::uint64_t subMeshCount, subMeshesOffset;
+
+		std::uint64_t vertexCount;
+		std::uint64_t positionsOffset;
+		std::uint64_t normalsOffset;
+		std::uint64_t texcoordsOffset;
+
+		std::uint64_t indexCount;
+		std::uint64_t indicesOffset;
+
+		std::uint64_t stringsOffset, stringsBytes;
+	};
+
+	// Strings are stored as (offset,length) pairs into the string table.
+	struct StringRef
+	{
+		std::uint64_t offset, length;
+	};
+
+	struct SourceRecord
+	{
+		StringRef path;
+		std::int64_t modifiedTime;
+		std::uint64_t bytes;
+		std::uint64_t hash;
+	};
+
+	struct MaterialRecord
+	{
+		StringRef name;
+		StringRef colorTexturePath;
+		float color[3];
+		std::uint32_t padding;
+	};
+
+	struct MeshRecord
+	{
+		StringRef name;
+		std::uint32_t materialIndex;
+		std::uint32_t padding;
+		std::uint64_t vertexStartIndex;
+		std::uint64_t numberOfVertices;
+		std::uint64_t indexStartIndex;
+		std::uint64_t numberOfIndices;
+		std::uint64_t subMeshStartIndex;
+		std::uint64_t numberOfSubMeshes;
+	};
+
+	struct SubMeshRecord
+	{
+		StringRef name;
+		std::uint64_t indexStartIndex;
+		std::uint64_t numberOfIndices;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	static_assert( std::is_trivially_copyable_v<CacheHeader> );
+	static_assert( sizeof(glm::vec3) == 3*sizeof(float) && sizeof(glm::vec2) == 2*sizeof(float) );
+
+	struct SourceFile
+	{
+		std::string path;
+		SourceRecord record;
+	};
+
+	std::uint32_t processing_flags_( ModelLoadOptions const& aOptions )
+	{
+		std::uint32_t flags = 0;
+		if( aOptions.optimizeMeshes )
+			flags |= kProcessOptimizeMeshes;
+		if( aOptions.batchByMaterial )
+			flags |= kProcessBatchByMaterial;
+		if( aOptions.streamObj )
+			flags |= kProcessStreamObj;
+
+		return flags;
+	}
+
+	void store_stats_( std::uint64_t (&aOut)[3], VertexCacheStats const& aStats )
+	{
+		aOut[0] = aStats.triangles;
+		aOut[1] = aStats.vertices;
+		aOut[2] = aStats.misses;
+	}
+	VertexCacheStats load_stats_( std::uint64_t const (&aIn)[3] )
+	{
+		VertexCacheStats ret{};
+		ret.triangles = std::size_t(aIn[0]);
+		ret.vertices = std::size_t(aIn[1]);
+		ret.misses = std::size_t(aIn[2]);
+		return ret;
+	}
+
+	std::string normalize_path_( std::string_view const& aPath )
+	{
+		// Mirrors the path handling in load_obj_model()
+		if( auto const separator = aPath.find_last_of( "/\\" ); std::string_view::npos != separator )
+			return std::string(aPath);
+
+		return "./" + std::string(aPath);
+	}
+
+	std::string directory_of_( std::string const& aPath )
+	{
+		auto const separator = aPath.find_last_of( "/\\" );
+		assert( std::string::npos != separator );
+		return aPath.substr( 0, separator+1 );
+	}
+
+	// Describe a source file. The content hash is only computed if
+	// aWithHash is set, since that requires reading the whole file.
+	SourceRecord describe_source_( std::string const& aPath, bool aWithHash )
+	{
+		namespace fs = std::filesystem;
+
+		SourceRecord ret{};
+
+		std::error_code ec;
+		auto const bytes = fs::file_size( aPath, ec );
+		if( ec )
+		{
+			ret.bytes = kMissingSource;
+			return ret;
+		}
+
+		ret.bytes = bytes;
+
+		if( auto const mtime = fs::last_write_time( aPath, ec ); !ec )
+			ret.modifiedTime = std::int64_t(mtime.time_since_epoch().count());
+
+		if( aWithHash )
+		{
+			auto const file = lut::map_file( aPath.c_str() );
+			ret.hash = lut::hash_bytes( file.data, file.size );
+		}
+
+		return ret;
+	}
+
+	// Find the MTL files referenced by an OBJ via "mtllib" statements.
+	std::vector<std::string> find_material_libraries_( lut::MappedFile const& aObj, std::string const& aDirectory )
+	{
+		std::vector<std::string> ret;
+
+		auto const* beg = reinterpret_cast<char const*>(aObj.data);
+		auto const* end = beg + aObj.size;
+
+		constexpr std::string_view kKeyword = "mtllib";
+
+		for( auto const* line = beg; line < end; )
+		{
+			auto const* eol = static_cast<char const*>(std::memchr( line, '\n', std::size_t(end-line) ));
+			if( !eol ) eol = end;
+
+			auto const* ptr = line;
+			while( ptr < eol && (' ' == *ptr || '\t' == *ptr) )
+				++ptr;
+
+			if( std::size_t(eol-ptr) > kKeyword.size() && 0 == std::memcmp( ptr, kKeyword.data(), kKeyword.size() ) )
+			{
+				ptr += kKeyword.size();
+				while( ptr < eol )
+				{
+					while( ptr < eol && (' ' == *ptr || '\t' == *ptr || '\r' == *ptr) )
+						++ptr;
+
+					auto const* tok = ptr;
+					while( ptr < eol && ' ' != *ptr && '\t' != *ptr && '\r' != *ptr )
+						++ptr;
+
+					if( ptr != tok )
+						ret.emplace_back( aDirectory + std::string( tok, ptr ) );
+				}
+			}
+
+			line = eol+1;
+		}
+
+		return ret;
+	}
+
+	std::vector<SourceFile> collect_sources_( std::string const& aObjPath )
+	{
+		std::vector<SourceFile> ret;
+
+		auto const obj = lut::map_file( aObjPath.c_str() );
+
+		SourceFile objSource;
+		objSource.path = aObjPath;
+		objSource.record = describe_source_( aObjPath, false );
+		objSource.record.hash = lut::hash_bytes( obj.data, obj.size );
+		ret.emplace_back( std::move(objSource) );
+
+		for( auto& mtl : find_material_libraries_( obj, directory_of_( aObjPath ) ) )
+		{
+			SourceFile source;
+			source.record = describe_source_( mtl, true );
+			source.path = std::move(mtl);
+			ret.emplace_back( std::move(source) );
+		}
+
+		return ret;
+	}
+
+	// Reading
+	template< typename tType >
+	tType const* section_( lut::MappedFile const& aFile, std::uint64_t aOffset, std::uint64_t aCount )
+	{
+		if( aOffset > aFile.size || aCount > (aFile.size - aOffset) / sizeof(tType) )
+			throw lut::Error( "section out of bounds" );
+
+		return reinterpret_cast<tType const*>(aFile.data + aOffset);
+	}
+
+	std::string string_( lut::MappedFile const& aFile, CacheHeader const& aHeader, StringRef const& aRef )
+	{
+		if( aRef.offset > aHeader.stringsBytes || aRef.length > aHeader.stringsBytes - aRef.offset )
+			throw lut::Error( "string out of bounds" );
+
+		auto const* base = section_<char>( aFile, aHeader.stringsOffset, aHeader.stringsBytes );
+		return std::string( base + aRef.offset, base + aRef.offset + aRef.length );
+	}
+
+	bool source_unchanged_( std::string const& aPath, SourceRecord const& aRecord )
+	{
+		auto const current = describe_source_( aPath, false );
+
+		if( current.bytes != aRecord.bytes )
+			return false;
+
+		if( kMissingSource == current.bytes )
+			return true; // still missing
+
+		if( current.modifiedTime == aRecord.modifiedTime )
+			return true;
+
+		// Timestamp changed (e.g., fresh checkout). The contents might still
+		// be the same.
+		auto const file = lut::map_file( aPath.c_str() );
+		return lut::hash_bytes( file.data, file.size ) == aRecord.hash;
+	}
+
+	std::optional<ModelData> read_cache_( std::string const& aCachePath, std::string const& aObjPath, std::uint32_t aProcessingFlags, ModelCacheInfo& aInfo )
+	{
+		std::error_code ec;
+		if( !std::filesystem::exists( aCachePath, ec ) )
+			return {};
+
+		auto const file = lut::map_file( aCachePath.c_str() );
+
+		auto const& header = *section_<CacheHeader>( file, 0, 1 );
+		if( 0 != std::memcmp( header.magic, kCacheMagic, sizeof(kCacheMagic) ) )
+			throw lut::Error( "bad magic" );
+		if( kCacheVersion != header.version || sizeof(CacheHeader) != header.headerBytes )
+			return {}; // outdated, silently rebuild
+		if( header.fileBytes != file.size )
+			throw lut::Error( "truncated" );
+		if( header.processingFlags != aProcessingFlags )
+			return {}; // different options, rebuild
+
+		// Validate sources
+		auto const* sources = section_<SourceRecord>( file, header.sourcesOffset, header.sourceCount );
+		if( 0 == header.sourceCount || string_( file, header, sources[0].path ) != aObjPath )
+			return {};
+
+		for( std::uint64_t i = 0; i < header.sourceCount; ++i )
+		{
+			if( !source_unchanged_( string_( file, header, sources[i].path ), sources[i] ) )
+				return {};
+		}
+
+		// Copy data
+		ModelData model;
+		model.modelSourcePath = aObjPath;
+
+		auto const* materials = section_<MaterialRecord>( file, header.materialsOffset, header.materialCount );
+		model.materials.reserve( header.materialCount );
+		for( std::uint64_t i = 0; i < header.materialCount; ++i )
+		{
+			MaterialInfo info{};
+			info.materialName      = string_( file, header, materials[i].name );
+			info.color             = glm::vec3( materials[i].color[0], materials[i].color[1], materials[i].color[2] );
+			info.colorTexturePath  = string_( file, header, materials[i].colorTexturePath );
+			model.materials.emplace_back( std::move(info) );
+		}
+
+		auto const* meshes = section_<MeshRecord>( file, header.meshesOffset, header.meshCount );
+		model.meshes.reserve( header.meshCount );
+		for( std::uint64_t i = 0; i < header.meshCount; ++i )
+		{
+			if( meshes[i].materialIndex >= header.materialCount ||
+				meshes[i].vertexStartIndex + meshes[i].numberOfVertices > header.vertexCount ||
+				meshes[i].indexStartIndex + meshes[i].numberOfIndices > header.indexCount ||
+				meshes[i].subMeshStartIndex + meshes[i].numberOfSubMeshes > header.subMeshCount )
+				throw lut::Error( "mesh %llu out of bounds", (unsigned long long)i );
+
+			MeshInfo info{};
+			info.meshName          = string_( file, header, meshes[i].name );
+			info.materialIndex     = meshes[i].materialIndex;
+			info.vertexStartIndex  = std::size_t(meshes[i].vertexStartIndex);
+			info.numberOfVertices  = std::size_t(meshes[i].numberOfVertices);
+			info.indexStartIndex   = std::size_t(meshes[i].indexStartIndex);
+			info.numberOfIndices   = std::size_t(meshes[i].numberOfIndices);
+			info.subMeshStartIndex = std::size_t(meshes[i].subMeshStartIndex);
+			info.numberOfSubMeshes = std::size_t(meshes[i].numberOfSubMeshes);
+			model.meshes.emplace_back( std::move(info) );
+		}
+
+		auto const* subMeshes = section_<SubMeshRecord>( file, header.subMeshesOffset, header.subMeshCount );
+		model.subMeshes.reserve( header.subMeshCount );
+		for( std::uint64_t i = 0; i < header.subMeshCount; ++i )
+		{
+			if( subMeshes[i].indexStartIndex + subMeshes[i].numberOfIndices > header.indexCount )
+				throw lut::Error( "sub-mesh %llu out of bounds", (unsigned long long)i );
+
+			SubMeshInfo info{};
+			info.meshName          = string_( file, header, subMeshes[i].name );
+			info.indexStartIndex   = std::size_t(subMeshes[i].indexStartIndex);
+			info.numberOfIndices   = std::size_t(subMeshes[i].numberOfIndices);
+			info.boundsMin         = glm::vec3( subMeshes[i].boundsMin[0], subMeshes[i].boundsMin[1], subMeshes[i].boundsMin[2] );
+			info.boundsMax         = glm::vec3( subMeshes[i].boundsMax[0], subMeshes[i].boundsMax[1], subMeshes[i].boundsMax[2] );
+			model.subMeshes.emplace_back( std::move(info) );
+		}
+
+		auto const vertexCount = std::size_t(header.vertexCount);
+		auto const* positions = section_<glm::vec3>( file, header.positionsOffset, vertexCount );
+		auto const* normals = section_<glm::vec3>( file, header.normalsOffset, vertexCount );
+		auto const* texcoords = section_<glm::vec2>( file, header.texcoordsOffset, vertexCount );
+
+		model.vertexPositions.assign( positions, positions + vertexCount );
+		model.vertexNormals.assign( normals, normals + vertexCount );
+		model.vertexTextureCoords.assign( texcoords, texcoords + vertexCount );
+
+		auto const indexCount = std::size_t(header.indexCount);
+		auto const* indices = section_<std::uint32_t>( file, header.indicesOffset, indexCount );
+		model.indices.assign( indices, indices + indexCount );
+
+		aInfo.parseMilliseconds = header.parseMilliseconds;
+		aInfo.parsePeakBytes = std::size_t(header.parsePeakBytes);
+		aInfo.streamedParse = 0 != (header.processingFlags & kProcessStreamObj);
+		aInfo.meshesOptimized = 0 != (header.processingFlags & kProcessOptimizeMeshes);
+		aInfo.optimizeStats.before = load_stats_( header.cacheStatsBefore );
+		aInfo.optimizeStats.after = load_stats_( header.cacheStatsAfter );
+		return model;
+	}
+
+	// Writing
+	class CacheWriter
+	{
+		public:
+			template< typename tType >
+			std::uint64_t blob( tType const* aData, std::size_t aCount )
+			{
+				align_( kBlobAlignment );
+				auto const offset = std::uint64_t(mBytes.size());
+				auto const* bytes = reinterpret_cast<char const*>(aData);
+				mBytes.insert( mBytes.end(), bytes, bytes + aCount*sizeof(tType) );
+				return offset;
+			}
+
+			StringRef string( std::string const& aString )
+			{
+				StringRef ret{ std::uint64_t(mStrings.size()), std::uint64_t(aString.size()) };
+				mStrings.insert( mStrings.end(), aString.begin(), aString.end() );
+				return ret;
+			}
+
+			void finish( CacheHeader& aHeader )
+			{
+				aHeader.stringsOffset = blob( mStrings.data(), mStrings.size() );
+				aHeader.stringsBytes = mStrings.size();
+				aHeader.fileBytes = mBytes.size();
+
+				std::memcpy( mBytes.data(), &aHeader, sizeof(CacheHeader) );
+			}
+
+			std::vector<char> const& bytes() const noexcept
+			{
+				return mBytes;
+			}
+
+		private:
+			void align_( std::uint64_t aAlignment )
+			{
+				mBytes.resize( (mBytes.size() + aAlignment-1) / aAlignment * aAlignment );
+			}
+
+			std::vector<char> mBytes = std::vector<char>( sizeof(CacheHeader) );
+			std::vector<char> mStrings;
+	};
+
+	void write_cache_( std::string const& aCachePath, ModelData const& aModel, std::vector<SourceFile> const& aSources, std::uint32_t aProcessingFlags, ModelCacheInfo const& aInfo )
+	{
+		CacheWriter writer;
+
+		CacheHeader header{};
+		std::memcpy( header.magic, kCacheMagic, sizeof(kCacheMagic) );
+		header.version = kCacheVersion;
+		header.headerBytes = sizeof(CacheHeader);
+		header.parseMilliseconds = aInfo.parseMilliseconds;
+		header.parsePeakBytes = aInfo.parsePeakBytes;
+		header.processingFlags = aProcessingFlags;
+		store_stats_( header.cacheStatsBefore, aInfo.optimizeStats.before );
+		store_stats_( header.cacheStatsAfter, aInfo.optimizeStats.after );
+
+		std::vector<SourceRecord> sources;
+		for( auto const& source : aSources )
+		{
+			auto& record = sources.emplace_back( source.record );
+			record.path = writer.string( source.path );
+		}
+
+		std::vector<MaterialRecord> materials;
+		for( auto const& mat : aModel.materials )
+		{
+			auto& record = materials.emplace_back();
+			record.name = writer.string( mat.materialName );
+			record.colorTexturePath = writer.string( mat.colorTexturePath );
+			record.color[0] = mat.color.x;
+			record.color[1] = mat.color.y;
+			record.color[2] = mat.color.z;
+		}
+
+		std::vector<MeshRecord> meshes;
+		for( auto const& mesh : aModel.meshes )
+		{
+			auto& record = meshes.emplace_back();
+			record.name = writer.string( mesh.meshName );
+			record.materialIndex = mesh.materialIndex;
+			record.vertexStartIndex = mesh.vertexStartIndex;
+			record.numberOfVertices = mesh.numberOfVertices;
+			record.indexStartIndex = mesh.indexStartIndex;
+			record.numberOfIndices = mesh.numberOfIndices;
+			record.subMeshStartIndex = mesh.subMeshStartIndex;
+			record.numberOfSubMeshes = mesh.numberOfSubMeshes;
+		}
+
+		std::vector<SubMeshRecord> subMeshes;
+		for( auto const& sub : aModel.subMeshes )
+		{
+			auto& record = subMeshes.emplace_back();
+			record.name = writer.string( sub.meshName );
+			record.indexStartIndex = sub.indexStartIndex;
+			record.numberOfIndices = sub.numberOfIndices;
+			for( int i = 0; i < 3; ++i )
+			{
+				record.boundsMin[i] = sub.boundsMin[i];
+				record.boundsMax[i] = sub.boundsMax[i];
+			}
+		}
+
+		header.sourceCount = sources.size();
+		header.sourcesOffset = writer.blob( sources.data(), sources.size() );
+		header.materialCount = materials.size();
+		header.materialsOffset = writer.blob( materials.data(), materials.size() );
+		header.meshCount = meshes.size();
+		header.meshesOffset = writer.blob( meshes.data(), meshes.size() );
+		header.subMeshCount = subMeshes.size();
+		header.subMeshesOffset = writer.blob( subMeshes.data(), subMeshes.size() );
+
+		header.vertexCount = aModel.vertexPositions.size();
+		header.positionsOffset = writer.blob( aModel.vertexPositions.data(), aModel.vertexPositions.size() );
+		header.normalsOffset = writer.blob( aModel.vertexNormals.data(), aModel.vertexNormals.size() );
+		header.texcoordsOffset = writer.blob( aModel.vertexTextureCoords.data(), aModel.vertexTextureCoords.size() );
+
+		header.indexCount = aModel.indices.size();
+		header.indicesOffset = writer.blob( aModel.indices.data(), aModel.indices.size() );
+
+		writer.finish( header );
+
+		// Write to a temporary file first, such that a crash never leaves a
+		// partial cache file behind.
+		auto const tempPath = aCachePath + ".tmp";
+		{
+			std::ofstream ofs( tempPath, std::ios::binary | std::ios::trunc );
+			if( !ofs )
+				throw lut::Error( "unable to open '%s' for writing", tempPath.c_str() );
+
+			auto const& bytes = writer.bytes();
+			ofs.write( bytes.data(), std::streamsize(bytes.size()) );
+			if( !ofs )
+				throw lut::Error( "unable to write '%s'", tempPath.c_str() );
+		}
+
+		std::error_code ec;
+		std::filesystem::rename( tempPath, aCachePath, ec );
+		if( ec )
+		{
+			std::filesystem::remove( tempPath, ec );
+			throw lut::Error( "unable to rename '%s'", tempPath.c_str() );
+		}
+	}
+
+	// Parses and welds the OBJ with either loader, measuring the time that
+	// parsing takes and the peak memory use of both
+	ModelData parse_obj_( std::string_view const& aOBJPath, bool aStream, ObjStreamOptions const& aStreamOptions, double& aMilliseconds, std::size_t& aPeakBytes )
+	{
+		lut::ResidentPeakScope const parsePeak;
+
+		auto const parseStart = std::chrono::steady_clock::now();
+		ModelData model = aStream
+			? load_obj_model_streaming( aOBJPath, aStreamOptions )
+			: load_obj_model( aOBJPath );
+		aMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - parseStart ).count();
+
+		// The cache holds the model in the form that is uploaded to the GPU.
+		// The streaming loader already welds by OBJ index; this merges the
+		// remaining duplicates (identical values with different OBJ indices).
+		weld_vertices( model );
+
+		aPeakBytes = parsePeak.peak_increase();
+		return model;
+	}
+}
+
+ModelData load_obj_model_cached( std::string_view const& aOBJPath, ModelCacheInfo* aInfo, ModelLoadOptions const& aOptions )
+{
+	using Clock_ = std::chrono::steady_clock;
+	using Ms_ = std::chrono::duration<double, std::milli>;
+
+	auto const loadStart = Clock_::now();
+
+	auto const objPath = normalize_path_( aOBJPath );
+	auto const cachePath = objPath + kCacheSuffix;
+
+	auto const processingFlags = processing_flags_( aOptions );
+
+	ModelCacheInfo info{};
+
+	// Try the cache first
+	try
+	{
+		if( auto cached = read_cache_( cachePath, objPath, processingFlags, info ) )
+		{
+			cached->modelName = aOBJPath;
+
+			info.cacheHit = true;
+			info.loadMilliseconds = Ms_( Clock_::now() - loadStart ).count();
+
+			std::printf( "Loading: '%s' from cache ... OK (%.1f ms)\n", cachePath.c_str(), info.loadMilliseconds );
+
+			if( aInfo ) *aInfo = info;
+			return std::move(*cached);
+		}
+	}
+	catch( std::exception const& eErr )
+	{
+		std::fprintf( stderr, "Warning: ignoring mesh cache '%s': %s\n", cachePath.c_str(), eErr.what() );
+	}
+
+	// Cache miss. Describe the sources before parsing, such that changes that
+	// happen while we're parsing invalidate the cache on the next run.
+	auto const sources = collect_sources_( objPath );
+
+	ModelData model = parse_obj_( aOBJPath, aOptions.streamObj, aOptions.streamOptions, info.parseMilliseconds, info.parsePeakBytes );
+	info.streamedParse = aOptions.streamObj;
+
+	if( aOptions.optimizeMeshes )
+	{
+		info.meshesOptimized = true;
+		info.optimizeStats = optimize_meshes( model );
+	}
+
+	if( aOptions.batchByMaterial )
+		batch_meshes_by_material( model );
+
+	try
+	{
+		write_cache_( cachePath, model, sources, processingFlags, info );
+	}
+	catch( std::exception const& eErr )
+	{
+		std::fprintf( stderr, "Warning: unable to write mesh cache '%s': %s\n", cachePath.c_str(), eErr.what() );
+	}
+
+	info.loadMilliseconds = Ms_( Clock_::now() - loadStart ).count();
+
+	if( aInfo ) *aInfo = info;
+	return model;
+}
+
+ObjLoaderComparison compare_obj_loaders( std::string_view const& aOBJPath, ObjStreamOptions const& aStreamOptions )
+{
+	ObjLoaderComparison ret;
+	ret.exact = lut::ResidentPeakScope().exact();
+
+	// One at a time; each model is released before the next parse
+	parse_obj_( aOBJPath, false, aStreamOptions, ret.parallelMilliseconds, ret.parallelPeakBytes );
+	parse_obj_( aOBJPath, true, aStreamOptions, ret.streamingMilliseconds, ret.streamingPeakBytes );
+
+	return ret;
+}
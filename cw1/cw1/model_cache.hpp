@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string_view>
+
+#include <cstddef>
+
+#include "model.hpp"
+#include "mesh_batch.hpp"
+#include "mesh_optimize.hpp"
+
+/* Binary cache for ModelData.
+ *
+ * Parsing the OBJ files with tinyobjloader dominates the start-up time. The
+ * first call to load_obj_model_cached() parses the OBJ as usual and writes the
+ * result to "<path>.meshcache" next to the source. Later calls map the cache
+ * file and copy the vertex data straight out of the mapping.
+ *
+ * The cached model is post-processed: its vertices are welded and each mesh
+ * is indexed (see weld_vertices()). Optionally, the meshes are optimized for
+ * the vertex cache and overdraw (see optimize_meshes()) and merged into one
+ * mesh per material (see batch_meshes_by_material()). The options used are
+ * recorded in the cache; changing them causes the cache to be rebuilt.
+ *
+ * The OBJ is parsed either with load_obj_model() or, if
+ * ModelLoadOptions::streamObj is set, with the bounded-memory
+ * load_obj_model_streaming(). Both are measured for their peak memory use
+ * (see ModelCacheInfo::parsePeakBytes); compare_obj_loaders() runs both on
+ * the same OBJ, bypassing the cache.
+ *
+ * The cache records the path, modification time, size and content hash of the
+ * OBJ and of each MTL file referenced by it. If any of them changed, the cache
+ * is discarded and rebuilt. A cache that cannot be read or written is never
+ * fatal; the loader falls back to parsing the OBJ.
+ */
+
+struct ModelLoadOptions
+{
+	bool optimizeMeshes = true;
+	bool batchByMaterial = true;
+
+	bool streamObj = false;
+	ObjStreamOptions streamOptions{};
+};
+
+struct ModelCacheInfo
+{
+	bool cacheHit = false;
+
+	// Wall-clock time spent in load_obj_model_cached().
+	double loadMilliseconds = 0.0;
+
+	// Time that parsing the OBJ took. On a cache hit, this is the value that
+	// was recorded when the cache was written.
+	double parseMilliseconds = 0.0;
+
+	// Increase of the process' peak resident set size while parsing and
+	// welding. Like parseMilliseconds, recorded when the cache was written.
+	// On platforms where the peak cannot be reset (see
+	// labutils::reset_peak_resident_bytes()), this is a lower bound.
+	bool streamedParse = false;
+	std::size_t parsePeakBytes = 0;
+
+	// Vertex cache statistics before and after optimize_meshes(). Only
+	// valid if the meshes were optimized (again, recorded when the cache
+	// was written).
+	bool meshesOptimized = false;
+	MeshOptimizeStats optimizeStats;
+};
+
+ModelData load_obj_model_cached( std::string_view const& aOBJPath, ModelCacheInfo* aInfo = nullptr, ModelLoadOptions const& aOptions = {} );
+
+struct ObjLoaderComparison
+{
+	// Parsing and welding with load_obj_model() and load_obj_model_streaming(),
+	// as for ModelCacheInfo::parseMilliseconds and parsePeakBytes
+	double parallelMilliseconds = 0.0;
+	double streamingMilliseconds = 0.0;
+	std::size_t parallelPeakBytes = 0;
+	std::size_t streamingPeakBytes = 0;
+
+	// False if the peaks are lower bounds
+	bool exact = false;
+};
+
+ObjLoaderComparison compare_obj_loaders( std::string_view const& aOBJPath, ObjStreamOptions const& = ObjStreamOptions{} );
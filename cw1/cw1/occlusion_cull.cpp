@@ -0,0 +1,691 @@
+#include "occlusion_cull.hpp"
+
+#include <limits>
+#include <chrono>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define CW1_OCCLUSION_AVX2_ 1
+#endif
+
+namespace
+{
+	constexpr std::int32_t kTileWidth = 32; // one bit per pixel in a row's mask
+	constexpr std::int32_t kTileHeight = 8; // one row per AVX2 lane
+
+	constexpr std::uint32_t kBinTilesX = 2;
+	constexpr std::uint32_t kBinTilesY = 8;
+
+	constexpr std::size_t kChunkTriangles = 512;
+
+	// Triangles are clipped to this multiple of the screen, which bounds
+	// the pixel coordinates of the edge functions
+	constexpr float kGuardBand = 2.f;
+
+	constexpr std::size_t kMaxClipVertices = 3 + 5;
+
+	// A connected part of a mesh, e.g. a building
+	struct Object_
+	{
+		MeshInfo const* mesh;
+		std::vector<std::size_t> triangles; // first index (or vertex, without indices) of each, relative to the mesh
+		glm::vec3 boundsMin, boundsMax;
+	};
+
+	glm::vec3 mesh_vertex_( ModelData const& aModel, MeshInfo const& aMesh, std::size_t aIndex )
+	{
+		if( 0 == aMesh.numberOfIndices )
+			return aModel.vertexPositions[aMesh.vertexStartIndex + aIndex];
+
+		return aModel.vertexPositions[aMesh.vertexStartIndex + aModel.indices[aMesh.indexStartIndex + aIndex]];
+	}
+
+	std::size_t find_root_( std::vector<std::size_t>& aParent, std::size_t aItem )
+	{
+		while( aParent[aItem] != aItem )
+			aItem = aParent[aItem] = aParent[aParent[aItem]];
+		return aItem;
+	}
+
+	// Splits the triangles [aFirst,aFirst+aCount) of a mesh into parts that
+	// share vertex positions
+	void split_objects_( ModelData const& aModel, MeshInfo const& aMesh, std::size_t aFirst, std::size_t aCount, std::vector<Object_>& aObjects )
+	{
+		auto const triangles = aCount / 3;
+		if( 0 == triangles )
+			return;
+
+		std::unordered_map<std::uint64_t, std::size_t> firstTriangle; // by hashed position
+		std::vector<std::size_t> parent( triangles );
+		std::iota( parent.begin(), parent.end(), std::size_t(0) );
+
+		for( std::size_t t = 0; t < triangles; ++t )
+		{
+			for( std::size_t k = 0; k < 3; ++k )
+			{
+				auto const p = mesh_vertex_( aModel, aMesh, aFirst + 3*t + k );
+
+				std::uint32_t bits[3];
+				std::memcpy( bits, &p, sizeof(bits) );
+				std::uint64_t const key = (std::uint64_t(bits[0]) * 0x9e3779b97f4a7c15ull) ^ (std::uint64_t(bits[1]) * 0xc2b2ae3d27d4eb4full) ^ bits[2];
+
+				auto const [it, inserted] = firstTriangle.emplace( key, t );
+				if( !inserted )
+					parent[find_root_( parent, t )] = find_root_( parent, it->second );
+			}
+		}
+
+		std::unordered_map<std::size_t, std::size_t> objectOf; // by root
+		for( std::size_t t = 0; t < triangles; ++t )
+		{
+			auto const [it, inserted] = objectOf.emplace( find_root_( parent, t ), aObjects.size() );
+			if( inserted )
+				aObjects.emplace_back( Object_{ &aMesh, {}, glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( std::numeric_limits<float>::lowest() ) } );
+
+			auto& object = aObjects[it->second];
+			object.triangles.emplace_back( aFirst + 3*t );
+			for( std::size_t k = 0; k < 3; ++k )
+			{
+				auto const p = mesh_vertex_( aModel, aMesh, aFirst + 3*t + k );
+				object.boundsMin = glm::min( object.boundsMin, p );
+				object.boundsMax = glm::max( object.boundsMax, p );
+			}
+		}
+	}
+
+	// Sutherland-Hodgman against the near plane (z >= 0) and the guard band;
+	// returns the number of vertices
+	std::size_t clip_polygon_( glm::vec4 (&aVertices)[kMaxClipVertices], std::size_t aCount )
+	{
+		glm::vec4 const planes[] = {
+			{ 0.f, 0.f, 1.f, 0.f },
+			{ -1.f, 0.f, 0.f, kGuardBand },
+			{ 1.f, 0.f, 0.f, kGuardBand },
+			{ 0.f, -1.f, 0.f, kGuardBand },
+			{ 0.f, 1.f, 0.f, kGuardBand }
+		};
+
+		for( auto const& plane : planes )
+		{
+			glm::vec4 out[kMaxClipVertices];
+			std::size_t outCount = 0;
+
+			for( std::size_t i = 0; i < aCount; ++i )
+			{
+				auto const& a = aVertices[i];
+				auto const& b = aVertices[(i+1) % aCount];
+				float const da = glm::dot( plane, a ), db = glm::dot( plane, b );
+
+				if( da >= 0.f )
+					out[outCount++] = a;
+				if( (da >= 0.f) != (db >= 0.f) )
+					out[outCount++] = a + (b - a) * (da / (da - db));
+			}
+
+			if( outCount < 3 )
+				return 0;
+
+			std::copy( out, out + outCount, aVertices );
+			aCount = outCount;
+		}
+
+		return aCount;
+	}
+
+	// Pixel spans of the 8 rows starting at aRowY: pixel x of row r is
+	// covered if aFirst[r] <= x <= aLast[r]. Both are clamped to
+	// [-1,aWidth+1].
+	void row_spans_( float const (&aA)[3], float const (&aB)[3], float const (&aC)[3], float aRowY, float aWidth,
+		std::int32_t (&aFirst)[8], std::int32_t (&aLast)[8] ) noexcept
+	{
+#		if CW1_OCCLUSION_AVX2_
+		// Pixel centers
+		__m256 const y = _mm256_add_ps( _mm256_set1_ps( aRowY + 0.5f ), _mm256_setr_ps( 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f ) );
+
+		__m256 lo = _mm256_set1_ps( -1.f );
+		__m256 hi = _mm256_set1_ps( aWidth + 1.f );
+		for( int e = 0; e < 3; ++e )
+		{
+			// a*x + b*y + c >= 0 bounds x from one side, or not at all
+			__m256 const v = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( aB[e] ), y ), _mm256_set1_ps( aC[e] ) );
+			if( aA[e] > 0.f )
+				lo = _mm256_max_ps( lo, _mm256_div_ps( v, _mm256_set1_ps( -aA[e] ) ) );
+			else if( aA[e] < 0.f )
+				hi = _mm256_min_ps( hi, _mm256_div_ps( v, _mm256_set1_ps( -aA[e] ) ) );
+			else
+				lo = _mm256_blendv_ps( lo, _mm256_set1_ps( aWidth + 1.f ), _mm256_cmp_ps( v, _mm256_setzero_ps(), _CMP_LT_OQ ) );
+		}
+
+		__m256 const half = _mm256_set1_ps( 0.5f );
+		__m256 const first = _mm256_min_ps( _mm256_ceil_ps( _mm256_sub_ps( lo, half ) ), _mm256_set1_ps( aWidth + 1.f ) );
+		__m256 const last = _mm256_max_ps( _mm256_floor_ps( _mm256_sub_ps( hi, half ) ), _mm256_set1_ps( -1.f ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>(aFirst), _mm256_cvttps_epi32( first ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>(aLast), _mm256_cvttps_epi32( last ) );
+#		else
+		for( int r = 0; r < 8; ++r )
+		{
+			float const y = aRowY + float(r) + 0.5f;
+
+			float lo = -1.f, hi = aWidth + 1.f;
+			for( int e = 0; e < 3; ++e )
+			{
+				float const v = aB[e] * y + aC[e];
+				if( aA[e] > 0.f )
+					lo = std::max( lo, v / -aA[e] );
+				else if( aA[e] < 0.f )
+					hi = std::min( hi, v / -aA[e] );
+				else if( v < 0.f )
+					lo = aWidth + 1.f;
+			}
+
+			aFirst[r] = std::int32_t(std::min( std::ceil( lo - 0.5f ), aWidth + 1.f ));
+			aLast[r] = std::int32_t(std::max( std::floor( hi - 0.5f ), -1.f ));
+		}
+#		endif
+	}
+
+#	if !CW1_OCCLUSION_AVX2_
+	// Bits [aFirst,aLast] of a row, which may lie outside [0,31]
+	std::uint32_t row_mask_( std::int32_t aFirst, std::int32_t aLast ) noexcept
+	{
+		aFirst = std::clamp( aFirst, 0, 32 );
+		auto const shift = std::clamp( 31 - aLast, 0, 32 );
+		if( 32 == aFirst || 32 == shift )
+			return 0;
+
+		return (~std::uint32_t(0) << aFirst) & (~std::uint32_t(0) >> shift);
+	}
+#	endif
+}
+
+OccluderSet select_occluders( ModelData const& aModel, OccluderSelection const& aSelection )
+{
+	// The original meshes, split into connected parts: exporters tend to
+	// merge everything that shares a material. A hash collision merely
+	// joins two parts.
+	std::vector<Object_> objects;
+	for( auto const& mesh : aModel.meshes )
+	{
+		if( 0 == mesh.numberOfSubMeshes )
+		{
+			split_objects_( aModel, mesh, 0, 0 != mesh.numberOfIndices ? mesh.numberOfIndices : mesh.numberOfVertices, objects );
+			continue;
+		}
+
+		for( std::size_t i = 0; i < mesh.numberOfSubMeshes; ++i )
+		{
+			auto const& sub = aModel.subMeshes[mesh.subMeshStartIndex + i];
+			assert( sub.indexStartIndex >= mesh.indexStartIndex );
+			split_objects_( aModel, mesh, sub.indexStartIndex - mesh.indexStartIndex, sub.numberOfIndices, objects );
+		}
+	}
+
+	OccluderSet ret;
+	ret.candidates = objects.size();
+	if( objects.empty() )
+		return ret;
+
+	glm::vec3 modelMin = objects.front().boundsMin, modelMax = objects.front().boundsMax;
+	for( auto const& object : objects )
+	{
+		modelMin = glm::min( modelMin, object.boundsMin );
+		modelMax = glm::max( modelMax, object.boundsMax );
+	}
+
+	float const minExtent = aSelection.minExtentFraction * glm::length( modelMax - modelMin );
+
+	// Extents, largest first
+	auto const extents = [] ( Object_ const& aObject ) {
+		auto e = aObject.boundsMax - aObject.boundsMin;
+		if( e.x < e.y ) std::swap( e.x, e.y );
+		if( e.y < e.z ) std::swap( e.y, e.z );
+		if( e.x < e.y ) std::swap( e.x, e.y );
+		return e;
+	};
+
+	// Qualifying objects by the (half) surface area of their bounds, largest first
+	std::vector<std::pair<float, std::size_t>> ranked;
+	for( std::size_t i = 0; i < objects.size(); ++i )
+	{
+		auto const e = extents( objects[i] );
+		if( e.x >= minExtent && e.y >= minExtent )
+			ranked.emplace_back( e.x * e.y + e.y * e.z + e.z * e.x, i );
+	}
+
+	std::stable_sort( ranked.begin(), ranked.end(), [] ( auto const& a, auto const& b ) { return a.first > b.first; } );
+	if( ranked.size() > aSelection.maxOccluders )
+		ranked.resize( aSelection.maxOccluders );
+
+	// Each keeps its largest triangles
+	std::vector<std::pair<float, std::size_t>> triangles;
+	for( auto const& [score, index] : ranked )
+	{
+		auto const& object = objects[index];
+		auto const e = extents( object );
+		float const minArea = aSelection.minTriangleAreaFraction * e.x * e.y;
+
+		triangles.clear();
+		for( auto const t : object.triangles )
+		{
+			auto const a = mesh_vertex_( aModel, *object.mesh, t );
+			auto const b = mesh_vertex_( aModel, *object.mesh, t+1 );
+			auto const c = mesh_vertex_( aModel, *object.mesh, t+2 );
+
+			float const area = 0.5f * glm::length( glm::cross( b - a, c - a ) );
+			if( area >= minArea && area > 0.f )
+				triangles.emplace_back( area, t );
+		}
+
+		if( triangles.empty() )
+			continue;
+
+		std::stable_sort( triangles.begin(), triangles.end(), [] ( auto const& a, auto const& b ) { return a.first > b.first; } );
+		if( triangles.size() > aSelection.maxTrianglesPerOccluder )
+			triangles.resize( aSelection.maxTrianglesPerOccluder );
+
+		for( auto const& [area, t] : triangles )
+		{
+			for( std::size_t k = 0; k < 3; ++k )
+				ret.vertices.emplace_back( mesh_vertex_( aModel, *object.mesh, t+k ) );
+		}
+
+		++ret.occluders;
+	}
+
+	return ret;
+}
+
+
+OcclusionCuller::OcclusionCuller( OccluderSet aOccluders, std::uint32_t aWidth, std::uint32_t aHeight, std::size_t aThreadCount )
+	: mOccluders( std::move(aOccluders) )
+	, mTilesX( std::max<std::uint32_t>( 1, (aWidth + kTileWidth - 1) / kTileWidth ) )
+	, mTilesY( std::max<std::uint32_t>( 1, (aHeight + kTileHeight - 1) / kTileHeight ) )
+	, mBinsX( (mTilesX + kBinTilesX - 1) / kBinTilesX )
+	, mBinsY( (mTilesY + kBinTilesY - 1) / kBinTilesY )
+	, mTiles( std::size_t(mTilesX) * mTilesY )
+	, mPool( aThreadCount )
+{
+	assert( mOccluders.vertices.size() % 3 == 0 );
+
+	auto const triangles = mOccluders.vertices.size() / 3;
+	mChunks.resize( (triangles + kChunkTriangles - 1) / kChunkTriangles );
+	for( auto& chunk : mChunks )
+	{
+		chunk.triangles.reserve( kChunkTriangles );
+		chunk.bins.resize( std::size_t(mBinsX) * mBinsY );
+	}
+
+	// Nothing occludes before the first render()
+	for( auto& tile : mTiles )
+	{
+		std::fill( std::begin(tile.mask), std::end(tile.mask), 0u );
+		tile.zMax0 = 1.f;
+		tile.zMax1 = 0.f;
+	}
+}
+
+void OcclusionCuller::render( glm::mat4 const& aProjCam )
+{
+	auto const start = std::chrono::steady_clock::now();
+
+	mStats = OcclusionStats{};
+	mStats.triangles = mOccluders.vertices.size() / 3;
+	mProjCam = aProjCam;
+
+	mPool.parallel_for( mChunks.size(), [this] ( std::size_t aChunk ) { setup_chunk_( aChunk ); } );
+	mPool.parallel_for( std::size_t(mBinsX) * mBinsY, [this] ( std::size_t aBin ) { rasterize_bin_( aBin ); } );
+
+	for( auto const& chunk : mChunks )
+	{
+		for( auto const& bin : chunk.bins )
+			mStats.binned += bin.size();
+	}
+
+	mStats.rasterMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+bool OcclusionCuller::occluded( glm::vec3 const& aMin, glm::vec3 const& aMax )
+{
+	auto const start = std::chrono::steady_clock::now();
+	auto const finish = [&] ( bool aOccluded ) {
+		++mStats.tested;
+		mStats.occluded += aOccluded;
+		mStats.testMilliseconds += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		return aOccluded;
+	};
+
+	// Screen rectangle and nearest depth of the corners
+	float const width = float(mTilesX * kTileWidth), height = float(mTilesY * kTileHeight);
+
+	float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+	float minY = minX, maxY = maxX;
+	float zNear = 1.f;
+	for( int i = 0; i < 8; ++i )
+	{
+		glm::vec3 const corner( (i & 1) ? aMax.x : aMin.x, (i & 2) ? aMax.y : aMin.y, (i & 4) ? aMax.z : aMin.z );
+		auto const clip = mProjCam * glm::vec4( corner, 1.f );
+		if( clip.z < 0.f || clip.w <= 0.f )
+			return finish( false );
+
+		float const x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+		float const y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+		minX = std::min( minX, x ); maxX = std::max( maxX, x );
+		minY = std::min( minY, y ); maxY = std::max( maxY, y );
+		zNear = std::min( zNear, clip.z / clip.w );
+	}
+
+	if( maxX < 0.f || maxY < 0.f || minX >= width || minY >= height )
+		return finish( false );
+
+	// Every pixel that the rectangle touches
+	auto const px0 = std::int32_t(std::max( 0.f, std::floor( minX ) ));
+	auto const px1 = std::int32_t(std::min( width - 1.f, std::floor( maxX ) ));
+	auto const py0 = std::int32_t(std::max( 0.f, std::floor( minY ) ));
+	auto const py1 = std::int32_t(std::min( height - 1.f, std::floor( maxY ) ));
+
+	for( std::int32_t ty = py0 / kTileHeight; ty <= py1 / kTileHeight; ++ty )
+	{
+		for( std::int32_t tx = px0 / kTileWidth; tx <= px1 / kTileWidth; ++tx )
+		{
+			auto const& tile = mTiles[std::size_t(ty) * mTilesX + tx];
+
+			// Everything in the tile is nearer
+			if( zNear > tile.zMax0 )
+				continue;
+
+			// The rectangle's part of the tile lies within the mask, which is nearer
+			if( zNear > tile.zMax1 )
+			{
+				std::int32_t const first = std::max( px0 - tx * kTileWidth, 0 );
+				std::int32_t const last = std::min( px1 - tx * kTileWidth, kTileWidth - 1 );
+				std::uint32_t const columns = (~std::uint32_t(0) << first) & (~std::uint32_t(0) >> (31 - last));
+
+#				if CW1_OCCLUSION_AVX2_
+				__m256i const row = _mm256_add_epi32( _mm256_set1_epi32( ty * kTileHeight ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+				__m256i const inside = _mm256_and_si256(
+					_mm256_cmpgt_epi32( row, _mm256_set1_epi32( py0 - 1 ) ),
+					_mm256_cmpgt_epi32( _mm256_set1_epi32( py1 + 1 ), row )
+				);
+				__m256i const rect = _mm256_and_si256( inside, _mm256_set1_epi32( std::int32_t(columns) ) );
+				__m256i const mask = _mm256_load_si256( reinterpret_cast<__m256i const*>(tile.mask) );
+				if( _mm256_testc_si256( mask, rect ) )
+					continue;
+#				else
+				bool covered = true;
+				for( std::int32_t r = 0; r < kTileHeight && covered; ++r )
+				{
+					std::int32_t const y = ty * kTileHeight + r;
+					if( y >= py0 && y <= py1 && (columns & ~tile.mask[r]) )
+						covered = false;
+				}
+				if( covered )
+					continue;
+#				endif
+			}
+
+			return finish( false );
+		}
+	}
+
+	return finish( true );
+}
+
+OcclusionStats const& OcclusionCuller::stats() const noexcept
+{
+	return mStats;
+}
+
+std::uint32_t OcclusionCuller::width() const noexcept
+{
+	return mTilesX * kTileWidth;
+}
+
+std::uint32_t OcclusionCuller::height() const noexcept
+{
+	return mTilesY * kTileHeight;
+}
+
+std::size_t OcclusionCuller::thread_count() const noexcept
+{
+	return mPool.thread_count();
+}
+
+void OcclusionCuller::setup_chunk_( std::size_t aChunk )
+{
+	auto& chunk = mChunks[aChunk];
+	chunk.triangles.clear();
+	for( auto& bin : chunk.bins )
+		bin.clear();
+
+	float const width = float(mTilesX * kTileWidth), height = float(mTilesY * kTileHeight);
+
+	auto const first = aChunk * kChunkTriangles;
+	auto const last = std::min( first + kChunkTriangles, mOccluders.vertices.size() / 3 );
+	for( auto t = first; t < last; ++t )
+	{
+		glm::vec4 clip[kMaxClipVertices];
+		for( std::size_t k = 0; k < 3; ++k )
+			clip[k] = mProjCam * glm::vec4( mOccluders.vertices[3*t + k], 1.f );
+
+		// Entirely outside one of the side planes
+		auto const outside = [&] ( auto aDistance ) {
+			return aDistance( clip[0] ) < 0.f && aDistance( clip[1] ) < 0.f && aDistance( clip[2] ) < 0.f;
+		};
+		if( outside( [] ( glm::vec4 const& v ) { return v.w - v.x; } ) || outside( [] ( glm::vec4 const& v ) { return v.w + v.x; } )
+			|| outside( [] ( glm::vec4 const& v ) { return v.w - v.y; } ) || outside( [] ( glm::vec4 const& v ) { return v.w + v.y; } )
+			|| outside( [] ( glm::vec4 const& v ) { return v.z; } ) || outside( [] ( glm::vec4 const& v ) { return v.w - v.z; } ) )
+		{
+			continue;
+		}
+
+		auto const count = clip_polygon_( clip, 3 );
+
+		// Screen space
+		glm::vec3 screen[kMaxClipVertices];
+		for( std::size_t k = 0; k < count; ++k )
+		{
+			screen[k] = glm::vec3(
+				(clip[k].x / clip[k].w * 0.5f + 0.5f) * width,
+				(clip[k].y / clip[k].w * 0.5f + 0.5f) * height,
+				clip[k].z / clip[k].w
+			);
+		}
+
+		// Both sides of the occluders are drawn
+		for( std::size_t k = 1; k + 1 < count; ++k )
+		{
+			glm::vec3 v[3] = { screen[0], screen[k], screen[k+1] };
+
+			float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+			if( std::abs( area ) < 1e-6f )
+				continue;
+
+			if( area < 0.f )
+			{
+				std::swap( v[1], v[2] );
+				area = -area;
+			}
+
+			// Pixels whose centers may be covered
+			float const minX = std::min( { v[0].x, v[1].x, v[2].x } ), maxX = std::max( { v[0].x, v[1].x, v[2].x } );
+			float const minY = std::min( { v[0].y, v[1].y, v[2].y } ), maxY = std::max( { v[0].y, v[1].y, v[2].y } );
+
+			auto const px0 = std::int32_t(std::max( 0.f, std::ceil( minX - 0.5f ) ));
+			auto const px1 = std::int32_t(std::min( width - 1.f, std::floor( maxX - 0.5f ) ));
+			auto const py0 = std::int32_t(std::max( 0.f, std::ceil( minY - 0.5f ) ));
+			auto const py1 = std::int32_t(std::min( height - 1.f, std::floor( maxY - 0.5f ) ));
+			if( px0 > px1 || py0 > py1 )
+				continue;
+
+			Triangle_ tri{};
+			for( int e = 0; e < 3; ++e )
+			{
+				auto const& a = v[e];
+				auto const& b = v[(e+1) % 3];
+				tri.edgeA[e] = a.y - b.y;
+				tri.edgeB[e] = b.x - a.x;
+				tri.edgeC[e] = a.x * b.y - b.x * a.y;
+			}
+
+			float const dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+			float const dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+			tri.zPlane[0] = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+			tri.zPlane[1] = dzdx;
+			tri.zPlane[2] = dzdy;
+
+			tri.zMin = std::min( { v[0].z, v[1].z, v[2].z } );
+			tri.zMax = std::max( { v[0].z, v[1].z, v[2].z } );
+
+			tri.tileX0 = px0 / kTileWidth;
+			tri.tileX1 = px1 / kTileWidth;
+			tri.tileY0 = py0 / kTileHeight;
+			tri.tileY1 = py1 / kTileHeight;
+
+			auto const index = std::uint32_t(chunk.triangles.size());
+			chunk.triangles.emplace_back( tri );
+
+			for( auto by = std::uint32_t(tri.tileY0) / kBinTilesY; by <= std::uint32_t(tri.tileY1) / kBinTilesY; ++by )
+			{
+				for( auto bx = std::uint32_t(tri.tileX0) / kBinTilesX; bx <= std::uint32_t(tri.tileX1) / kBinTilesX; ++bx )
+					chunk.bins[by * mBinsX + bx].emplace_back( index );
+			}
+		}
+	}
+}
+
+void OcclusionCuller::rasterize_bin_( std::size_t aBin )
+{
+	auto const bx = std::int32_t(aBin % mBinsX), by = std::int32_t(aBin / mBinsX);
+
+	std::int32_t const x0 = bx * std::int32_t(kBinTilesX);
+	std::int32_t const y0 = by * std::int32_t(kBinTilesY);
+	std::int32_t const x1 = std::min( x0 + std::int32_t(kBinTilesX), std::int32_t(mTilesX) ) - 1;
+	std::int32_t const y1 = std::min( y0 + std::int32_t(kBinTilesY), std::int32_t(mTilesY) ) - 1;
+
+	for( auto y = y0; y <= y1; ++y )
+	{
+		for( auto x = x0; x <= x1; ++x )
+		{
+			auto& tile = mTiles[std::size_t(y) * mTilesX + x];
+			std::fill( std::begin(tile.mask), std::end(tile.mask), 0u );
+			tile.zMax0 = 1.f;
+			tile.zMax1 = 0.f;
+		}
+	}
+
+	// In submission order, which is the same for every bin
+	for( auto const& chunk : mChunks )
+	{
+		for( auto const index : chunk.bins[aBin] )
+		{
+			auto const& tri = chunk.triangles[index];
+			rasterize_( tri, std::max( tri.tileX0, x0 ), std::max( tri.tileY0, y0 ), std::min( tri.tileX1, x1 ), std::min( tri.tileY1, y1 ) );
+		}
+	}
+}
+
+void OcclusionCuller::rasterize_( Triangle_ const& aTri, std::int32_t aTileX0, std::int32_t aTileY0, std::int32_t aTileX1, std::int32_t aTileY1 )
+{
+	float const width = float(mTilesX * kTileWidth);
+
+	// Farthest depth of the triangle within a tile: the plane's maximum over
+	// the tile's corners, or the farthest vertex
+	float const zHalfExtent = std::abs( aTri.zPlane[1] ) * (0.5f * kTileWidth) + std::abs( aTri.zPlane[2] ) * (0.5f * kTileHeight);
+
+	for( auto ty = aTileY0; ty <= aTileY1; ++ty )
+	{
+		alignas(32) std::int32_t first[8], last[8];
+		row_spans_( aTri.edgeA, aTri.edgeB, aTri.edgeC, float(ty * kTileHeight), width, first, last );
+
+		for( auto tx = aTileX0; tx <= aTileX1; ++tx )
+		{
+			auto& tile = mTiles[std::size_t(ty) * mTilesX + tx];
+
+			// Entirely behind what the tile already holds
+			if( aTri.zMin >= tile.zMax0 )
+				continue;
+
+			float const centerX = (float(tx) + 0.5f) * kTileWidth;
+			float const centerY = (float(ty) + 0.5f) * kTileHeight;
+			float const zTri = std::min( aTri.zMax, aTri.zPlane[0] + aTri.zPlane[1] * centerX + aTri.zPlane[2] * centerY + zHalfExtent );
+
+			std::int32_t const tileX = tx * kTileWidth;
+
+#			if CW1_OCCLUSION_AVX2_
+			// Bits [first,last] of each row; variable shifts by 32 or more give 0
+			__m256i const ones = _mm256_set1_epi32( -1 );
+			__m256i const base = _mm256_set1_epi32( tileX );
+			__m256i const lo = _mm256_min_epi32( _mm256_max_epi32( _mm256_sub_epi32( _mm256_load_si256( reinterpret_cast<__m256i const*>(first) ), base ), _mm256_setzero_si256() ), _mm256_set1_epi32( 32 ) );
+			__m256i const hi = _mm256_min_epi32( _mm256_max_epi32( _mm256_sub_epi32( _mm256_set1_epi32( 31 + tileX ), _mm256_load_si256( reinterpret_cast<__m256i const*>(last) ) ), _mm256_setzero_si256() ), _mm256_set1_epi32( 32 ) );
+			__m256i const coverage = _mm256_and_si256( _mm256_sllv_epi32( ones, lo ), _mm256_srlv_epi32( ones, hi ) );
+			if( _mm256_testz_si256( coverage, coverage ) )
+				continue;
+
+			__m256i mask = _mm256_load_si256( reinterpret_cast<__m256i const*>(tile.mask) );
+#			else
+			std::uint32_t coverage[8];
+			std::uint32_t any = 0;
+			for( int r = 0; r < 8; ++r )
+				any |= coverage[r] = row_mask_( first[r] - tileX, last[r] - tileX );
+			if( 0 == any )
+				continue;
+
+			std::uint32_t mask[8];
+			std::copy( std::begin(tile.mask), std::end(tile.mask), mask );
+#			endif
+
+			// Start the mask over if the triangle is much nearer than its
+			// contents, which are then closer to zMax0
+			if( tile.zMax1 - zTri > tile.zMax0 - tile.zMax1 )
+			{
+				tile.zMax1 = 0.f;
+#				if CW1_OCCLUSION_AVX2_
+				mask = _mm256_setzero_si256();
+#				else
+				std::fill( std::begin(mask), std::end(mask), 0u );
+#				endif
+			}
+
+			tile.zMax1 = std::max( tile.zMax1, zTri );
+
+#			if CW1_OCCLUSION_AVX2_
+			mask = _mm256_or_si256( mask, coverage );
+			bool const full = _mm256_testc_si256( mask, ones );
+#			else
+			bool full = true;
+			for( int r = 0; r < 8; ++r )
+			{
+				mask[r] |= coverage[r];
+				full = full && ~std::uint32_t(0) == mask[r];
+			}
+#			endif
+
+			// A full mask covers the tile
+			if( full )
+			{
+				tile.zMax0 = std::min( tile.zMax0, tile.zMax1 );
+				tile.zMax1 = 0.f;
+#				if CW1_OCCLUSION_AVX2_
+				mask = _mm256_setzero_si256();
+#				else
+				std::fill( std::begin(mask), std::end(mask), 0u );
+#				endif
+			}
+
+#			if CW1_OCCLUSION_AVX2_
+			_mm256_store_si256( reinterpret_cast<__m256i*>(tile.mask), mask );
+#			else
+			std::copy( std::begin(mask), std::end(mask), tile.mask );
+#			endif
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+#include "../labutils/thread_pool.hpp"
+
+/* CPU occlusion culling with a masked software depth buffer.
+ *
+ * select_occluders() picks the largest objects of a model, e.g. the
+ * buildings of a city, by the size of their bounds, and keeps a simplified
+ * version of each: its largest triangles. They are real geometry, so they
+ * never hide anything that is visible. Objects are the connected parts of
+ * the original meshes (see batch_meshes_by_material()).
+ *
+ * OcclusionCuller::render() rasterizes the occluders into a low-resolution
+ * depth buffer, following "Masked Software Occlusion Culling" (Hasselgren,
+ * Andersson and Akenine-Moller, 2016). The buffer is made of tiles of 32x8
+ * pixels, each with a coverage mask (one bit per pixel) and two depths:
+ *  - zMax0, the farthest depth of the whole tile,
+ *  - zMax1, the farthest depth of the pixels in the mask.
+ * Triangles are merged into the mask until it covers the tile, which then
+ * lowers zMax0. The coverage of a tile's 8 rows is computed at once, one
+ * row per AVX2 lane.
+ *
+ * The work is binned: the triangles are transformed, clipped against the
+ * near plane and a guard band, and set up in chunks, which sort them into
+ * bins of tiles. The bins are then rasterized independently. Both steps run
+ * on the culler's thread pool.
+ *
+ * occluded() tests an object's world-space AABB against the buffer; it is
+ * conservative, and anything that crosses the near plane is visible. Depths
+ * are those of a glm::perspectiveRH_ZO() projection, i.e. [0,1] with 0 at
+ * the near plane.
+ */
+struct OccluderSelection
+{
+	std::size_t maxOccluders = 256;
+	std::size_t maxTrianglesPerOccluder = 64;
+
+	// Objects qualify if the two largest extents of their bounds are at
+	// least this fraction of the model's bounds' diagonal
+	float minExtentFraction = 0.01f;
+
+	// Triangles smaller than this fraction of the largest face of their
+	// object's bounds are dropped
+	float minTriangleAreaFraction = 0.01f;
+};
+
+struct OccluderSet
+{
+	// Three world-space vertices per triangle
+	std::vector<glm::vec3> vertices;
+
+	std::size_t occluders = 0;
+	std::size_t candidates = 0; // objects in the model
+};
+
+OccluderSet select_occluders( ModelData const&, OccluderSelection const& = OccluderSelection{} );
+
+
+struct OcclusionStats
+{
+	std::size_t triangles = 0; // occluder triangles submitted
+	std::size_t binned = 0; // triangles after clipping and culling, per bin they overlap
+	std::size_t tested = 0; // occluded() calls
+	std::size_t occluded = 0;
+
+	double rasterMilliseconds = 0.0; // render()
+	double testMilliseconds = 0.0; // all occluded() calls
+};
+
+class OcclusionCuller
+{
+	public:
+		// The size is rounded up to whole tiles. aThreadCount == 0 selects
+		// the hardware's concurrency.
+		OcclusionCuller( OccluderSet, std::uint32_t aWidth, std::uint32_t aHeight, std::size_t aThreadCount = 0 );
+
+		OcclusionCuller( OcclusionCuller const& ) = delete;
+		OcclusionCuller& operator= (OcclusionCuller const&) = delete;
+
+	public:
+		// Clears the buffer and rasterizes the occluders; also resets the
+		// statistics
+		void render( glm::mat4 const& aProjCam );
+
+		// Whether the box is hidden behind the occluders of the last render().
+		// Call from one thread at a time.
+		bool occluded( glm::vec3 const& aMin, glm::vec3 const& aMax );
+
+		OcclusionStats const& stats() const noexcept;
+
+		std::uint32_t width() const noexcept;
+		std::uint32_t height() const noexcept;
+		std::size_t thread_count() const noexcept;
+
+	private:
+		struct Tile_
+		{
+			alignas(32) std::uint32_t mask[8]; // row r, bit i: pixel (i,r) of the tile
+			float zMax0;
+			float zMax1;
+		};
+
+		struct Triangle_
+		{
+			float edgeA[3], edgeB[3], edgeC[3]; // inside where a*x + b*y + c >= 0, in pixels
+			float zPlane[3]; // depth = z0 + dzdx*x + dzdy*y
+			float zMin, zMax;
+			std::int32_t tileX0, tileY0, tileX1, tileY1; // inclusive
+		};
+
+		struct Chunk_
+		{
+			std::vector<Triangle_> triangles;
+			std::vector<std::vector<std::uint32_t>> bins; // triangles per bin
+		};
+
+		void setup_chunk_( std::size_t aChunk );
+		void rasterize_bin_( std::size_t aBin );
+		void rasterize_( Triangle_ const&, std::int32_t aTileX0, std::int32_t aTileY0, std::int32_t aTileX1, std::int32_t aTileY1 );
+
+		OccluderSet mOccluders;
+
+		std::uint32_t mTilesX, mTilesY;
+		std::uint32_t mBinsX, mBinsY;
+		std::vector<Tile_> mTiles;
+
+		glm::mat4 mProjCam{ 1.f };
+		std::vector<Chunk_> mChunks;
+
+		OcclusionStats mStats;
+
+		labutils::ThreadPool mPool;
+};
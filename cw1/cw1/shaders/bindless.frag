@@ -0,0 +1,53 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// default.frag with bindless textures: all textures are in one array, which
+// is bound once per frame, and each material has the index of its texture.
+// Only used if the device supports descriptor indexing.
+
+layout( location = 0 ) in vec2 v2fTexCoord;
+layout( location = 1 ) flat in uint v2fMaterial; // from the draw data
+layout( location = 0 ) out vec4 oColor;
+
+// The index comes from the material of the draw; a multi-draw may mix
+// draws within a subgroup, so it is not dynamically uniform
+layout( set = 1, binding = 0 ) uniform sampler2D uTextures[];
+
+// per-material constants (glsl::MaterialConstants), indexed per draw
+struct MaterialConstants
+{
+	vec4 color; // linear; multiplies the texture
+	uint streamedTexture; // feedback entry, or ~0u if the texture is not streamed
+	uint texture; // in uTextures
+};
+
+layout( std430, set = 2, binding = 0 ) readonly buffer SMaterials
+{
+	MaterialConstants materials[];
+}sMaterials;
+
+// Finest level that each streamed texture needs (see labutils::TextureStreamer),
+// relative to the bound image and biased by kFeedbackLodBias
+layout( std430, set = 3, binding = 0 ) buffer SFeedback
+{
+	uint levels[];
+}sFeedback;
+
+const float kFeedbackLodBias = 32.0;
+
+void main()
+{
+	MaterialConstants material = sMaterials.materials[v2fMaterial];
+	oColor = vec4( texture(uTextures[nonuniformEXT(material.texture)], v2fTexCoord).rgb * material.color.rgb, 1.f );
+
+	// Derivatives need uniform control flow, so the level is computed by
+	// all fragments. Only one fragment in each 4x4 block reports it, and only
+	// if it is finer than what is there already, to keep the atomics down.
+	float lod = textureQueryLod( uTextures[nonuniformEXT(material.texture)], v2fTexCoord ).y;
+	if( material.streamedTexture != ~0u && 0u == ((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) )
+	{
+		uint level = uint( clamp( floor(lod) + kFeedbackLodBias, 0.0, 2.0*kFeedbackLodBias - 1.0 ) );
+		if( level < sFeedback.levels[material.streamedTexture] )
+			atomicMin( sFeedback.levels[material.streamedTexture], level );
+	}
+}
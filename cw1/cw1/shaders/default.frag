@@ -1,13 +1,46 @@
 #version 450
 
 layout( location = 0 ) in vec2 v2fTexCoord;
+layout( location = 1 ) flat in uint v2fMaterial; // from the draw data
 layout( location = 0 ) out vec4 oColor;
 
 layout( set = 1, binding = 0 ) uniform sampler2D uTexColor;
 
+// per-material constants (glsl::MaterialConstants), indexed per draw
+struct MaterialConstants
+{
+	vec4 color; // linear; multiplies the texture
+	uint streamedTexture; // feedback entry, or ~0u if the texture is not streamed
+	uint texture; // in the bindless texture array (see bindless.frag)
+};
+
+layout( std430, set = 2, binding = 0 ) readonly buffer SMaterials
+{
+	MaterialConstants materials[];
+}sMaterials;
+
+// Finest level that each streamed texture needs (see labutils::TextureStreamer),
+// relative to the bound image and biased by kFeedbackLodBias
+layout( std430, set = 3, binding = 0 ) buffer SFeedback
+{
+	uint levels[];
+}sFeedback;
+
+const float kFeedbackLodBias = 32.0;
+
 void main()
 {
-	
-	oColor = vec4( texture(uTexColor, v2fTexCoord).rgb, 1.f );
+	MaterialConstants material = sMaterials.materials[v2fMaterial];
+	oColor = vec4( texture(uTexColor, v2fTexCoord).rgb * material.color.rgb, 1.f );
 
-}
\ No newline at end of file
+	// Derivatives need uniform control flow, so the level is computed by
+	// all fragments. Only one fragment in each 4x4 block reports it, and only
+	// if it is finer than what is there already, to keep the atomics down.
+	float lod = textureQueryLod( uTexColor, v2fTexCoord ).y;
+	if( material.streamedTexture != ~0u && 0u == ((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) )
+	{
+		uint level = uint( clamp( floor(lod) + kFeedbackLodBias, 0.0, 2.0*kFeedbackLodBias - 1.0 ) );
+		if( level < sFeedback.levels[material.streamedTexture] )
+			atomicMin( sFeedback.levels[material.streamedTexture], level );
+	}
+}
@@ -1,11 +1,12 @@
 #version 450
 
-// inputs
-layout(location = 0) in vec3 inPosition;
+// inputs (quantized formats are normalized; see vertex_format.hpp)
+layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec2 inTexcoord;
 
 // outputs
 layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) flat out uint v2fMaterial;
 
 // uniform
 layout(set = 0, binding = 0) uniform UScene
@@ -15,8 +16,27 @@ layout(set = 0, binding = 0) uniform UScene
 	mat4 projCam;
 }uScene;
 
+// per-draw data (glsl::DrawData), selected by the indirect draw's first
+// instance: dequantization (vfmt::VertexDequant) and the material index
+struct DrawData
+{
+	vec4 positionScale;
+	vec4 positionOffset;
+	vec4 texcoordScaleOffset;
+	uint materialIndex;
+};
+
+layout( std430, set = 0, binding = 1 ) readonly buffer SDraws
+{
+	DrawData draws[];
+}sDraws;
+
 void main()
 {
-	v2fTexCoord = inTexcoord;
-	gl_Position = uScene.projCam * vec4( inPosition.xyz, 1.f ); 
-}
\ No newline at end of file
+	DrawData draw = sDraws.draws[gl_InstanceIndex];
+	vec3 position = inPosition.xyz * draw.positionScale.xyz + draw.positionOffset.xyz;
+
+	v2fTexCoord = inTexcoord * draw.texcoordScaleOffset.xy + draw.texcoordScaleOffset.zw;
+	v2fMaterial = draw.materialIndex;
+	gl_Position = uScene.projCam * vec4( position, 1.f ); 
+}
@@ -0,0 +1,25 @@
+#version 450
+
+// Materials without a texture (see default.frag): the constant color is all
+// there is, so no texture or sampler is bound.
+layout( location = 0 ) in vec2 v2fTexCoord;
+layout( location = 1 ) flat in uint v2fMaterial; // from the draw data
+layout( location = 0 ) out vec4 oColor;
+
+// per-material constants (glsl::MaterialConstants), indexed per draw
+struct MaterialConstants
+{
+	vec4 color; // linear
+	uint streamedTexture; // unused without a texture
+	uint texture; // unused without a texture
+};
+
+layout( std430, set = 2, binding = 0 ) readonly buffer SMaterials
+{
+	MaterialConstants materials[];
+}sMaterials;
+
+void main()
+{
+	oColor = vec4( sMaterials.materials[v2fMaterial].color.rgb, 1.f );
+}
@@ -1,231 +1,342 @@
 #include "vertex_data.h"
 
 #include <limits>
+#include <memory>
+#include <algorithm>
 #include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cassert>
 #include <cstring> // for std::memcpy()
+#include "vertex_weld.hpp"
 #include "../labutils/error.hpp"
 #include "../labutils/vkutil.hpp"
+#include "../labutils/vkbuffer.hpp"
 #include "../labutils/to_string.hpp"
+#include "../labutils/upload_queue.hpp"
 
 
 namespace lut = labutils;
 
 
-Mesh create_mesh_with_texture(labutils::VulkanContext const& aContext, labutils::Allocator const& aAllocator, ModelData& const modelData, unsigned int subMeshIndex)
+namespace
 {
-	
-	// Store the number of vertices for the first object
-	unsigned int numberOfVertices = modelData.meshes[subMeshIndex].numberOfVertices;
-	unsigned int vertexStartIndex = modelData.meshes[subMeshIndex].vertexStartIndex;
+	// Staging regions start on 16 byte boundaries
+	constexpr VkDeviceSize kStagingAlignment = 16;
 
-	if (modelData.vertexTextureCoords.empty())
-		modelData.vertexTextureCoords.resize(numberOfVertices,glm::vec2(0,0));
+	VkDeviceSize align_up(VkDeviceSize value)
+	{
+		return (value + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+	}
 
-	
-	// Vertex data
-	lut::Buffer vertexPosGPU = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY
-	);
+	struct MeshLayout
+	{
+		VkDeviceSize vertexBytes, indexBytes;
+		VkDeviceSize stagingBytes; // both, including alignment
+		std::uint32_t numberOfIndices;
+		bool use16BitIndices;
+	};
 
-	lut::Buffer vertexTexcoordGPU = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec2),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY
-	);
+	MeshLayout size_mesh(MeshUpload const& upload)
+	{
+		MeshInfo const& meshInfo = upload.model->meshes[upload.subMeshIndex];
 
+		// Meshes are indexed (see weld_vertices()); indices are relative to vertexStartIndex
+		assert(meshInfo.numberOfIndices > 0);
+		assert(upload.vertices.count == meshInfo.numberOfVertices);
 
-	lut::Buffer posStaging = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU
-	);
+		MeshLayout layout{};
+		layout.numberOfIndices = std::uint32_t(meshInfo.numberOfIndices);
+		layout.use16BitIndices = mesh_uses_16bit_indices(meshInfo);
 
-	lut::Buffer texcoordStaging = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec2),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU
-	);
+		std::size_t const totalIndices = meshInfo.numberOfIndices + upload.extraIndices.size();
+		layout.vertexBytes = VkDeviceSize(upload.vertices.count) * upload.vertices.stride;
+		layout.indexBytes = totalIndices * (layout.use16BitIndices ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+		layout.stagingBytes = align_up(layout.vertexBytes) + align_up(layout.indexBytes);
+		return layout;
+	}
 
-	// map the buffer with a pointer
-	void* posPtr = nullptr;
-	if (auto const res = vmaMapMemory(aAllocator.allocator, posStaging.allocation, &posPtr); VK_SUCCESS != res)
+	// OBJ colors are sRGB encoded, like the textures (which are sampled from sRGB formats); the shaders work in linear
+	float srgb_to_linear(float c)
 	{
-		throw lut::Error("Mapping memory for writing\nvmaMapMemory() returned %s", lut::to_string(res).c_str());
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
 	}
-	// copy the data into buffer pointed by the pointer
-	std::memcpy(posPtr, &modelData.vertexPositions[vertexStartIndex], numberOfVertices * sizeof(glm::vec3));
-
-	// un map buffer
-	vmaUnmapMemory(aAllocator.allocator, posStaging.allocation);
 
+	glm::vec3 srgb_to_linear(glm::vec3 const& c)
+	{
+		glm::vec3 const clamped = glm::clamp(c, 0.f, 1.f);
+		return glm::vec3(srgb_to_linear(clamped.r), srgb_to_linear(clamped.g), srgb_to_linear(clamped.b));
+	}
 
-	void* texcoordPtr = nullptr;
-	if (auto const res = vmaMapMemory(aAllocator.allocator, texcoordStaging.allocation, &texcoordPtr); VK_SUCCESS != res)
+	// Writes the mesh's indices followed by the extra indices, narrowing to 16 bits if needed
+	void write_indices(MeshUpload const& upload, MeshLayout const& layout, void* dst)
 	{
-		throw lut::Error("Mapping memory for writing\nvmaMapMemory() returned % s", lut::to_string(res).c_str());
+		MeshInfo const& meshInfo = upload.model->meshes[upload.subMeshIndex];
+		std::uint32_t const* meshIndices = upload.model->indices.data() + meshInfo.indexStartIndex;
+		auto const& extraIndices = upload.extraIndices;
+
+		if (layout.use16BitIndices)
+		{
+			std::uint16_t* indexDst = static_cast<std::uint16_t*>(dst);
+			for (std::uint32_t i = 0; i < layout.numberOfIndices; ++i)
+				indexDst[i] = static_cast<std::uint16_t>(meshIndices[i]);
+			for (std::size_t i = 0; i < extraIndices.size(); ++i)
+				indexDst[layout.numberOfIndices + i] = static_cast<std::uint16_t>(extraIndices[i]);
+		}
+		else
+		{
+			std::uint32_t* indexDst = static_cast<std::uint32_t*>(dst);
+			std::memcpy(indexDst, meshIndices, layout.numberOfIndices * sizeof(std::uint32_t));
+			if (!extraIndices.empty())
+				std::memcpy(indexDst + layout.numberOfIndices, extraIndices.data(), extraIndices.size() * sizeof(std::uint32_t));
+		}
 	}
+}
 
-	std::memcpy(texcoordPtr, &modelData.vertexTextureCoords[vertexStartIndex], numberOfVertices * sizeof(glm::vec2));
 
-	vmaUnmapMemory(aAllocator.allocator, texcoordStaging.allocation);
+std::vector<Mesh> create_meshes(labutils::VulkanContext const&, labutils::Allocator const& aAllocator, labutils::UploadQueue& aQueue,
+	std::vector<MeshUpload> const& uploads, SceneGeometry& geometry, MeshUploadStats* stats)
+{
+	std::vector<Mesh> meshes;
+	meshes.reserve(uploads.size());
 
-	// create fence
-	lut::Fence uploadComplete = create_fence(aContext);
+	std::size_t const batchesBefore = aQueue.stats().batches;
+	VkDeviceSize stagedBytes = 0;
 
-	// create command pool and buffer
-	lut::CommandPool uploadPool = create_command_pool(aContext);
+	// Size all meshes first, such that each buffer of the scene is created once; the meshes are laid out back to back
+	std::vector<MeshLayout> layouts;
+	layouts.reserve(uploads.size());
 
-	VkCommandBuffer uploadCmd = alloc_command_buffer(aContext, uploadPool.handle);
+	geometry = SceneGeometry{};
+	for (auto const& upload : uploads)
+	{
+		auto const& layout = layouts.emplace_back(size_mesh(upload));
 
-	VkCommandBufferBeginInfo beginInfo{};
+		// Vertex offsets are in vertices, so all meshes must have the same stride
+		assert(upload.vertices.stride == uploads.front().vertices.stride);
 
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = 0;
-	beginInfo.pInheritanceInfo = nullptr;
+		geometry.vertexBytes += layout.vertexBytes;
+		(layout.use16BitIndices ? geometry.indexBytes16 : geometry.indexBytes32) += layout.indexBytes;
+	}
+
+	if (geometry.vertexBytes)
+	{
+		geometry.vertices = lut::create_buffer(
+			aAllocator,
+			geometry.vertexBytes,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+	}
 
-	if (auto const res = vkBeginCommandBuffer(uploadCmd, &beginInfo); VK_SUCCESS != res)
+	for (auto const& [bytes, buffer] : { std::pair{ geometry.indexBytes16, &geometry.indices16 }, std::pair{ geometry.indexBytes32, &geometry.indices32 } })
 	{
-		throw lut::Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
+		if (!bytes)
+			continue;
+
+		*buffer = lut::create_buffer(
+			aAllocator,
+			bytes,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
 	}
 
-	VkBufferCopy pcopy{};
-	pcopy.size = numberOfVertices * sizeof(glm::vec3);
+	// Write the data straight into the mapped staging memory, and record the copies. The queue submits a batch
+	// whenever it has staged half the staging ring, such that the next batch can be written while the previous
+	// one is copied.
+	VkDeviceSize vertexCursor = 0, indexCursor16 = 0, indexCursor32 = 0;
 
-	vkCmdCopyBuffer(uploadCmd, posStaging.buffer, vertexPosGPU.buffer, 1, &pcopy);
+	for (std::size_t i = 0; i < uploads.size(); ++i)
+	{
+		auto const& upload = uploads[i];
+		auto const& layout = layouts[i];
 
-	// create barrier
-	lut::buffer_barrier(uploadCmd,
-		vertexPosGPU.buffer,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-	);
+		lut::StagingRegion const staging = aQueue.stage(layout.stagingBytes, kStagingAlignment);
 
-	VkBufferCopy ccopy{};
-	ccopy.size = numberOfVertices * sizeof(glm::vec2);
+		VkDeviceSize const vertexOffset = 0;
+		VkDeviceSize const indexOffset = align_up(layout.vertexBytes);
 
-	vkCmdCopyBuffer(uploadCmd, texcoordStaging.buffer, vertexTexcoordGPU.buffer, 1, &ccopy);
+		vfmt::VertexDequant const dequant = upload.vertices.write(staging.data + vertexOffset);
+		write_indices(upload, layout, staging.data + indexOffset);
 
-	// create barrier
-	lut::buffer_barrier(uploadCmd,
-		vertexTexcoordGPU.buffer,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-	);
+		VkDeviceSize& indexCursor = layout.use16BitIndices ? indexCursor16 : indexCursor32;
+		VkDeviceSize const indexSize = layout.use16BitIndices ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
 
-	if (auto const res = vkEndCommandBuffer(uploadCmd); VK_SUCCESS != res)
-	{
-		throw lut::Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
-	}
+		aQueue.copy_to_buffer(staging, geometry.vertices.buffer, layout.vertexBytes,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, vertexOffset, vertexCursor);
+		aQueue.copy_to_buffer(staging, geometry.index_buffer(layout.use16BitIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32),
+			layout.indexBytes, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, indexOffset, indexCursor);
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &uploadCmd;
+		stagedBytes += layout.vertexBytes + layout.indexBytes;
 
-	if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo, uploadComplete.handle)
-		; VK_SUCCESS != res)
-	{
-		throw lut::Error("Submitting commands\nvkQueueSubmit() returned %s", lut::to_string(res).c_str());
+		MaterialInfo const& material = upload.model->materials[upload.model->meshes[upload.subMeshIndex].materialIndex];
+
+		meshes.emplace_back(Mesh{
+			std::int32_t(vertexCursor / upload.vertices.stride),
+			std::uint32_t(indexCursor / indexSize),
+			dequant,
+			material.colorTexturePath,
+			material.color,
+			upload.vertices.count,
+			layout.numberOfIndices,
+			layout.use16BitIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32
+		});
+
+		vertexCursor += layout.vertexBytes;
+		indexCursor += layout.indexBytes;
 	}
 
-	if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max())
-		; VK_SUCCESS != res)
+	// Start copying the rest; the meshes are ready once the queue's ticket has completed
+	aQueue.flush();
+
+	if (stats)
 	{
-		throw lut::Error("Waiting for upload to complete\nvkWaitForFences() returned %s", lut::to_string(res).c_str());
+		stats->batches = aQueue.stats().batches - batchesBefore;
+		stats->stagedBytes = std::size_t(stagedBytes);
 	}
 
-	return Mesh{
-		std::move(vertexPosGPU),
-		std::move(vertexTexcoordGPU),
-		modelData.materials[modelData.meshes[subMeshIndex].materialIndex].colorTexturePath,
-		modelData.materials[modelData.meshes[subMeshIndex].materialIndex].color,
-		numberOfVertices
-	};
+	return meshes;
+}
+
 
-	
-	
+Mesh create_mesh_with_texture(labutils::VulkanContext const& aContext, labutils::Allocator const& aAllocator, labutils::UploadQueue& aQueue, ModelData const& modelData,
+	vfmt::VertexWriter const& vertices, std::vector<std::uint32_t> const& extraIndices, unsigned int subMeshIndex, SceneGeometry& geometry)
+{
+	std::vector<MeshUpload> uploads;
+	uploads.emplace_back(MeshUpload{ &modelData, subMeshIndex, vertices, extraIndices });
+
+	auto meshes = create_meshes(aContext, aAllocator, aQueue, uploads, geometry);
+	return std::move(meshes.front());
 }
 
 
 
-ModelBufferPack create_model_buffer_pack(labutils::VulkanWindow const& window, labutils::Allocator const& allocator, 
-	ModelData& const modelData, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool, unsigned int subMeshIndex)
+std::uint32_t MaterialTable::add(glm::vec4 const& color, std::uint32_t streamedTexture, std::uint32_t texture)
 {
-	Mesh mesh = create_mesh_with_texture(window, allocator, modelData, subMeshIndex);
+	// Scenes have at most a few hundred materials, so a linear search is fine
+	for (std::size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].color == color && entries[i].streamedTexture == streamedTexture && entries[i].texture == texture)
+			return std::uint32_t(i);
+	}
+
+	entries.emplace_back(Entry{ color, streamedTexture, texture });
+	return std::uint32_t(entries.size() - 1);
+}
+
 
-	// load textures into image
-	labutils::Image image;
+ModelBufferPack create_model_buffer_pack(labutils::VulkanWindow const& window, labutils::Allocator const& allocator, labutils::UploadQueue& uploadQueue,
+	labutils::ResourceCache& cache, MaterialTable& materials, Mesh&& mesh, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool,
+	PreparedTexture const& preparedTexture, labutils::BindlessTextures* bindless)
+{
+	// Streamed textures have their images and descriptor sets in the streamer, which replaces them as levels come and go
+	if (labutils::kNoStreamedTexture != preparedTexture.streamed)
 	{
-		// check if the device image format can support 
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(window.physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
-		
-		// create command pool
-		labutils::CommandPool loadCmdPool = labutils::create_command_pool(window,VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		return ModelBufferPack{
+			mesh.vertexOffset,
+			mesh.firstIndex,
+			mesh.dequant,
+			materialSetLayout,
+			VK_NULL_HANDLE,
+			nullptr,
+			materials.add(glm::vec4(1.f), preparedTexture.streamed, preparedTexture.streamedBindless),
+			preparedTexture.streamed,
+			mesh.vertexCount,
+			mesh.indexCount,
+			mesh.indexType
+		};
+	}
 
-		// load a texture for the model
-		if (mesh.colorTexturePath != "")
-		{
-			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) 
-			{
-				image = labutils::load_image_texture2d_with_bliting(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator);
-			}
-			else
-			{
-				image = labutils::load_image_texture2d_no_minmap(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator);
-			}
-		}
-		else
-			image = create_image_texture2d_with_solid_color(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator, glm::vec4(mesh.color,1.f));
+	// load textures into image (once per path; see labutils::ResourceCache)
+	std::shared_ptr<labutils::Texture const> texture;
+	if (auto const* baked = preparedTexture.baked)
+	{
+		// The levels are copied from the mapped file straight into the staging buffer
+		texture = cache.texture(mesh.colorTexturePath, baked->format, [&] {
+			return labutils::upload_image_levels_texture2d(baked->format, baked->levels, allocator, uploadQueue);
+		});
 	}
+	else if (auto const* compressed = preparedTexture.compressed)
+	{
+		auto const format = labutils::block_format_srgb(compressed->format);
+		texture = cache.texture(mesh.colorTexturePath, format, [&] {
+			return labutils::upload_image_texture2d(*compressed, allocator, uploadQueue);
+		});
+	}
+	else if (mesh.colorTexturePath != "")
+	{
+		texture = cache.texture(mesh.colorTexturePath, VK_FORMAT_R8G8B8A8_SRGB, [&] {
+			// check if the device image format can support 
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(window.physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
 
-	// create image view for texture image
-	labutils::ImageView view= labutils::create_image_view_texture2d(window, image.image, VK_FORMAT_R8G8B8A8_SRGB);
-	
-	labutils::Sampler sampler = labutils::create_default_sampler(window, VK_TRUE);
-	
+			bool const blitMipmaps = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 
-	// allocate and initialize descriptor sets for texture
-	VkDescriptorSet texDescriptors = labutils::alloc_desc_set(window, dpool, materialSetLayout);
-	{
-		// Write descriptor set
-		VkWriteDescriptorSet desc[1]{};
+			if (preparedTexture.decoded)
+				return labutils::upload_image_texture2d(*preparedTexture.decoded, allocator, uploadQueue, blitMipmaps);
 
-		// Descriptor Buffer Info 
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = view.handle;
-		imageInfo.sampler = sampler.handle;
+			if (blitMipmaps)
+				return labutils::load_image_texture2d_with_bliting(mesh.colorTexturePath.c_str(), allocator, uploadQueue);
 
-		desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		desc[0].dstSet = texDescriptors;
-		desc[0].dstBinding = 0;
-		desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[0].descriptorCount = 1;
-		desc[0].pImageInfo = &imageInfo;
+			return labutils::load_image_texture2d_no_minmap(mesh.colorTexturePath.c_str(), allocator, uploadQueue);
+		});
+	}
+	else
+	{
+		// No texture: the color comes from the material table alone
+		return ModelBufferPack{
+			mesh.vertexOffset,
+			mesh.firstIndex,
+			mesh.dequant,
+			materialSetLayout,
+			VK_NULL_HANDLE,
+			nullptr,
+			materials.add(glm::vec4(srgb_to_linear(mesh.color), 1.f)),
+			labutils::kNoStreamedTexture,
+			mesh.vertexCount,
+			mesh.indexCount,
+			mesh.indexType
+		};
+	}
+
+	auto sampler = cache.sampler(labutils::default_sampler_info(window, VK_TRUE));
 
-		constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
-		vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
+	// bindless: an entry in the table, shared by all meshes with the same texture and sampler; the pack keeps both alive
+	if (bindless)
+	{
+		auto const index = bindless->add(texture->view.handle, sampler->handle);
+		auto material = std::make_shared<labutils::MaterialSet const>(labutils::MaterialSet{ VK_NULL_HANDLE, std::move(texture), std::move(sampler) });
+
+		return ModelBufferPack{
+			mesh.vertexOffset,
+			mesh.firstIndex,
+			mesh.dequant,
+			materialSetLayout,
+			VK_NULL_HANDLE,
+			std::move(material),
+			materials.add(glm::vec4(1.f), labutils::kNoStreamedTexture, index),
+			labutils::kNoStreamedTexture,
+			mesh.vertexCount,
+			mesh.indexCount,
+			mesh.indexType
+		};
 	}
 
+	// descriptor set for texture, shared by all meshes with the same texture and sampler
+	auto material = cache.material_set(dpool, materialSetLayout, std::move(texture), std::move(sampler));
+
 	return ModelBufferPack{
-		std::move(mesh.positions),
-		std::move(mesh.texcoords),
+		mesh.vertexOffset,
+		mesh.firstIndex,
+		mesh.dequant,
 		std::move(materialSetLayout),
-		std::move(texDescriptors),
-		std::move(image),
-		std::move(view),
-		std::move(sampler),
-		mesh.vertexCount
+		material->set,
+		std::move(material),
+		materials.add(glm::vec4(1.f)), // textures are used as they are
+		labutils::kNoStreamedTexture,
+		mesh.vertexCount,
+		mesh.indexCount,
+		mesh.indexType
 	};
-}
\ No newline at end of file
+}
@@ -4,39 +4,170 @@
 #include "../labutils/vkbuffer.hpp"
 #include "../labutils/allocator.hpp" 
 #include "../cw1/model.hpp"
+#include "../cw1/vertex_format.hpp"
+#include "../cw1/meshlet.hpp"
+#include "../cw1/mesh_lod.hpp"
+#include "../cw1/bounds_cull.hpp"
 #include "../labutils/vkutil.hpp"
 #include "../labutils/vkimage.hpp"
+#include "../labutils/image_decode.hpp"
+#include "../labutils/block_compress.hpp"
+#include "../labutils/ktx2.hpp"
+#include "../labutils/resource_cache.hpp"
+#include "../labutils/upload_queue.hpp"
+#include "../labutils/texture_streamer.hpp"
+#include "../labutils/bindless_textures.hpp"
 
 
+// Vertices and indices of all meshes, sub-allocated from one vertex buffer and one index buffer per index type. A whole
+// pass then binds them once, and each mesh is drawn with its offsets (see Mesh::vertexOffset and Mesh::firstIndex), e.g.
+// from indirect draw commands.
+struct SceneGeometry
+{
+	labutils::Buffer vertices; // interleaved, see vertex_format.hpp; all meshes share the format
+	labutils::Buffer indices16, indices32; // VK_NULL_HANDLE if no mesh uses the type
+
+	VkDeviceSize vertexBytes = 0;
+	VkDeviceSize indexBytes16 = 0, indexBytes32 = 0;
+
+	VkBuffer index_buffer(VkIndexType type) const noexcept
+	{
+		return VK_INDEX_TYPE_UINT16 == type ? indices16.buffer : indices32.buffer;
+	}
+};
+
 struct Mesh
 {
-	labutils::Buffer positions;
-	labutils::Buffer texcoords;
+	// Location in the SceneGeometry: the first vertex, and the first index in the buffer of the mesh's index type
+	std::int32_t vertexOffset;
+	std::uint32_t firstIndex;
+	vfmt::VertexDequant dequant;
 
 	std::string colorTexturePath;
 	glm::vec3 color;
 
 	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	VkIndexType indexType;
 };
 
 struct ModelBufferPack
 {
-	labutils::Buffer positions;
-	labutils::Buffer texcoords;
+	// See Mesh; meshlet and LOD index ranges are relative to firstIndex
+	std::int32_t vertexOffset;
+	std::uint32_t firstIndex;
+	vfmt::VertexDequant dequant;
 	
 	VkDescriptorSetLayout materialSetLayout;
-	VkDescriptorSet materialDescriptorSet;
-	
-	labutils::Image image;
-	labutils::ImageView view;
-	labutils::Sampler sampler;
+	VkDescriptorSet materialDescriptorSet; // VK_NULL_HANDLE if untextured or bindless
+
+	// Texture, sampler and descriptor set, shared with all packs that use the same material. Null for materials without
+	// a texture, which only use their constants. With bindless textures, the set is null, and the texture is selected by
+	// the material constants instead (see MaterialTable::Entry::texture).
+	std::shared_ptr<labutils::MaterialSet const> material;
+
+	// Index of the material's constants (see MaterialTable)
+	std::uint32_t materialIndex;
+
+	// Texture in the TextureStreamer, whose descriptor sets are per frame; materialDescriptorSet and material are then
+	// null. labutils::kNoStreamedTexture otherwise.
+	std::uint32_t streamedTexture;
 	
 	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	VkIndexType indexType;
+
+	// Meshlets for cluster culling; their index ranges partition the
+	// index buffer (see build_meshlets()). Empty if meshlets are not used.
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> meshletBounds;
+
+	// LOD groups (see build_lods()); meshletStart refers to lodMeshlets.
+	// Empty if level of detail is not used.
+	std::vector<LodGroup> lodGroups;
+	std::vector<std::uint32_t> lodMeshlets;
+
+	// Bounds of the whole mesh, for culling it before its meshlets (see cull_bounds())
+	MeshBounds bounds{};
+
+	bool textured() const noexcept
+	{
+		return nullptr != material || labutils::kNoStreamedTexture != streamedTexture;
+	}
+};
+
+
+// Geometry upload. create_meshes() sizes all meshes, creates the buffers of the
+// SceneGeometry, and then packs the vertices (see vfmt::pack_vertices_into())
+// and indices of each mesh straight into staging memory, and records the
+// copies to the mesh's ranges in the upload queue, which submits them in
+// batches (see labutils::UploadQueue). The call does not wait for the copies;
+// the meshes can be drawn once the queue's ticket has completed, or by later
+// submissions to the graphics queue. The ModelData referenced by the uploads
+// is only read during the call; afterwards, its CPU-side geometry is no
+// longer needed.
+struct MeshUpload
+{
+	ModelData const* model;
+	unsigned int subMeshIndex;
+
+	vfmt::VertexWriter vertices; // see vfmt::vertex_writer()
+
+	// Appended to the mesh's index buffer, after the mesh's own indices
+	std::vector<std::uint32_t> extraIndices;
+};
+
+struct MeshUploadStats
+{
+	std::size_t batches = 0;        // submitted by the upload queue during the call
+	std::size_t stagedBytes = 0;    // vertex and index data written to staging
 };
 
+std::vector<Mesh> create_meshes(labutils::VulkanContext const&, labutils::Allocator const&, labutils::UploadQueue&, std::vector<MeshUpload> const& uploads,
+	SceneGeometry& geometry, MeshUploadStats* stats = nullptr);
+
+
+// Single mesh, with geometry of its own; see create_meshes()
+Mesh create_mesh_with_texture(labutils::VulkanContext const&, labutils::Allocator const&, labutils::UploadQueue&, ModelData const& modelData,
+	vfmt::VertexWriter const& vertices, std::vector<std::uint32_t> const& extraIndices, unsigned int subMeshIndex, SceneGeometry& geometry);
 
-Mesh create_mesh_with_texture(labutils::VulkanContext const&, labutils::Allocator const&, ModelData& const modelData, unsigned int subMeshIndex);
 
+// Constants of all materials, in the layout of the shaders' MaterialConstants. The table is uploaded to a storage buffer
+// once all packs have been created, and the shaders index it with ModelBufferPack::materialIndex. Materials with equal
+// constants share an entry.
+struct MaterialTable
+{
+	struct Entry
+	{
+		glm::vec4 color; // linear; multiplies the texture, if any
+		std::uint32_t streamedTexture; // where the shader reports mip feedback (see labutils::TextureStreamer)
+		std::uint32_t texture; // index in the bindless texture table (see labutils::BindlessTextures)
+	};
+
+	std::vector<Entry> entries;
+
+	std::uint32_t add(glm::vec4 const& color, std::uint32_t streamedTexture = labutils::kNoStreamedTexture,
+		std::uint32_t texture = labutils::kNoBindlessTexture);
+};
+
+
+// mesh.colorTexturePath, prepared ahead of the upload. Any may be null; a streamed texture takes precedence over a baked
+// one, which takes precedence over a compressed image, which takes precedence over a decoded one.
+struct PreparedTexture
+{
+	std::uint32_t streamed = labutils::kNoStreamedTexture; // see labutils::TextureStreamer::add()
+	std::uint32_t streamedBindless = labutils::kNoBindlessTexture; // see labutils::TextureStreamer::bindless_index()
+	labutils::Ktx2Image const* baked = nullptr; // see labutils::load_baked_texture()
+	labutils::DecodedImage const* decoded = nullptr; // see labutils::decode_images()
+	labutils::CompressedImage const* compressed = nullptr; // see labutils::compress_image()
+};
 
-ModelBufferPack create_model_buffer_pack(labutils::VulkanWindow const& window, labutils::Allocator const& allocator,
-	ModelData& const modelData, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool, unsigned int subMeshIndex);
+// Textures, samplers and descriptor sets come from the cache, so meshes with the same material share them. Textures are
+// uploaded through the upload queue, like the geometry. Materials without a texture get neither, only an entry in the
+// material table.
+//
+// With a bindless table, textures get an entry there instead of a descriptor set; materialSetLayout and dpool are then
+// unused.
+ModelBufferPack create_model_buffer_pack(labutils::VulkanWindow const& window, labutils::Allocator const& allocator, labutils::UploadQueue& uploadQueue,
+	labutils::ResourceCache& cache, MaterialTable& materials, Mesh&& mesh, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool,
+	PreparedTexture const& preparedTexture = {}, labutils::BindlessTextures* bindless = nullptr);
@@ -0,0 +1,527 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <array>
+#include <limits>
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "model.hpp"
+
+/* Compile-time vertex format descriptors.
+ *
+ * A vertex format is a plain struct whose members are storage types from
+ * vfmt (Float3, Snorm16x4, Half2, ...). A specialization of
+ * vfmt::VertexLayout<> lists the members that are vertex attributes, using
+ * CW1_VERTEX_ATTRIBUTE() to record their semantic, shader location and
+ * offset. From this, vertex_binding() and vertex_attributes() derive the
+ * Vulkan input descriptions at compile time, and pack_vertices() converts
+ * (and quantizes) a mesh from ModelData into the format.
+ *
+ * Quantized storage types are normalized against per-mesh ranges:
+ *  - Snorm16x4 positions are stored relative to the mesh's AABB,
+ *  - Unorm16x2 texture coordinates relative to the mesh's UV range,
+ *  - Oct16 normals are octahedral-encoded unit vectors.
+ * The resulting scale and offset are returned as VertexDequant, which the
+ * vertex shader receives with each draw's data (see shaders/default.vert).
+ *
+ * pack_vertices_into() writes the converted vertices to caller-provided
+ * memory, e.g. a mapped staging buffer, without an intermediate copy. It
+ * first scans the mesh for the quantization ranges and then writes complete
+ * vertices front to back, which suits write-combined memory. vertex_writer()
+ * wraps this for code that does not know the vertex format.
+ *
+ * All formats interleave attributes into a single vertex buffer binding.
+ * Attributes that a format does not contain can be dropped from ModelData
+ * with strip_unused_attributes().
+ */
+
+namespace vfmt
+{
+	enum class Semantic : std::uint32_t
+	{
+		position,
+		normal,
+		texcoord
+	};
+
+	// How a storage type maps values into its representable range.
+	enum class Range
+	{
+		none,       // stored as-is
+		signedUnit, // per-mesh range mapped to [-1,1]
+		unitRange,  // per-mesh range mapped to [0,1]
+		octahedral  // unit vectors only
+	};
+
+	// Storage types
+	struct Float3
+	{
+		float value[3];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R32G32B32_SFLOAT;
+		static constexpr Range kRange = Range::none;
+	};
+
+	struct Float2
+	{
+		float value[2];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R32G32_SFLOAT;
+		static constexpr Range kRange = Range::none;
+	};
+
+	// Three components plus padding; R16G16B16_SNORM is not a mandatory
+	// vertex format, while R16G16B16A16_SNORM is.
+	struct Snorm16x4
+	{
+		std::int16_t value[4];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_SNORM;
+		static constexpr Range kRange = Range::signedUnit;
+	};
+
+	struct Half2
+	{
+		std::uint16_t value[2];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R16G16_SFLOAT;
+		static constexpr Range kRange = Range::none;
+	};
+
+	struct Unorm16x2
+	{
+		std::uint16_t value[2];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R16G16_UNORM;
+		static constexpr Range kRange = Range::unitRange;
+	};
+
+	struct Oct16
+	{
+		std::int16_t value[2];
+
+		static constexpr VkFormat kFormat = VK_FORMAT_R16G16_SNORM;
+		static constexpr Range kRange = Range::octahedral;
+	};
+
+	// Attribute descriptors
+	template< Semantic tSemantic, std::uint32_t tLocation, typename tStorage, std::size_t tOffset >
+	struct Attribute
+	{
+		using Storage = tStorage;
+
+		static constexpr Semantic kSemantic = tSemantic;
+		static constexpr std::uint32_t kLocation = tLocation;
+		static constexpr std::uint32_t kOffset = std::uint32_t(tOffset);
+	};
+
+	template< typename... tAttributes >
+	struct AttributeList
+	{
+		static constexpr std::size_t kCount = sizeof...(tAttributes);
+	};
+
+	// Specialize for each vertex format:
+	//   template<> struct VertexLayout<MyVertex> {
+	//     using Attributes = AttributeList< CW1_VERTEX_ATTRIBUTE(...), ... >;
+	//   };
+	template< typename tVertex >
+	struct VertexLayout;
+
+#	define CW1_VERTEX_ATTRIBUTE( vertex, member, semantic, location )                  \
+		::vfmt::Attribute< ::vfmt::Semantic::semantic, location,                       \
+			std::remove_cv_t<decltype(vertex::member)>, offsetof(vertex, member) >
+
+	// Dequantization parameters, laid out to match the start of the DrawData struct in
+	// shaders/default.vert: value = stored * scale + offset.
+	struct VertexDequant
+	{
+		glm::vec4 positionScale{ 1.f };
+		glm::vec4 positionOffset{ 0.f };
+		glm::vec4 texcoordScaleOffset{ 1.f, 1.f, 0.f, 0.f }; // xy = scale, zw = offset
+	};
+
+	static_assert( sizeof(VertexDequant) == 48, "VertexDequant must match the shader's DrawData struct" );
+
+	struct PackedVertices
+	{
+		std::vector<std::byte> data;
+		std::uint32_t stride = 0;
+		std::uint32_t count = 0;
+		VertexDequant dequant;
+	};
+
+	// Type-erased pack_vertices_into() for a single mesh. write() expects
+	// count*stride bytes.
+	struct VertexWriter
+	{
+		std::uint32_t stride = 0;
+		std::uint32_t count = 0;
+		std::function<VertexDequant(void*)> write;
+	};
+}
+
+// Vertex formats
+struct VertexF32
+{
+	vfmt::Float3 position;
+	vfmt::Float2 texcoord;
+};
+
+// Half-float texture coordinates lose precision quickly for tiled UVs
+// (|uv| > 16 leaves 1/64 steps); VertexQuantizedUnorm uses the full 16 bits
+// across the mesh's UV range instead.
+struct VertexQuantized
+{
+	vfmt::Snorm16x4 position;
+	vfmt::Half2 texcoord;
+};
+
+struct VertexQuantizedUnorm
+{
+	vfmt::Snorm16x4 position;
+	vfmt::Unorm16x2 texcoord;
+};
+
+struct VertexQuantizedLit
+{
+	vfmt::Snorm16x4 position;
+	vfmt::Oct16 normal;
+	vfmt::Half2 texcoord;
+};
+
+namespace vfmt
+{
+	template<> struct VertexLayout<VertexF32>
+	{
+		using Attributes = AttributeList<
+			CW1_VERTEX_ATTRIBUTE( VertexF32, position, position, 0 ),
+			CW1_VERTEX_ATTRIBUTE( VertexF32, texcoord, texcoord, 1 )
+		>;
+	};
+
+	template<> struct VertexLayout<VertexQuantized>
+	{
+		using Attributes = AttributeList<
+			CW1_VERTEX_ATTRIBUTE( VertexQuantized, position, position, 0 ),
+			CW1_VERTEX_ATTRIBUTE( VertexQuantized, texcoord, texcoord, 1 )
+		>;
+	};
+
+	template<> struct VertexLayout<VertexQuantizedUnorm>
+	{
+		using Attributes = AttributeList<
+			CW1_VERTEX_ATTRIBUTE( VertexQuantizedUnorm, position, position, 0 ),
+			CW1_VERTEX_ATTRIBUTE( VertexQuantizedUnorm, texcoord, texcoord, 1 )
+		>;
+	};
+
+	template<> struct VertexLayout<VertexQuantizedLit>
+	{
+		using Attributes = AttributeList<
+			CW1_VERTEX_ATTRIBUTE( VertexQuantizedLit, position, position, 0 ),
+			CW1_VERTEX_ATTRIBUTE( VertexQuantizedLit, texcoord, texcoord, 1 ),
+			CW1_VERTEX_ATTRIBUTE( VertexQuantizedLit, normal, normal, 2 )
+		>;
+	};
+}
+
+// Interface
+namespace vfmt
+{
+	template< typename tVertex >
+	constexpr VkVertexInputBindingDescription vertex_binding( std::uint32_t aBinding = 0 ) noexcept;
+
+	template< typename tVertex >
+	constexpr auto vertex_attributes( std::uint32_t aBinding = 0 ) noexcept
+		-> std::array<VkVertexInputAttributeDescription, VertexLayout<tVertex>::Attributes::kCount>;
+
+	template< typename tVertex >
+	constexpr bool uses_semantic( Semantic ) noexcept;
+
+	// Converts the vertices of aMesh into tVertex.
+	template< typename tVertex >
+	PackedVertices pack_vertices( ModelData const& aModel, MeshInfo const& aMesh );
+
+	// Converts the vertices of aMesh into tVertex and writes them to aDst,
+	// which must hold aMesh.numberOfVertices vertices (no alignment needed).
+	template< typename tVertex >
+	VertexDequant pack_vertices_into( ModelData const& aModel, MeshInfo const& aMesh, void* aDst );
+
+	// The returned writer refers to both aModel and aMesh, which must
+	// outlive it; aMesh must also stay in place, so aModel.meshes must not
+	// be resized while the writer is in use.
+	template< typename tVertex >
+	VertexWriter vertex_writer( ModelData const& aModel, MeshInfo const& aMesh );
+
+	// Releases the CPU-side attribute arrays that tVertex does not use.
+	template< typename tVertex >
+	void strip_unused_attributes( ModelData& aModel );
+}
+
+// Implementation
+namespace vfmt
+{
+	namespace detail
+	{
+		template< typename tVertex, typename tFunc, typename... tAttributes >
+		constexpr void for_each_attribute_( AttributeList<tAttributes...>, tFunc&& aFunc )
+		{
+			(aFunc( tAttributes{} ), ...);
+		}
+
+		template< typename tVertex, typename tFunc >
+		constexpr void for_each_attribute( tFunc&& aFunc )
+		{
+			for_each_attribute_<tVertex>( typename VertexLayout<tVertex>::Attributes{}, std::forward<tFunc>(aFunc) );
+		}
+
+		inline std::int16_t to_snorm16( float aValue ) noexcept
+		{
+			return std::int16_t(std::lround( std::clamp( aValue, -1.f, 1.f ) * 32767.f ));
+		}
+		inline std::uint16_t to_unorm16( float aValue ) noexcept
+		{
+			return std::uint16_t(std::lround( std::clamp( aValue, 0.f, 1.f ) * 65535.f ));
+		}
+
+		inline glm::vec2 octahedral_encode( glm::vec3 aNormal ) noexcept
+		{
+			auto const l1 = std::abs( aNormal.x ) + std::abs( aNormal.y ) + std::abs( aNormal.z );
+			if( l1 <= 0.f )
+				return glm::vec2( 0.f );
+
+			glm::vec2 p = glm::vec2( aNormal.x, aNormal.y ) / l1;
+			if( aNormal.z < 0.f )
+			{
+				// Fold the lower hemisphere over the diagonals
+				auto const sx = p.x >= 0.f ? 1.f : -1.f;
+				auto const sy = p.y >= 0.f ? 1.f : -1.f;
+				p = glm::vec2( (1.f - std::abs( p.y )) * sx, (1.f - std::abs( p.x )) * sy );
+			}
+
+			return p;
+		}
+
+		// Store a value that has already been normalized according to the
+		// storage type's Range.
+		inline void store( Float3& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = aIn.x; aOut.value[1] = aIn.y; aOut.value[2] = aIn.z;
+		}
+		inline void store( Float2& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = aIn.x; aOut.value[1] = aIn.y;
+		}
+		inline void store( Snorm16x4& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = to_snorm16( aIn.x );
+			aOut.value[1] = to_snorm16( aIn.y );
+			aOut.value[2] = to_snorm16( aIn.z );
+			aOut.value[3] = 0;
+		}
+		inline void store( Half2& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = glm::packHalf1x16( aIn.x );
+			aOut.value[1] = glm::packHalf1x16( aIn.y );
+		}
+		inline void store( Unorm16x2& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = to_unorm16( aIn.x );
+			aOut.value[1] = to_unorm16( aIn.y );
+		}
+		inline void store( Oct16& aOut, glm::vec4 const& aIn ) noexcept
+		{
+			aOut.value[0] = to_snorm16( aIn.x );
+			aOut.value[1] = to_snorm16( aIn.y );
+		}
+
+		// Per-mesh range of an attribute; returns (scale, offset) such that
+		// value = normalized * scale + offset.
+		template< typename tVec >
+		std::pair<tVec,tVec> range_transform( Range aRange, tVec const* aValues, std::size_t aCount ) noexcept
+		{
+			if( Range::signedUnit != aRange && Range::unitRange != aRange )
+				return { tVec( 1.f ), tVec( 0.f ) };
+
+			tVec lo( std::numeric_limits<float>::max() ), hi( -std::numeric_limits<float>::max() );
+			for( std::size_t i = 0; i < aCount; ++i )
+			{
+				lo = glm::min( lo, aValues[i] );
+				hi = glm::max( hi, aValues[i] );
+			}
+
+			if( 0 == aCount )
+				lo = hi = tVec( 0.f );
+
+			// Avoid division by zero for flat meshes
+			tVec extent = glm::max( hi - lo, tVec( std::numeric_limits<float>::min() ) );
+
+			if( Range::signedUnit == aRange )
+				return { extent * 0.5f, (lo + hi) * 0.5f };
+
+			return { extent, lo };
+		}
+
+		template< typename tVec >
+		glm::vec4 normalize_value( Range aRange, tVec const& aValue, std::pair<tVec,tVec> const& aTransform ) noexcept
+		{
+			tVec ret = aValue;
+			if( Range::signedUnit == aRange || Range::unitRange == aRange )
+				ret = (aValue - aTransform.second) / aTransform.first;
+
+			glm::vec4 out( 0.f );
+			for( int i = 0; i < tVec::length(); ++i )
+				out[i] = ret[i];
+			return out;
+		}
+	}
+
+	template< typename tVertex >
+	constexpr VkVertexInputBindingDescription vertex_binding( std::uint32_t aBinding ) noexcept
+	{
+		VkVertexInputBindingDescription ret{};
+		ret.binding = aBinding;
+		ret.stride = std::uint32_t(sizeof(tVertex));
+		ret.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return ret;
+	}
+
+	template< typename tVertex >
+	constexpr auto vertex_attributes( std::uint32_t aBinding ) noexcept
+		-> std::array<VkVertexInputAttributeDescription, VertexLayout<tVertex>::Attributes::kCount>
+	{
+		std::array<VkVertexInputAttributeDescription, VertexLayout<tVertex>::Attributes::kCount> ret{};
+
+		std::size_t i = 0;
+		detail::for_each_attribute<tVertex>( [&] ( auto aAttrib ) {
+			using Attrib_ = decltype(aAttrib);
+			ret[i].location = Attrib_::kLocation;
+			ret[i].binding = aBinding;
+			ret[i].format = Attrib_::Storage::kFormat;
+			ret[i].offset = Attrib_::kOffset;
+			++i;
+		} );
+
+		return ret;
+	}
+
+	template< typename tVertex >
+	constexpr bool uses_semantic( Semantic aSemantic ) noexcept
+	{
+		bool ret = false;
+		detail::for_each_attribute<tVertex>( [&] ( auto aAttrib ) {
+			ret = ret || (decltype(aAttrib)::kSemantic == aSemantic);
+		} );
+		return ret;
+	}
+
+	template< typename tVertex >
+	VertexDequant pack_vertices_into( ModelData const& aModel, MeshInfo const& aMesh, void* aDst )
+	{
+		static_assert( std::is_standard_layout_v<tVertex> && std::is_trivially_copyable_v<tVertex> );
+
+		auto const first = aMesh.vertexStartIndex;
+		auto const count = aMesh.numberOfVertices;
+
+		// Pass one: quantization ranges
+		std::pair<glm::vec3,glm::vec3> positionXform{ glm::vec3( 1.f ), glm::vec3( 0.f ) };
+		std::pair<glm::vec2,glm::vec2> texcoordXform{ glm::vec2( 1.f ), glm::vec2( 0.f ) };
+
+		VertexDequant ret;
+		detail::for_each_attribute<tVertex>( [&] ( auto aAttrib ) {
+			using Attrib_ = decltype(aAttrib);
+			constexpr auto kRange = Attrib_::Storage::kRange;
+
+			if constexpr( Semantic::position == Attrib_::kSemantic )
+			{
+				positionXform = detail::range_transform( kRange, aModel.vertexPositions.data() + first, count );
+				ret.positionScale = glm::vec4( positionXform.first, 1.f );
+				ret.positionOffset = glm::vec4( positionXform.second, 0.f );
+			}
+			else if constexpr( Semantic::texcoord == Attrib_::kSemantic )
+			{
+				texcoordXform = detail::range_transform( kRange, aModel.vertexTextureCoords.data() + first, count );
+				ret.texcoordScaleOffset = glm::vec4( texcoordXform.first, texcoordXform.second );
+			}
+		} );
+
+		// Pass two: assemble each vertex locally and write it out in one go
+		auto* dst = static_cast<std::byte*>(aDst);
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			tVertex vertex{};
+
+			detail::for_each_attribute<tVertex>( [&] ( auto aAttrib ) {
+				using Attrib_ = decltype(aAttrib);
+				using Storage_ = typename Attrib_::Storage;
+				constexpr auto kRange = Storage_::kRange;
+
+				glm::vec4 value( 0.f );
+				if constexpr( Semantic::position == Attrib_::kSemantic )
+					value = detail::normalize_value( kRange, aModel.vertexPositions[first+i], positionXform );
+				else if constexpr( Semantic::texcoord == Attrib_::kSemantic )
+					value = detail::normalize_value( kRange, aModel.vertexTextureCoords[first+i], texcoordXform );
+				else if constexpr( Semantic::normal == Attrib_::kSemantic && Range::octahedral == kRange )
+					value = glm::vec4( detail::octahedral_encode( aModel.vertexNormals[first+i] ), 0.f, 0.f );
+				else if constexpr( Semantic::normal == Attrib_::kSemantic )
+					value = glm::vec4( aModel.vertexNormals[first+i], 0.f );
+
+				Storage_ stored;
+				detail::store( stored, value );
+				std::memcpy( reinterpret_cast<std::byte*>(&vertex) + Attrib_::kOffset, &stored, sizeof(Storage_) );
+			} );
+
+			std::memcpy( dst + i*sizeof(tVertex), &vertex, sizeof(tVertex) );
+		}
+
+		return ret;
+	}
+
+	template< typename tVertex >
+	PackedVertices pack_vertices( ModelData const& aModel, MeshInfo const& aMesh )
+	{
+		PackedVertices ret;
+		ret.stride = std::uint32_t(sizeof(tVertex));
+		ret.count = std::uint32_t(aMesh.numberOfVertices);
+		ret.data.resize( aMesh.numberOfVertices * sizeof(tVertex) );
+		ret.dequant = pack_vertices_into<tVertex>( aModel, aMesh, ret.data.data() );
+		return ret;
+	}
+
+	template< typename tVertex >
+	VertexWriter vertex_writer( ModelData const& aModel, MeshInfo const& aMesh )
+	{
+		VertexWriter ret;
+		ret.stride = std::uint32_t(sizeof(tVertex));
+		ret.count = std::uint32_t(aMesh.numberOfVertices);
+		ret.write = [&aModel, &aMesh] ( void* aDst ) {
+			return pack_vertices_into<tVertex>( aModel, aMesh, aDst );
+		};
+		return ret;
+	}
+
+	template< typename tVertex >
+	void strip_unused_attributes( ModelData& aModel )
+	{
+		if constexpr( !uses_semantic<tVertex>( Semantic::position ) )
+			aModel.vertexPositions = {};
+		if constexpr( !uses_semantic<tVertex>( Semantic::normal ) )
+			aModel.vertexNormals = {};
+		if constexpr( !uses_semantic<tVertex>( Semantic::texcoord ) )
+			aModel.vertexTextureCoords = {};
+	}
+}
@@ -0,0 +1,207 @@
+#include "vertex_weld.hpp"
+
+#include <limits>
+#include <vector>
+#include <utility>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr std::uint32_t kEmptySlot = ~std::uint32_t(0);
+
+	// Vertices are compared bit-wise, so welding is lossless. (This does
+	// mean that e.g. 0.0 and -0.0 are considered distinct.)
+	struct VertexKey_
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texcoord;
+	};
+
+	static_assert( sizeof(VertexKey_) == 8*sizeof(float) );
+
+	std::uint64_t hash_key_( VertexKey_ const& aKey ) noexcept
+	{
+		std::uint32_t words[8];
+		std::memcpy( words, &aKey, sizeof(words) );
+
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		for( auto const w : words )
+		{
+			h ^= w;
+			h *= 0x100000001b3ull;
+			h ^= h >> 29;
+		}
+
+		return h;
+	}
+
+	bool same_key_( VertexKey_ const& aA, VertexKey_ const& aB ) noexcept
+	{
+		return 0 == std::memcmp( &aA, &aB, sizeof(VertexKey_) );
+	}
+
+	// Open addressing with linear probing. The table stores the index of the
+	// welded vertex (relative to the mesh's first vertex).
+	class WeldTable_
+	{
+		public:
+			explicit WeldTable_( std::size_t aMaxEntries )
+			{
+				std::size_t capacity = 16;
+				while( capacity < aMaxEntries*2 )
+					capacity *= 2;
+
+				mSlots.assign( capacity, kEmptySlot );
+				mMask = capacity-1;
+			}
+
+			// Returns the existing entry for aKey, or inserts aNewIndex.
+			template< typename tKeyOf >
+			std::uint32_t find_or_insert( VertexKey_ const& aKey, std::uint32_t aNewIndex, tKeyOf&& aKeyOf )
+			{
+				for( auto slot = std::size_t(hash_key_( aKey )) & mMask;; slot = (slot+1) & mMask )
+				{
+					auto& entry = mSlots[slot];
+					if( kEmptySlot == entry )
+					{
+						entry = aNewIndex;
+						return aNewIndex;
+					}
+
+					if( same_key_( aKeyOf( entry ), aKey ) )
+						return entry;
+				}
+			}
+
+		private:
+			std::vector<std::uint32_t> mSlots;
+			std::size_t mMask;
+	};
+}
+
+WeldStats weld_vertices( ModelData& aModel )
+{
+	assert( aModel.vertexPositions.size() == aModel.vertexNormals.size() );
+	assert( aModel.vertexPositions.size() == aModel.vertexTextureCoords.size() );
+
+	if( !aModel.subMeshes.empty() )
+		throw lut::Error( "weld_vertices(): model '%s' is batched; weld before batching", aModel.modelName.c_str() );
+
+	WeldStats stats{};
+	stats.inputVertices = aModel.vertexPositions.size();
+
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<std::uint32_t> indices;
+
+	positions.reserve( aModel.vertexPositions.size() );
+	normals.reserve( aModel.vertexPositions.size() );
+	texcoords.reserve( aModel.vertexPositions.size() );
+
+	for( auto& mesh : aModel.meshes )
+	{
+		bool const indexed = 0 != mesh.numberOfIndices;
+		auto const corners = indexed ? mesh.numberOfIndices : mesh.numberOfVertices;
+
+		if( mesh.vertexStartIndex + mesh.numberOfVertices > aModel.vertexPositions.size() ||
+			(indexed && mesh.indexStartIndex + mesh.numberOfIndices > aModel.indices.size()) )
+		{
+			throw lut::Error( "Mesh '%s' refers to data outside of model '%s'", mesh.meshName.c_str(), aModel.modelName.c_str() );
+		}
+
+		auto const base = positions.size();
+		if( base + corners > std::numeric_limits<std::uint32_t>::max() )
+			throw lut::Error( "Model '%s' has too many vertices for 32-bit indices", aModel.modelName.c_str() );
+
+		auto const keyOf = [&] ( std::uint32_t aLocal ) {
+			return VertexKey_{ positions[base+aLocal], normals[base+aLocal], texcoords[base+aLocal] };
+		};
+
+		WeldTable_ table( corners );
+
+		auto const indexStart = indices.size();
+		for( std::size_t i = 0; i < corners; ++i )
+		{
+			std::size_t source = i;
+			if( indexed )
+			{
+				source = aModel.indices[mesh.indexStartIndex + i];
+				if( source >= mesh.numberOfVertices )
+					throw lut::Error( "Mesh '%s' has an out-of-range index", mesh.meshName.c_str() );
+			}
+
+			source += mesh.vertexStartIndex;
+
+			VertexKey_ const key{ aModel.vertexPositions[source], aModel.vertexNormals[source], aModel.vertexTextureCoords[source] };
+
+			auto const next = std::uint32_t(positions.size() - base);
+			auto const index = table.find_or_insert( key, next, keyOf );
+
+			if( index == next )
+			{
+				positions.emplace_back( key.position );
+				normals.emplace_back( key.normal );
+				texcoords.emplace_back( key.texcoord );
+			}
+
+			indices.emplace_back( index );
+		}
+
+		mesh.vertexStartIndex = base;
+		mesh.numberOfVertices = positions.size() - base;
+		mesh.indexStartIndex = indexStart;
+		mesh.numberOfIndices = indices.size() - indexStart;
+	}
+
+	positions.shrink_to_fit();
+	normals.shrink_to_fit();
+	texcoords.shrink_to_fit();
+
+	aModel.vertexPositions = std::move(positions);
+	aModel.vertexNormals = std::move(normals);
+	aModel.vertexTextureCoords = std::move(texcoords);
+	aModel.indices = std::move(indices);
+
+	stats.outputVertices = aModel.vertexPositions.size();
+	stats.indices = aModel.indices.size();
+	return stats;
+}
+
+bool mesh_uses_16bit_indices( MeshInfo const& aMesh ) noexcept
+{
+	return aMesh.numberOfVertices <= std::size_t(std::numeric_limits<std::uint16_t>::max()) + 1;
+}
+
+GeometryMemoryStats geometry_memory_stats( ModelData const& aModel, std::size_t aBytesPerVertex )
+{
+	GeometryMemoryStats stats{};
+
+	for( auto const& mesh : aModel.meshes )
+	{
+		if( 0 == mesh.numberOfIndices )
+		{
+			// Triangle soup
+			stats.soupVertices += mesh.numberOfVertices;
+			stats.indexedVertices += mesh.numberOfVertices;
+			continue;
+		}
+
+		auto const indexBytes = mesh_uses_16bit_indices( mesh ) ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+
+		stats.soupVertices += mesh.numberOfIndices;
+		stats.indexedVertices += mesh.numberOfVertices;
+		stats.indices += mesh.numberOfIndices;
+		stats.indexedBytes += mesh.numberOfIndices * indexBytes;
+	}
+
+	stats.soupBytes = stats.soupVertices * aBytesPerVertex;
+	stats.indexedBytes += stats.indexedVertices * aBytesPerVertex;
+	return stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+#include "model.hpp"
+
+/* Vertex welding.
+ *
+ * load_obj_model() produces a triangle soup: every triangle corner is its own
+ * vertex, so a vertex shared by six triangles is stored (and shaded) six
+ * times. weld_vertices() merges corners with bit-identical position, normal
+ * and texture coordinate into a single vertex and builds an index list for
+ * each mesh.
+ *
+ * Welding happens per mesh, such that each mesh keeps a contiguous vertex
+ * range. The indices of a mesh are relative to its first vertex, which lets
+ * meshes with at most 64k vertices use 16-bit indices.
+ */
+
+struct WeldStats
+{
+	std::size_t inputVertices = 0;
+	std::size_t outputVertices = 0;
+	std::size_t indices = 0;
+};
+
+// Welds the vertices of all meshes in aModel. The model may be a triangle
+// soup or already indexed; in the latter case, the existing indices are
+// followed and duplicates are merged. Vertices that are not referenced by
+// any mesh are dropped.
+WeldStats weld_vertices( ModelData& aModel );
+
+// Index type used for a mesh; true if all indices fit into 16 bits.
+bool mesh_uses_16bit_indices( MeshInfo const& aMesh ) noexcept;
+
+// GPU memory used by the geometry of aModel, as a triangle soup and as
+// indexed geometry. aBytesPerVertex is the size of the vertex attributes
+// that are actually uploaded.
+struct GeometryMemoryStats
+{
+	std::size_t soupVertices = 0;
+	std::size_t indexedVertices = 0;
+	std::size_t indices = 0;
+
+	std::size_t soupBytes = 0;
+	std::size_t indexedBytes = 0;
+};
+
+GeometryMemoryStats geometry_memory_stats( ModelData const& aModel, std::size_t aBytesPerVertex );
@@ -0,0 +1,193 @@
+#include "bindless_textures.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "to_string.hpp"
+
+namespace labutils
+{
+	BindlessTextures::BindlessTextures( VulkanContext const& aContext, std::uint32_t aCapacity, std::uint32_t aFrameSlots )
+		: mContext( &aContext )
+	{
+		assert( aContext.descriptorIndexing );
+		assert( aFrameSlots > 0 );
+
+		// Update-after-bind bindings have their own (usually larger) limits
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProps{};
+		indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &indexingProps;
+
+		vkGetPhysicalDeviceProperties2( aContext.physicalDevice, &props );
+
+		mCapacity = std::min( {
+			aCapacity,
+			indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+			indexingProps.maxDescriptorSetUpdateAfterBindSamplers
+		} );
+
+		if( 0 == mCapacity )
+			throw Error( "Bindless textures: device supports no update-after-bind sampled images" );
+
+		// Layout
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = mCapacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorBindingFlags const bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		flagsInfo.bindingCount = 1;
+		flagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+			throw Error( "Unable to create bindless descriptor set layout\nvkCreateDescriptorSetLayout() returned %s", to_string(res).c_str() );
+
+		mLayout = DescriptorSetLayout( aContext.device, layout );
+
+		// Pool; sets from update-after-bind layouts need a pool of their own
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = mCapacity * aFrameSlots;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = aFrameSlots;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		if( auto const res = vkCreateDescriptorPool( aContext.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+			throw Error( "Unable to create bindless descriptor pool\nvkCreateDescriptorPool() returned %s", to_string(res).c_str() );
+
+		mPool = DescriptorPool( aContext.device, pool );
+
+		// Sets
+		std::vector<VkDescriptorSetLayout> const layouts( aFrameSlots, mLayout.handle );
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = mPool.handle;
+		allocInfo.descriptorSetCount = aFrameSlots;
+		allocInfo.pSetLayouts = layouts.data();
+
+		mSets.resize( aFrameSlots );
+		if( auto const res = vkAllocateDescriptorSets( aContext.device, &allocInfo, mSets.data() ); VK_SUCCESS != res )
+			throw Error( "Unable to allocate bindless descriptor sets\nvkAllocateDescriptorSets() returned %s", to_string(res).c_str() );
+
+		mSlotVersions.resize( aFrameSlots );
+	}
+
+	std::uint32_t BindlessTextures::add( VkImageView aView, VkSampler aSampler )
+	{
+		assert( VK_NULL_HANDLE != aView && VK_NULL_HANDLE != aSampler );
+
+		auto const key = std::make_pair( aView, aSampler );
+		if( auto const it = mIndices.find( key ); mIndices.end() != it )
+			return it->second;
+
+		if( mEntries.size() >= mCapacity )
+			throw Error( "Bindless texture table is full (%u textures)", mCapacity );
+
+		auto const index = std::uint32_t(mEntries.size());
+		mEntries.emplace_back( Entry_{ aView, aSampler } );
+		mIndices.emplace( key, index );
+
+		return index;
+	}
+
+	void BindlessTextures::update( std::uint32_t aIndex, VkImageView aView )
+	{
+		assert( aIndex < mEntries.size() );
+		auto& entry = mEntries[aIndex];
+
+		// The old view may be destroyed, and its handle reused, once the
+		// slots have moved past it
+		mIndices.erase( std::make_pair( entry.view, entry.sampler ) );
+
+		entry.view = aView;
+		++entry.version;
+
+		mIndices.emplace( std::make_pair( entry.view, entry.sampler ), aIndex );
+	}
+
+	void BindlessTextures::begin_frame( std::uint32_t aSlot )
+	{
+		assert( aSlot < mSets.size() );
+		auto& versions = mSlotVersions[aSlot];
+		versions.resize( mEntries.size(), 0 );
+
+		std::vector<VkDescriptorImageInfo> imageInfos;
+		std::vector<VkWriteDescriptorSet> writes;
+		imageInfos.reserve( mEntries.size() );
+
+		for( std::size_t i = 0; i < mEntries.size(); ++i )
+		{
+			auto const& entry = mEntries[i];
+			if( versions[i] == entry.version )
+				continue;
+
+			auto& imageInfo = imageInfos.emplace_back();
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = entry.view;
+			imageInfo.sampler = entry.sampler;
+
+			auto& desc = writes.emplace_back();
+			desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc.dstSet = mSets[aSlot];
+			desc.dstBinding = 0;
+			desc.dstArrayElement = std::uint32_t(i);
+			desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			desc.descriptorCount = 1;
+			desc.pImageInfo = &imageInfo;
+
+			versions[i] = entry.version;
+		}
+
+		if( !writes.empty() )
+			vkUpdateDescriptorSets( mContext->device, std::uint32_t(writes.size()), writes.data(), 0, nullptr );
+	}
+
+	VkDescriptorSetLayout BindlessTextures::layout() const noexcept
+	{
+		return mLayout.handle;
+	}
+
+	VkDescriptorSet BindlessTextures::set( std::uint32_t aSlot ) const noexcept
+	{
+		assert( aSlot < mSets.size() );
+		return mSets[aSlot];
+	}
+
+	std::uint32_t BindlessTextures::size() const noexcept
+	{
+		return std::uint32_t(mEntries.size());
+	}
+
+	std::uint32_t BindlessTextures::capacity() const noexcept
+	{
+		return mCapacity;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
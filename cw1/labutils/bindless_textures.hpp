@@ -0,0 +1,88 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	/* Bindless texture table.
+	 *
+	 * All material textures live in one array of combined image samplers, at
+	 * binding 0 of layout(); shaders index it with a texture's index from
+	 * add(), e.g. taken from the material constants. The set is bound once
+	 * per frame, instead of one set per material and draw.
+	 *
+	 * The binding is partially bound and update-after-bind, so that entries
+	 * beyond size() need not be valid, and entries can change while the set
+	 * is bound by command buffers that are not yet recorded. There is one set
+	 * per frame slot: update() only reaches a slot's set with its next
+	 * begin_frame(), once the slot's previous frame has completed, such that
+	 * the replaced view can be destroyed once every slot has moved past it
+	 * (as TextureStreamer does).
+	 *
+	 * Requires VulkanContext::descriptorIndexing. Not thread-safe.
+	 */
+	constexpr std::uint32_t kNoBindlessTexture = ~std::uint32_t(0);
+
+	class BindlessTextures
+	{
+		public:
+			// aCapacity is clamped to the device's limits for update-after-bind
+			// sampled images
+			BindlessTextures( VulkanContext const&, std::uint32_t aCapacity, std::uint32_t aFrameSlots );
+
+			BindlessTextures( BindlessTextures const& ) = delete;
+			BindlessTextures& operator= (BindlessTextures const&) = delete;
+
+		public:
+			// Returns the index of (aView, aSampler), adding it if it is new.
+			// The view and the sampler must stay alive while the index is in
+			// use.
+			std::uint32_t add( VkImageView, VkSampler );
+
+			// Replaces the view of an existing entry
+			void update( std::uint32_t aIndex, VkImageView );
+
+			// Writes the entries that changed since the slot's last frame to
+			// its set. Call once the slot's previous frame has completed, and
+			// before recording the next one for it.
+			void begin_frame( std::uint32_t aSlot );
+
+			VkDescriptorSetLayout layout() const noexcept;
+			VkDescriptorSet set( std::uint32_t aSlot ) const noexcept;
+
+			std::uint32_t size() const noexcept;
+			std::uint32_t capacity() const noexcept;
+
+		private:
+			struct Entry_
+			{
+				VkImageView view;
+				VkSampler sampler;
+				std::uint32_t version = 1; // increases with each update
+			};
+
+			VulkanContext const* mContext;
+			std::uint32_t mCapacity;
+
+			DescriptorSetLayout mLayout;
+			DescriptorPool mPool;
+
+			std::vector<VkDescriptorSet> mSets; // per slot
+			std::vector<std::vector<std::uint32_t>> mSlotVersions; // per slot and entry; 0: not written yet
+
+			std::vector<Entry_> mEntries;
+			std::map<std::pair<VkImageView,VkSampler>, std::uint32_t> mIndices;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
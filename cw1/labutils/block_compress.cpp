@@ -0,0 +1,731 @@
+#include "block_compress.hpp"
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <utility>
+#include <optional>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define LUT_BC_SSE2_ 1
+#	define LUT_BC_AVX2_ 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define LUT_BC_SSE2_ 1
+#endif
+
+#include "error.hpp"
+#include "image_decode.hpp"
+#include "thread_pool.hpp"
+
+namespace lut = labutils;
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+	using Msecs_ = std::chrono::duration<double, std::milli>;
+
+	constexpr std::size_t kBlockTexels = 16;
+
+	// Texels of a 4x4 block in row-major order, one array per channel
+	// (values 0-255)
+	struct Block_
+	{
+		alignas(32) float c[4][kBlockTexels];
+	};
+
+	void load_block_( Block_& aBlock, lut::DecodedLevel const& aLevel, std::uint32_t aBlockX, std::uint32_t aBlockY )
+	{
+		for( std::uint32_t y = 0; y < 4; ++y )
+		{
+			auto const sy = std::min( aBlockY*4 + y, aLevel.height-1 );
+			for( std::uint32_t x = 0; x < 4; ++x )
+			{
+				auto const sx = std::min( aBlockX*4 + x, aLevel.width-1 );
+				auto const* texel = aLevel.pixels.get() + (std::size_t(sy) * aLevel.width + sx) * 4;
+
+				for( std::size_t c = 0; c < 4; ++c )
+					aBlock.c[c][y*4 + x] = texel[c];
+			}
+		}
+	}
+
+	// aT[i] = sum_c (texel_i[c] - aOrigin[c]) * aAxis[c], over the first
+	// aChannels channels
+	void project_( float* aT, Block_ const& aBlock, float const* aOrigin, float const* aAxis, std::size_t aChannels )
+	{
+#		if defined(LUT_BC_AVX2_)
+		for( std::size_t i = 0; i < kBlockTexels; i += 8 )
+		{
+			__m256 acc = _mm256_setzero_ps();
+			for( std::size_t c = 0; c < aChannels; ++c )
+			{
+				__m256 const d = _mm256_sub_ps( _mm256_load_ps( aBlock.c[c] + i ), _mm256_set1_ps( aOrigin[c] ) );
+				acc = _mm256_add_ps( acc, _mm256_mul_ps( d, _mm256_set1_ps( aAxis[c] ) ) );
+			}
+
+			_mm256_storeu_ps( aT + i, acc );
+		}
+#		elif defined(LUT_BC_SSE2_)
+		for( std::size_t i = 0; i < kBlockTexels; i += 4 )
+		{
+			__m128 acc = _mm_setzero_ps();
+			for( std::size_t c = 0; c < aChannels; ++c )
+			{
+				__m128 const d = _mm_sub_ps( _mm_load_ps( aBlock.c[c] + i ), _mm_set1_ps( aOrigin[c] ) );
+				acc = _mm_add_ps( acc, _mm_mul_ps( d, _mm_set1_ps( aAxis[c] ) ) );
+			}
+
+			_mm_storeu_ps( aT + i, acc );
+		}
+#		else // scalar
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			float acc = 0.f;
+			for( std::size_t c = 0; c < aChannels; ++c )
+				acc += (aBlock.c[c][i] - aOrigin[c]) * aAxis[c];
+
+			aT[i] = acc;
+		}
+#		endif // ~ SIMD
+	}
+
+	// Mean and (unit length) principal axis of the block's texels
+	void principal_axis_( float* aMean, float* aAxis, Block_ const& aBlock, std::size_t aChannels )
+	{
+		for( std::size_t c = 0; c < aChannels; ++c )
+		{
+			float sum = 0.f;
+			for( std::size_t i = 0; i < kBlockTexels; ++i )
+				sum += aBlock.c[c][i];
+
+			aMean[c] = sum / kBlockTexels;
+		}
+
+		float cov[4][4] = {};
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			for( std::size_t c = 0; c < aChannels; ++c )
+			{
+				for( std::size_t d = c; d < aChannels; ++d )
+					cov[c][d] += (aBlock.c[c][i] - aMean[c]) * (aBlock.c[d][i] - aMean[d]);
+			}
+		}
+
+		std::size_t largest = 0;
+		for( std::size_t c = 0; c < aChannels; ++c )
+		{
+			for( std::size_t d = 0; d < c; ++d )
+				cov[c][d] = cov[d][c];
+
+			if( cov[c][c] > cov[largest][largest] )
+				largest = c;
+		}
+
+		// Power iteration, starting from the covariance's column with the
+		// largest variance (which is never orthogonal to the principal axis,
+		// unless the block has a single color)
+		float axis[4] = {};
+		for( std::size_t c = 0; c < aChannels; ++c )
+			axis[c] = cov[c][largest];
+
+		for( int iteration = 0; iteration < 8; ++iteration )
+		{
+			float next[4] = {}, scale = 0.f;
+			for( std::size_t c = 0; c < aChannels; ++c )
+			{
+				for( std::size_t d = 0; d < aChannels; ++d )
+					next[c] += cov[c][d] * axis[d];
+
+				scale = std::max( scale, std::abs( next[c] ) );
+			}
+
+			if( scale < 1e-6f )
+				break;
+
+			for( std::size_t c = 0; c < aChannels; ++c )
+				axis[c] = next[c] / scale;
+		}
+
+		float length = 0.f;
+		for( std::size_t c = 0; c < aChannels; ++c )
+			length += axis[c] * axis[c];
+
+		length = std::sqrt( length );
+		for( std::size_t c = 0; c < aChannels; ++c )
+			aAxis[c] = length > 1e-6f ? axis[c] / length : 0.f;
+	}
+
+	// Endpoints at the extremes of the block's projection onto its principal
+	// axis
+	void initial_endpoints_( float* aE0, float* aE1, Block_ const& aBlock, std::size_t aChannels )
+	{
+		float mean[4], axis[4];
+		principal_axis_( mean, axis, aBlock, aChannels );
+
+		alignas(32) float t[kBlockTexels];
+		project_( t, aBlock, mean, axis, aChannels );
+
+		auto const [lo, hi] = std::minmax_element( t, t + kBlockTexels );
+		for( std::size_t c = 0; c < aChannels; ++c )
+		{
+			aE0[c] = std::clamp( mean[c] + *lo * axis[c], 0.f, 255.f );
+			aE1[c] = std::clamp( mean[c] + *hi * axis[c], 0.f, 255.f );
+		}
+	}
+
+	// Positions of the texels along the segment aE0-aE1, clamped to [0,1]
+	void segment_positions_( float* aT, Block_ const& aBlock, float const* aE0, float const* aE1, std::size_t aChannels )
+	{
+		float axis[4];
+		float lengthSq = 0.f;
+		for( std::size_t c = 0; c < aChannels; ++c )
+		{
+			axis[c] = aE1[c] - aE0[c];
+			lengthSq += axis[c] * axis[c];
+		}
+
+		if( lengthSq < 1e-6f )
+		{
+			std::fill_n( aT, kBlockTexels, 0.f );
+			return;
+		}
+
+		for( std::size_t c = 0; c < aChannels; ++c )
+			axis[c] /= lengthSq;
+
+		project_( aT, aBlock, aE0, axis, aChannels );
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+			aT[i] = std::clamp( aT[i], 0.f, 1.f );
+	}
+
+	// Least-squares endpoints for texels interpolated with aWeights (0 =
+	// aE0, 1 = aE1). Returns false if the weights do not determine both.
+	bool fit_endpoints_( float* aE0, float* aE1, Block_ const& aBlock, float const* aWeights, std::size_t aChannels )
+	{
+		float aa = 0.f, bb = 0.f, ab = 0.f;
+		float ax[4] = {}, bx[4] = {};
+
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			float const b = aWeights[i], a = 1.f - b;
+			aa += a*a;
+			bb += b*b;
+			ab += a*b;
+
+			for( std::size_t c = 0; c < aChannels; ++c )
+			{
+				ax[c] += a * aBlock.c[c][i];
+				bx[c] += b * aBlock.c[c][i];
+			}
+		}
+
+		float const det = aa*bb - ab*ab;
+		if( std::abs( det ) < 1e-6f )
+			return false;
+
+		for( std::size_t c = 0; c < aChannels; ++c )
+		{
+			aE0[c] = std::clamp( (ax[c]*bb - bx[c]*ab) / det, 0.f, 255.f );
+			aE1[c] = std::clamp( (bx[c]*aa - ax[c]*ab) / det, 0.f, 255.f );
+		}
+
+		return true;
+	}
+
+
+	// BC1
+	std::uint16_t to_565_( float const* aColor )
+	{
+		auto const quantize = [] ( float aValue, float aMax ) {
+			return std::uint16_t(std::clamp( std::lround( aValue * aMax / 255.f ), 0l, long(aMax) ));
+		};
+
+		return std::uint16_t(quantize( aColor[0], 31.f ) << 11 | quantize( aColor[1], 63.f ) << 5 | quantize( aColor[2], 31.f ));
+	}
+
+	void from_565_( std::uint32_t* aColor, std::uint16_t aPacked )
+	{
+		std::uint32_t const r = (aPacked >> 11) & 31, g = (aPacked >> 5) & 63, b = aPacked & 31;
+		aColor[0] = (r << 3) | (r >> 2);
+		aColor[1] = (g << 2) | (g >> 4);
+		aColor[2] = (b << 3) | (b >> 2);
+	}
+
+	// Four-color palette of aC0 > aC1 (or the three-color palette and
+	// transparent black otherwise)
+	void bc1_palette_( std::uint32_t (*aPalette)[4], std::uint16_t aC0, std::uint16_t aC1 )
+	{
+		from_565_( aPalette[0], aC0 );
+		from_565_( aPalette[1], aC1 );
+		aPalette[0][3] = aPalette[1][3] = 255;
+
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			if( aC0 > aC1 )
+			{
+				aPalette[2][c] = (2*aPalette[0][c] + aPalette[1][c]) / 3;
+				aPalette[3][c] = (aPalette[0][c] + 2*aPalette[1][c]) / 3;
+			}
+			else
+			{
+				aPalette[2][c] = (aPalette[0][c] + aPalette[1][c]) / 2;
+				aPalette[3][c] = 0;
+			}
+		}
+
+		aPalette[2][3] = 255;
+		aPalette[3][3] = aC0 > aC1 ? 255 : 0;
+	}
+
+	// Indices (order c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1) for the
+	// quantized endpoints; returns the squared RGB error
+	float bc1_indices_( std::uint8_t* aIndices, Block_ const& aBlock, std::uint16_t aC0, std::uint16_t aC1 )
+	{
+		std::uint32_t palette[4][4];
+		bc1_palette_( palette, std::max( aC0, aC1 ), std::min( aC0, aC1 ) );
+
+		if( aC0 < aC1 )
+		{
+			std::swap( palette[0], palette[1] );
+			std::swap( palette[2], palette[3] );
+		}
+
+		float e0[3], e1[3];
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			e0[c] = float(palette[0][c]);
+			e1[c] = float(palette[1][c]);
+		}
+
+		alignas(32) float t[kBlockTexels];
+		segment_positions_( t, aBlock, e0, e1, 3 );
+
+		static constexpr std::uint8_t kRemap[4] = { 0, 2, 3, 1 };
+
+		float error = 0.f;
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			aIndices[i] = aC0 == aC1 ? 0 : kRemap[int(t[i] * 3.f + 0.5f)];
+			for( std::size_t c = 0; c < 3; ++c )
+			{
+				float const d = aBlock.c[c][i] - float(palette[aIndices[i]][c]);
+				error += d*d;
+			}
+		}
+
+		return error;
+	}
+
+	void encode_bc1_( std::uint8_t* aOut, Block_ const& aBlock )
+	{
+		static constexpr float kWeights[4] = { 0.f, 1.f, 1.f/3.f, 2.f/3.f };
+
+		float e0[4], e1[4];
+		initial_endpoints_( e0, e1, aBlock, 3 );
+
+		std::uint16_t c0 = to_565_( e0 ), c1 = to_565_( e1 );
+		std::uint8_t indices[kBlockTexels];
+		float error = bc1_indices_( indices, aBlock, c0, c1 );
+
+		// Refine
+		float weights[kBlockTexels];
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+			weights[i] = kWeights[indices[i]];
+
+		if( fit_endpoints_( e0, e1, aBlock, weights, 3 ) )
+		{
+			std::uint16_t const r0 = to_565_( e0 ), r1 = to_565_( e1 );
+			std::uint8_t refined[kBlockTexels];
+
+			if( float const refinedError = bc1_indices_( refined, aBlock, r0, r1 ); refinedError < error )
+			{
+				c0 = r0;
+				c1 = r1;
+				std::copy_n( refined, kBlockTexels, indices );
+			}
+		}
+
+		// Four-color mode requires c0 > c1; swapping the endpoints swaps
+		// indices 0,1 and 2,3. Equal endpoints use index 0 throughout.
+		if( c0 < c1 )
+		{
+			std::swap( c0, c1 );
+			for( auto& index : indices )
+				index ^= 1;
+		}
+
+		std::uint32_t bits = 0;
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+			bits |= std::uint32_t(indices[i]) << (2*i);
+
+		aOut[0] = std::uint8_t(c0);
+		aOut[1] = std::uint8_t(c0 >> 8);
+		aOut[2] = std::uint8_t(c1);
+		aOut[3] = std::uint8_t(c1 >> 8);
+		for( std::size_t i = 0; i < 4; ++i )
+			aOut[4+i] = std::uint8_t(bits >> (8*i));
+	}
+
+	void decode_bc1_( std::uint8_t (*aTexels)[4], std::uint8_t const* aBlock )
+	{
+		auto const c0 = std::uint16_t(aBlock[0] | aBlock[1] << 8);
+		auto const c1 = std::uint16_t(aBlock[2] | aBlock[3] << 8);
+
+		std::uint32_t palette[4][4];
+		bc1_palette_( palette, c0, c1 );
+
+		auto const bits = std::uint32_t(aBlock[4] | aBlock[5] << 8 | aBlock[6] << 16 | std::uint32_t(aBlock[7]) << 24);
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			for( std::size_t c = 0; c < 4; ++c )
+				aTexels[i][c] = std::uint8_t(palette[(bits >> (2*i)) & 3][c]);
+		}
+	}
+
+
+	// BC7 (mode 6)
+	constexpr std::uint32_t kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	class Bc7Bits_
+	{
+		public:
+			explicit Bc7Bits_( std::uint8_t* aBytes ) noexcept
+				: mBytes( aBytes )
+			{}
+
+			void put( std::uint32_t aValue, std::uint32_t aBits ) noexcept
+			{
+				for( std::uint32_t i = 0; i < aBits; ++i, ++mPosition )
+				{
+					if( (aValue >> i) & 1 )
+						mBytes[mPosition >> 3] |= std::uint8_t(1u << (mPosition & 7));
+				}
+			}
+
+			std::uint32_t get( std::uint32_t aBits ) noexcept
+			{
+				std::uint32_t ret = 0;
+				for( std::uint32_t i = 0; i < aBits; ++i, ++mPosition )
+					ret |= std::uint32_t((mBytes[mPosition >> 3] >> (mPosition & 7)) & 1) << i;
+
+				return ret;
+			}
+
+		private:
+			std::uint8_t* mBytes;
+			std::uint32_t mPosition = 0;
+	};
+
+	struct Bc7Endpoint_
+	{
+		std::uint32_t q[4]; // 7 bits per channel
+		std::uint32_t p;    // p-bit
+
+		std::uint32_t value( std::size_t aChannel ) const noexcept
+		{
+			return (q[aChannel] << 1) | p;
+		}
+	};
+
+	Bc7Endpoint_ bc7_quantize_( float const* aColor )
+	{
+		Bc7Endpoint_ best{};
+		float bestError = std::numeric_limits<float>::max();
+
+		for( std::uint32_t p = 0; p < 2; ++p )
+		{
+			Bc7Endpoint_ candidate{};
+			candidate.p = p;
+
+			float error = 0.f;
+			for( std::size_t c = 0; c < 4; ++c )
+			{
+				candidate.q[c] = std::uint32_t(std::clamp( std::lround( (aColor[c] - p) * 0.5f ), 0l, 127l ));
+
+				float const d = float(candidate.value( c )) - aColor[c];
+				error += d*d;
+			}
+
+			if( error < bestError )
+			{
+				best = candidate;
+				bestError = error;
+			}
+		}
+
+		return best;
+	}
+
+	std::uint32_t bc7_interpolate_( std::uint32_t aE0, std::uint32_t aE1, std::uint32_t aIndex ) noexcept
+	{
+		return ((64 - kBc7Weights[aIndex]) * aE0 + kBc7Weights[aIndex] * aE1 + 32) >> 6;
+	}
+
+	// Indices for the quantized endpoints; returns the squared RGBA error
+	float bc7_indices_( std::uint8_t* aIndices, Block_ const& aBlock, Bc7Endpoint_ const& aE0, Bc7Endpoint_ const& aE1 )
+	{
+		// Nearest index for each position along the segment, in 1/64 steps
+		static std::array<std::uint8_t, 65> const nearest = [] {
+			std::array<std::uint8_t, 65> ret{};
+			for( std::uint32_t v = 0; v <= 64; ++v )
+			{
+				std::uint32_t best = 0;
+				for( std::uint32_t i = 1; i < 16; ++i )
+				{
+					auto const d = [v] ( std::uint32_t aW ) { return aW > v ? aW - v : v - aW; };
+					if( d( kBc7Weights[i] ) < d( kBc7Weights[best] ) )
+						best = i;
+				}
+
+				ret[v] = std::uint8_t(best);
+			}
+			return ret;
+		}();
+
+		float e0[4], e1[4];
+		for( std::size_t c = 0; c < 4; ++c )
+		{
+			e0[c] = float(aE0.value( c ));
+			e1[c] = float(aE1.value( c ));
+		}
+
+		alignas(32) float t[kBlockTexels];
+		segment_positions_( t, aBlock, e0, e1, 4 );
+
+		float error = 0.f;
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			aIndices[i] = nearest[std::size_t(t[i] * 64.f + 0.5f)];
+			for( std::size_t c = 0; c < 4; ++c )
+			{
+				float const d = aBlock.c[c][i] - float(bc7_interpolate_( aE0.value( c ), aE1.value( c ), aIndices[i] ));
+				error += d*d;
+			}
+		}
+
+		return error;
+	}
+
+	void encode_bc7_( std::uint8_t* aOut, Block_ const& aBlock )
+	{
+		float e0[4], e1[4];
+		initial_endpoints_( e0, e1, aBlock, 4 );
+
+		auto q0 = bc7_quantize_( e0 ), q1 = bc7_quantize_( e1 );
+		std::uint8_t indices[kBlockTexels];
+		float error = bc7_indices_( indices, aBlock, q0, q1 );
+
+		// Refine
+		float weights[kBlockTexels];
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+			weights[i] = kBc7Weights[indices[i]] / 64.f;
+
+		if( fit_endpoints_( e0, e1, aBlock, weights, 4 ) )
+		{
+			auto const r0 = bc7_quantize_( e0 ), r1 = bc7_quantize_( e1 );
+			std::uint8_t refined[kBlockTexels];
+
+			if( float const refinedError = bc7_indices_( refined, aBlock, r0, r1 ); refinedError < error )
+			{
+				q0 = r0;
+				q1 = r1;
+				std::copy_n( refined, kBlockTexels, indices );
+			}
+		}
+
+		// The first index is stored without its top bit, which must be zero
+		if( indices[0] & 8 )
+		{
+			std::swap( q0, q1 );
+			for( auto& index : indices )
+				index = std::uint8_t(15 - index);
+		}
+
+		std::fill_n( aOut, 16, std::uint8_t(0) );
+		Bc7Bits_ bits( aOut );
+
+		bits.put( 1u << 6, 7 ); // mode 6
+		for( std::size_t c = 0; c < 4; ++c )
+		{
+			bits.put( q0.q[c], 7 );
+			bits.put( q1.q[c], 7 );
+		}
+
+		bits.put( q0.p, 1 );
+		bits.put( q1.p, 1 );
+
+		bits.put( indices[0], 3 );
+		for( std::size_t i = 1; i < kBlockTexels; ++i )
+			bits.put( indices[i], 4 );
+	}
+
+	// Only decodes mode 6 (as written by encode_bc7_())
+	void decode_bc7_( std::uint8_t (*aTexels)[4], std::uint8_t const* aBlock )
+	{
+		std::uint8_t bytes[16];
+		std::copy_n( aBlock, 16, bytes );
+		Bc7Bits_ bits( bytes );
+
+		if( (1u << 6) != bits.get( 7 ) )
+			throw lut::Error( "decode_bc7_(): only mode 6 blocks are supported" );
+
+		Bc7Endpoint_ e0{}, e1{};
+		for( std::size_t c = 0; c < 4; ++c )
+		{
+			e0.q[c] = bits.get( 7 );
+			e1.q[c] = bits.get( 7 );
+		}
+
+		e0.p = bits.get( 1 );
+		e1.p = bits.get( 1 );
+
+		for( std::size_t i = 0; i < kBlockTexels; ++i )
+		{
+			auto const index = bits.get( 0 == i ? 3 : 4 );
+			for( std::size_t c = 0; c < 4; ++c )
+				aTexels[i][c] = std::uint8_t(bc7_interpolate_( e0.value( c ), e1.value( c ), index ));
+		}
+	}
+}
+
+namespace labutils
+{
+	std::size_t block_bytes( BlockFormat aFormat ) noexcept
+	{
+		return BlockFormat::bc1 == aFormat ? 8 : 16;
+	}
+
+	VkFormat block_format_srgb( BlockFormat aFormat ) noexcept
+	{
+		return BlockFormat::bc1 == aFormat ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+
+	bool is_opaque( DecodedImage const& aImage ) noexcept
+	{
+		for( auto const& level : aImage.levels )
+		{
+			for( std::size_t i = 3; i < level.size_bytes(); i += 4 )
+			{
+				if( 255 != level.pixels[i] )
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	CompressedImage compress_image( DecodedImage const& aImage, BlockFormat aFormat, ThreadPool* aPool )
+	{
+		auto const start = Clock_::now();
+
+		std::optional<ThreadPool> localPool;
+		if( !aPool )
+			aPool = &localPool.emplace();
+
+		CompressedImage ret;
+		ret.format = aFormat;
+		ret.levels.resize( aImage.levels.size() );
+
+		auto const blockSize = block_bytes( aFormat );
+
+		// Rows of blocks of all levels, so that the small levels are spread
+		// over the threads as well
+		std::vector<std::pair<std::size_t, std::uint32_t>> rows;
+		for( std::size_t i = 0; i < aImage.levels.size(); ++i )
+		{
+			auto const& source = aImage.levels[i];
+			auto& level = ret.levels[i];
+
+			level.width = source.width;
+			level.height = source.height;
+
+			auto const blocksX = (source.width + 3) / 4, blocksY = (source.height + 3) / 4;
+			level.blocks.resize( std::size_t(blocksX) * blocksY * blockSize );
+
+			for( std::uint32_t y = 0; y < blocksY; ++y )
+				rows.emplace_back( i, y );
+		}
+
+		aPool->parallel_for( rows.size(), [&] ( std::size_t aIndex ) {
+			auto const [levelIndex, y] = rows[aIndex];
+			auto const& source = aImage.levels[levelIndex];
+			auto& level = ret.levels[levelIndex];
+
+			auto const blocksX = (source.width + 3) / 4;
+			auto* out = level.blocks.data() + std::size_t(y) * blocksX * blockSize;
+
+			Block_ block;
+			for( std::uint32_t x = 0; x < blocksX; ++x, out += blockSize )
+			{
+				load_block_( block, source, x, y );
+
+				if( BlockFormat::bc1 == aFormat )
+					encode_bc1_( out, block );
+				else
+					encode_bc7_( out, block );
+			}
+		} );
+
+		ret.encodeMilliseconds = Msecs_( Clock_::now() - start ).count();
+		return ret;
+	}
+
+	double compression_psnr( DecodedImage const& aReference, CompressedImage const& aImage )
+	{
+		assert( aReference.levels.size() == aImage.levels.size() );
+
+		auto const blockSize = block_bytes( aImage.format );
+
+		double squaredError = 0.0;
+		std::size_t samples = 0;
+
+		for( std::size_t i = 0; i < aImage.levels.size(); ++i )
+		{
+			auto const& reference = aReference.levels[i];
+			auto const& level = aImage.levels[i];
+
+			auto const blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+			for( std::uint32_t by = 0; by < blocksY; ++by )
+			{
+				for( std::uint32_t bx = 0; bx < blocksX; ++bx )
+				{
+					auto const* block = level.blocks.data() + (std::size_t(by) * blocksX + bx) * blockSize;
+
+					std::uint8_t texels[kBlockTexels][4];
+					if( BlockFormat::bc1 == aImage.format )
+						decode_bc1_( texels, block );
+					else
+						decode_bc7_( texels, block );
+
+					for( std::uint32_t y = 0; y < 4 && by*4 + y < level.height; ++y )
+					{
+						for( std::uint32_t x = 0; x < 4 && bx*4 + x < level.width; ++x )
+						{
+							auto const* expected = reference.pixels.get() + (std::size_t(by*4 + y) * level.width + bx*4 + x) * 4;
+							for( std::size_t c = 0; c < 3; ++c )
+							{
+								double const d = double(texels[y*4 + x][c]) - expected[c];
+								squaredError += d*d;
+							}
+
+							samples += 3;
+						}
+					}
+				}
+			}
+		}
+
+		if( 0.0 == squaredError )
+			return std::numeric_limits<double>::infinity();
+
+		return 10.0 * std::log10( 255.0 * 255.0 * samples / squaredError );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	class ThreadPool;
+	struct DecodedImage;
+
+	/* Block compression of color textures.
+	 *
+	 * compress_image() encodes every level of a decoded image (see
+	 * generate_mipmaps() for the chain) into 4x4 texel blocks:
+	 *  - BC1: RGB at 4 bits per texel (8x smaller than RGBA8). For opaque
+	 *    images only; the block's alpha is ignored.
+	 *  - BC7: RGBA at 8 bits per texel (4x smaller). Only mode 6 (one subset,
+	 *    7777 endpoints with p-bits and 4-bit indices) is written. This gives
+	 *    up some quality against a full BC7 mode search but encodes quickly,
+	 *    and it is still considerably better than BC1.
+	 *
+	 * Endpoints are found along the principal axis of the block's colors,
+	 * and then refined once by least squares for the chosen indices. Indices
+	 * are found by projecting the texels onto the endpoint segment; the
+	 * projection has SSE2 and AVX2 kernels. Blocks are encoded in their sRGB
+	 * values, as is usual for the _SRGB block formats. Blocks at the edges
+	 * of levels that are not a multiple of 4 replicate the edge texels.
+	 *
+	 * Rows of blocks (of all levels) are encoded in parallel on aPool (or on
+	 * a temporary pool with one thread per core if aPool is null).
+	 */
+	enum class BlockFormat
+	{
+		bc1,
+		bc7
+	};
+
+	struct CompressedLevel
+	{
+		std::uint32_t width = 0, height = 0; // in texels
+		std::vector<std::uint8_t> blocks;
+	};
+
+	struct CompressedImage
+	{
+		BlockFormat format = BlockFormat::bc1;
+		std::vector<CompressedLevel> levels;
+
+		double encodeMilliseconds = 0.0;
+	};
+
+	std::size_t block_bytes( BlockFormat ) noexcept;
+	VkFormat block_format_srgb( BlockFormat ) noexcept;
+
+	// True if all texels of all levels have alpha 255
+	bool is_opaque( DecodedImage const& ) noexcept;
+
+	CompressedImage compress_image( DecodedImage const&, BlockFormat, ThreadPool* aPool = nullptr );
+
+	// Peak signal-to-noise ratio (in dB) of the RGB channels of all levels,
+	// against the image that was compressed. Infinite for a lossless result.
+	double compression_psnr( DecodedImage const& aReference, CompressedImage const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,202 @@
+#include "image_decode.hpp"
+
+#include <chrono>
+#include <optional>
+#include <algorithm>
+
+#include <cstdio>
+#include <cassert>
+
+#include <stb_image.h>
+
+#include "error.hpp"
+#include "vkimage.hpp"
+#include "thread_pool.hpp"
+
+namespace lut = labutils;
+
+namespace
+{
+	using Clock_ = std::chrono::steady_clock;
+	using Msecs_ = std::chrono::duration<double, std::milli>;
+
+	struct ImageInfo_
+	{
+		std::uint32_t width, height;
+		std::uint32_t levels;
+	};
+
+	std::string level_name_( char const* aPattern, std::uint32_t aLevel )
+	{
+		char name[4096];
+		if( int iret = std::snprintf( name, sizeof(name), aPattern, aLevel ); iret < 0 || iret >= int(sizeof(name)) )
+		{
+			throw lut::Error( "Pattern '%s': unable to derive level %u image file name (%d).",
+				aPattern, aLevel, iret );
+		}
+
+		return name;
+	}
+
+	// Reads only the header
+	ImageInfo_ image_info_( char const* aPath )
+	{
+		int widthi, heighti, channelsi;
+		if( 1 != stbi_info( aPath, &widthi, &heighti, &channelsi ) )
+			throw lut::Error( "%s: unable to get image information (%s)", aPath, stbi_failure_reason() );
+
+		return ImageInfo_{ std::uint32_t(widthi), std::uint32_t(heighti), 1 };
+	}
+
+	ImageInfo_ pattern_info_( char const* aPattern )
+	{
+		auto info = image_info_( level_name_( aPattern, 0 ).c_str() );
+		info.levels = lut::compute_mip_level_count( info.width, info.height );
+		return info;
+	}
+
+	// Sizes of the levels, as they are expected from the files
+	void size_levels_( lut::DecodedImage& aImage, ImageInfo_ const& aInfo )
+	{
+		aImage.levels.resize( aInfo.levels );
+
+		std::uint32_t width = aInfo.width, height = aInfo.height;
+		for( auto& level : aImage.levels )
+		{
+			level.width = width;
+			level.height = height;
+
+			width = std::max( 1u, width >> 1 );
+			height = std::max( 1u, height >> 1 );
+		}
+	}
+
+	// Decodes aPath into aLevel, whose size must already be set; returns the
+	// time taken in milliseconds
+	double decode_level_( char const* aPath, lut::DecodedLevel& aLevel )
+	{
+		auto const start = Clock_::now();
+
+		int widthi, heighti, channelsi;
+		stbi_uc* data = stbi_load( aPath, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/ );
+
+		if( !data )
+			throw lut::Error( "%s: unable to load image (%s)", aPath, stbi_failure_reason() );
+
+		aLevel.pixels.reset( data );
+
+		// The level may have changed on disk since its header was read; the
+		// upload relies on the size
+		if( std::uint32_t(widthi) != aLevel.width || std::uint32_t(heighti) != aLevel.height )
+		{
+			throw lut::Error( "%s: image is %dx%d, expected %ux%u", aPath, widthi, heighti,
+				aLevel.width, aLevel.height );
+		}
+
+		return Msecs_( Clock_::now() - start ).count();
+	}
+}
+
+namespace labutils
+{
+	void DecodedPixelsDeleter::operator() (std::uint8_t* aPixels) const noexcept
+	{
+		if( fromStb )
+			stbi_image_free( aPixels );
+		else
+			delete [] aPixels;
+	}
+
+	DecodedImage decode_image( char const* aPath )
+	{
+		DecodedImage ret;
+		ret.source = aPath;
+
+		size_levels_( ret, image_info_( aPath ) );
+		ret.decodeMilliseconds = decode_level_( aPath, ret.levels[0] );
+
+		return ret;
+	}
+
+	DecodedImage decode_image_levels( char const* aPattern )
+	{
+		DecodedImage ret;
+		ret.source = aPattern;
+
+		size_levels_( ret, pattern_info_( aPattern ) );
+		for( std::uint32_t level = 0; level < ret.levels.size(); ++level )
+			ret.decodeMilliseconds += decode_level_( level_name_( aPattern, level ).c_str(), ret.levels[level] );
+
+		return ret;
+	}
+
+	DecodedImage describe_image_levels( char const* aPattern )
+	{
+		DecodedImage ret;
+		ret.source = aPattern;
+
+		size_levels_( ret, pattern_info_( aPattern ) );
+		return ret;
+	}
+
+	double decode_image_level( DecodedImage& aImage, std::uint32_t aLevel )
+	{
+		assert( aLevel < aImage.levels.size() );
+		return decode_level_( level_name_( aImage.source.c_str(), aLevel ).c_str(), aImage.levels[aLevel] );
+	}
+
+	std::vector<DecodedImage> decode_images( std::vector<ImageDecodeRequest> const& aRequests, ThreadPool* aPool )
+	{
+		std::optional<ThreadPool> localPool;
+		if( !aPool )
+			aPool = &localPool.emplace();
+
+		// Phase one: read the headers, which gives the number of levels and
+		// the size of each level
+		std::vector<DecodedImage> images( aRequests.size() );
+
+		aPool->parallel_for( aRequests.size(), [&] ( std::size_t aIndex ) {
+			auto const& request = aRequests[aIndex];
+			auto& image = images[aIndex];
+
+			image.source = request.path;
+			size_levels_( image, request.levelPattern ? pattern_info_( request.path.c_str() ) : image_info_( request.path.c_str() ) );
+		} );
+
+		// Phase two: decode each level as a separate job. Decode time is
+		// roughly proportional to the image size, so starting with the
+		// largest jobs avoids a long job being left for last.
+		struct Job_
+		{
+			std::size_t image;
+			std::uint32_t level;
+			double milliseconds;
+		};
+
+		std::vector<Job_> jobs;
+		for( std::size_t i = 0; i < images.size(); ++i )
+		{
+			for( std::uint32_t level = 0; level < images[i].levels.size(); ++level )
+				jobs.emplace_back( Job_{ i, level, 0.0 } );
+		}
+
+		std::stable_sort( jobs.begin(), jobs.end(), [&] ( Job_ const& aX, Job_ const& aY ) {
+			return images[aX.image].levels[aX.level].size_bytes() > images[aY.image].levels[aY.level].size_bytes();
+		} );
+
+		aPool->parallel_for( jobs.size(), [&] ( std::size_t aIndex ) {
+			auto& job = jobs[aIndex];
+			auto const& request = aRequests[job.image];
+
+			auto const path = request.levelPattern ? level_name_( request.path.c_str(), job.level ) : request.path;
+			job.milliseconds = decode_level_( path.c_str(), images[job.image].levels[job.level] );
+		} );
+
+		for( auto const& job : jobs )
+			images[job.image].decodeMilliseconds += job.milliseconds;
+
+		return images;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	class ThreadPool;
+
+	/* CPU-side image decoding, separate from the GPU upload (see
+	 * upload_image_texture2d()), so that many images can be decoded
+	 * concurrently.
+	 *
+	 * Images are decoded to 8-bit RGBA. An image is either a single file, or
+	 * a full mip chain given as a printf-style pattern with one %u for the
+	 * level (see load_image_texture2d()); level 0 determines the number of
+	 * levels.
+	 */
+
+	// Frees pixels from stb_image, or from new[] for levels that were
+	// generated rather than decoded (see generate_mipmaps())
+	struct DecodedPixelsDeleter
+	{
+		bool fromStb = true;
+
+		void operator() (std::uint8_t*) const noexcept;
+	};
+
+	struct DecodedLevel
+	{
+		std::uint32_t width = 0, height = 0;
+		std::unique_ptr<std::uint8_t[], DecodedPixelsDeleter> pixels; // width*height RGBA texels
+
+		std::size_t size_bytes() const noexcept { return std::size_t(width) * height * 4; }
+	};
+
+	struct DecodedImage
+	{
+		std::string source; // file name or pattern
+		std::vector<DecodedLevel> levels;
+
+		// Time spent decoding (summed over the levels, which may have been
+		// decoded on different threads)
+		double decodeMilliseconds = 0.0;
+	};
+
+	struct ImageDecodeRequest
+	{
+		std::string path;
+		bool levelPattern = false; // path is a pattern for a full mip chain
+	};
+
+	DecodedImage decode_image( char const* aPath );
+	DecodedImage decode_image_levels( char const* aPattern );
+
+	// Sizes of the levels of a pattern, read from the header of level 0,
+	// without decoding anything. decode_image_level() then decodes single
+	// levels on demand (e.g. for streaming, see TextureStreamer); different
+	// levels of the same image may be decoded concurrently. Returns the time
+	// taken in milliseconds.
+	DecodedImage describe_image_levels( char const* aPattern );
+	double decode_image_level( DecodedImage&, std::uint32_t aLevel );
+
+	// Decodes all requests on aPool (or on a temporary pool with one thread
+	// per core if aPool is null). Each level of a pattern is decoded as a
+	// separate job; the largest jobs are started first. The results are in
+	// the order of the requests. Throws labutils::Error if any image fails to
+	// decode.
+	std::vector<DecodedImage> decode_images( std::vector<ImageDecodeRequest> const&, ThreadPool* aPool = nullptr );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,446 @@
+#include "ktx2.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+#include "error.hpp"
+
+namespace
+{
+	constexpr std::uint8_t kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	constexpr char const* kBakedSuffix = ".ktx2";
+
+	// Bump kBakeVersion whenever the processing of baked textures changes in
+	// a way that is not captured by the caller's settings string.
+	constexpr char const* kBakeVersion = "1";
+
+	constexpr char const* kWriterKey = "KTXwriter";
+	constexpr char const* kWriterValue = "labutils";
+	constexpr char const* kSourceKey = "cw1.source";
+	constexpr char const* kSettingsKey = "cw1.settings";
+
+	struct Header_
+	{
+		std::uint8_t identifier[12];
+		std::uint32_t vkFormat;
+		std::uint32_t typeSize;
+		std::uint32_t pixelWidth, pixelHeight, pixelDepth;
+		std::uint32_t layerCount;
+		std::uint32_t faceCount;
+		std::uint32_t levelCount;
+		std::uint32_t supercompressionScheme;
+
+		std::uint32_t dfdByteOffset, dfdByteLength;
+		std::uint32_t kvdByteOffset, kvdByteLength;
+		std::uint64_t sgdByteOffset, sgdByteLength;
+	};
+
+	struct LevelIndex_
+	{
+		std::uint64_t byteOffset;
+		std::uint64_t byteLength;
+		std::uint64_t uncompressedByteLength;
+	};
+
+	static_assert( sizeof(Header_) == 80 && std::is_trivially_copyable_v<Header_> );
+	static_assert( sizeof(LevelIndex_) == 24 );
+
+	// Data format descriptor constants (Khronos Data Format Specification)
+	constexpr std::uint8_t kModelRgbsda = 1, kModelBc1a = 128, kModelBc7 = 135;
+	constexpr std::uint8_t kPrimariesBt709 = 1;
+	constexpr std::uint8_t kTransferSrgb = 2;
+	constexpr std::uint8_t kChannelAlpha = 15;
+	constexpr std::uint8_t kQualifierLinear = 0x10;
+
+	struct FormatInfo_
+	{
+		std::uint32_t blockWidth, blockHeight, blockBytes;
+		std::uint8_t colorModel;
+	};
+
+	bool format_info_( VkFormat aFormat, FormatInfo_& aInfo ) noexcept
+	{
+		switch( aFormat )
+		{
+			case VK_FORMAT_R8G8B8A8_SRGB: aInfo = { 1, 1, 4, kModelRgbsda }; return true;
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK: aInfo = { 4, 4, 8, kModelBc1a }; return true;
+			case VK_FORMAT_BC7_SRGB_BLOCK: aInfo = { 4, 4, 16, kModelBc7 }; return true;
+			default: return false;
+		}
+	}
+
+	std::uint64_t level_bytes_( FormatInfo_ const& aInfo, std::uint32_t aWidth, std::uint32_t aHeight ) noexcept
+	{
+		std::uint64_t const bx = (aWidth + aInfo.blockWidth-1) / aInfo.blockWidth;
+		std::uint64_t const by = (aHeight + aInfo.blockHeight-1) / aInfo.blockHeight;
+		return bx * by * aInfo.blockBytes;
+	}
+
+	std::uint64_t align_up_( std::uint64_t aValue, std::uint64_t aAlignment ) noexcept
+	{
+		return (aValue + aAlignment-1) / aAlignment * aAlignment;
+	}
+
+	void put_u32_( std::vector<std::uint8_t>& aOut, std::uint32_t aValue )
+	{
+		std::uint8_t bytes[4];
+		std::memcpy( bytes, &aValue, 4 );
+		aOut.insert( aOut.end(), bytes, bytes+4 );
+	}
+
+	// Basic data format descriptor with one block: one sample per channel
+	// for RGBA8, one sample for the whole block of BC formats.
+	std::vector<std::uint8_t> make_dfd_( FormatInfo_ const& aInfo )
+	{
+		struct Sample { std::uint32_t bitOffset, bitLength; std::uint8_t channel; std::uint32_t upper; };
+		std::vector<Sample> samples;
+		if( kModelRgbsda == aInfo.colorModel )
+		{
+			for( std::uint8_t c = 0; c < 3; ++c )
+				samples.push_back( { 8u*c, 8, c, 255 } );
+			samples.push_back( { 24, 8, std::uint8_t(kChannelAlpha | kQualifierLinear), 255 } );
+		}
+		else
+		{
+			samples.push_back( { 0, 8*aInfo.blockBytes, 0, 0xffffffffu } );
+		}
+
+		std::uint32_t const blockSize = 24 + 16*std::uint32_t(samples.size());
+
+		std::vector<std::uint8_t> ret;
+		put_u32_( ret, 4 + blockSize ); // dfdTotalSize
+		put_u32_( ret, 0 ); // vendorId = Khronos, descriptorType = basic
+		put_u32_( ret, 2u | (blockSize << 16) ); // versionNumber = 1.3
+		put_u32_( ret, aInfo.colorModel | (kPrimariesBt709 << 8) | (kTransferSrgb << 16) );
+		put_u32_( ret, (aInfo.blockWidth-1) | ((aInfo.blockHeight-1) << 8) );
+		put_u32_( ret, aInfo.blockBytes ); // bytesPlane0
+		put_u32_( ret, 0 );
+
+		for( auto const& sample : samples )
+		{
+			put_u32_( ret, sample.bitOffset | ((sample.bitLength-1) << 16) | (std::uint32_t(sample.channel) << 24) );
+			put_u32_( ret, 0 ); // samplePosition
+			put_u32_( ret, 0 ); // sampleLower
+			put_u32_( ret, sample.upper );
+		}
+
+		return ret;
+	}
+
+	// Entries are sorted by key, as required by the specification. Values
+	// are stored as NUL-terminated strings.
+	std::vector<std::uint8_t> make_kvd_( labutils::Ktx2KeyValues aKeyValues )
+	{
+		std::sort( aKeyValues.begin(), aKeyValues.end() );
+
+		std::vector<std::uint8_t> ret;
+		for( auto const& [key, value] : aKeyValues )
+		{
+			assert( key.find( '\0' ) == std::string::npos );
+			put_u32_( ret, std::uint32_t(key.size() + 1 + value.size() + 1) );
+			ret.insert( ret.end(), key.begin(), key.end() );
+			ret.push_back( 0 );
+			ret.insert( ret.end(), value.begin(), value.end() );
+			ret.push_back( 0 );
+			ret.resize( std::size_t(align_up_( ret.size(), 4 )), 0 );
+		}
+
+		return ret;
+	}
+
+	labutils::Ktx2KeyValues parse_kvd_( std::byte const* aData, std::size_t aSize )
+	{
+		labutils::Ktx2KeyValues ret;
+
+		std::size_t offset = 0;
+		while( offset + 4 <= aSize )
+		{
+			std::uint32_t length;
+			std::memcpy( &length, aData+offset, 4 );
+			offset += 4;
+
+			if( length > aSize - offset )
+				throw labutils::Error( "key/value entry out of bounds" );
+
+			auto const* entry = reinterpret_cast<char const*>(aData+offset);
+			auto const* keyEnd = static_cast<char const*>(std::memchr( entry, '\0', length ));
+			if( !keyEnd )
+				throw labutils::Error( "key/value entry without key" );
+
+			std::string key( entry, keyEnd );
+			std::string value( keyEnd+1, entry+length );
+			if( !value.empty() && '\0' == value.back() )
+				value.pop_back();
+
+			ret.emplace_back( std::move(key), std::move(value) );
+			offset = std::size_t(align_up_( offset + length, 4 ));
+		}
+
+		return ret;
+	}
+
+	bool source_unchanged_( std::string const& aPath, labutils::BakeSource const& aRecord )
+	{
+		namespace fs = std::filesystem;
+
+		std::error_code ec;
+		auto const bytes = fs::file_size( aPath, ec );
+		if( ec || bytes != aRecord.bytes )
+			return false;
+
+		auto const mtime = fs::last_write_time( aPath, ec );
+		if( !ec && std::int64_t(mtime.time_since_epoch().count()) == aRecord.modifiedTime )
+			return true;
+
+		// Timestamp changed (e.g., fresh checkout). The contents might still
+		// be the same.
+		auto const file = labutils::map_file( aPath.c_str() );
+		return labutils::hash_bytes( file.data, file.size ) == aRecord.hash;
+	}
+
+	std::string settings_value_( std::string_view aSettings )
+	{
+		return std::string(kBakeVersion) + ";" + std::string(aSettings);
+	}
+}
+
+namespace labutils
+{
+	std::string_view Ktx2Image::value( std::string_view aKey ) const noexcept
+	{
+		for( auto const& [key, value] : keyValues )
+		{
+			if( key == aKey )
+				return value;
+		}
+
+		return {};
+	}
+
+	void write_ktx2( char const* aPath, VkFormat aFormat, std::vector<ImageLevelData> const& aLevels, Ktx2KeyValues const& aKeyValues )
+	{
+		assert( aPath );
+
+		FormatInfo_ info;
+		if( !format_info_( aFormat, info ) )
+			throw Error( "KTX2: unsupported format %d", int(aFormat) );
+		if( aLevels.empty() )
+			throw Error( "KTX2: no levels" );
+
+		auto const width = aLevels[0].width, height = aLevels[0].height;
+		for( std::size_t i = 0; i < aLevels.size(); ++i )
+		{
+			auto const& level = aLevels[i];
+			if( level.width != std::max( width >> i, 1u ) || level.height != std::max( height >> i, 1u ) )
+				throw Error( "KTX2: level %zu has size %ux%u", i, level.width, level.height );
+			if( level.size != level_bytes_( info, level.width, level.height ) )
+				throw Error( "KTX2: level %zu has %zu bytes", i, level.size );
+		}
+
+		auto const dfd = make_dfd_( info );
+
+		auto keyValues = aKeyValues;
+		keyValues.emplace_back( kWriterKey, kWriterValue );
+		auto const kvd = make_kvd_( std::move(keyValues) );
+
+		// Layout: header, level index, DFD, KVD, then the levels, smallest
+		// first. Each level starts at a multiple of lcm(texel block size, 4).
+		auto const levelCount = std::uint32_t(aLevels.size());
+
+		Header_ header{};
+		std::memcpy( header.identifier, kIdentifier, sizeof(kIdentifier) );
+		header.vkFormat = std::uint32_t(aFormat);
+		header.typeSize = 1;
+		header.pixelWidth = width;
+		header.pixelHeight = height;
+		header.faceCount = 1;
+		header.levelCount = levelCount;
+		header.dfdByteOffset = std::uint32_t(sizeof(Header_) + levelCount*sizeof(LevelIndex_));
+		header.dfdByteLength = std::uint32_t(dfd.size());
+		header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+		header.kvdByteLength = std::uint32_t(kvd.size());
+
+		std::uint64_t const alignment = std::lcm( std::uint64_t(info.blockBytes), std::uint64_t(4) );
+
+		std::vector<LevelIndex_> levelIndex( levelCount );
+		std::uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+		for( std::uint32_t i = levelCount; i-- > 0; )
+		{
+			offset = align_up_( offset, alignment );
+			levelIndex[i].byteOffset = offset;
+			levelIndex[i].byteLength = aLevels[i].size;
+			levelIndex[i].uncompressedByteLength = aLevels[i].size;
+			offset += aLevels[i].size;
+		}
+
+		// Write to a temporary file first, such that a crash never leaves a
+		// partial file behind.
+		auto const tempPath = std::string(aPath) + ".tmp";
+		{
+			std::ofstream ofs( tempPath, std::ios::binary | std::ios::trunc );
+			if( !ofs )
+				throw Error( "unable to open '%s' for writing", tempPath.c_str() );
+
+			ofs.write( reinterpret_cast<char const*>(&header), sizeof(header) );
+			ofs.write( reinterpret_cast<char const*>(levelIndex.data()), std::streamsize(levelIndex.size()*sizeof(LevelIndex_)) );
+			ofs.write( reinterpret_cast<char const*>(dfd.data()), std::streamsize(dfd.size()) );
+			ofs.write( reinterpret_cast<char const*>(kvd.data()), std::streamsize(kvd.size()) );
+
+			std::uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+			char const padding[16] = {};
+			for( std::uint32_t i = levelCount; i-- > 0; )
+			{
+				ofs.write( padding, std::streamsize(levelIndex[i].byteOffset - written) );
+				ofs.write( static_cast<char const*>(aLevels[i].data), std::streamsize(aLevels[i].size) );
+				written = levelIndex[i].byteOffset + levelIndex[i].byteLength;
+			}
+
+			if( !ofs )
+				throw Error( "unable to write '%s'", tempPath.c_str() );
+		}
+
+		std::error_code ec;
+		std::filesystem::rename( tempPath, aPath, ec );
+		if( ec )
+		{
+			std::filesystem::remove( tempPath, ec );
+			throw Error( "unable to rename '%s'", tempPath.c_str() );
+		}
+	}
+
+	Ktx2Image map_ktx2( char const* aPath )
+	{
+		assert( aPath );
+
+		Ktx2Image ret;
+		ret.file = map_file( aPath );
+
+		auto const& file = ret.file;
+		if( file.size < sizeof(Header_) )
+			throw Error( "KTX2 '%s': truncated", aPath );
+
+		Header_ header;
+		std::memcpy( &header, file.data, sizeof(header) );
+
+		if( 0 != std::memcmp( header.identifier, kIdentifier, sizeof(kIdentifier) ) )
+			throw Error( "KTX2 '%s': bad identifier", aPath );
+
+		FormatInfo_ info;
+		if( !format_info_( VkFormat(header.vkFormat), info ) )
+			throw Error( "KTX2 '%s': unsupported format %u", aPath, header.vkFormat );
+
+		if( 0 != header.pixelDepth || header.layerCount > 1 || 1 != header.faceCount || 0 != header.supercompressionScheme )
+			throw Error( "KTX2 '%s': only plain 2D textures are supported", aPath );
+		if( 0 == header.pixelWidth || 0 == header.pixelHeight )
+			throw Error( "KTX2 '%s': empty image", aPath );
+		if( 0 == header.levelCount || header.levelCount > compute_mip_level_count( header.pixelWidth, header.pixelHeight ) )
+			throw Error( "KTX2 '%s': bad level count %u", aPath, header.levelCount );
+
+		auto const indexEnd = sizeof(Header_) + std::uint64_t(header.levelCount)*sizeof(LevelIndex_);
+		if( indexEnd > file.size )
+			throw Error( "KTX2 '%s': truncated level index", aPath );
+		if( std::uint64_t(header.kvdByteOffset) + header.kvdByteLength > file.size )
+			throw Error( "KTX2 '%s': key/value data out of bounds", aPath );
+
+		ret.format = VkFormat(header.vkFormat);
+		ret.keyValues = parse_kvd_( file.data + header.kvdByteOffset, header.kvdByteLength );
+
+		ret.levels.reserve( header.levelCount );
+		for( std::uint32_t i = 0; i < header.levelCount; ++i )
+		{
+			LevelIndex_ level;
+			std::memcpy( &level, file.data + sizeof(Header_) + i*sizeof(LevelIndex_), sizeof(level) );
+
+			auto const width = std::max( header.pixelWidth >> i, 1u );
+			auto const height = std::max( header.pixelHeight >> i, 1u );
+
+			if( level.byteLength != level_bytes_( info, width, height ) )
+				throw Error( "KTX2 '%s': level %u has %llu bytes", aPath, i, (unsigned long long)level.byteLength );
+			if( level.byteOffset > file.size || level.byteLength > file.size - level.byteOffset )
+				throw Error( "KTX2 '%s': level %u out of bounds", aPath, i );
+
+			ret.levels.emplace_back( ImageLevelData{ width, height, file.data + level.byteOffset, std::size_t(level.byteLength) } );
+		}
+
+		return ret;
+	}
+
+
+	BakeSource describe_bake_source( char const* aSourcePath )
+	{
+		namespace fs = std::filesystem;
+
+		BakeSource ret{};
+
+		std::error_code ec;
+		ret.bytes = fs::file_size( aSourcePath, ec );
+		if( ec )
+			throw Error( "unable to stat '%s'", aSourcePath );
+
+		if( auto const mtime = fs::last_write_time( aSourcePath, ec ); !ec )
+			ret.modifiedTime = std::int64_t(mtime.time_since_epoch().count());
+
+		auto const file = map_file( aSourcePath );
+		ret.hash = hash_bytes( file.data, file.size );
+
+		return ret;
+	}
+
+	std::string baked_texture_path( std::string_view aSourcePath )
+	{
+		return std::string(aSourcePath) + kBakedSuffix;
+	}
+
+	std::optional<Ktx2Image> load_baked_texture( std::string_view aSourcePath, std::string_view aSettings )
+	{
+		auto const path = baked_texture_path( aSourcePath );
+
+		std::error_code ec;
+		if( !std::filesystem::exists( path, ec ) )
+			return {};
+
+		auto image = map_ktx2( path.c_str() );
+		if( image.value( kSettingsKey ) != settings_value_( aSettings ) )
+			return {}; // different settings or version, rebake
+
+		BakeSource record;
+		unsigned long long bytes, hash;
+		long long mtime;
+		if( 3 != std::sscanf( std::string(image.value( kSourceKey )).c_str(), "%llu %lld %llx", &bytes, &mtime, &hash ) )
+			throw Error( "KTX2 '%s': bad source record", path.c_str() );
+
+		record.bytes = bytes;
+		record.modifiedTime = mtime;
+		record.hash = hash;
+
+		if( !source_unchanged_( std::string(aSourcePath), record ) )
+			return {};
+
+		return image;
+	}
+
+	void bake_texture( std::string_view aSourcePath, std::string_view aSettings, BakeSource const& aSource, VkFormat aFormat, std::vector<ImageLevelData> const& aLevels )
+	{
+		char source[64];
+		std::snprintf( source, sizeof(source), "%llu %lld %016llx", (unsigned long long)aSource.bytes, (long long)aSource.modifiedTime, (unsigned long long)aSource.hash );
+
+		Ktx2KeyValues const keyValues{
+			{ kSourceKey, source },
+			{ kSettingsKey, settings_value_( aSettings ) }
+		};
+
+		write_ktx2( baked_texture_path( aSourcePath ).c_str(), aFormat, aLevels, keyValues );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkimage.hpp"
+#include "mapped_file.hpp"
+
+namespace labutils
+{
+	/* KTX2 containers (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+	 *
+	 * Only what is needed for baked 2D textures is supported: a single face
+	 * and layer, no supercompression, and the formats VK_FORMAT_R8G8B8A8_SRGB,
+	 * VK_FORMAT_BC1_RGB_SRGB_BLOCK and VK_FORMAT_BC7_SRGB_BLOCK (which get a
+	 * basic data format descriptor). Files are read through a memory mapping;
+	 * the levels point into it and can be copied to a staging buffer as they
+	 * are (see upload_image_levels_texture2d()).
+	 */
+	using Ktx2KeyValues = std::vector<std::pair<std::string, std::string>>;
+
+	struct Ktx2Image
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		std::vector<ImageLevelData> levels; // level 0 first; point into file
+		Ktx2KeyValues keyValues;
+
+		MappedFile file;
+
+		std::string_view value( std::string_view aKey ) const noexcept; // empty if missing
+	};
+
+	// Writes to a temporary file that is then renamed, so that an existing
+	// file is never left half-written. Throws labutils::Error on failure.
+	void write_ktx2( char const* aPath, VkFormat, std::vector<ImageLevelData> const&, Ktx2KeyValues const& = {} );
+
+	// Throws labutils::Error if the file cannot be mapped, is malformed, or
+	// uses features that are not supported (see above)
+	Ktx2Image map_ktx2( char const* aPath );
+
+
+	/* Baked textures.
+	 *
+	 * bake_texture() writes the final, GPU-ready mip chain of a texture to
+	 * "<source>.ktx2" next to the source. The container records the size,
+	 * modification time and content hash of the source, as well as a
+	 * caller-defined settings string (e.g. the mip filter and compression
+	 * used). load_baked_texture() returns the baked texture only if the
+	 * settings match and the source is unchanged; like the mesh cache, a
+	 * changed timestamp alone (e.g. after a fresh checkout) falls back to
+	 * comparing the content hash.
+	 */
+	struct BakeSource
+	{
+		std::uint64_t bytes = 0;
+		std::int64_t modifiedTime = 0;
+		std::uint64_t hash = 0;
+	};
+
+	// Describes the source as it is now; call before reading it, so that
+	// changes made in the meantime invalidate the baked texture
+	BakeSource describe_bake_source( char const* aSourcePath );
+
+	std::string baked_texture_path( std::string_view aSourcePath );
+
+	// Returns nothing if there is no baked texture or it is out of date.
+	// Throws labutils::Error if the baked texture is unreadable.
+	std::optional<Ktx2Image> load_baked_texture( std::string_view aSourcePath, std::string_view aSettings );
+
+	void bake_texture( std::string_view aSourcePath, std::string_view aSettings, BakeSource const&, VkFormat, std::vector<ImageLevelData> const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,170 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#include <cassert>
+#include <cstring>
+
+#if defined(_WIN32)
+#	if !defined(WIN32_LEAN_AND_MEAN)
+#		define WIN32_LEAN_AND_MEAN 1
+#	endif
+#	if !defined(NOMINMAX)
+#		define NOMINMAX 1
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+#include "error.hpp"
+
+namespace labutils
+{
+	MappedFile::MappedFile() noexcept = default;
+
+	MappedFile::~MappedFile()
+	{
+		if( data )
+		{
+#			if defined(_WIN32)
+			UnmapViewOfFile( data );
+			CloseHandle( mMapping );
+#			else
+			munmap( const_cast<std::byte*>(data), size );
+#			endif
+		}
+	}
+
+	MappedFile::MappedFile( MappedFile&& aOther ) noexcept
+		: data( std::exchange( aOther.data, nullptr ) )
+		, size( std::exchange( aOther.size, 0 ) )
+		, mMapping( std::exchange( aOther.mMapping, nullptr ) )
+	{}
+	MappedFile& MappedFile::operator=( MappedFile&& aOther ) noexcept
+	{
+		std::swap( data, aOther.data );
+		std::swap( size, aOther.size );
+		std::swap( mMapping, aOther.mMapping );
+		return *this;
+	}
+}
+
+namespace labutils
+{
+	MappedFile map_file( char const* aPath )
+	{
+		assert( aPath );
+
+		MappedFile ret;
+
+#		if defined(_WIN32)
+		HANDLE file = CreateFileA( aPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if( INVALID_HANDLE_VALUE == file )
+			throw Error( "Unable to open '%s' for mapping (error %lu)", aPath, GetLastError() );
+
+		LARGE_INTEGER fileSize{};
+		if( !GetFileSizeEx( file, &fileSize ) )
+		{
+			auto const err = GetLastError();
+			CloseHandle( file );
+			throw Error( "Unable to query size of '%s' (error %lu)", aPath, err );
+		}
+
+		if( 0 == fileSize.QuadPart )
+		{
+			CloseHandle( file );
+			return ret;
+		}
+
+		HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		CloseHandle( file ); // the mapping keeps the file alive
+
+		if( !mapping )
+			throw Error( "Unable to create file mapping for '%s' (error %lu)", aPath, GetLastError() );
+
+		void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		if( !view )
+		{
+			auto const err = GetLastError();
+			CloseHandle( mapping );
+			throw Error( "Unable to map '%s' (error %lu)", aPath, err );
+		}
+
+		ret.data = static_cast<std::byte const*>(view);
+		ret.size = std::size_t(fileSize.QuadPart);
+		ret.mMapping = mapping;
+#		else
+		int const fd = open( aPath, O_RDONLY );
+		if( -1 == fd )
+			throw Error( "Unable to open '%s' for mapping", aPath );
+
+		struct stat st{};
+		if( -1 == fstat( fd, &st ) )
+		{
+			close( fd );
+			throw Error( "Unable to query size of '%s'", aPath );
+		}
+
+		if( 0 == st.st_size )
+		{
+			close( fd );
+			return ret;
+		}
+
+		void* view = mmap( nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd ); // the mapping keeps the file alive
+
+		if( MAP_FAILED == view )
+			throw Error( "Unable to map '%s'", aPath );
+
+		ret.data = static_cast<std::byte const*>(view);
+		ret.size = std::size_t(st.st_size);
+#		endif
+
+		return ret;
+	}
+
+	std::uint64_t hash_bytes( void const* aData, std::size_t aSize, std::uint64_t aSeed )
+	{
+		// Loosely follows MurmurHash3's 64-bit mixing steps.
+		constexpr std::uint64_t kC1 = 0x87c37b91114253d5ull;
+		constexpr std::uint64_t kC2 = 0x4cf5ad432745937full;
+
+		auto const rotl = [] ( std::uint64_t aX, int aR ) {
+			return (aX << aR) | (aX >> (64-aR));
+		};
+
+		auto const* bytes = static_cast<unsigned char const*>(aData);
+		std::uint64_t h = aSeed ^ (aSize * kC1);
+
+		std::size_t const words = aSize / 8;
+		for( std::size_t i = 0; i < words; ++i )
+		{
+			std::uint64_t k;
+			std::memcpy( &k, bytes + i*8, sizeof(k) );
+
+			k *= kC1; k = rotl( k, 31 ); k *= kC2;
+			h ^= k;
+			h = rotl( h, 27 ) * 5 + 0x52dce729;
+		}
+
+		std::uint64_t tail = 0;
+		for( std::size_t i = words*8; i < aSize; ++i )
+			tail = (tail << 8) | bytes[i];
+
+		tail *= kC1; tail = rotl( tail, 31 ); tail *= kC2;
+		h ^= tail;
+
+		// fmix64
+		h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
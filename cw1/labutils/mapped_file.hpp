@@ -0,0 +1,42 @@
+#pragma once
+
+#include <utility>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	// Read-only memory mapping of a whole file. Like the Vulkan wrappers, this
+	// is move-only and unmaps the file when it goes out of scope.
+	class MappedFile
+	{
+		public:
+			MappedFile() noexcept, ~MappedFile();
+
+			MappedFile( MappedFile const& ) = delete;
+			MappedFile& operator= (MappedFile const&) = delete;
+
+			MappedFile( MappedFile&& ) noexcept;
+			MappedFile& operator = (MappedFile&&) noexcept;
+
+		public:
+			std::byte const* data = nullptr;
+			std::size_t size = 0;
+
+		private:
+			friend MappedFile map_file( char const* );
+
+			void* mMapping = nullptr; // HANDLE on Windows, unused elsewhere
+	};
+
+	// Maps the file at aPath. Throws labutils::Error if the file cannot be
+	// opened or mapped. Empty files result in a MappedFile with data == nullptr.
+	MappedFile map_file( char const* aPath );
+
+	// Non-cryptographic 64-bit hash. Processes eight bytes per step, so it is
+	// cheap enough to run over multi-MB source assets on every start-up.
+	std::uint64_t hash_bytes( void const* aData, std::size_t aSize, std::uint64_t aSeed = 0 );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,372 @@
+#include "mip_generate.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+#include <cassert>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define LUT_MIP_SSE2_ 1
+#	define LUT_MIP_AVX2_ 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define LUT_MIP_SSE2_ 1
+#endif
+
+#include "image_decode.hpp"
+#include "thread_pool.hpp"
+
+namespace lut = labutils;
+
+namespace
+{
+	// Kaiser-windowed sinc
+	constexpr double kKaiserRadius = 2.0; // in destination texels
+	constexpr double kKaiserAlpha = 4.0;
+
+	// Target number of texels per band of rows
+	constexpr std::size_t kBandTexels = 16*1024;
+
+	// Linear values are quantized to 16 bits to look up their sRGB encoding.
+	// That is fine enough to round correctly even for the darkest sRGB codes.
+	constexpr std::size_t kLinearSteps = 65536;
+
+	struct SrgbTables_
+	{
+		float toLinear[256];
+		std::uint8_t fromLinear[kLinearSteps];
+
+		SrgbTables_()
+		{
+			for( std::size_t i = 0; i < 256; ++i )
+			{
+				double const c = i / 255.0;
+				toLinear[i] = float(c <= 0.04045 ? c / 12.92 : std::pow( (c + 0.055) / 1.055, 2.4 ));
+			}
+
+			for( std::size_t i = 0; i < kLinearSteps; ++i )
+			{
+				double const l = i / double(kLinearSteps-1);
+				double const c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow( l, 1.0/2.4 ) - 0.055;
+				fromLinear[i] = std::uint8_t(std::clamp( c * 255.0 + 0.5, 0.0, 255.0 ));
+			}
+		}
+	};
+
+	SrgbTables_ const& srgb_tables_()
+	{
+		static SrgbTables_ const tables;
+		return tables;
+	}
+
+	// Contributions of the source texels to one destination texel, along one
+	// axis: count weights (at weightOffset) for the texels starting at first
+	struct Taps_
+	{
+		std::uint32_t first, count;
+		std::uint32_t weightOffset;
+	};
+
+	struct Filter1D_
+	{
+		std::vector<Taps_> taps; // one per destination texel
+		std::vector<float> weights;
+	};
+
+	double bessel_i0_( double aX )
+	{
+		// Power series; converges quickly for the small arguments used here
+		double sum = 1.0, term = 1.0;
+		for( int k = 1; k < 32; ++k )
+		{
+			term *= (aX / (2.0*k)) * (aX / (2.0*k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	double kaiser_( double aT )
+	{
+		double const x = aT / kKaiserRadius;
+		if( x <= -1.0 || x >= 1.0 )
+			return 0.0;
+
+		double const pit = 3.14159265358979323846 * aT;
+		double const sinc = std::abs( pit ) < 1e-9 ? 1.0 : std::sin( pit ) / pit;
+		return sinc * bessel_i0_( kKaiserAlpha * std::sqrt( 1.0 - x*x ) ) / bessel_i0_( kKaiserAlpha );
+	}
+
+	Filter1D_ make_filter_( std::uint32_t aSource, std::uint32_t aTarget, lut::MipFilter aFilter )
+	{
+		Filter1D_ ret;
+		ret.taps.reserve( aTarget );
+
+		double const scale = double(aSource) / aTarget;
+		std::vector<double> weights;
+
+		for( std::uint32_t x = 0; x < aTarget; ++x )
+		{
+			// An axis that is not reduced (i.e., that is already 1) is copied
+			if( aSource == aTarget )
+			{
+				ret.taps.emplace_back( Taps_{ x, 1, std::uint32_t(ret.weights.size()) } );
+				ret.weights.emplace_back( 1.f );
+				continue;
+			}
+
+			std::int64_t first, last;
+			weights.clear();
+
+			if( lut::MipFilter::box == aFilter )
+			{
+				// Overlap of each source texel with the footprint [lo,hi)
+				double const lo = x * scale, hi = (x+1) * scale;
+				first = std::int64_t(std::floor( lo ));
+				last = std::min<std::int64_t>( std::int64_t(std::ceil( hi )) - 1, aSource-1 );
+
+				for( auto i = first; i <= last; ++i )
+					weights.emplace_back( std::min( hi, double(i+1) ) - std::max( lo, double(i) ) );
+			}
+			else
+			{
+				// Texel centers within the kernel's support; texels outside
+				// of the image are clamped to the edge
+				double const center = (x + 0.5) * scale;
+				double const radius = kKaiserRadius * scale;
+
+				auto const lo = std::int64_t(std::ceil( center - radius - 0.5 ));
+				auto const hi = std::int64_t(std::floor( center + radius - 0.5 ));
+
+				first = std::max<std::int64_t>( lo, 0 );
+				last = std::min<std::int64_t>( hi, aSource-1 );
+				weights.assign( std::size_t(last - first + 1), 0.0 );
+
+				for( auto i = lo; i <= hi; ++i )
+				{
+					auto const texel = std::clamp<std::int64_t>( i, first, last );
+					weights[std::size_t(texel - first)] += kaiser_( (i + 0.5 - center) / scale );
+				}
+			}
+
+			double sum = 0.0;
+			for( auto const weight : weights )
+				sum += weight;
+
+			assert( sum > 0.0 );
+			ret.taps.emplace_back( Taps_{ std::uint32_t(first), std::uint32_t(weights.size()), std::uint32_t(ret.weights.size()) } );
+			for( auto const weight : weights )
+				ret.weights.emplace_back( float(weight / sum) );
+		}
+
+		return ret;
+	}
+
+
+	// aDst[i] = sum_k aWeights[k] * aRows[k][i] for i in [0,aCount); aCount
+	// is a multiple of 4 (whole RGBA texels)
+	void weighted_row_sum_( float* aDst, float const* const* aRows, float const* aWeights, std::size_t aTaps, std::size_t aCount )
+	{
+		assert( aTaps > 0 && 0 == aCount % 4 );
+		std::size_t i = 0;
+
+#		if defined(LUT_MIP_AVX2_)
+		for( ; i + 8 <= aCount; i += 8 )
+		{
+			__m256 acc = _mm256_mul_ps( _mm256_set1_ps( aWeights[0] ), _mm256_loadu_ps( aRows[0] + i ) );
+			for( std::size_t k = 1; k < aTaps; ++k )
+				acc = _mm256_add_ps( acc, _mm256_mul_ps( _mm256_set1_ps( aWeights[k] ), _mm256_loadu_ps( aRows[k] + i ) ) );
+
+			_mm256_storeu_ps( aDst + i, acc );
+		}
+#		endif // ~ AVX2
+
+#		if defined(LUT_MIP_SSE2_)
+		for( ; i + 4 <= aCount; i += 4 )
+		{
+			__m128 acc = _mm_mul_ps( _mm_set1_ps( aWeights[0] ), _mm_loadu_ps( aRows[0] + i ) );
+			for( std::size_t k = 1; k < aTaps; ++k )
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( aWeights[k] ), _mm_loadu_ps( aRows[k] + i ) ) );
+
+			_mm_storeu_ps( aDst + i, acc );
+		}
+#		endif // ~ SSE2
+
+		for( ; i < aCount; ++i )
+		{
+			float acc = aWeights[0] * aRows[0][i];
+			for( std::size_t k = 1; k < aTaps; ++k )
+				acc += aWeights[k] * aRows[k][i];
+
+			aDst[i] = acc;
+		}
+	}
+
+	// Filters one row of RGBA texels horizontally
+	void resample_row_( float* aDst, float const* aSrc, Filter1D_ const& aFilter )
+	{
+		for( std::size_t x = 0; x < aFilter.taps.size(); ++x )
+		{
+			auto const& taps = aFilter.taps[x];
+			float const* src = aSrc + std::size_t(taps.first) * 4;
+			float const* weights = aFilter.weights.data() + taps.weightOffset;
+
+#			if defined(LUT_MIP_SSE2_)
+			// One texel per register
+			__m128 acc = _mm_mul_ps( _mm_set1_ps( weights[0] ), _mm_loadu_ps( src ) );
+			for( std::size_t k = 1; k < taps.count; ++k )
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( weights[k] ), _mm_loadu_ps( src + 4*k ) ) );
+
+			_mm_storeu_ps( aDst + 4*x, acc );
+#			else // !SSE2
+			for( std::size_t c = 0; c < 4; ++c )
+			{
+				float acc = weights[0] * src[c];
+				for( std::size_t k = 1; k < taps.count; ++k )
+					acc += weights[k] * src[4*k + c];
+
+				aDst[4*x + c] = acc;
+			}
+#			endif // ~ SSE2
+		}
+	}
+
+	void to_float_( float* aDst, std::uint8_t const* aSrc, std::size_t aTexels, bool aSrgb )
+	{
+		auto const& tables = srgb_tables_();
+		for( std::size_t i = 0; i < aTexels; ++i )
+		{
+			for( std::size_t c = 0; c < 3; ++c )
+				aDst[4*i + c] = aSrgb ? tables.toLinear[aSrc[4*i + c]] : aSrc[4*i + c] / 255.f;
+
+			aDst[4*i + 3] = aSrc[4*i + 3] / 255.f;
+		}
+	}
+
+	void to_unorm8_( std::uint8_t* aDst, float const* aSrc, std::size_t aTexels, bool aSrgb )
+	{
+		auto const& tables = srgb_tables_();
+
+		// sRGB color channels are quantized to look-up indices, everything
+		// else to its 8-bit value directly
+		float const colorScale = aSrgb ? float(kLinearSteps-1) : 255.f;
+
+#		if defined(LUT_MIP_SSE2_)
+		__m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.f );
+		__m128 const scale = _mm_setr_ps( colorScale, colorScale, colorScale, 255.f );
+		__m128 const half = _mm_set1_ps( 0.5f );
+
+		for( std::size_t i = 0; i < aTexels; ++i )
+		{
+			__m128 const v = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( aSrc + 4*i ), zero ), one );
+			alignas(16) std::int32_t q[4];
+			_mm_store_si128( reinterpret_cast<__m128i*>(q), _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( v, scale ), half ) ) );
+
+			for( std::size_t c = 0; c < 3; ++c )
+				aDst[4*i + c] = aSrgb ? tables.fromLinear[q[c]] : std::uint8_t(q[c]);
+
+			aDst[4*i + 3] = std::uint8_t(q[3]);
+		}
+#		else // !SSE2
+		for( std::size_t i = 0; i < aTexels; ++i )
+		{
+			for( std::size_t c = 0; c < 4; ++c )
+			{
+				float const v = std::clamp( aSrc[4*i + c], 0.f, 1.f );
+				auto const q = std::int32_t(v * (c < 3 ? colorScale : 255.f) + 0.5f);
+				aDst[4*i + c] = (c < 3 && aSrgb) ? tables.fromLinear[q] : std::uint8_t(q);
+			}
+		}
+#		endif // ~ SSE2
+	}
+
+	// Rows per band, such that a band of rows of aWidth texels has about
+	// kBandTexels texels
+	std::size_t band_rows_( std::size_t aWidth )
+	{
+		return std::max<std::size_t>( 1, kBandTexels / std::max<std::size_t>( 1, aWidth ) );
+	}
+}
+
+namespace labutils
+{
+	void generate_mipmaps( DecodedImage& aImage, MipFilter aFilter, bool aSrgb, ThreadPool* aPool )
+	{
+		assert( !aImage.levels.empty() && aImage.levels[0].pixels );
+
+		std::optional<ThreadPool> localPool;
+		if( !aPool )
+			aPool = &localPool.emplace();
+
+		aImage.levels.resize( 1 );
+
+		std::size_t width = aImage.levels[0].width, height = aImage.levels[0].height;
+
+		// Level 0 in linear floating point
+		std::vector<float> source( width * height * 4 );
+		{
+			auto const bandRows = band_rows_( width );
+			auto const* pixels = aImage.levels[0].pixels.get();
+
+			aPool->parallel_for( (height + bandRows-1) / bandRows, [&] ( std::size_t aBand ) {
+				auto const y0 = aBand * bandRows, y1 = std::min( height, y0 + bandRows );
+				to_float_( source.data() + y0*width*4, pixels + y0*width*4, (y1-y0)*width, aSrgb );
+			} );
+		}
+
+		std::vector<float> target;
+		while( width > 1 || height > 1 )
+		{
+			auto const targetWidth = std::max<std::size_t>( 1, width >> 1 );
+			auto const targetHeight = std::max<std::size_t>( 1, height >> 1 );
+
+			auto const horizontal = make_filter_( std::uint32_t(width), std::uint32_t(targetWidth), aFilter );
+			auto const vertical = make_filter_( std::uint32_t(height), std::uint32_t(targetHeight), aFilter );
+
+			auto& level = aImage.levels.emplace_back();
+			level.width = std::uint32_t(targetWidth);
+			level.height = std::uint32_t(targetHeight);
+			level.pixels = std::unique_ptr<std::uint8_t[], DecodedPixelsDeleter>(
+				new std::uint8_t[level.size_bytes()], DecodedPixelsDeleter{ false }
+			);
+
+			target.resize( targetWidth * targetHeight * 4 );
+
+			// Vertical pass into a temporary row (vectorized along the row),
+			// then horizontal pass (one texel at a time)
+			auto const bandRows = band_rows_( width );
+			auto* pixels = level.pixels.get();
+
+			aPool->parallel_for( (targetHeight + bandRows-1) / bandRows, [&] ( std::size_t aBand ) {
+				std::vector<float> row( width * 4 );
+				std::vector<float const*> rows;
+
+				auto const y0 = aBand * bandRows, y1 = std::min( targetHeight, y0 + bandRows );
+				for( auto y = y0; y < y1; ++y )
+				{
+					auto const& taps = vertical.taps[y];
+
+					rows.clear();
+					for( std::size_t k = 0; k < taps.count; ++k )
+						rows.emplace_back( source.data() + (taps.first + k) * width * 4 );
+
+					weighted_row_sum_( row.data(), rows.data(), vertical.weights.data() + taps.weightOffset, taps.count, width * 4 );
+
+					float* out = target.data() + y * targetWidth * 4;
+					resample_row_( out, row.data(), horizontal );
+					to_unorm8_( pixels + y * targetWidth * 4, out, targetWidth, aSrgb );
+				}
+			} );
+
+			std::swap( source, target );
+			width = targetWidth;
+			height = targetHeight;
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
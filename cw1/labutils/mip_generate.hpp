@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace labutils
+{
+	class ThreadPool;
+	struct DecodedImage;
+
+	/* CPU mipmap generation.
+	 *
+	 * generate_mipmaps() replaces all levels but level 0 of a decoded image
+	 * by a full chain down to 1x1, which can then be uploaded in a single
+	 * copy (see upload_image_texture2d()). Unlike blitting, this works for
+	 * every format and does not serialize the queue on per-level barriers.
+	 *
+	 * Colors are filtered in linear space: sRGB values are converted through
+	 * a lookup table and converted back after filtering. Alpha is always
+	 * linear (and not premultiplied). Each level is computed from the
+	 * previous one, kept in floating point, so rounding errors do not
+	 * accumulate down the chain.
+	 *
+	 * Each level halves the size (rounding down, minimum 1). The filters are
+	 * separable and are evaluated at the exact footprint of each destination
+	 * texel, so odd and non-power-of-two sizes are handled correctly (e.g. a
+	 * box filter from 5 to 2 texels uses the weights 2/5, 2/5, 1/5).
+	 *  - box: average over the footprint. Cheap; slightly blurry and prone
+	 *    to aliasing.
+	 *  - kaiser: Kaiser-windowed sinc (radius two destination texels,
+	 *    alpha 4). Sharper, at the cost of more taps; results are clamped,
+	 *    since the negative lobes can ring near hard edges.
+	 *
+	 * The inner loops have SSE2 and AVX2 kernels, selected at compile time.
+	 * The rows of each level are split into bands that are filtered in
+	 * parallel on aPool (or on a temporary pool with one thread per core if
+	 * aPool is null).
+	 */
+	enum class MipFilter
+	{
+		box,
+		kaiser
+	};
+
+	void generate_mipmaps( DecodedImage&, MipFilter = MipFilter::box, bool aSrgb = true, ThreadPool* aPool = nullptr );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,127 @@
+#include "process_memory.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#	if !defined(WIN32_LEAN_AND_MEAN)
+#		define WIN32_LEAN_AND_MEAN 1
+#	endif
+#	if !defined(NOMINMAX)
+#		define NOMINMAX 1
+#	endif
+#	include <windows.h>
+#	include <psapi.h> // K32GetProcessMemoryInfo() in kernel32 on Windows 7+, no psapi.lib needed
+#elif defined(__APPLE__)
+#	include <mach/mach.h>
+#	include <sys/resource.h>
+#endif
+
+namespace
+{
+#	if defined(__linux__)
+	// Reads a "<aKey>: <value> kB" line from /proc/self/status
+	std::size_t read_status_kib_( char const* aKey )
+	{
+		std::FILE* status = std::fopen( "/proc/self/status", "r" );
+		if( !status )
+			return 0;
+
+		auto const keyLength = std::strlen( aKey );
+
+		std::size_t kib = 0;
+		char line[256];
+		while( std::fgets( line, sizeof(line), status ) )
+		{
+			if( 0 == std::strncmp( line, aKey, keyLength ) && ':' == line[keyLength] )
+			{
+				unsigned long long value = 0;
+				if( 1 == std::sscanf( line + keyLength + 1, "%llu", &value ) )
+					kib = std::size_t(value);
+				break;
+			}
+		}
+
+		std::fclose( status );
+		return kib;
+	}
+#	endif // ~ __linux__
+}
+
+namespace labutils
+{
+	std::size_t current_resident_bytes()
+	{
+#		if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+			return 0;
+		return std::size_t(counters.WorkingSetSize);
+#		elif defined(__linux__)
+		return read_status_kib_( "VmRSS" ) * 1024;
+#		elif defined(__APPLE__)
+		mach_task_basic_info_data_t info{};
+		mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+		if( KERN_SUCCESS != task_info( mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count ) )
+			return 0;
+		return std::size_t(info.resident_size);
+#		else
+		return 0;
+#		endif
+	}
+
+	std::size_t peak_resident_bytes()
+	{
+#		if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+			return 0;
+		return std::size_t(counters.PeakWorkingSetSize);
+#		elif defined(__linux__)
+		return read_status_kib_( "VmHWM" ) * 1024;
+#		elif defined(__APPLE__)
+		rusage usage{};
+		if( 0 != getrusage( RUSAGE_SELF, &usage ) )
+			return 0;
+		return std::size_t(usage.ru_maxrss); // bytes on macOS
+#		else
+		return 0;
+#		endif
+	}
+
+	bool reset_peak_resident_bytes()
+	{
+#		if defined(__linux__)
+		// Writing "5" resets VmHWM (Linux 4.0 and later)
+		std::FILE* refs = std::fopen( "/proc/self/clear_refs", "w" );
+		if( !refs )
+			return false;
+
+		bool const ok = EOF != std::fputs( "5", refs );
+		return 0 == std::fclose( refs ) && ok;
+#		else
+		return false;
+#		endif
+	}
+}
+
+namespace labutils
+{
+	ResidentPeakScope::ResidentPeakScope()
+		: mBaseline( current_resident_bytes() )
+		, mReset( reset_peak_resident_bytes() )
+	{}
+
+	std::size_t ResidentPeakScope::peak_increase() const
+	{
+		auto const peak = peak_resident_bytes();
+		return peak > mBaseline ? peak - mBaseline : 0;
+	}
+
+	bool ResidentPeakScope::exact() const noexcept
+	{
+		return mReset;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace labutils
+{
+	// Resident set size (physical memory used by the process), in bytes.
+	// Returns zero if the platform does not provide the information.
+	std::size_t current_resident_bytes();
+
+	// Peak resident set size since process start or since the last
+	// successful call to reset_peak_resident_bytes().
+	std::size_t peak_resident_bytes();
+
+	// Resets the peak to the current resident set size, so that the peak of
+	// a single phase (e.g. loading a model) can be measured. Only supported
+	// on Linux (via /proc/self/clear_refs); returns false elsewhere, in which
+	// case the peak remains the peak since process start.
+	bool reset_peak_resident_bytes();
+
+	// Measures the peak resident set size during a scope, relative to the
+	// resident set size at its start.
+	class ResidentPeakScope
+	{
+		public:
+			ResidentPeakScope();
+
+		public:
+			// Increase of the peak over the resident set size at the start of
+			// the scope. If the peak could not be reset, this is a lower bound
+			// (the phase may have stayed below an earlier, higher peak).
+			std::size_t peak_increase() const;
+
+			bool exact() const noexcept;
+
+		private:
+			std::size_t mBaseline;
+			bool mReset;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
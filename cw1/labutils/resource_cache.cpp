@@ -0,0 +1,158 @@
+#include "resource_cache.hpp"
+
+#include <chrono>
+#include <utility>
+#include <filesystem>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace labutils
+{
+	ResourceCache::ResourceCache( VulkanContext const& aContext, Allocator const& aAllocator )
+		: mContext( &aContext )
+		, mAllocator( &aAllocator )
+	{}
+
+	std::shared_ptr<Texture const> ResourceCache::texture( std::string_view aPath, VkFormat aFormat, std::function<Image()> const& aLoad )
+	{
+		++mStats.textureRequests;
+
+		auto key = std::make_pair( normalize_path( aPath ), aFormat );
+		if( auto const it = mTextures.find( key ); mTextures.end() != it )
+		{
+			if( auto texture = it->second.texture.lock() )
+			{
+				mStats.textureBytesRequested += it->second.bytes;
+				mStats.savedMilliseconds += it->second.loadMilliseconds;
+				return texture;
+			}
+		}
+
+		auto const loadStart = std::chrono::steady_clock::now();
+
+		auto texture = std::make_shared<Texture>();
+		texture->image = aLoad();
+		texture->view = create_image_view_texture2d( *mContext, texture->image.image, aFormat );
+
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo( mAllocator->allocator, texture->image.allocation, &info );
+		texture->bytes = info.size;
+
+		double const loadMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - loadStart ).count();
+
+		++mStats.texturesLoaded;
+		mStats.textureBytes += texture->bytes;
+		mStats.textureBytesRequested += texture->bytes;
+		mStats.loadMilliseconds += loadMs;
+
+		mTextures[std::move(key)] = TextureEntry_{ texture, texture->bytes, loadMs };
+		return texture;
+	}
+
+	std::shared_ptr<Sampler const> ResourceCache::sampler( VkSamplerCreateInfo const& aInfo )
+	{
+		// The extension chain would have to be part of the key
+		if( aInfo.pNext )
+			throw Error( "ResourceCache::sampler(): VkSamplerCreateInfo::pNext must be null" );
+
+		++mStats.samplerRequests;
+
+		SamplerKey_ const key{
+			aInfo.flags,
+			aInfo.magFilter, aInfo.minFilter, aInfo.mipmapMode,
+			aInfo.addressModeU, aInfo.addressModeV, aInfo.addressModeW,
+			aInfo.mipLodBias, aInfo.anisotropyEnable, aInfo.maxAnisotropy, aInfo.compareEnable, aInfo.compareOp,
+			aInfo.minLod, aInfo.maxLod, aInfo.borderColor, aInfo.unnormalizedCoordinates
+		};
+
+		auto& entry = mSamplers[key];
+		if( auto sampler = entry.lock() )
+			return sampler;
+
+		VkSampler handle = VK_NULL_HANDLE;
+		if( auto const res = vkCreateSampler( mContext->device, &aInfo, nullptr, &handle ); VK_SUCCESS != res )
+			throw Error( "Unable to create sampler\nvkCreateSampler() returned %s", to_string(res).c_str() );
+
+		auto sampler = std::make_shared<Sampler const>( mContext->device, handle );
+		++mStats.samplersCreated;
+
+		entry = sampler;
+		return sampler;
+	}
+
+	std::shared_ptr<MaterialSet const> ResourceCache::material_set( VkDescriptorPool aPool, VkDescriptorSetLayout aLayout, std::shared_ptr<Texture const> aTexture, std::shared_ptr<Sampler const> aSampler )
+	{
+		assert( aTexture && aSampler );
+
+		++mStats.setRequests;
+
+		SetKey_ const key{ aPool, aLayout, aTexture->view.handle, aSampler->handle };
+		if( auto const it = mSets.find( key ); mSets.end() != it )
+		{
+			if( auto set = it->second.set.lock() )
+				return set;
+		}
+
+		// Recycle a set that is no longer used, or allocate a new one
+		VkDescriptorSet handle = VK_NULL_HANDLE;
+		for( auto it = mSets.begin(); mSets.end() != it; ++it )
+		{
+			if( std::get<0>(it->first) == aPool && std::get<1>(it->first) == aLayout && it->second.set.expired() )
+			{
+				handle = it->second.handle;
+				mSets.erase( it );
+				break;
+			}
+		}
+
+		if( VK_NULL_HANDLE == handle )
+		{
+			handle = alloc_desc_set( *mContext, aPool, aLayout );
+			++mStats.setsAllocated;
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = aTexture->view.handle;
+		imageInfo.sampler = aSampler->handle;
+
+		VkWriteDescriptorSet desc{};
+		desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc.dstSet = handle;
+		desc.dstBinding = 0;
+		desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		desc.descriptorCount = 1;
+		desc.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets( mContext->device, 1, &desc, 0, nullptr );
+
+		auto set = std::make_shared<MaterialSet const>( MaterialSet{ handle, std::move(aTexture), std::move(aSampler) } );
+		mSets[key] = SetEntry_{ set, handle };
+		return set;
+	}
+
+	ResourceCacheStats const& ResourceCache::stats() const noexcept
+	{
+		return mStats;
+	}
+
+	std::string ResourceCache::normalize_path( std::string_view aPath )
+	{
+		// Lexical only: "a/./b/../c.png" and "a\c.png" become "a/c.png".
+		// This does not touch the file system, so generated keys work, too.
+		std::string path( aPath );
+		for( auto& c : path )
+		{
+			if( '\\' == c )
+				c = '/';
+		}
+
+		return std::filesystem::path( path ).lexically_normal().generic_string();
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
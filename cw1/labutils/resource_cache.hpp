@@ -0,0 +1,129 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <map>
+#include <tuple>
+#include <memory>
+#include <string>
+#include <functional>
+#include <string_view>
+
+#include <cstddef>
+
+#include "vkimage.hpp"
+#include "vkobject.hpp"
+#include "allocator.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	/* Reference-counted cache for textures, samplers and material descriptor
+	 * sets.
+	 *
+	 * Each request returns a std::shared_ptr; the resource is destroyed when
+	 * the last user releases it, and a later request for the same key loads
+	 * it again. The cache itself only holds weak references. Keys are:
+	 *  - textures (image and view): the normalized path and the format,
+	 *  - samplers: all fields of the VkSamplerCreateInfo (without pNext),
+	 *  - descriptor sets: pool, layout, texture and sampler.
+	 *
+	 * Descriptor sets cannot be freed individually from the pools created by
+	 * create_descriptor_pool(), so sets whose users are gone are recycled for
+	 * the next material with the same pool and layout.
+	 *
+	 * Not thread-safe.
+	 */
+	struct Texture
+	{
+		Image image;
+		ImageView view;
+
+		VkDeviceSize bytes = 0; // size of the image's allocation
+	};
+
+	struct MaterialSet
+	{
+		VkDescriptorSet set = VK_NULL_HANDLE;
+
+		std::shared_ptr<Texture const> texture;
+		std::shared_ptr<Sampler const> sampler;
+	};
+
+	struct ResourceCacheStats
+	{
+		std::size_t textureRequests = 0, texturesLoaded = 0;
+		std::size_t samplerRequests = 0, samplersCreated = 0;
+		std::size_t setRequests = 0, setsAllocated = 0;
+
+		// Image memory that was allocated, and that would have been
+		// allocated without sharing
+		VkDeviceSize textureBytes = 0;
+		VkDeviceSize textureBytesRequested = 0;
+
+		// Time spent loading textures, and the load time of the textures
+		// that were shared instead of being loaded again
+		double loadMilliseconds = 0.0;
+		double savedMilliseconds = 0.0;
+	};
+
+	class ResourceCache
+	{
+		public:
+			ResourceCache( VulkanContext const&, Allocator const& );
+
+			ResourceCache( ResourceCache const& ) = delete;
+			ResourceCache& operator= (ResourceCache const&) = delete;
+
+		public:
+			// Returns the texture for (aPath, aFormat), calling aLoad() to
+			// create the image on a miss. aPath does not need to name a file;
+			// e.g. generated textures can use a descriptive key.
+			std::shared_ptr<Texture const> texture( std::string_view aPath, VkFormat aFormat, std::function<Image()> const& aLoad );
+
+			std::shared_ptr<Sampler const> sampler( VkSamplerCreateInfo const& );
+
+			// Descriptor set with aTexture and aSampler as a combined image
+			// sampler at binding 0 of aLayout
+			std::shared_ptr<MaterialSet const> material_set( VkDescriptorPool, VkDescriptorSetLayout, std::shared_ptr<Texture const> aTexture, std::shared_ptr<Sampler const> aSampler );
+
+			ResourceCacheStats const& stats() const noexcept;
+
+			static std::string normalize_path( std::string_view );
+
+		private:
+			struct TextureEntry_
+			{
+				std::weak_ptr<Texture const> texture;
+				VkDeviceSize bytes;
+				double loadMilliseconds;
+			};
+
+			using SamplerKey_ = std::tuple<
+				VkSamplerCreateFlags,
+				VkFilter, VkFilter, VkSamplerMipmapMode,
+				VkSamplerAddressMode, VkSamplerAddressMode, VkSamplerAddressMode,
+				float, VkBool32, float, VkBool32, VkCompareOp,
+				float, float, VkBorderColor, VkBool32
+			>;
+
+			using SetKey_ = std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkImageView, VkSampler>;
+
+			struct SetEntry_
+			{
+				std::weak_ptr<MaterialSet const> set;
+				VkDescriptorSet handle;
+			};
+
+			VulkanContext const* mContext;
+			Allocator const* mAllocator;
+
+			std::map<std::pair<std::string,VkFormat>, TextureEntry_> mTextures;
+			std::map<SamplerKey_, std::weak_ptr<Sampler const>> mSamplers;
+			std::map<SetKey_, SetEntry_> mSets;
+
+			ResourceCacheStats mStats;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,241 @@
+#include "staging_ring.hpp"
+
+#include <limits>
+#include <utility>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace
+{
+	VkDeviceSize align_up_( VkDeviceSize aValue, VkDeviceSize aAlignment ) noexcept
+	{
+		return (aValue + aAlignment-1) & ~(aAlignment-1);
+	}
+}
+
+namespace labutils
+{
+	StagingRing::StagingRing( VulkanContext const& aContext, Allocator const& aAllocator, VkDeviceSize aCapacity )
+		: mContext( &aContext )
+		, mAllocator( &aAllocator )
+		, mCapacity( align_up_( aCapacity > 0 ? aCapacity : 1, kMaxAlignment ) )
+	{
+		mBuffer = create_buffer(
+			aAllocator,
+			mCapacity,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_MEMORY_USAGE_CPU_TO_GPU,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT
+		);
+
+		mMapped = static_cast<std::byte*>(mapped_pointer( aAllocator, mBuffer ));
+		assert( mMapped );
+
+		mStats.capacity = mCapacity;
+	}
+
+	StagingRing::~StagingRing()
+	{
+		// The buffers must outlive the copies that read from them
+		for( auto const& pending : mPending )
+			vkWaitForFences( mContext->device, 1, &pending.fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max() );
+	}
+
+	StagingRegion StagingRing::allocate( VkDeviceSize aSize, VkDeviceSize aAlignment )
+	{
+		assert( aAlignment > 0 && 0 == (aAlignment & (aAlignment-1)) && aAlignment <= kMaxAlignment );
+
+		++mStats.allocations;
+		mStats.allocatedBytes += aSize;
+
+		if( aSize > mCapacity )
+			return allocate_dedicated_( aSize );
+
+		// Reclaim whatever has completed by now
+		while( !mPending.empty() && is_complete( mPending.front().id ) )
+			retire_front_( false );
+
+		bool waited = false;
+		for( ;; )
+		{
+			// Regions do not wrap; skip the rest of the buffer instead
+			auto pos = align_up_( mHead, aAlignment );
+			if( pos % mCapacity + aSize > mCapacity )
+				pos = (pos / mCapacity + 1) * mCapacity;
+
+			if( pos + aSize - mTail <= mCapacity )
+			{
+				mHead = pos + aSize;
+				mStats.waits += waited ? 1 : 0;
+				return StagingRegion{ mBuffer.buffer, pos % mCapacity, aSize, mMapped + pos % mCapacity };
+			}
+
+			if( !mPending.empty() )
+			{
+				retire_front_( true );
+				waited = true;
+				continue;
+			}
+
+			// Nothing in flight. If nothing is waiting to be submitted either,
+			// start over at the front of the buffer.
+			if( mHead == mSubmitted && mHead != 0 )
+			{
+				mHead = mSubmitted = mTail = 0;
+				continue;
+			}
+
+			mStats.waits += waited ? 1 : 0;
+			return allocate_dedicated_( aSize );
+		}
+	}
+
+	std::uint64_t StagingRing::submit( VkQueue aQueue, VkSubmitInfo const& aSubmit )
+	{
+		flush_pending_();
+
+		VkFence fence = acquire_fence_();
+		if( auto const res = vkQueueSubmit( aQueue, 1, &aSubmit, fence ); VK_SUCCESS != res )
+		{
+			mFreeFences.emplace_back( fence );
+			throw Error( "Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str() );
+		}
+
+		auto const id = mNextId++;
+		mPending.emplace_back( Pending_{ id, fence, mHead, std::move(mDedicated) } );
+		mDedicated.clear();
+		mSubmitted = mHead;
+
+		++mStats.submissions;
+		return id;
+	}
+
+	void StagingRing::wait( std::uint64_t aId )
+	{
+		assert( aId < mNextId );
+		while( !mPending.empty() && mPending.front().id <= aId )
+			retire_front_( true );
+	}
+
+	void StagingRing::wait_idle()
+	{
+		while( !mPending.empty() )
+			retire_front_( true );
+	}
+
+	bool StagingRing::is_complete( std::uint64_t aId )
+	{
+		if( aId <= mCompletedId )
+			return true;
+
+		for( auto const& pending : mPending )
+		{
+			if( pending.id > aId )
+				break;
+
+			auto const res = vkGetFenceStatus( mContext->device, pending.fence );
+			if( VK_NOT_READY == res )
+				return false;
+			if( VK_SUCCESS != res )
+				throw Error( "Querying staging fence\nvkGetFenceStatus() returned %s", to_string(res).c_str() );
+		}
+
+		return true;
+	}
+
+	VkDeviceSize StagingRing::capacity() const noexcept
+	{
+		return mCapacity;
+	}
+
+	StagingRingStats const& StagingRing::stats() const noexcept
+	{
+		return mStats;
+	}
+
+
+	StagingRegion StagingRing::allocate_dedicated_( VkDeviceSize aSize )
+	{
+		++mStats.dedicated;
+
+		auto& buffer = mDedicated.emplace_back( create_buffer(
+			*mAllocator,
+			aSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_MEMORY_USAGE_CPU_TO_GPU,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT
+		) );
+
+		auto* data = static_cast<std::byte*>(mapped_pointer( *mAllocator, buffer ));
+		assert( data );
+
+		return StagingRegion{ buffer.buffer, 0, aSize, data };
+	}
+
+	void StagingRing::flush_pending_()
+	{
+		// CPU_TO_GPU memory is not necessarily host-coherent
+		for( auto const& buffer : mDedicated )
+			flush_buffer( *mAllocator, buffer );
+
+		if( mHead == mSubmitted )
+			return;
+
+		if( mHead - mSubmitted >= mCapacity )
+		{
+			flush_buffer( *mAllocator, mBuffer );
+			return;
+		}
+
+		auto const beg = mSubmitted % mCapacity, end = mHead % mCapacity;
+		if( beg < end )
+		{
+			flush_buffer( *mAllocator, mBuffer, beg, end-beg );
+		}
+		else
+		{
+			flush_buffer( *mAllocator, mBuffer, beg, mCapacity-beg );
+			if( end > 0 )
+				flush_buffer( *mAllocator, mBuffer, 0, end );
+		}
+	}
+
+	void StagingRing::retire_front_( bool aWait )
+	{
+		assert( !mPending.empty() );
+		auto& front = mPending.front();
+
+		if( aWait )
+		{
+			if( auto const res = vkWaitForFences( mContext->device, 1, &front.fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+				throw Error( "Waiting for staging fence\nvkWaitForFences() returned %s", to_string(res).c_str() );
+		}
+
+		if( auto const res = vkResetFences( mContext->device, 1, &front.fence ); VK_SUCCESS != res )
+			throw Error( "Resetting staging fence\nvkResetFences() returned %s", to_string(res).c_str() );
+
+		mFreeFences.emplace_back( front.fence );
+		mTail = front.end;
+		mCompletedId = front.id;
+
+		mPending.pop_front(); // releases the dedicated buffers
+	}
+
+	VkFence StagingRing::acquire_fence_()
+	{
+		if( !mFreeFences.empty() )
+		{
+			auto const fence = mFreeFences.back();
+			mFreeFences.pop_back();
+			return fence;
+		}
+
+		return mFences.emplace_back( create_fence( *mContext ) ).handle;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <deque>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkbuffer.hpp"
+#include "vkobject.hpp"
+#include "allocator.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	/* Staging memory shared by all uploads.
+	 *
+	 * The ring is a single persistently mapped CPU_TO_GPU buffer. allocate()
+	 * hands out aligned regions of it, front to back, wrapping around at the
+	 * end. submit() submits the commands that read the regions allocated
+	 * since the previous submit() with a fence; the regions are reclaimed
+	 * once the fence has signalled. allocate() only blocks if the ring is
+	 * full of regions that are still in flight, and then waits for the
+	 * oldest submission.
+	 *
+	 * Requests that do not fit (larger than the ring, or larger than what is
+	 * left next to the regions that have not been submitted yet) get a
+	 * dedicated buffer that is released with the submission, so allocate()
+	 * never fails for lack of space; stats() counts these.
+	 *
+	 * Every allocation must be followed by a submit() before the ring is
+	 * destroyed. The destructor waits for all submissions.
+	 *
+	 * Not thread-safe.
+	 */
+	struct StagingRegion
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0; // in buffer
+		VkDeviceSize size = 0;
+		std::byte* data = nullptr; // mapped; see offset
+	};
+
+	struct StagingRingStats
+	{
+		VkDeviceSize capacity = 0;
+		VkDeviceSize allocatedBytes = 0; // including dedicated buffers
+		std::size_t allocations = 0;
+		std::size_t submissions = 0;
+		std::size_t waits = 0; // allocations that waited for space
+		std::size_t dedicated = 0; // allocations that did not fit the ring
+	};
+
+	class StagingRing
+	{
+		public:
+			// aCapacity is rounded up to a multiple of kMaxAlignment
+			StagingRing( VulkanContext const&, Allocator const&, VkDeviceSize aCapacity );
+			~StagingRing();
+
+			StagingRing( StagingRing const& ) = delete;
+			StagingRing& operator= (StagingRing const&) = delete;
+
+		public:
+			static constexpr VkDeviceSize kMaxAlignment = 256;
+
+			// aAlignment must be a power of two no larger than kMaxAlignment.
+			// The region is flushed by submit().
+			StagingRegion allocate( VkDeviceSize aSize, VkDeviceSize aAlignment = 16 );
+
+			// Submits aSubmit to aQueue with a fence that releases the regions
+			// allocated since the previous submit(). Returns an id for wait().
+			// Throws labutils::Error (with the regions still pending) if the
+			// submission fails.
+			std::uint64_t submit( VkQueue, VkSubmitInfo const& );
+
+			// Waits until the submission aId and all earlier ones have
+			// completed.
+			void wait( std::uint64_t aId );
+			void wait_idle();
+
+			bool is_complete( std::uint64_t aId );
+
+			VkDeviceSize capacity() const noexcept;
+			StagingRingStats const& stats() const noexcept;
+
+		private:
+			struct Pending_
+			{
+				std::uint64_t id;
+				VkFence fence;
+				std::uint64_t end; // ring position
+				std::vector<Buffer> dedicated;
+			};
+
+			StagingRegion allocate_dedicated_( VkDeviceSize );
+			void flush_pending_();
+			void retire_front_( bool aWait );
+			VkFence acquire_fence_();
+
+			VulkanContext const* mContext;
+			Allocator const* mAllocator;
+
+			Buffer mBuffer;
+			std::byte* mMapped = nullptr;
+			VkDeviceSize mCapacity = 0;
+
+			// Positions increase monotonically; the offset in the buffer is
+			// position % mCapacity. [mTail,mSubmitted) is in flight and
+			// [mSubmitted,mHead) has been allocated but not submitted yet.
+			std::uint64_t mHead = 0, mSubmitted = 0, mTail = 0;
+
+			std::deque<Pending_> mPending;
+			std::vector<Buffer> mDedicated; // not submitted yet
+			std::uint64_t mNextId = 1, mCompletedId = 0;
+
+			std::vector<Fence> mFences;
+			std::vector<VkFence> mFreeFences;
+
+			StagingRingStats mStats;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
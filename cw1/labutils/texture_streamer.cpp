@@ -0,0 +1,645 @@
+#include "texture_streamer.hpp"
+
+#include <limits>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include "ktx2.hpp"
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+#include "upload_queue.hpp"
+#include "image_decode.hpp"
+
+namespace
+{
+	// Estimated size of a level, for planning; the images' actual sizes
+	// are only known once they have been allocated
+	VkDeviceSize level_bytes_( VkFormat aFormat, VkExtent2D const& aExtent ) noexcept
+	{
+		auto const blocks = VkDeviceSize((aExtent.width+3)/4) * ((aExtent.height+3)/4);
+
+		switch( aFormat )
+		{
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+				return blocks * 8;
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+				return blocks * 16;
+			default:
+				return VkDeviceSize(aExtent.width) * aExtent.height * 4;
+		}
+	}
+}
+
+namespace labutils
+{
+	MipChainSource ktx2_mip_source( std::shared_ptr<Ktx2Image const> aImage )
+	{
+		assert( aImage );
+
+		MipChainSource ret;
+		ret.format = aImage->format;
+		for( auto const& level : aImage->levels )
+			ret.extents.emplace_back( VkExtent2D{ level.width, level.height } );
+
+		ret.load = [image = std::move(aImage)] ( std::uint32_t aLevel ) {
+			return StreamedLevel{ image->levels[aLevel], image };
+		};
+
+		return ret;
+	}
+
+	MipChainSource level_pattern_mip_source( std::string aPattern )
+	{
+		auto const description = describe_image_levels( aPattern.c_str() );
+
+		MipChainSource ret;
+		ret.format = VK_FORMAT_R8G8B8A8_SRGB;
+		for( auto const& level : description.levels )
+			ret.extents.emplace_back( VkExtent2D{ level.width, level.height } );
+
+		ret.load = [pattern = std::move(aPattern), extents = ret.extents] ( std::uint32_t aLevel ) {
+			// Only the requested level is decoded
+			auto image = std::make_shared<DecodedImage>();
+			image->source = pattern;
+			image->levels.resize( aLevel+1 );
+			image->levels[aLevel].width = extents[aLevel].width;
+			image->levels[aLevel].height = extents[aLevel].height;
+
+			decode_image_level( *image, aLevel );
+
+			auto const& level = image->levels[aLevel];
+			return StreamedLevel{ ImageLevelData{ level.width, level.height, level.pixels.get(), level.size_bytes() }, std::move(image) };
+		};
+
+		return ret;
+	}
+
+	MipChainSource memory_mip_source( VkFormat aFormat, std::vector<ImageLevelData> aLevels, std::shared_ptr<void const> aOwner )
+	{
+		MipChainSource ret;
+		ret.format = aFormat;
+		for( auto const& level : aLevels )
+			ret.extents.emplace_back( VkExtent2D{ level.width, level.height } );
+
+		ret.load = [levels = std::move(aLevels), owner = std::move(aOwner)] ( std::uint32_t aLevel ) {
+			return StreamedLevel{ levels[aLevel], owner };
+		};
+
+		return ret;
+	}
+
+
+	TextureStreamer::TextureStreamer( VulkanContext const& aContext, Allocator const& aAllocator, UploadQueue& aQueue, VkDescriptorPool aPool, VkDescriptorSetLayout aTextureLayout, VkDescriptorSetLayout aFeedbackLayout, VkSampler aSampler, TextureStreamerConfig const& aConfig, BindlessTextures* aBindless )
+		: mContext( &aContext )
+		, mAllocator( &aAllocator )
+		, mQueue( &aQueue )
+		, mPool( aPool )
+		, mTextureLayout( aTextureLayout )
+		, mFeedbackLayout( aFeedbackLayout )
+		, mSampler( aSampler )
+		, mConfig( aConfig )
+		, mBindless( aBindless )
+		, mLoaders( std::max<std::size_t>( 1, aConfig.loaderThreads ) )
+	{
+		assert( mConfig.frameSlots > 0 );
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Loads own copies of their sources, but the sources' load functions
+		// may refer to data that the caller releases once this returns
+		for( auto const& texture : mTextures )
+		{
+			if( texture->loading )
+				texture->load.wait();
+		}
+	}
+
+	std::uint32_t TextureStreamer::add( MipChainSource aSource )
+	{
+		assert( mSlots.empty() && "Textures must be added before the first frame" );
+		assert( !aSource.extents.empty() && aSource.load );
+
+		auto texture = std::make_unique<Texture_>();
+		texture->source = std::move(aSource);
+
+		// Smallest levels first
+		auto const& extents = texture->source.extents;
+
+		std::uint32_t base = 0;
+		while( base+1 < extents.size() && (extents[base].width > mConfig.initialExtent || extents[base].height > mConfig.initialExtent) )
+			++base;
+
+		texture->initialBase = base;
+		texture->wanted = base;
+
+		auto const index = std::uint32_t(mTextures.size());
+		mTextures.emplace_back( std::move(texture) );
+
+		auto const& source = mTextures.back()->source;
+		install_( index, load_( source, base, std::uint32_t(source.extents.size()) - base ) );
+		return index;
+	}
+
+	void TextureStreamer::begin_frame( std::uint32_t aSlot )
+	{
+		if( mSlots.empty() )
+			create_slots_();
+
+		assert( aSlot < mSlots.size() );
+		++mFrame;
+
+		read_feedback_( mSlots[aSlot] );
+		apply_loads_();
+		schedule_();
+
+		update_sets_( aSlot );
+		retire_();
+	}
+
+	void TextureStreamer::record_feedback_clear( VkCommandBuffer aCmdBuff, std::uint32_t aSlot )
+	{
+		assert( aSlot < mSlots.size() );
+		auto const& slot = mSlots[aSlot];
+
+		// All ones: nothing was requested
+		vkCmdFillBuffer( aCmdBuff, slot.feedback.buffer, 0, VK_WHOLE_SIZE, ~std::uint32_t(0) );
+
+		buffer_barrier( aCmdBuff, slot.feedback.buffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		);
+	}
+
+	void TextureStreamer::record_feedback_readback( VkCommandBuffer aCmdBuff, std::uint32_t aSlot )
+	{
+		assert( aSlot < mSlots.size() );
+		auto& slot = mSlots[aSlot];
+
+		buffer_barrier( aCmdBuff, slot.feedback.buffer,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT
+		);
+
+		VkBufferCopy copy{};
+		copy.size = std::max<VkDeviceSize>( 1, mTextures.size() ) * sizeof(std::uint32_t);
+		vkCmdCopyBuffer( aCmdBuff, slot.feedback.buffer, slot.readback.buffer, 1, &copy );
+
+		buffer_barrier( aCmdBuff, slot.readback.buffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_HOST_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT
+		);
+
+		slot.recorded = true;
+	}
+
+	VkDescriptorSet TextureStreamer::texture_set( std::uint32_t aTexture, std::uint32_t aSlot ) const noexcept
+	{
+		assert( aTexture < mTextures.size() && aSlot < mSlots.size() );
+		assert( !mBindless );
+		return mTextures[aTexture]->sets[aSlot];
+	}
+
+	std::uint32_t TextureStreamer::bindless_index( std::uint32_t aTexture ) const noexcept
+	{
+		assert( aTexture < mTextures.size() );
+		return mTextures[aTexture]->bindlessIndex;
+	}
+
+	VkDescriptorSet TextureStreamer::feedback_set( std::uint32_t aSlot ) const noexcept
+	{
+		assert( aSlot < mSlots.size() );
+		return mSlots[aSlot].feedbackSet;
+	}
+
+	std::size_t TextureStreamer::texture_count() const noexcept
+	{
+		return mTextures.size();
+	}
+
+	TextureStreamerStats TextureStreamer::stats() const
+	{
+		auto ret = mStats;
+		ret.textures = mTextures.size();
+		ret.residentLevels = ret.totalLevels = 0;
+		for( auto const& texture : mTextures )
+		{
+			ret.residentLevels += texture->source.extents.size() - texture->base;
+			ret.totalLevels += texture->source.extents.size();
+		}
+
+		ret.residentBytes = mResidentBytes;
+		return ret;
+	}
+
+
+	auto TextureStreamer::load_( MipChainSource const& aSource, std::uint32_t aBase, std::uint32_t aCount ) -> Loaded_
+	{
+		Loaded_ ret;
+		ret.base = aBase;
+		for( auto level = aBase; level < aBase + aCount; ++level )
+			ret.levels.emplace_back( aSource.load( level ) );
+
+		return ret;
+	}
+
+	void TextureStreamer::install_( std::uint32_t aTexture, Loaded_ const& aLoaded )
+	{
+		auto& texture = *mTextures[aTexture];
+
+		auto const& extents = texture.source.extents;
+		auto const mipLevels = std::uint32_t(extents.size()) - aLoaded.base;
+		auto const loadedEnd = aLoaded.base + std::uint32_t(aLoaded.levels.size());
+		assert( mipLevels > 0 && loadedEnd <= extents.size() );
+
+		// The new image may itself be a copy source later on
+		auto image = create_image_texture2d( *mAllocator, extents[aLoaded.base].width, extents[aLoaded.base].height, texture.source.format,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipLevels );
+
+		// Levels that are resident already are copied from the current image
+		// on the GPU, rather than loaded again
+		ImageLevelSource resident;
+		if( loadedEnd < extents.size() )
+		{
+			assert( VK_NULL_HANDLE != texture.image.image && loadedEnd >= texture.base );
+			resident = ImageLevelSource{ texture.image.image, loadedEnd - texture.base };
+		}
+
+		if( aLoaded.levels.empty() )
+		{
+			mQueue->copy_to_image( image.image, mipLevels, extents[aLoaded.base], resident );
+		}
+		else
+		{
+			// The data is copied to staging memory right away, and is not
+			// needed afterwards. Level sizes are multiples of the texel block
+			// size, so all levels stay aligned to it.
+			VkDeviceSize sizeInBytes = 0;
+			for( auto const& level : aLoaded.levels )
+				sizeInBytes += level.data.size;
+
+			auto const staging = mQueue->stage( sizeInBytes, 16 );
+
+			std::vector<VkBufferImageCopy> copies( aLoaded.levels.size() );
+
+			VkDeviceSize offset = 0;
+			for( std::uint32_t i = 0; i < copies.size(); ++i )
+			{
+				auto const& data = aLoaded.levels[i].data;
+				std::memcpy( staging.data + offset, data.data, data.size );
+
+				auto& copy = copies[i];
+				copy.bufferOffset = offset;
+				copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+				copy.imageExtent = VkExtent3D{ data.width, data.height, 1 };
+
+				offset += data.size;
+			}
+
+			mStats.uploadedBytes += sizeInBytes;
+
+			if( VK_NULL_HANDLE != resident.image )
+				mQueue->copy_to_image( staging, image.image, mipLevels, copies, resident );
+			else
+				mQueue->copy_to_image( staging, image.image, mipLevels, copies );
+		}
+
+		auto view = create_image_view_texture2d( *mContext, image.image, texture.source.format );
+
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo( mAllocator->allocator, image.allocation, &info );
+
+		if( VK_NULL_HANDLE != texture.image.image )
+		{
+			mRetired.emplace_back( Retired_{ aTexture, texture.version, mQueue->ticket(), std::move(texture.image), std::move(texture.view) } );
+			mResidentBytes -= texture.bytes;
+		}
+
+		texture.image = std::move(image);
+		texture.view = std::move(view);
+		texture.base = aLoaded.base;
+		texture.bytes = info.size;
+		++texture.version;
+
+		if( mBindless )
+		{
+			if( kNoBindlessTexture == texture.bindlessIndex )
+				texture.bindlessIndex = mBindless->add( texture.view.handle, mSampler );
+			else
+				mBindless->update( texture.bindlessIndex, texture.view.handle );
+		}
+
+		mResidentBytes += texture.bytes;
+	}
+
+	void TextureStreamer::create_slots_()
+	{
+		auto const bytes = std::max<VkDeviceSize>( 1, mTextures.size() ) * sizeof(std::uint32_t);
+
+		mSlots.resize( mConfig.frameSlots );
+		for( auto& slot : mSlots )
+		{
+			slot.feedback = create_buffer(
+				*mAllocator,
+				bytes,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY
+			);
+			slot.readback = create_buffer(
+				*mAllocator,
+				bytes,
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_TO_CPU,
+				VMA_ALLOCATION_CREATE_MAPPED_BIT
+			);
+			slot.readbackData = static_cast<std::uint32_t const*>(mapped_pointer( *mAllocator, slot.readback ));
+			assert( slot.readbackData );
+
+			slot.feedbackSet = alloc_desc_set( *mContext, mPool, mFeedbackLayout );
+
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = slot.feedback.buffer;
+			bufferInfo.range = VK_WHOLE_SIZE;
+
+			VkWriteDescriptorSet desc{};
+			desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc.dstSet = slot.feedbackSet;
+			desc.dstBinding = 0;
+			desc.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			desc.descriptorCount = 1;
+			desc.pBufferInfo = &bufferInfo;
+
+			vkUpdateDescriptorSets( mContext->device, 1, &desc, 0, nullptr );
+
+			// Version 0 is never used, so all sets are written on the slot's
+			// first frame
+			slot.versions.assign( mTextures.size(), 0 );
+			slot.bases.assign( mTextures.size(), 0 );
+		}
+
+		if( mBindless )
+			return;
+
+		for( auto const& texture : mTextures )
+		{
+			for( std::size_t i = 0; i < mSlots.size(); ++i )
+				texture->sets.emplace_back( alloc_desc_set( *mContext, mPool, mTextureLayout ) );
+		}
+	}
+
+	void TextureStreamer::read_feedback_( Slot_& aSlot )
+	{
+		if( !aSlot.recorded )
+			return;
+
+		if( auto const res = vmaInvalidateAllocation( mAllocator->allocator, aSlot.readback.allocation, 0, VK_WHOLE_SIZE ); VK_SUCCESS != res )
+			throw Error( "Unable to invalidate feedback buffer\nvmaInvalidateAllocation() returned %s", to_string(res).c_str() );
+
+		for( std::size_t i = 0; i < mTextures.size(); ++i )
+		{
+			auto const value = aSlot.readbackData[i];
+			if( ~std::uint32_t(0) == value )
+				continue; // not visible
+
+			// The shader's level is relative to the image that was bound;
+			// levels coarser than the initial ones are always resident
+			auto& texture = *mTextures[i];
+			auto const level = std::int64_t(value) - std::int64_t(kFeedbackLodBias) + aSlot.bases[i];
+			auto const wanted = std::uint32_t(std::clamp<std::int64_t>( level, 0, texture.initialBase ));
+
+			// Requests for coarser levels only take over once the finer
+			// ones have not been asked for in a while
+			if( wanted <= texture.wanted || mFrame - texture.wantedFrame > mConfig.keepFrames )
+			{
+				texture.wanted = wanted;
+				texture.wantedFrame = mFrame;
+			}
+		}
+	}
+
+	void TextureStreamer::apply_loads_()
+	{
+		for( std::uint32_t i = 0; i < mTextures.size(); ++i )
+		{
+			auto& texture = *mTextures[i];
+			if( !texture.loading || std::future_status::ready != texture.load.wait_for( std::chrono::seconds(0) ) )
+				continue;
+
+			if( !mQueue->has_budget() )
+			{
+				++mStats.deferred;
+				continue;
+			}
+
+			auto const loaded = texture.load.get(); // re-throws errors from the source
+			texture.loading = false;
+			--mLoadsInFlight;
+
+			mStats.loads += loaded.levels.size();
+			install_( i, loaded );
+		}
+	}
+
+	void TextureStreamer::schedule_()
+	{
+		auto const budget = budget_();
+		mStats.budgetBytes = budget;
+
+		// Planned use, counting loads in flight as done
+		VkDeviceSize planned = 0;
+
+		std::vector<std::uint32_t> grow, trim;
+		for( std::uint32_t i = 0; i < mTextures.size(); ++i )
+		{
+			auto& texture = *mTextures[i];
+			if( mFrame - texture.wantedFrame > mConfig.keepFrames )
+				texture.wanted = texture.initialBase;
+
+			planned += chain_bytes_( texture, texture.loading ? texture.target : texture.base );
+
+			if( texture.loading )
+				continue;
+
+			if( texture.wanted < texture.base )
+				grow.emplace_back( i );
+			else if( texture.wanted > texture.base )
+				trim.emplace_back( i );
+		}
+
+		// Largest shortfall first; trim the textures that were used least
+		// recently first
+		std::sort( grow.begin(), grow.end(), [this] ( std::uint32_t aX, std::uint32_t aY ) {
+			auto const& x = *mTextures[aX];
+			auto const& y = *mTextures[aY];
+			return x.base - x.wanted > y.base - y.wanted;
+		} );
+		std::sort( trim.begin(), trim.end(), [this] ( std::uint32_t aX, std::uint32_t aY ) {
+			return mTextures[aX]->wantedFrame < mTextures[aY]->wantedFrame;
+		} );
+
+		// Trimming only copies the remaining levels on the GPU, so it
+		// happens right away
+		std::size_t nextTrim = 0;
+		auto const trim_next = [&] {
+			auto const index = trim[nextTrim++];
+			auto const& texture = *mTextures[index];
+
+			planned -= chain_bytes_( texture, texture.base ) - chain_bytes_( texture, texture.wanted );
+			mStats.evictions += texture.wanted - texture.base;
+			install_( index, Loaded_{ texture.wanted, {} } );
+		};
+
+		while( planned > budget && nextTrim < trim.size() )
+			trim_next();
+
+		for( auto const index : grow )
+		{
+			if( mLoadsInFlight >= mConfig.maxLoadsInFlight )
+				break;
+
+			auto const& texture = *mTextures[index];
+			auto const target = texture.base - 1;
+			auto const extra = chain_bytes_( texture, target ) - chain_bytes_( texture, texture.base );
+
+			while( planned + extra > budget && nextTrim < trim.size() )
+				trim_next();
+
+			// Smaller textures may still fit
+			if( planned + extra > budget )
+				continue;
+
+			start_load_( index, target );
+			planned += extra;
+		}
+	}
+
+	void TextureStreamer::start_load_( std::uint32_t aTexture, std::uint32_t aBase )
+	{
+		auto& texture = *mTextures[aTexture];
+		assert( !texture.loading );
+
+		texture.loading = true;
+		texture.target = aBase;
+		++mLoadsInFlight;
+
+		// Only the new levels; the resident ones are copied over on install
+		texture.load = mLoaders.submit( [source = texture.source, aBase, count = texture.base - aBase] {
+			return load_( source, aBase, count );
+		} );
+	}
+
+	void TextureStreamer::update_sets_( std::uint32_t aSlot )
+	{
+		auto& slot = mSlots[aSlot];
+
+		std::vector<VkDescriptorImageInfo> imageInfos;
+		std::vector<VkWriteDescriptorSet> writes;
+		imageInfos.reserve( mTextures.size() );
+
+		for( std::size_t i = 0; i < mTextures.size(); ++i )
+		{
+			auto const& texture = *mTextures[i];
+			if( slot.versions[i] == texture.version )
+				continue;
+
+			slot.versions[i] = texture.version;
+			slot.bases[i] = texture.base;
+
+			// The table writes the slot's set (see BindlessTextures::begin_frame())
+			if( mBindless )
+				continue;
+
+			auto& imageInfo = imageInfos.emplace_back();
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = texture.view.handle;
+			imageInfo.sampler = mSampler;
+
+			auto& desc = writes.emplace_back();
+			desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc.dstSet = texture.sets[aSlot];
+			desc.dstBinding = 0;
+			desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			desc.descriptorCount = 1;
+			desc.pImageInfo = &imageInfo;
+		}
+
+		if( !writes.empty() )
+			vkUpdateDescriptorSets( mContext->device, std::uint32_t(writes.size()), writes.data(), 0, nullptr );
+	}
+
+	void TextureStreamer::retire_()
+	{
+		// An image can go once every slot's set has moved past it; each slot
+		// is only updated after its previous frame has completed. Its levels
+		// may also still be copied to its replacement.
+		auto const unused = [this] ( Retired_ const& aRetired ) {
+			if( !mQueue->is_complete( aRetired.ticket ) )
+				return false;
+
+			for( auto const& slot : mSlots )
+			{
+				if( slot.versions[aRetired.texture] <= aRetired.version )
+					return false;
+			}
+			return true;
+		};
+
+		mRetired.erase( std::remove_if( mRetired.begin(), mRetired.end(), unused ), mRetired.end() );
+	}
+
+	VkDeviceSize TextureStreamer::budget_() const
+	{
+		if( mConfig.budgetBytes )
+			return mConfig.budgetBytes;
+
+		VkPhysicalDeviceMemoryProperties const* props = nullptr;
+		vmaGetMemoryProperties( mAllocator->allocator, &props );
+
+		// The largest device-local heap is where the textures go
+		std::uint32_t heap = 0;
+		bool found = false;
+		for( std::uint32_t i = 0; i < props->memoryHeapCount; ++i )
+		{
+			auto const& candidate = props->memoryHeaps[i];
+			if( (candidate.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && (!found || candidate.size > props->memoryHeaps[heap].size) )
+			{
+				heap = i;
+				found = true;
+			}
+		}
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+		vmaGetHeapBudgets( mAllocator->allocator, budgets );
+
+		// Leave room for everything else that uses the heap
+		auto const& budget = budgets[heap];
+		auto const others = budget.usage > mResidentBytes ? budget.usage - mResidentBytes : 0;
+		auto const available = budget.budget > others ? budget.budget - others : 0;
+
+		return std::min( VkDeviceSize(double(budget.budget) * mConfig.heapBudgetFraction), available );
+	}
+
+	VkDeviceSize TextureStreamer::chain_bytes_( Texture_ const& aTexture, std::uint32_t aBase ) const noexcept
+	{
+		VkDeviceSize ret = 0;
+		for( auto level = aBase; level < aTexture.source.extents.size(); ++level )
+			ret += level_bytes_( aTexture.source.format, aTexture.source.extents[level] );
+
+		return ret;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
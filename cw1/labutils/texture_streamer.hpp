@@ -0,0 +1,268 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <future>
+#include <functional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkimage.hpp"
+#include "vkbuffer.hpp"
+#include "vkobject.hpp"
+#include "allocator.hpp"
+#include "thread_pool.hpp"
+#include "upload_queue.hpp"
+#include "bindless_textures.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	struct Ktx2Image;
+
+	/* Mip-level streaming driven by feedback from the GPU.
+	 *
+	 * A streamed texture starts out with only its smallest levels resident,
+	 * i.e. those up to TextureStreamerConfig::initialExtent. The resident
+	 * levels [base,n) of the full chain make up the image that is bound; the
+	 * finer levels are simply not part of it. Changing the residency
+	 * replaces the image with one holding the new range, so that evicted
+	 * levels actually free their memory. The levels that stay resident are
+	 * copied from the old image to the new one on the GPU (see
+	 * UploadQueue::copy_to_image()), so only new levels are ever loaded, and
+	 * evictions never touch the source.
+	 *
+	 * The fragment shader writes the finest level that each streamed texture
+	 * needs into a feedback buffer (see feedback_set()); the level is
+	 * relative to the bound image, and biased by kFeedbackLodBias so that it
+	 * stays positive. The buffer is copied back each frame and read once the
+	 * frame has completed. Textures that need finer levels have the next one
+	 * loaded from their MipChainSource on a worker thread, and uploaded
+	 * through the UploadQueue while it has budget for the frame.
+	 *
+	 * All streamed images together stay within a memory budget, which is
+	 * either given, or a fraction of the device-local heap's budget as
+	 * reported by VMA. Textures that have more levels than they were asked
+	 * for recently are trimmed to make room, the ones unused for longest
+	 * first.
+	 *
+	 * Each texture has one descriptor set per frame slot (i.e. per frame
+	 * that may be in flight), or, with a BindlessTextures table, one entry in
+	 * the table's per-slot sets. A slot's sets are updated by begin_frame(),
+	 * once the slot's previous frame has completed; replaced images are
+	 * destroyed once no slot refers to them any more.
+	 *
+	 * Not thread-safe; the worker threads only run MipChainSource::load.
+	 */
+	constexpr std::uint32_t kNoStreamedTexture = ~std::uint32_t(0);
+	constexpr std::uint32_t kFeedbackLodBias = 32; // must match the fragment shader
+
+	// Data of one level of a mip chain, kept alive by owner (if the source
+	// does not outlive the streamer by itself)
+	struct StreamedLevel
+	{
+		ImageLevelData data;
+		std::shared_ptr<void const> owner;
+	};
+
+	// Full mip chain of a streamed texture, level 0 first. load() is called
+	// on the worker threads, for any level; it must be safe to call
+	// concurrently, including with different levels.
+	struct MipChainSource
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		std::vector<VkExtent2D> extents;
+
+		std::function<StreamedLevel(std::uint32_t aLevel)> load;
+	};
+
+	// Levels of a baked texture, read from its mapping (see map_ktx2())
+	MipChainSource ktx2_mip_source( std::shared_ptr<Ktx2Image const> );
+
+	// A full mip chain in files, as for load_image_texture2d(); each level is
+	// decoded when it is loaded (see decode_image_level())
+	MipChainSource level_pattern_mip_source( std::string aPattern );
+
+	// Levels in memory, e.g. of a DecodedImage or CompressedImage; aOwner
+	// keeps them alive
+	MipChainSource memory_mip_source( VkFormat, std::vector<ImageLevelData>, std::shared_ptr<void const> aOwner );
+
+
+	struct TextureStreamerConfig
+	{
+		std::uint32_t frameSlots = 1;
+
+		// Levels with both sides at most this large are resident from the
+		// start, and are never evicted
+		std::uint32_t initialExtent = 128;
+
+		VkDeviceSize budgetBytes = 0; // 0: derived from the heap budget
+		float heapBudgetFraction = 0.5f; // of the device-local heap's budget
+
+		std::size_t loaderThreads = 1;
+		std::size_t maxLoadsInFlight = 4;
+
+		// Frames after which a texture's request for finer levels expires
+		std::uint32_t keepFrames = 120;
+	};
+
+	struct TextureStreamerStats
+	{
+		std::size_t textures = 0;
+		std::size_t residentLevels = 0, totalLevels = 0;
+
+		VkDeviceSize residentBytes = 0;
+		VkDeviceSize budgetBytes = 0;
+
+		std::size_t loads = 0; // finer levels loaded
+		std::size_t evictions = 0; // levels dropped to stay within budget, without loading anything
+		std::size_t deferred = 0; // loaded levels that waited for upload budget
+		VkDeviceSize uploadedBytes = 0;
+	};
+
+	class TextureStreamer
+	{
+		public:
+			// aTextureLayout has a combined image sampler at binding 0 (as for
+			// ResourceCache::material_set()), aFeedbackLayout a storage buffer
+			// at binding 0. Sets are allocated from aPool.
+			//
+			// With aBindless, the textures are entries of its table instead,
+			// and aTextureLayout is unused; the table's begin_frame() must
+			// then be called for a slot after the streamer's.
+			TextureStreamer(
+				VulkanContext const&,
+				Allocator const&,
+				UploadQueue&,
+				VkDescriptorPool aPool,
+				VkDescriptorSetLayout aTextureLayout,
+				VkDescriptorSetLayout aFeedbackLayout,
+				VkSampler,
+				TextureStreamerConfig const& = {},
+				BindlessTextures* aBindless = nullptr
+			);
+			~TextureStreamer(); // waits for outstanding loads
+
+			TextureStreamer( TextureStreamer const& ) = delete;
+			TextureStreamer& operator= (TextureStreamer const&) = delete;
+
+		public:
+			// Loads and uploads the initial levels. Returns the texture's
+			// index, which is also its entry in the feedback buffer. Textures
+			// must be added before the first begin_frame().
+			std::uint32_t add( MipChainSource );
+
+			// Call once the slot's previous frame has completed, and before
+			// recording the next one for it. Reads the slot's feedback,
+			// uploads loaded levels, starts new loads and evictions, and
+			// updates the slot's descriptor sets.
+			void begin_frame( std::uint32_t aSlot );
+
+			// Clears the slot's feedback buffer; record before the draws
+			void record_feedback_clear( VkCommandBuffer, std::uint32_t aSlot );
+			// Copies the slot's feedback back to the host; record after the
+			// draws, outside of a render pass
+			void record_feedback_readback( VkCommandBuffer, std::uint32_t aSlot );
+
+			VkDescriptorSet texture_set( std::uint32_t aTexture, std::uint32_t aSlot ) const noexcept;
+			// Index in the BindlessTextures table, if any
+			std::uint32_t bindless_index( std::uint32_t aTexture ) const noexcept;
+			VkDescriptorSet feedback_set( std::uint32_t aSlot ) const noexcept;
+
+			std::size_t texture_count() const noexcept;
+			TextureStreamerStats stats() const;
+
+		private:
+			struct Loaded_
+			{
+				std::uint32_t base;
+				std::vector<StreamedLevel> levels; // [base,base+size); the rest are resident
+			};
+
+			struct Texture_
+			{
+				MipChainSource source;
+				std::uint32_t initialBase;
+
+				Image image;
+				ImageView view;
+				std::uint32_t base; // first resident level
+				VkDeviceSize bytes = 0;
+				std::uint32_t version = 0; // increases with each new image
+
+				std::vector<VkDescriptorSet> sets; // per slot; empty if bindless
+				std::uint32_t bindlessIndex = kNoBindlessTexture;
+
+				// Finest level asked for, and the frame it was last asked for
+				std::uint32_t wanted;
+				std::uint64_t wantedFrame = 0;
+
+				bool loading = false;
+				std::uint32_t target; // the level being loaded
+				std::future<Loaded_> load;
+			};
+
+			struct Slot_
+			{
+				Buffer feedback; // device-local, written by the shaders
+				Buffer readback; // host-visible copy
+				std::uint32_t const* readbackData = nullptr;
+				VkDescriptorSet feedbackSet = VK_NULL_HANDLE;
+
+				// State of each texture's set, as of the last update
+				std::vector<std::uint32_t> versions, bases;
+				bool recorded = false; // has feedback to read
+			};
+
+			struct Retired_
+			{
+				std::uint32_t texture, version;
+				UploadTicket ticket; // of the copy to the replacement
+				Image image;
+				ImageView view;
+			};
+
+			static Loaded_ load_( MipChainSource const&, std::uint32_t aBase, std::uint32_t aCount );
+			void install_( std::uint32_t aTexture, Loaded_ const& );
+
+			void create_slots_();
+			void read_feedback_( Slot_& );
+			void apply_loads_();
+			void schedule_();
+			void start_load_( std::uint32_t aTexture, std::uint32_t aBase );
+			void update_sets_( std::uint32_t aSlot );
+			void retire_();
+
+			VkDeviceSize budget_() const;
+			VkDeviceSize chain_bytes_( Texture_ const&, std::uint32_t aBase ) const noexcept;
+
+			VulkanContext const* mContext;
+			Allocator const* mAllocator;
+			UploadQueue* mQueue;
+
+			VkDescriptorPool mPool;
+			VkDescriptorSetLayout mTextureLayout, mFeedbackLayout;
+			VkSampler mSampler;
+
+			TextureStreamerConfig mConfig;
+			BindlessTextures* mBindless;
+
+			std::vector<std::unique_ptr<Texture_>> mTextures;
+			std::vector<Slot_> mSlots;
+			std::vector<Retired_> mRetired;
+
+			VkDeviceSize mResidentBytes = 0;
+			std::uint64_t mFrame = 0;
+			std::size_t mLoadsInFlight = 0;
+
+			TextureStreamerStats mStats;
+
+			ThreadPool mLoaders; // last, such that its threads are joined first
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,141 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+#include <cassert>
+
+namespace labutils
+{
+	ThreadPool::ThreadPool( std::size_t aThreadCount )
+	{
+		if( 0 == aThreadCount )
+			aThreadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+		mThreads.reserve( aThreadCount );
+		for( std::size_t i = 0; i < aThreadCount; ++i )
+			mThreads.emplace_back( [this] { worker_(); } );
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::unique_lock lock( mMutex );
+			mStopping = true;
+		}
+
+		mCondition.notify_all();
+
+		for( auto& thread : mThreads )
+			thread.join();
+	}
+
+	std::size_t ThreadPool::thread_count() const noexcept
+	{
+		return mThreads.size();
+	}
+
+	void ThreadPool::parallel_for( std::size_t aCount, std::function<void(std::size_t)> const& aFunc )
+	{
+		if( 0 == aCount )
+			return;
+
+		if( 1 == aCount )
+		{
+			aFunc( 0 );
+			return;
+		}
+
+		// State is shared with the helper tasks, which may only get to run
+		// after this call has returned (at which point they find no work).
+		struct State_
+		{
+			std::atomic<std::size_t> next{ 0 };
+			std::size_t done = 0;
+
+			std::mutex mutex;
+			std::condition_variable finished;
+			std::exception_ptr error;
+		};
+
+		auto state = std::make_shared<State_>();
+		auto const* func = &aFunc;
+
+		auto const work = [state, func, aCount] {
+			std::size_t completed = 0;
+			std::exception_ptr error;
+
+			for( std::size_t i; (i = state->next.fetch_add( 1 )) < aCount; ++completed )
+			{
+				try
+				{
+					(*func)( i );
+				}
+				catch( ... )
+				{
+					if( !error ) error = std::current_exception();
+				}
+			}
+
+			if( completed )
+			{
+				std::unique_lock lock( state->mutex );
+				if( error && !state->error )
+					state->error = error;
+
+				state->done += completed;
+				if( aCount == state->done )
+					state->finished.notify_all();
+			}
+		};
+
+		auto const helpers = std::min( aCount-1, mThreads.size() );
+		for( std::size_t i = 0; i < helpers; ++i )
+			enqueue_( work );
+
+		work();
+
+		std::unique_lock lock( state->mutex );
+		state->finished.wait( lock, [&] { return aCount == state->done; } );
+
+		if( state->error )
+			std::rethrow_exception( state->error );
+	}
+
+	void ThreadPool::enqueue_( std::function<void()> aTask )
+	{
+		{
+			std::unique_lock lock( mMutex );
+			mQueue.emplace_back( std::move(aTask) );
+		}
+
+		mCondition.notify_one();
+	}
+
+	void ThreadPool::worker_()
+	{
+		for( ;; )
+		{
+			std::function<void()> task;
+
+			{
+				std::unique_lock lock( mMutex );
+				mCondition.wait( lock, [this] { return mStopping || !mQueue.empty(); } );
+
+				if( mQueue.empty() )
+				{
+					assert( mStopping );
+					return;
+				}
+
+				task = std::move(mQueue.front());
+				mQueue.pop_front();
+			}
+
+			task();
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <future>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+#include <cstddef>
+
+namespace labutils
+{
+	// Fixed-size pool of worker threads. Work is either submitted as
+	// individual tasks (submit()), which return a std::future, or as a
+	// data-parallel loop (parallel_for()), which blocks until all iterations
+	// have completed. The calling thread helps out with parallel_for(), so
+	// nesting a parallel_for() inside a task does not dead-lock.
+	class ThreadPool
+	{
+		public:
+			// aThreadCount == 0 selects std::thread::hardware_concurrency()
+			explicit ThreadPool( std::size_t aThreadCount = 0 );
+			~ThreadPool();
+
+			ThreadPool( ThreadPool const& ) = delete;
+			ThreadPool& operator= (ThreadPool const&) = delete;
+
+		public:
+			std::size_t thread_count() const noexcept;
+
+			template< typename tFunc >
+			auto submit( tFunc&& aFunc ) -> std::future<std::invoke_result_t<std::decay_t<tFunc>>>;
+
+			// Calls aFunc(i) for each i in [0,aCount). If any call throws,
+			// the first exception is re-thrown once all calls have finished.
+			void parallel_for( std::size_t aCount, std::function<void(std::size_t)> const& aFunc );
+
+		private:
+			void enqueue_( std::function<void()> );
+			void worker_();
+
+			std::vector<std::thread> mThreads;
+
+			std::mutex mMutex;
+			std::condition_variable mCondition;
+			std::deque<std::function<void()>> mQueue;
+			bool mStopping = false;
+	};
+
+	template< typename tFunc >
+	auto ThreadPool::submit( tFunc&& aFunc ) -> std::future<std::invoke_result_t<std::decay_t<tFunc>>>
+	{
+		using Result_ = std::invoke_result_t<std::decay_t<tFunc>>;
+
+		// std::function requires copyable targets, std::packaged_task isn't.
+		auto task = std::make_shared<std::packaged_task<Result_()>>( std::forward<tFunc>(aFunc) );
+		auto future = task->get_future();
+
+		enqueue_( [task] { (*task)(); } );
+		return future;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
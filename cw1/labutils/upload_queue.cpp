@@ -0,0 +1,656 @@
+#include "upload_queue.hpp"
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace
+{
+	VkBufferMemoryBarrier buffer_barrier_( VkBuffer aBuffer, VkAccessFlags aSrcAccess, VkAccessFlags aDstAccess, VkDeviceSize aOffset, VkDeviceSize aSize, std::uint32_t aSrcFamily, std::uint32_t aDstFamily )
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = aSrcAccess;
+		barrier.dstAccessMask = aDstAccess;
+		barrier.srcQueueFamilyIndex = aSrcFamily;
+		barrier.dstQueueFamilyIndex = aDstFamily;
+		barrier.buffer = aBuffer;
+		barrier.offset = aOffset;
+		barrier.size = aSize;
+		return barrier;
+	}
+
+	VkImageMemoryBarrier image_barrier_( VkImage aImage, VkAccessFlags aSrcAccess, VkAccessFlags aDstAccess, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkImageSubresourceRange const& aRange, std::uint32_t aSrcFamily = VK_QUEUE_FAMILY_IGNORED, std::uint32_t aDstFamily = VK_QUEUE_FAMILY_IGNORED )
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = aSrcAccess;
+		barrier.dstAccessMask = aDstAccess;
+		barrier.oldLayout = aOldLayout;
+		barrier.newLayout = aNewLayout;
+		barrier.srcQueueFamilyIndex = aSrcFamily;
+		barrier.dstQueueFamilyIndex = aDstFamily;
+		barrier.image = aImage;
+		barrier.subresourceRange = aRange;
+		return barrier;
+	}
+
+	// A batch with ticket k is complete once the timeline reaches 2k. With a
+	// dedicated transfer queue, the copies signal 2k-1 and the acquire on
+	// the graphics queue waits for that and signals 2k.
+	std::uint64_t timeline_value_( labutils::UploadTicket aTicket ) noexcept
+	{
+		return 2*aTicket;
+	}
+}
+
+namespace labutils
+{
+	UploadQueue::UploadQueue( VulkanContext const& aContext, StagingRing& aRing )
+		: mContext( &aContext )
+		, mRing( &aRing )
+		, mDedicated( aContext.transferFamilyIndex != aContext.graphicsFamilyIndex )
+	{
+		if( !aContext.timelineSemaphores )
+			throw Error( "UploadQueue: timeline semaphores are not enabled" );
+
+		// Command buffers are reused once their batch has completed
+		VkCommandPoolCreateFlags const poolFlags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		mTransferPool = create_command_pool( aContext, aContext.transferFamilyIndex, poolFlags );
+		if( mDedicated )
+			mGraphicsPool = create_command_pool( aContext, aContext.graphicsFamilyIndex, poolFlags );
+
+		mTimeline = create_timeline_semaphore( aContext );
+
+		// Core in Vulkan 1.2; Vulkan 1.1 devices have the KHR extension
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aContext.physicalDevice, &props );
+
+		bool const core = VK_API_VERSION_MAJOR( props.apiVersion ) > 1 || VK_API_VERSION_MINOR( props.apiVersion ) >= 2;
+		mWaitSemaphores = core ? vkWaitSemaphores : vkWaitSemaphoresKHR;
+		mGetCounterValue = core ? vkGetSemaphoreCounterValue : vkGetSemaphoreCounterValueKHR;
+
+		if( !mWaitSemaphores || !mGetCounterValue )
+			throw Error( "UploadQueue: timeline semaphore functions not loaded" );
+	}
+
+	UploadQueue::~UploadQueue()
+	{
+		// An open batch is dropped. The command buffers are freed with the
+		// pools, which requires the submitted ones to have completed.
+		if( !mPending.empty() )
+		{
+			std::uint64_t const value = timeline_value_( mPending.back().ticket );
+
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &mTimeline.handle;
+			waitInfo.pValues = &value;
+
+			mWaitSemaphores( mContext->device, &waitInfo, std::numeric_limits<std::uint64_t>::max() );
+		}
+	}
+
+	StagingRegion UploadQueue::stage( VkDeviceSize aSize, VkDeviceSize aAlignment )
+	{
+		// Submit the batch once it has staged half the ring, such that the
+		// ring has room for the next batch while this one is copied
+		if( mOpenBytes > 0 && mOpenBytes + aSize > mRing->capacity() / 2 )
+			flush();
+
+		auto const region = mRing->allocate( aSize, aAlignment );
+		open_();
+
+		mOpenBytes += aSize;
+		mFrameBytes += aSize;
+		mStats.stagedBytes += aSize;
+
+		mStageStart = Clock_::now();
+		return region;
+	}
+
+	void UploadQueue::copy_to_buffer( StagingRegion const& aRegion, VkBuffer aBuffer, VkDeviceSize aSize, VkPipelineStageFlags aDstStage, VkAccessFlags aDstAccess, VkDeviceSize aSrcOffset, VkDeviceSize aDstOffset )
+	{
+		assert( mOpenCmd );
+		assert( aSrcOffset + aSize <= aRegion.size );
+
+		VkBufferCopy copy{};
+		copy.srcOffset = aRegion.offset + aSrcOffset;
+		copy.dstOffset = aDstOffset;
+		copy.size = aSize;
+		vkCmdCopyBuffer( mOpenCmd, aRegion.buffer, aBuffer, 1, &copy );
+
+		if( mDedicated )
+		{
+			auto const src = mContext->transferFamilyIndex, dst = mContext->graphicsFamilyIndex;
+			mBufferReleases.emplace_back( buffer_barrier_( aBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, 0, aDstOffset, aSize, src, dst ) );
+			mBufferAcquires.emplace_back( buffer_barrier_( aBuffer, 0, aDstAccess, aDstOffset, aSize, src, dst ) );
+			++mStats.ownershipTransfers;
+		}
+		else
+		{
+			// All buffers of the batch share one memory barrier
+			mDstAccess |= aDstAccess;
+		}
+
+		mDstStages |= aDstStage;
+		++mStats.bufferCopies;
+
+		mFrameTime += Clock_::now() - mStageStart;
+	}
+
+	void UploadQueue::copy_to_image( StagingRegion const& aRegion, VkImage aImage, std::uint32_t aMipLevels, std::vector<VkBufferImageCopy> const& aCopies, bool aBlitRemaining )
+	{
+		if( stage_to_image_( aRegion, aImage, aMipLevels, aCopies, aBlitRemaining ) )
+		{
+			mBlits.emplace_back( Blit_{ aImage, std::uint32_t(aCopies.size()), aMipLevels, aCopies.back().imageExtent } );
+			++mStats.blits;
+		}
+
+		mFrameTime += Clock_::now() - mStageStart;
+	}
+
+	void UploadQueue::copy_to_image( StagingRegion const& aRegion, VkImage aImage, std::uint32_t aMipLevels, std::vector<VkBufferImageCopy> const& aCopies, ImageLevelSource const& aRemaining )
+	{
+		assert( VK_NULL_HANDLE != aRemaining.image );
+
+		if( stage_to_image_( aRegion, aImage, aMipLevels, aCopies, true ) )
+		{
+			auto const& last = aCopies.back().imageExtent;
+			VkExtent3D const extent{ std::max( 1u, last.width >> 1 ), std::max( 1u, last.height >> 1 ), 1 };
+
+			mLevelCopies.emplace_back( LevelCopy_{ aImage, std::uint32_t(aCopies.size()), aMipLevels, extent, aRemaining } );
+			++mStats.levelCopies;
+		}
+
+		mFrameTime += Clock_::now() - mStageStart;
+	}
+
+	void UploadQueue::copy_to_image( VkImage aImage, std::uint32_t aMipLevels, VkExtent2D aExtent, ImageLevelSource const& aSource )
+	{
+		assert( VK_NULL_HANDLE != aSource.image && aMipLevels > 0 );
+
+		// The batch may consist of nothing else
+		open_();
+
+		mLevelCopies.emplace_back( LevelCopy_{ aImage, 0, aMipLevels, VkExtent3D{ aExtent.width, aExtent.height, 1 }, aSource } );
+		++mStats.levelCopies;
+	}
+
+	UploadTicket UploadQueue::ticket() const noexcept
+	{
+		return mOpenCmd ? mOpenTicket : mOpenTicket-1;
+	}
+
+	UploadTicket UploadQueue::flush()
+	{
+		if( !mOpenCmd )
+			return mOpenTicket-1;
+
+		poll_();
+
+		auto const ticket = mOpenTicket;
+		auto const stages = mDstStages ? mDstStages : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkCommandBuffer const copyCmd = mOpenCmd;
+		VkCommandBuffer graphicsCmd = VK_NULL_HANDLE;
+
+		if( mDedicated )
+		{
+			// Release everything to the graphics family ...
+			if( !mBufferReleases.empty() || !mImageReleases.empty() )
+			{
+				vkCmdPipelineBarrier( copyCmd,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					0, nullptr,
+					std::uint32_t(mBufferReleases.size()), mBufferReleases.data(),
+					std::uint32_t(mImageReleases.size()), mImageReleases.data()
+				);
+			}
+
+			// ... and acquire it there. The acquire is ordered after the
+			// semaphore wait through the common stage mask.
+			graphicsCmd = begin_( mGraphicsPool.handle, mFreeGraphicsCmds );
+
+			if( !mBufferAcquires.empty() || !mImageAcquires.empty() )
+			{
+				vkCmdPipelineBarrier( graphicsCmd,
+					stages, stages, 0,
+					0, nullptr,
+					std::uint32_t(mBufferAcquires.size()), mBufferAcquires.data(),
+					std::uint32_t(mImageAcquires.size()), mImageAcquires.data()
+				);
+			}
+
+			record_blits_( graphicsCmd );
+			record_level_copies_( graphicsCmd );
+
+			if( auto const res = vkEndCommandBuffer( graphicsCmd ); VK_SUCCESS != res )
+				throw Error( "Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str() );
+		}
+		else
+		{
+			// One barrier for all copies of the batch
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = mDstAccess;
+
+			if( mDstAccess || !mImageAcquires.empty() )
+			{
+				vkCmdPipelineBarrier( copyCmd,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, stages, 0,
+					mDstAccess ? 1 : 0, &barrier,
+					0, nullptr,
+					std::uint32_t(mImageAcquires.size()), mImageAcquires.data()
+				);
+			}
+
+			record_blits_( copyCmd );
+			record_level_copies_( copyCmd );
+		}
+
+		if( auto const res = vkEndCommandBuffer( copyCmd ); VK_SUCCESS != res )
+			throw Error( "Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str() );
+
+		// The copies go through the ring, which flushes the staging regions
+		// and reclaims them once the copies have completed
+		std::uint64_t const copiedValue = mDedicated ? timeline_value_( ticket )-1 : timeline_value_( ticket );
+
+		VkTimelineSemaphoreSubmitInfo copyTimeline{};
+		copyTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		copyTimeline.signalSemaphoreValueCount = 1;
+		copyTimeline.pSignalSemaphoreValues = &copiedValue;
+
+		VkSubmitInfo copySubmit{};
+		copySubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		copySubmit.pNext = &copyTimeline;
+		copySubmit.commandBufferCount = 1;
+		copySubmit.pCommandBuffers = &copyCmd;
+		copySubmit.signalSemaphoreCount = 1;
+		copySubmit.pSignalSemaphores = &mTimeline.handle;
+
+		mRing->submit( mContext->transferQueue, copySubmit );
+
+		if( mDedicated )
+		{
+			std::uint64_t const doneValue = timeline_value_( ticket );
+
+			VkTimelineSemaphoreSubmitInfo acquireTimeline{};
+			acquireTimeline.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			acquireTimeline.waitSemaphoreValueCount = 1;
+			acquireTimeline.pWaitSemaphoreValues = &copiedValue;
+			acquireTimeline.signalSemaphoreValueCount = 1;
+			acquireTimeline.pSignalSemaphoreValues = &doneValue;
+
+			VkSubmitInfo acquireSubmit{};
+			acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireSubmit.pNext = &acquireTimeline;
+			acquireSubmit.waitSemaphoreCount = 1;
+			acquireSubmit.pWaitSemaphores = &mTimeline.handle;
+			acquireSubmit.pWaitDstStageMask = &stages;
+			acquireSubmit.commandBufferCount = 1;
+			acquireSubmit.pCommandBuffers = &graphicsCmd;
+			acquireSubmit.signalSemaphoreCount = 1;
+			acquireSubmit.pSignalSemaphores = &mTimeline.handle;
+
+			if( auto const res = vkQueueSubmit( mContext->graphicsQueue, 1, &acquireSubmit, VK_NULL_HANDLE ); VK_SUCCESS != res )
+				throw Error( "Submitting upload acquire\nvkQueueSubmit() returned %s", to_string(res).c_str() );
+		}
+
+		mPending.emplace_back( Pending_{ ticket, copyCmd, graphicsCmd } );
+		++mStats.batches;
+
+		// Start over
+		mOpenCmd = VK_NULL_HANDLE;
+		mOpenBytes = 0;
+		++mOpenTicket;
+
+		mBufferReleases.clear();
+		mBufferAcquires.clear();
+		mImageReleases.clear();
+		mImageAcquires.clear();
+		mBlits.clear();
+		mLevelCopies.clear();
+		mDstStages = 0;
+		mDstAccess = 0;
+
+		return ticket;
+	}
+
+	bool UploadQueue::is_complete( UploadTicket aTicket )
+	{
+		if( aTicket <= mCompleted )
+			return true;
+
+		if( aTicket >= mOpenTicket )
+			return false; // not submitted yet
+
+		poll_();
+		return aTicket <= mCompleted;
+	}
+
+	void UploadQueue::wait( UploadTicket aTicket )
+	{
+		if( aTicket >= mOpenTicket )
+			flush();
+
+		assert( aTicket < mOpenTicket );
+		if( is_complete( aTicket ) )
+			return;
+
+		std::uint64_t const value = timeline_value_( aTicket );
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &mTimeline.handle;
+		waitInfo.pValues = &value;
+
+		if( auto const res = mWaitSemaphores( mContext->device, &waitInfo, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+			throw Error( "Waiting for uploads\nvkWaitSemaphores() returned %s", to_string(res).c_str() );
+
+		++mStats.waits;
+		mCompleted = std::max( mCompleted, aTicket );
+		recycle_();
+	}
+
+	void UploadQueue::wait_idle()
+	{
+		if( auto const last = flush(); last > 0 )
+			wait( last );
+	}
+
+	void UploadQueue::set_budget( UploadBudget const& aBudget ) noexcept
+	{
+		mBudget = aBudget;
+	}
+
+	void UploadQueue::begin_frame() noexcept
+	{
+		mFrameBytes = 0;
+		mFrameTime = {};
+	}
+
+	bool UploadQueue::has_budget() const noexcept
+	{
+		if( mBudget.bytesPerFrame > 0 && mFrameBytes >= mBudget.bytesPerFrame )
+			return false;
+
+		if( mBudget.millisecondsPerFrame > 0.0 && std::chrono::duration<double, std::milli>( mFrameTime ).count() >= mBudget.millisecondsPerFrame )
+			return false;
+
+		return true;
+	}
+
+	bool UploadQueue::uses_transfer_queue() const noexcept
+	{
+		return mDedicated;
+	}
+
+	UploadQueueStats const& UploadQueue::stats() const noexcept
+	{
+		return mStats;
+	}
+
+
+	VkCommandBuffer UploadQueue::begin_( VkCommandPool aPool, std::vector<VkCommandBuffer>& aFree )
+	{
+		VkCommandBuffer cmd = VK_NULL_HANDLE;
+		if( !aFree.empty() )
+		{
+			cmd = aFree.back();
+			aFree.pop_back();
+		}
+		else
+		{
+			cmd = alloc_command_buffer( *mContext, aPool );
+		}
+
+		// Implicitly resets recycled command buffers (see the pool flags)
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if( auto const res = vkBeginCommandBuffer( cmd, &beginInfo ); VK_SUCCESS != res )
+			throw Error( "Beginning command buffer recording\nvkBeginCommandBuffer() returned %s", to_string(res).c_str() );
+
+		return cmd;
+	}
+
+	void UploadQueue::open_()
+	{
+		if( !mOpenCmd )
+			mOpenCmd = begin_( mTransferPool.handle, mFreeTransferCmds );
+	}
+
+	bool UploadQueue::stage_to_image_( StagingRegion const& aRegion, VkImage aImage, std::uint32_t aMipLevels, std::vector<VkBufferImageCopy> const& aCopies, bool aKeepRemaining )
+	{
+		assert( mOpenCmd );
+		assert( !aCopies.empty() && aCopies.size() <= aMipLevels );
+
+		auto const copiedLevels = std::uint32_t(aCopies.size());
+		bool const keep = aKeepRemaining && copiedLevels < aMipLevels;
+
+		VkImageSubresourceRange const allLevels{ VK_IMAGE_ASPECT_COLOR_BIT, 0, aMipLevels, 0, 1 };
+
+		image_barrier(
+			mOpenCmd, aImage,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			allLevels
+		);
+
+		// Whole levels only, which also satisfies the image transfer
+		// granularity of dedicated transfer queues
+		std::vector<VkBufferImageCopy> copies( aCopies );
+		for( auto& copy : copies )
+			copy.bufferOffset += aRegion.offset;
+
+		vkCmdCopyBufferToImage( mOpenCmd, aRegion.buffer, aImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLevels, copies.data() );
+
+		// Images with remaining levels stay in the transfer destination
+		// layout until these are written on the graphics queue; the rest go
+		// straight to shader reads
+		if( mDedicated )
+		{
+			auto const src = mContext->transferFamilyIndex, dst = mContext->graphicsFamilyIndex;
+			auto const layout = keep ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			auto const access = keep ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+
+			mImageReleases.emplace_back( image_barrier_( aImage, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, allLevels, src, dst ) );
+			mImageAcquires.emplace_back( image_barrier_( aImage, 0, access, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, allLevels, src, dst ) );
+			mDstStages |= keep ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			++mStats.ownershipTransfers;
+		}
+		else if( !keep )
+		{
+			mImageAcquires.emplace_back( image_barrier_( aImage, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, allLevels ) );
+			mDstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		}
+
+		++mStats.imageCopies;
+		return keep;
+	}
+
+	void UploadQueue::record_blits_( VkCommandBuffer aCmd )
+	{
+		for( auto const& blit : mBlits )
+		{
+			// Copied levels other than the last one are not blitted from
+			if( blit.firstLevel > 1 )
+			{
+				image_barrier(
+					aCmd, blit.image,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, blit.firstLevel-1, 0, 1 }
+				);
+			}
+
+			auto mipWidth = std::int32_t(blit.extent.width);
+			auto mipHeight = std::int32_t(blit.extent.height);
+
+			for( std::uint32_t i = blit.firstLevel; i < blit.mipLevels; ++i )
+			{
+				image_barrier(
+					aCmd, blit.image,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, i-1, 1, 0, 1 }
+				);
+
+				// Non-square images stop halving the shorter side at 1
+				auto const dstWidth = mipWidth > 1 ? mipWidth >> 1 : 1;
+				auto const dstHeight = mipHeight > 1 ? mipHeight >> 1 : 1;
+
+				VkImageBlit region{};
+				region.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, i-1, 0, 1 };
+				region.srcOffsets[0] = { 0, 0, 0 };
+				region.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+				region.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+				region.dstOffsets[0] = { 0, 0, 0 };
+				region.dstOffsets[1] = { dstWidth, dstHeight, 1 };
+
+				vkCmdBlitImage( aCmd,
+					blit.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					blit.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1, &region, VK_FILTER_LINEAR
+				);
+
+				image_barrier(
+					aCmd, blit.image,
+					VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, i-1, 1, 0, 1 }
+				);
+
+				mipWidth = dstWidth;
+				mipHeight = dstHeight;
+			}
+
+			image_barrier(
+				aCmd, blit.image,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, blit.mipLevels-1, 1, 0, 1 }
+			);
+		}
+	}
+
+	void UploadQueue::record_level_copies_( VkCommandBuffer aCmd )
+	{
+		for( auto const& copy : mLevelCopies )
+		{
+			auto const levels = copy.mipLevels - copy.firstLevel;
+			VkImageSubresourceRange const srcRange{ VK_IMAGE_ASPECT_COLOR_BIT, copy.source.firstLevel, levels, 0, 1 };
+			VkImageSubresourceRange const dstRange{ VK_IMAGE_ASPECT_COLOR_BIT, copy.firstLevel, levels, 0, 1 };
+
+			// Staged levels are complete; without any, the image is new
+			if( copy.firstLevel > 0 )
+			{
+				image_barrier(
+					aCmd, copy.image,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, copy.firstLevel, 0, 1 }
+				);
+			}
+			else
+			{
+				image_barrier(
+					aCmd, copy.image,
+					0, VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					dstRange
+				);
+			}
+
+			// Earlier frames may still sample the source; later ones wait for
+			// it to return to its layout
+			image_barrier(
+				aCmd, copy.source.image,
+				0, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				srcRange
+			);
+
+			std::vector<VkImageCopy> regions( levels );
+			auto extent = copy.extent;
+			for( std::uint32_t i = 0; i < levels; ++i )
+			{
+				auto& region = regions[i];
+				region.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, copy.source.firstLevel + i, 0, 1 };
+				region.srcOffset = VkOffset3D{ 0, 0, 0 };
+				region.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, copy.firstLevel + i, 0, 1 };
+				region.dstOffset = VkOffset3D{ 0, 0, 0 };
+				region.extent = extent;
+
+				extent.width = std::max( 1u, extent.width >> 1 );
+				extent.height = std::max( 1u, extent.height >> 1 );
+			}
+
+			vkCmdCopyImage( aCmd,
+				copy.source.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				levels, regions.data()
+			);
+
+			image_barrier(
+				aCmd, copy.source.image,
+				0, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				srcRange
+			);
+			image_barrier(
+				aCmd, copy.image,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				dstRange
+			);
+		}
+	}
+
+	void UploadQueue::poll_()
+	{
+		std::uint64_t value = 0;
+		if( auto const res = mGetCounterValue( mContext->device, mTimeline.handle, &value ); VK_SUCCESS != res )
+			throw Error( "Querying upload timeline\nvkGetSemaphoreCounterValue() returned %s", to_string(res).c_str() );
+
+		mCompleted = std::max( mCompleted, value / 2 );
+		recycle_();
+	}
+
+	void UploadQueue::recycle_()
+	{
+		auto it = mPending.begin();
+		for( ; it != mPending.end() && it->ticket <= mCompleted; ++it )
+		{
+			mFreeTransferCmds.emplace_back( it->transferCmd );
+			if( VK_NULL_HANDLE != it->graphicsCmd )
+				mFreeGraphicsCmds.emplace_back( it->graphicsCmd );
+		}
+
+		mPending.erase( mPending.begin(), it );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <chrono>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "staging_ring.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	/* Asynchronous, batched uploads.
+	 *
+	 * Copies from staging memory (see StagingRing) are recorded into an open
+	 * batch, together with the layout transitions of the destinations. A
+	 * batch is submitted by flush(), or automatically once it has staged
+	 * half the ring, so that the next batch can be written while the
+	 * previous one is copied. Nothing blocks unless the ring runs out of
+	 * space or wait() is called.
+	 *
+	 * If the device has a dedicated transfer queue family (see
+	 * VulkanContext::transferQueue), the copies run there; the destinations
+	 * are then released to the graphics family, and acquired by a small
+	 * submission on the graphics queue that waits for the copies. Mipmap
+	 * blits (see copy_to_image()) need the graphics queue, and are recorded
+	 * after the acquire, as are copies from other images (which are owned by
+	 * the graphics family, and may be in use by earlier frames).
+	 *
+	 * Each batch signals a timeline semaphore. ticket() identifies the open
+	 * batch; once is_complete() returns true for it, everything recorded up
+	 * to then is on the GPU and can be used by later submissions to the
+	 * graphics queue without further synchronization.
+	 *
+	 * Budgets limit how much is uploaded per frame when streaming during
+	 * rendering: call begin_frame() once per frame, and only start uploads
+	 * while has_budget() returns true. The time budget counts the time
+	 * between stage() and the matching copy_to_*(), i.e., the time spent
+	 * writing staging memory.
+	 *
+	 * Not thread-safe.
+	 */
+	using UploadTicket = std::uint64_t;
+
+	// Levels of an image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, from
+	// firstLevel on. The image must be usable as a transfer source.
+	struct ImageLevelSource
+	{
+		VkImage image = VK_NULL_HANDLE;
+		std::uint32_t firstLevel = 0;
+	};
+
+	struct UploadBudget
+	{
+		VkDeviceSize bytesPerFrame = 0; // 0: unlimited
+		double millisecondsPerFrame = 0.0; // 0: unlimited
+	};
+
+	struct UploadQueueStats
+	{
+		std::size_t batches = 0;
+		std::size_t bufferCopies = 0;
+		std::size_t imageCopies = 0; // images, not regions
+		std::size_t blits = 0; // images with blitted mipmaps
+		std::size_t levelCopies = 0; // images with levels copied from another image
+		std::size_t ownershipTransfers = 0; // resources released to graphics
+		VkDeviceSize stagedBytes = 0;
+		std::size_t waits = 0; // calls to wait() that had to block
+	};
+
+	class UploadQueue
+	{
+		public:
+			// Requires VulkanContext::timelineSemaphores
+			UploadQueue( VulkanContext const&, StagingRing& );
+			~UploadQueue(); // waits for all batches
+
+			UploadQueue( UploadQueue const& ) = delete;
+			UploadQueue& operator= (UploadQueue const&) = delete;
+
+		public:
+			// Staging memory for the open batch. The copies that read the
+			// region must be recorded before the next call to stage(), which
+			// may submit the batch.
+			StagingRegion stage( VkDeviceSize aSize, VkDeviceSize aAlignment = 16 );
+
+			// Copies aSize bytes from aSrcOffset in the region. The buffer is
+			// ready for aDstStage/aDstAccess once the batch has completed.
+			void copy_to_buffer(
+				StagingRegion const&,
+				VkBuffer,
+				VkDeviceSize aSize,
+				VkPipelineStageFlags aDstStage,
+				VkAccessFlags aDstAccess,
+				VkDeviceSize aSrcOffset = 0,
+				VkDeviceSize aDstOffset = 0
+			);
+
+			// Copies whole levels of a color image with aMipLevels levels,
+			// starting at level 0; bufferOffset in aCopies is relative to the
+			// region. If aBlitRemaining is set, the levels after the copied
+			// ones are blitted from their predecessors (the image must then be
+			// usable as a transfer source). The image ends up in
+			// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for fragment shaders.
+			void copy_to_image(
+				StagingRegion const&,
+				VkImage,
+				std::uint32_t aMipLevels,
+				std::vector<VkBufferImageCopy> const& aCopies,
+				bool aBlitRemaining = false
+			);
+
+			// As above, but the levels after the copied ones are copied from
+			// aRemaining, on the graphics queue. The source stays in its
+			// layout, and must stay alive until the batch has completed.
+			void copy_to_image(
+				StagingRegion const&,
+				VkImage,
+				std::uint32_t aMipLevels,
+				std::vector<VkBufferImageCopy> const& aCopies,
+				ImageLevelSource const& aRemaining
+			);
+
+			// Copies all levels of a color image with aMipLevels levels, the
+			// first of which is aExtent, from aSource; nothing is staged.
+			void copy_to_image(
+				VkImage,
+				std::uint32_t aMipLevels,
+				VkExtent2D aExtent,
+				ImageLevelSource const&
+			);
+
+			// Ticket of the open batch, i.e. of everything recorded so far
+			UploadTicket ticket() const noexcept;
+
+			// Submits the open batch if it contains anything. Returns its
+			// ticket.
+			UploadTicket flush();
+
+			bool is_complete( UploadTicket );
+
+			// Flushes the batch first if aTicket refers to the open batch
+			void wait( UploadTicket );
+			void wait_idle();
+
+			void set_budget( UploadBudget const& ) noexcept;
+			void begin_frame() noexcept;
+			bool has_budget() const noexcept;
+
+			bool uses_transfer_queue() const noexcept;
+			UploadQueueStats const& stats() const noexcept;
+
+		private:
+			using Clock_ = std::chrono::steady_clock;
+
+			struct Pending_
+			{
+				UploadTicket ticket;
+				VkCommandBuffer transferCmd;
+				VkCommandBuffer graphicsCmd; // VK_NULL_HANDLE if unused
+			};
+
+			struct Blit_
+			{
+				VkImage image;
+				std::uint32_t firstLevel, mipLevels;
+				VkExtent3D extent; // of firstLevel-1
+			};
+
+			struct LevelCopy_
+			{
+				VkImage image;
+				std::uint32_t firstLevel, mipLevels;
+				VkExtent3D extent; // of firstLevel
+				ImageLevelSource source;
+			};
+
+			VkCommandBuffer begin_( VkCommandPool, std::vector<VkCommandBuffer>& aFree );
+			void open_();
+			bool stage_to_image_( StagingRegion const&, VkImage, std::uint32_t aMipLevels, std::vector<VkBufferImageCopy> const&, bool aKeepRemaining );
+			void record_blits_( VkCommandBuffer );
+			void record_level_copies_( VkCommandBuffer );
+			void recycle_();
+			void poll_(); // updates mCompleted
+
+			VulkanContext const* mContext;
+			StagingRing* mRing;
+
+			bool mDedicated = false; // transfer family != graphics family
+
+			CommandPool mTransferPool, mGraphicsPool;
+			std::vector<VkCommandBuffer> mFreeTransferCmds, mFreeGraphicsCmds;
+
+			Semaphore mTimeline;
+			PFN_vkWaitSemaphores mWaitSemaphores = nullptr;
+			PFN_vkGetSemaphoreCounterValue mGetCounterValue = nullptr;
+
+			// Open batch; the command buffer is allocated on first use
+			VkCommandBuffer mOpenCmd = VK_NULL_HANDLE;
+			VkDeviceSize mOpenBytes = 0;
+			UploadTicket mOpenTicket = 1;
+			UploadTicket mCompleted = 0;
+
+			std::vector<VkBufferMemoryBarrier> mBufferReleases, mBufferAcquires;
+			std::vector<VkImageMemoryBarrier> mImageReleases, mImageAcquires;
+			std::vector<Blit_> mBlits;
+			std::vector<LevelCopy_> mLevelCopies;
+			VkPipelineStageFlags mDstStages = 0;
+			VkAccessFlags mDstAccess = 0; // buffers, same family only
+
+			std::vector<Pending_> mPending; // oldest first
+
+			UploadBudget mBudget;
+			VkDeviceSize mFrameBytes = 0;
+			Clock_::duration mFrameTime{};
+			Clock_::time_point mStageStart{};
+
+			UploadQueueStats mStats;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -43,7 +43,7 @@ namespace labutils
 
 namespace labutils
 {
-	Buffer create_buffer( Allocator const& aAllocator, VkDeviceSize aSize, VkBufferUsageFlags aBufferUsage, VmaMemoryUsage aMemoryUsage )
+	Buffer create_buffer( Allocator const& aAllocator, VkDeviceSize aSize, VkBufferUsageFlags aBufferUsage, VmaMemoryUsage aMemoryUsage, VmaAllocationCreateFlags aAllocationFlags )
 	{
 		//DONE- (Section 2) implement me!
 
@@ -55,6 +55,7 @@ namespace labutils
 
 		VmaAllocationCreateInfo allocInfo{};
 		allocInfo.usage = aMemoryUsage;
+		allocInfo.flags = aAllocationFlags;
 
 		VkBuffer buffer = VK_NULL_HANDLE;
 		VmaAllocation allocation = VK_NULL_HANDLE;
@@ -67,3 +68,21 @@ namespace labutils
 		return Buffer(aAllocator.allocator, buffer, allocation);
 	}
 }
+
+namespace labutils
+{
+	void* mapped_pointer( Allocator const& aAllocator, Buffer const& aBuffer )
+	{
+		assert( VK_NULL_HANDLE != aBuffer.allocation );
+
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo( aAllocator.allocator, aBuffer.allocation, &info );
+		return info.pMappedData;
+	}
+
+	void flush_buffer( Allocator const& aAllocator, Buffer const& aBuffer, VkDeviceSize aOffset, VkDeviceSize aSize )
+	{
+		if( auto const res = vmaFlushAllocation( aAllocator.allocator, aBuffer.allocation, aOffset, aSize ); VK_SUCCESS != res )
+			throw Error( "Unable to flush mapped buffer\nvmaFlushAllocation() returned %s", to_string(res).c_str() );
+	}
+}
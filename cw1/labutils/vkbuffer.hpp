@@ -32,5 +32,15 @@ namespace labutils
 			VmaAllocator mAllocator = VK_NULL_HANDLE;
 	};
 
-	Buffer create_buffer( Allocator const&, VkDeviceSize, VkBufferUsageFlags, VmaMemoryUsage );
+	// aAllocationFlags are passed on to VMA. With VMA_ALLOCATION_CREATE_MAPPED_BIT,
+	// the buffer is persistently mapped; see mapped_pointer().
+	Buffer create_buffer( Allocator const&, VkDeviceSize, VkBufferUsageFlags, VmaMemoryUsage, VmaAllocationCreateFlags aAllocationFlags = 0 );
+
+	// Host pointer of a persistently mapped buffer; nullptr if the buffer was
+	// not created with VMA_ALLOCATION_CREATE_MAPPED_BIT.
+	void* mapped_pointer( Allocator const&, Buffer const& );
+
+	// Makes host writes to [aOffset,aOffset+aSize) of a mapped buffer visible
+	// to the device. A no-op for host-coherent memory.
+	void flush_buffer( Allocator const&, Buffer const&, VkDeviceSize aOffset = 0, VkDeviceSize aSize = VK_WHOLE_SIZE );
 }
@@ -14,6 +14,9 @@
 #include "vkutil.hpp"
 #include "vkbuffer.hpp"
 #include "to_string.hpp"
+#include "upload_queue.hpp"
+#include "image_decode.hpp"
+#include "block_compress.hpp"
 
 namespace
 {
@@ -122,619 +125,120 @@ namespace labutils
 		return 32-leadingZeros;
 	}
 
-	Image load_image_texture2d_no_minmap(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	bool supports_format_features(VulkanContext const& aContext, VkFormat aFormat, VkFormatFeatureFlags aFeatures)
 	{
-		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(aPattern, &baseWidthi, &baseHeighti, &baseChannelsi))
-		{
-			throw Error("%s: unable to get image information (%s)", aPattern,
-				stbi_failure_reason());
-		}
-
-		assert(baseWidthi > 0 && baseHeighti > 0);
-
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
-
-		// Create image
-		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
-
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(1);
-
-		// Load image data
-		int widthi, heighti, channelsi;
-		stbi_uc* data = stbi_load(aPattern, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-		if (!data)
-		{
-			throw Error("%s: unable to load image (%s)", aPattern, stbi_failure_reason());
-		}
-
-		assert(widthi > 0 && std::uint32_t(widthi) == width);
-		assert(heighti > 0 && std::uint32_t(heighti) == height);
-
-		auto const sizeInBytes = width * height * 4;
-
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-		}
-
-
-		// Copy data into buffer
-		std::memcpy(sptr, data, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// Free image data
-		stbi_image_free(data);
-
-		// Upload data from staging buffer into image
-		VkBufferImageCopy copy;
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource = VkImageSubresourceLayers{
-			VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-		copy.imageExtent = VkExtent3D{ width, height, 1 };
-		
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
-		}
-
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
-
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(aContext.physicalDevice, aFormat, &formatProperties);
 
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
-
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
-
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
-
-		return ret;
+		return aFeatures == (formatProperties.optimalTilingFeatures & aFeatures);
 	}
 
-	Image load_image_texture2d_with_bliting(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	Image load_image_texture2d_no_minmap(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue)
 	{
-		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(aPattern, &baseWidthi, &baseHeighti, &baseChannelsi))
-		{
-			throw Error("%s: unable to get image information (%s)", aPattern,
-				stbi_failure_reason());
-		}
-
-		assert(baseWidthi > 0 && baseHeighti > 0);
-
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
-
-		// Calculate miplevel
-		auto const mipLevels = compute_mip_level_count(baseWidth, baseHeight);
-
-		// Create image
-		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipLevels);
-
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
-
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
-
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(mipLevels);
-
-		// Load image data
-		int widthi, heighti, channelsi;
-		stbi_uc* data = stbi_load(aPattern, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-		if (!data)
-		{
-			throw Error("%s: unable to load image (%s)", aPattern, stbi_failure_reason());
-		}
-
-		assert(widthi > 0 && std::uint32_t(widthi) == width);
-		assert(heighti > 0 && std::uint32_t(heighti) == height);
-
-		auto const sizeInBytes = width * height * 4;
-
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-		}
-
-
-		// Copy data into buffer
-		std::memcpy(sptr, data, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// Free image data
-		stbi_image_free(data);
-
-		// Upload data from staging buffer into image
-		VkBufferImageCopy copy;
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource = VkImageSubresourceLayers{
-			VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-		copy.imageExtent = VkExtent3D{ width, height, 1 };
-
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-		// create variables for mipmap size
-		std::int32_t mipWidth = widthi;
-		std::int32_t mipHeight = heighti;
-
-		// generate mipmap texture
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			image_barrier(
-				cbuff, ret.image,
-				VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VkImageSubresourceRange{
-					VK_IMAGE_ASPECT_COLOR_BIT,
-					i - 1, 1,
-					0, 1
-				}
-			);
-
-			VkImageBlit blit{};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth >> 1 : 1, mipHeight > 1 ? mipHeight >> 1 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(cbuff, ret.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ret.image, 
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
-
-			image_barrier(
-				cbuff, ret.image,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VkImageSubresourceRange{
-					VK_IMAGE_ASPECT_COLOR_BIT,
-					i - 1, 1,
-					0, 1
-				}
-			);
-
-			// to prevent the bad situation when the size of texture is not a square
-			if (mipWidth > 1) mipWidth >>= 1;
-			if (mipHeight > 1) mipHeight >>= 1;
-		}
-
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				mipLevels-1, 1,
-				0, 1
-			}
-		);
-
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
-		}
-
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
-
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
-
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
-
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
-
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
-
+		return upload_image_texture2d(decode_image(aPattern), aAllocator, aQueue, false);
+	}
 
+	Image load_image_texture2d_with_bliting(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue)
+	{
+		return upload_image_texture2d(decode_image(aPattern), aAllocator, aQueue, true);
+	}
 
+	Image load_image_texture2d(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue)
+	{
+		return upload_image_texture2d(decode_image_levels(aPattern), aAllocator, aQueue, false);
+	}
 
+	Image upload_image_texture2d(DecodedImage const& aDecoded, Allocator const& aAllocator, UploadQueue& aQueue, bool aBlitMipmaps)
+	{
+		std::vector<ImageLevelData> levels;
+		for (auto const& level : aDecoded.levels)
+			levels.emplace_back(ImageLevelData{ level.width, level.height, level.pixels.get(), level.size_bytes() });
 
-		return ret;
-	
+		return upload_image_levels_texture2d(VK_FORMAT_R8G8B8A8_SRGB, levels, aAllocator, aQueue, aBlitMipmaps);
 	}
 
-	Image load_image_texture2d(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	Image upload_image_texture2d(CompressedImage const& aCompressed, Allocator const& aAllocator, UploadQueue& aQueue)
 	{
-		//TODO- (Section 4) implement me!
+		std::vector<ImageLevelData> levels;
+		for (auto const& level : aCompressed.levels)
+			levels.emplace_back(ImageLevelData{ level.width, level.height, level.blocks.data(), level.blocks.size() });
 
-		// Concat image file name
-		char baseName[4096];
-		if (int iret = std::snprintf(baseName, sizeof(baseName), aPattern, 0); iret < 0 || iret >= int(sizeof(baseName)))
-		{
-			throw Error("Pattern %s: unable to derive base image file name (%d).", aPattern, iret);
-		}
-
-		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(baseName, &baseWidthi, &baseHeighti, &baseChannelsi))
-		{
-			throw Error("%s: unable to get image information (%s)", baseName,
-				stbi_failure_reason());
-		}
+		return upload_image_levels_texture2d(block_format_srgb(aCompressed.format), levels, aAllocator, aQueue, false);
+	}
 
-		assert(baseWidthi > 0 && baseHeighti > 0);
+	Image upload_image_levels_texture2d(VkFormat aFormat, std::vector<ImageLevelData> const& aLevels, Allocator const& aAllocator, UploadQueue& aQueue, bool aBlitMipmaps)
+	{
+		assert(!aLevels.empty());
 
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
+		auto const baseWidth = aLevels[0].width;
+		auto const baseHeight = aLevels[0].height;
 
-		// Calculate miplevel
-		auto const mipLevels = compute_mip_level_count(baseWidth, baseHeight);
+		// Images that come with their levels are uploaded as they are
+		bool const blit = aBlitMipmaps && 1 == aLevels.size();
+		auto const decodedLevels = std::uint32_t(aLevels.size());
+		auto const mipLevels = blit ? compute_mip_level_count(baseWidth, baseHeight) : decodedLevels;
 
 		// Create image
-		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipLevels);
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (blit)
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
+		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, aFormat, usage, mipLevels);
 
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
+		// One staging region holds all levels. Level sizes are multiples of
+		// the texel block size, so all levels stay aligned to it.
+		VkDeviceSize sizeInBytes = 0;
+		for (auto const& level : aLevels)
+			sizeInBytes += level.size;
 
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
+		StagingRegion const staging = aQueue.stage(sizeInBytes, 16);
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
+		// Copy data into the region, and record where each level went
+		std::vector<VkBufferImageCopy> copies(decodedLevels);
 
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(mipLevels);
-		
-		for (std::uint32_t level = 0; level < mipLevels; ++level)
+		VkDeviceSize offset = 0;
+		for (std::uint32_t level = 0; level < decodedLevels; ++level)
 		{
-			// Get texture name for every level
-			char levelName[4096];
-			if (int iret = std::snprintf(levelName, sizeof(levelName), aPattern, level);
-				iret < 0 || iret >= int(sizeof(levelName)))
-			{
-				throw Error("Pattern %s: unable to derive level %u image file name (%d).",
-					aPattern, level, iret);
-			}
-
-			// Load image data
-			int widthi, heighti, channelsi;
-			stbi_uc* data = stbi_load(levelName, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-			if (!data)
-			{
-				throw Error("%s: unable to load image for level %u (%s)", levelName, level, stbi_failure_reason());
-			}
-
-			assert(widthi > 0 && std::uint32_t(widthi) == width);
-			assert(heighti > 0 && std::uint32_t(heighti) == height);
+			auto const& decoded = aLevels[level];
+			std::memcpy(staging.data + offset, decoded.data, decoded.size);
 
-			auto const sizeInBytes = width * height * 4;
-
-			// Create staging buffer for every level!!
-			auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-			// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-			void* sptr = nullptr;
-			if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-			{
-				throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-			}
-
-
-			// Copy data into buffer
-			std::memcpy(sptr, data, sizeInBytes);
-
-			// Unmapping memory
-			vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-			// Free image data
-			stbi_image_free(data);
-
-			// Upload data from staging buffer into image
-			VkBufferImageCopy copy;
-			copy.bufferOffset = 0;
+			auto& copy = copies[level];
+			copy.bufferOffset = offset;
 			copy.bufferRowLength = 0;
 			copy.bufferImageHeight = 0;
 			copy.imageSubresource = VkImageSubresourceLayers{
 				VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
 			copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-			copy.imageExtent = VkExtent3D{ width, height, 1 };
-
-			vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-			width >>= 1;
-			if (0 == width)
-				width = 1;
-
-			height >>= 1;
-			if (0 == height)
-				height = 1;
-		}
+			copy.imageExtent = VkExtent3D{ decoded.width, decoded.height, 1 };
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
+			offset += decoded.size;
 		}
 
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
-
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
-
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
-
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
-
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
+		// The queue records the copy and the layout transitions into its
+		// current batch; blitted levels are generated on the graphics queue.
+		// The image is ready once the batch has completed (see
+		// UploadQueue::ticket()).
+		aQueue.copy_to_image(staging, ret.image, mipLevels, copies, blit);
 
 		return ret;
 	}
 
-	Image create_image_texture2d_with_solid_color(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator, glm::vec4 inColor)
+	Image create_image_texture2d_with_solid_color(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue, glm::vec4 inColor)
 	{
 
 		// Create image
 		Image ret = create_image_texture2d(aAllocator, 1, 1, VK_FORMAT_R8G8B8A8_SRGB,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
-
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
 		// update data into mip level
-		std::vector<Buffer> stagingBuffers(1);
-
 		auto const sizeInBytes = 4;
 
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-		}
-
+		StagingRegion const staging = aQueue.stage(sizeInBytes, 4);
 
 		// Copy data into buffer
 		const char color[4] = {inColor[0] * 255, inColor[1] * 255, inColor[2] * 255, inColor[3] * 255 };
 		
-		std::memcpy(sptr, color, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
+		std::memcpy(staging.data, color, sizeInBytes);
 
 		// Upload data from staging buffer into image
 		VkBufferImageCopy copy;
@@ -746,55 +250,7 @@ namespace labutils
 		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
 		copy.imageExtent = VkExtent3D{ 1, 1, 1 };
 
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
-		}
-
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
-
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
-
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
-
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
-
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
+		aQueue.copy_to_image(staging, ret.image, 1, { copy });
 
 		return ret;
 	}
@@ -3,6 +3,7 @@
 #include <volk/volk.h>
 #include <vk_mem_alloc.h>
 #include <glm/glm.hpp>
+#include <vector>
 #include <utility>
 
 #include <cassert>
@@ -11,6 +12,10 @@
 
 namespace labutils
 {
+	class UploadQueue;
+	struct DecodedImage;
+	struct CompressedImage;
+
 	class Image
 	{
 		public:
@@ -32,13 +37,43 @@ namespace labutils
 			VmaAllocator mAllocator = VK_NULL_HANDLE;
 	};
 
-	Image load_image_texture2d(char const* aPattern, VulkanContext const&, VkCommandPool, Allocator const&);
-	Image load_image_texture2d_with_bliting(char const* aPattern, VulkanContext const&, VkCommandPool, Allocator const&);
-	Image load_image_texture2d_no_minmap(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator);
+	// Texture uploads go through an UploadQueue: the returned image can be
+	// used once the queue's current batch has completed (see
+	// UploadQueue::ticket()).
+	Image load_image_texture2d(char const* aPattern, Allocator const&, UploadQueue&);
+	Image load_image_texture2d_with_bliting(char const* aPattern, Allocator const&, UploadQueue&);
+	Image load_image_texture2d_no_minmap(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue);
+
+	// Uploads a decoded image (see image_decode.hpp). If aBlitMipmaps is set
+	// and the image has a single level, the remaining levels are generated
+	// on the GPU.
+	Image upload_image_texture2d(DecodedImage const&, Allocator const&, UploadQueue&, bool aBlitMipmaps);
+
+	// Uploads a block-compressed image (see block_compress.hpp) with all its
+	// levels
+	Image upload_image_texture2d(CompressedImage const&, Allocator const&, UploadQueue&);
+
+	// The data of one level, tightly packed (for block-compressed formats,
+	// in whole blocks)
+	struct ImageLevelData
+	{
+		std::uint32_t width, height;
+		void const* data;
+		std::size_t size;
+	};
+
+	// Uploads the levels of an image in aFormat through a single staging
+	// region and copy (see UploadQueue::copy_to_image()). aBlitMipmaps is as
+	// for upload_image_texture2d(); the format must then support linear
+	// filtering and blits.
+	Image upload_image_levels_texture2d(VkFormat, std::vector<ImageLevelData> const&, Allocator const&, UploadQueue&, bool aBlitMipmaps = false);
 
-	Image create_image_texture2d_with_solid_color(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator, glm::vec4 inColor);
+	Image create_image_texture2d_with_solid_color(char const* aPattern, Allocator const& aAllocator, UploadQueue& aQueue, glm::vec4 inColor);
 
 	Image create_image_texture2d( Allocator const&, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat, VkImageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, std::uint32_t mipLevels = 1);
 
 	std::uint32_t compute_mip_level_count( std::uint32_t aWidth, std::uint32_t aHeight );
+
+	// True if images with optimal tiling in aFormat support all of aFeatures
+	bool supports_format_features(VulkanContext const&, VkFormat, VkFormatFeatureFlags aFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 }
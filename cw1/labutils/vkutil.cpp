@@ -101,11 +101,16 @@ namespace labutils
 
 
 	CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags )
+	{
+		return create_command_pool( aContext, aContext.graphicsFamilyIndex, aFlags );
+	}
+
+	CommandPool create_command_pool( VulkanContext const& aContext, std::uint32_t aQueueFamilyIndex, VkCommandPoolCreateFlags aFlags )
 	{
 		//DONE: implement me!
 		VkCommandPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		poolInfo.queueFamilyIndex = aContext.graphicsFamilyIndex;
+		poolInfo.queueFamilyIndex = aQueueFamilyIndex;
 		poolInfo.flags = aFlags;
 
 		VkCommandPool cpool = VK_NULL_HANDLE;
@@ -189,6 +194,30 @@ namespace labutils
 		return Semaphore(aContext.device, semaphore);
 	}
 
+	Semaphore create_timeline_semaphore( VulkanContext const& aContext, std::uint64_t aInitialValue )
+	{
+		assert( aContext.timelineSemaphores );
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = aInitialValue;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		if( auto const res = vkCreateSemaphore( aContext.device, &semaphoreInfo, nullptr, &semaphore ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to create timeline semaphore\n"
+				"vkCreateSemaphore() returned %s", to_string(res).c_str()
+			);
+		}
+
+		return Semaphore( aContext.device, semaphore );
+	}
+
 	void buffer_barrier(
 		VkCommandBuffer aCmdBuff,
 		VkBuffer aBuffer,
@@ -221,7 +250,8 @@ namespace labutils
 		VkDescriptorPoolSize const pools[] = {
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aMaxDescriptors}, // each containing a descriptor type and number of 
 																  // descriptors of that type to be allocated in the pool
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors}
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, aMaxDescriptors}
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo{};
@@ -303,7 +333,7 @@ namespace labutils
 		return ImageView(aContext.device, view);
 	}
 
-	Sampler create_default_sampler(VulkanContext const& aContext, VkBool32 useAnisotropy)
+	VkSamplerCreateInfo default_sampler_info(VulkanContext const& aContext, VkBool32 useAnisotropy)
 	{
 
 		VkPhysicalDeviceFeatures features{};
@@ -327,7 +357,14 @@ namespace labutils
 		samplerInfo.mipLodBias = 0.f;
 		samplerInfo.anisotropyEnable = features.samplerAnisotropy?useAnisotropy:VK_FALSE;
 		samplerInfo.maxAnisotropy = props.limits.maxSamplerAnisotropy;
-		
+
+		return samplerInfo;
+	}
+
+	Sampler create_default_sampler(VulkanContext const& aContext, VkBool32 useAnisotropy)
+	{
+		VkSamplerCreateInfo const samplerInfo = default_sampler_info(aContext, useAnisotropy);
+
 		// create sampler
 		VkSampler sampler = VK_NULL_HANDLE;
 
@@ -10,11 +10,15 @@ namespace labutils
 	ShaderModule load_shader_module( VulkanContext const&, char const* aSpirvPath );
 
 	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0 );
+	CommandPool create_command_pool( VulkanContext const&, std::uint32_t aQueueFamilyIndex, VkCommandPoolCreateFlags );
 	VkCommandBuffer alloc_command_buffer( VulkanContext const&, VkCommandPool );
 
 	Fence create_fence( VulkanContext const&, VkFenceCreateFlags = 0 );
 	Semaphore create_semaphore( VulkanContext const& );
 
+	// Requires VulkanContext::timelineSemaphores
+	Semaphore create_timeline_semaphore( VulkanContext const&, std::uint64_t aInitialValue = 0 );
+
 
 	void buffer_barrier(
 		VkCommandBuffer,
@@ -46,5 +50,7 @@ namespace labutils
 	
 	ImageView create_image_view_texture2d(VulkanContext const&, VkImage, VkFormat);
 
+	// Trilinear, repeating sampler; anisotropic filtering is only enabled if the device supports it
+	VkSamplerCreateInfo default_sampler_info(VulkanContext const&, VkBool32 useAnisotropy);
 	Sampler create_default_sampler(VulkanContext const&, VkBool32 useAnisotropy);
 }
@@ -51,6 +51,12 @@ namespace labutils
 		, device( std::exchange( aOther.device, VK_NULL_HANDLE ) )
 		, graphicsFamilyIndex( aOther.graphicsFamilyIndex )
 		, graphicsQueue( std::exchange( aOther.graphicsQueue, VK_NULL_HANDLE ) )
+		, transferFamilyIndex( aOther.transferFamilyIndex )
+		, transferQueue( std::exchange( aOther.transferQueue, VK_NULL_HANDLE ) )
+		, timelineSemaphores( aOther.timelineSemaphores )
+		, descriptorIndexing( aOther.descriptorIndexing )
+		, multiDrawIndirect( aOther.multiDrawIndirect )
+		, drawIndirectCount( aOther.drawIndirectCount )
 		, debugMessenger( std::exchange( aOther.debugMessenger, VK_NULL_HANDLE ) )
 	{}
 
@@ -72,6 +78,12 @@ namespace labutils
 		std::swap( device, aOther.device );
 		std::swap( graphicsFamilyIndex, aOther.graphicsFamilyIndex );
 		std::swap( graphicsQueue, aOther.graphicsQueue );
+		std::swap( transferFamilyIndex, aOther.transferFamilyIndex );
+		std::swap( transferQueue, aOther.transferQueue );
+		std::swap( timelineSemaphores, aOther.timelineSemaphores );
+		std::swap( descriptorIndexing, aOther.descriptorIndexing );
+		std::swap( multiDrawIndirect, aOther.multiDrawIndirect );
+		std::swap( drawIndirectCount, aOther.drawIndirectCount );
 		std::swap( debugMessenger, aOther.debugMessenger );
 		return *this;
 	}
@@ -156,6 +168,10 @@ namespace labutils
 
 		assert( VK_NULL_HANDLE != ret.graphicsQueue );
 
+		// Uploads share the graphics queue
+		ret.transferFamilyIndex = ret.graphicsFamilyIndex;
+		ret.transferQueue = ret.graphicsQueue;
+
 		// Done
 		return ret;
 	}
@@ -28,6 +28,29 @@ namespace labutils
 			std::uint32_t graphicsFamilyIndex = 0;
 			VkQueue graphicsQueue = VK_NULL_HANDLE;
 
+			// Queue for uploads (see UploadQueue): one from a family with
+			// TRANSFER but without GRAPHICS if the device has one, otherwise
+			// the graphics queue.
+			std::uint32_t transferFamilyIndex = 0;
+			VkQueue transferQueue = VK_NULL_HANDLE;
+
+			// VK_KHR_timeline_semaphore (core in Vulkan 1.2) is enabled
+			bool timelineSemaphores = false;
+
+			// Descriptor indexing (VK_EXT_descriptor_indexing, core in Vulkan
+			// 1.2) is enabled with what BindlessTextures needs: runtime
+			// descriptor arrays, non-uniform indexing, and partially bound
+			// and update-after-bind sampled images
+			bool descriptorIndexing = false;
+
+			// multiDrawIndirect is enabled, i.e. indirect draws may have a
+			// drawCount greater than one
+			bool multiDrawIndirect = false;
+
+			// VK_KHR_draw_indirect_count is enabled, i.e. indirect draws may
+			// read their draw count from a buffer
+			bool drawIndirectCount = false;
+
 			
 			//bool haveDebugUtils = false;
 			VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
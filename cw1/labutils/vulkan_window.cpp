@@ -24,11 +24,17 @@ namespace
 	float score_device( VkPhysicalDevice, VkSurfaceKHR );
 
 	std::optional<std::uint32_t> find_queue_family( VkPhysicalDevice, VkQueueFlags, VkSurfaceKHR = VK_NULL_HANDLE );
+	std::optional<std::uint32_t> find_dedicated_queue_family( VkPhysicalDevice, VkQueueFlags, VkQueueFlags aExcludedFlags );
+
+	bool supports_timeline_semaphores( VkPhysicalDevice );
+	bool supports_descriptor_indexing( VkPhysicalDevice );
 
 	VkDevice create_device( 
 		VkPhysicalDevice,
 		std::vector<std::uint32_t> const& aQueueFamilies,
-		std::vector<char const*> const& aEnabledDeviceExtensions = {}
+		std::vector<char const*> const& aEnabledDeviceExtensions = {},
+		bool aTimelineSemaphores = false,
+		bool aDescriptorIndexing = false
 	);
 
 	std::vector<VkSurfaceFormatKHR> get_surface_formats( VkPhysicalDevice, VkSurfaceKHR );
@@ -253,6 +259,43 @@ namespace labutils
 		//DONE: list necessary extensions here
 		enabledDevExensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		// Timeline semaphores (see UploadQueue); the device selection ensures
+		// that they are supported. They are core in Vulkan 1.2.
+		ret.timelineSemaphores = supports_timeline_semaphores( ret.physicalDevice );
+		{
+			VkPhysicalDeviceProperties props;
+			vkGetPhysicalDeviceProperties( ret.physicalDevice, &props );
+			if( VK_API_VERSION_MINOR( props.apiVersion ) < 2 && VK_API_VERSION_MAJOR( props.apiVersion ) == 1 )
+				enabledDevExensions.emplace_back( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME );
+		}
+
+		// Bindless textures (see BindlessTextures), if available; optional
+		ret.descriptorIndexing = supports_descriptor_indexing( ret.physicalDevice );
+		if( ret.descriptorIndexing )
+		{
+			VkPhysicalDeviceProperties props;
+			vkGetPhysicalDeviceProperties( ret.physicalDevice, &props );
+			if( VK_API_VERSION_MINOR( props.apiVersion ) < 2 && VK_API_VERSION_MAJOR( props.apiVersion ) == 1 )
+				enabledDevExensions.emplace_back( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+		}
+
+		// Multi-draw indirect, if available; optional (see create_device())
+		{
+			VkPhysicalDeviceFeatures features{};
+			vkGetPhysicalDeviceFeatures( ret.physicalDevice, &features );
+			ret.multiDrawIndirect = VK_TRUE == features.multiDrawIndirect;
+		}
+
+		// Indirect draws with a GPU-written count, e.g. for GPU culling; optional.
+		// The extension is used on Vulkan 1.2 devices as well, where enabling it
+		// also enables the functionality.
+		{
+			auto const exts = lut::detail::get_device_extensions( ret.physicalDevice );
+			ret.drawIndirectCount = 0 != exts.count( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+			if( ret.drawIndirectCount )
+				enabledDevExensions.emplace_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+		}
+
 		for( auto const& ext : enabledDevExensions )
 			std::fprintf( stderr, "Enabling device extension: %s\n", ext );
 
@@ -287,7 +330,20 @@ namespace labutils
 			queueFamilyIndices.emplace_back(*present);
 		}
 
-		ret.device = create_device( ret.physicalDevice, queueFamilyIndices, enabledDevExensions );
+		// Uploads use a separate family with TRANSFER (but without GRAPHICS)
+		// if there is one, preferably one that does not do COMPUTE either.
+		// These typically map to the GPU's copy engines.
+		std::vector<std::uint32_t> deviceQueueFamilies = queueFamilyIndices;
+
+		auto transfer = find_dedicated_queue_family( ret.physicalDevice, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT );
+		if( !transfer )
+			transfer = find_dedicated_queue_family( ret.physicalDevice, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT );
+
+		ret.transferFamilyIndex = transfer ? *transfer : ret.graphicsFamilyIndex;
+		if( transfer && deviceQueueFamilies.end() == std::find( deviceQueueFamilies.begin(), deviceQueueFamilies.end(), *transfer ) )
+			deviceQueueFamilies.emplace_back( *transfer );
+
+		ret.device = create_device( ret.physicalDevice, deviceQueueFamilies, enabledDevExensions, ret.timelineSemaphores, ret.descriptorIndexing );
 
 		// Retrieve VkQueues
 		vkGetDeviceQueue( ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue );
@@ -304,6 +360,16 @@ namespace labutils
 			ret.presentQueue = ret.graphicsQueue;
 		}
 
+		if( ret.transferFamilyIndex != ret.graphicsFamilyIndex )
+			vkGetDeviceQueue( ret.device, ret.transferFamilyIndex, 0, &ret.transferQueue );
+		else
+			ret.transferQueue = ret.graphicsQueue;
+
+		{
+			char const* const kind = ret.transferFamilyIndex == ret.graphicsFamilyIndex ? "shared with graphics" : "dedicated";
+			std::fprintf( stderr, "Upload queue family: %u (%s)\n", ret.transferFamilyIndex, kind );
+		}
+
 		// Create swap chain
 		std::tie(ret.swapchain, ret.swapchainFormat, ret.swapchainExtent) = create_swapchain( ret.physicalDevice, ret.surface, ret.device, ret.window, queueFamilyIndices );
 		
@@ -654,7 +720,81 @@ namespace
 		return {};
 	}
 
-	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions )
+	// Finds a queue family with all of aQueueFlags and none of aExcludedFlags.
+	// Unlike find_queue_family(), this can find e.g. a dedicated TRANSFER
+	// family.
+	std::optional<std::uint32_t> find_dedicated_queue_family( VkPhysicalDevice aPhysicalDev, VkQueueFlags aQueueFlags, VkQueueFlags aExcludedFlags )
+	{
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, families.data() );
+
+		for( std::uint32_t i = 0; i < numQueues; ++i )
+		{
+			auto const flags = families[i].queueFlags;
+			if( aQueueFlags == (aQueueFlags & flags) && 0 == (aExcludedFlags & flags) )
+				return i;
+		}
+
+		return {};
+	}
+
+	bool supports_timeline_semaphores( VkPhysicalDevice aPhysicalDev )
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+		// Vulkan 1.1 devices need the extension
+		if( VK_API_VERSION_MAJOR( props.apiVersion ) == 1 && VK_API_VERSION_MINOR( props.apiVersion ) < 2 )
+		{
+			auto const exts = lut::detail::get_device_extensions( aPhysicalDev );
+			if( !exts.count( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) )
+				return false;
+		}
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &timelineFeatures;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+		return VK_TRUE == timelineFeatures.timelineSemaphore;
+	}
+
+	bool supports_descriptor_indexing( VkPhysicalDevice aPhysicalDev )
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+		// Vulkan 1.1 devices need the extension (its dependency,
+		// VK_KHR_maintenance3, is core in 1.1)
+		if( VK_API_VERSION_MAJOR( props.apiVersion ) == 1 && VK_API_VERSION_MINOR( props.apiVersion ) < 2 )
+		{
+			auto const exts = lut::detail::get_device_extensions( aPhysicalDev );
+			if( !exts.count( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ) )
+				return false;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+		indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &indexingFeatures;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+		return VK_TRUE == features.features.shaderSampledImageArrayDynamicIndexing
+			&& VK_TRUE == indexingFeatures.shaderSampledImageArrayNonUniformIndexing
+			&& VK_TRUE == indexingFeatures.runtimeDescriptorArray
+			&& VK_TRUE == indexingFeatures.descriptorBindingPartiallyBound
+			&& VK_TRUE == indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+	}
+
+	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions, bool aTimelineSemaphores, bool aDescriptorIndexing )
 	{
 		if( aQueues.empty() )
 			throw lut::Error( "create_device(): no queues requested" );
@@ -671,12 +811,51 @@ namespace
 			queueInfo.pQueuePriorities  = queuePriorities;
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures( aPhysicalDev, &supportedFeatures );
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
-		// No extra features for now.
-		
+		// Block-compressed textures (see block_compress.hpp), where available
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		// Mip feedback for texture streaming (required, see score_device())
+		deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+		// Indexing the bindless texture array (see supports_descriptor_indexing())
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = aDescriptorIndexing ? VK_TRUE : VK_FALSE;
+		// Indirect draws select their per-draw data with firstInstance (required, see score_device()), and go out as
+		// one call per batch where multi-draw is available
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+		// Feature structures are chained as requested
+		void* features = nullptr;
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineFeatures.timelineSemaphore = VK_TRUE;
+
+		if( aTimelineSemaphores )
+		{
+			timelineFeatures.pNext = features;
+			features = &timelineFeatures;
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+		indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+		if( aDescriptorIndexing )
+		{
+			indexingFeatures.pNext = features;
+			features = &indexingFeatures;
+		}
+
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext  = features;
 
 		deviceInfo.queueCreateInfoCount     = std::uint32_t(queueInfos.size());
 		deviceInfo.pQueueCreateInfos        = queueInfos.data();
@@ -752,6 +931,30 @@ namespace
 
 		}
 
+		// Uploads are tracked with timeline semaphores (see UploadQueue)
+		if (!supports_timeline_semaphores(aPhysicalDev))
+		{
+			std::fprintf(stderr, "Info: Discarding device '%s': no timeline semaphores\n", props.deviceName);
+			return -1.f;
+		}
+
+		// Texture streaming writes mip feedback from the fragment shader (see TextureStreamer)
+		VkPhysicalDeviceFeatures features{};
+		vkGetPhysicalDeviceFeatures(aPhysicalDev, &features);
+
+		if (VK_TRUE != features.fragmentStoresAndAtomics)
+		{
+			std::fprintf(stderr, "Info: Discarding device '%s': no fragment stores and atomics\n", props.deviceName);
+			return -1.f;
+		}
+
+		// Indirect draws index the per-draw data with firstInstance
+		if (VK_TRUE != features.drawIndirectFirstInstance)
+		{
+			std::fprintf(stderr, "Info: Discarding device '%s': no indirect draws with a first instance\n", props.deviceName);
+			return -1.f;
+		}
+
 		// Discrete GPU > Integrated GPU > others
 		float score = 0.f;
 
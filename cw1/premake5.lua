@@ -85,10 +85,19 @@ project "cw1"
 
 	dependson "x-glm" 
 
+	-- gcc/clang get AVX2 from -march=native; without this, MSVC builds the
+	-- culling kernels (bounds_cull.cpp, occlusion_cull.cpp) for SSE2 only.
+	-- Only cw1 itself needs it; the libraries keep their SSE2 baseline.
+	filter "toolset:msc-*"
+		vectorextensions "AVX2"
+
+	filter "*"
+
 project "cw1-shaders"
 	local shaders = { 
 		"cw1/shaders/*.vert",
-		"cw1/shaders/*.frag"
+		"cw1/shaders/*.frag",
+		"cw1/shaders/*.comp"
 	}
 
 	kind "Utility"